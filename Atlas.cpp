@@ -0,0 +1,320 @@
+// Name: Atlas.cpp
+// Description: Module implementation of the Julia set atlas renderer.
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "Atlas.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Namespaces
+using namespace std;
+
+// ATLAS SCHEDULE STRUCTURE
+// Parts: iNextGroup - Lock-free counter of the next group of thumbnails to hand
+//                     to a worker.
+//        iGroups - The number of groups (iKERNEL_LANES thumbnails each, in row
+//                  major order, the last one maybe fewer).
+//        iColumns, iRows - The number of thumbnails across and down the image.
+//        iThumbnailSize - The width and height of each thumbnail (those on the
+//                         right and bottom edges may be cut off).
+//        iWidth, iHeight - The size of the image.
+//        iMax_Iterations - The escape time limit of each pixel.
+//        sOptions - The render options.
+//        vZReal - The real part of the starting z of each column of a
+//                 thumbnail (and, the thumbnails being square, the imaginary
+//                 part of each row).
+//        pWeights - The row major color weights the workers draw into.
+//        pProgress - The progress counter bumped for each finished group.
+//        pStats - The statistics of the render.  Each worker only touches its
+//                 own entry of pStats->vWorkers.
+////////////////////////////////////////////////////////////////////////////////
+struct sAtlasSchedule
+{
+    atomic< int > iNextGroup;
+    int iGroups;
+    int iColumns;
+    int iRows;
+    int iThumbnailSize;
+    int iWidth;
+    int iHeight;
+    int iMax_Iterations;
+    sRenderOptions sOptions;
+    vector< double > vZReal;
+    vector< float > *pWeights;
+    sProgress *pProgress;
+    sRenderStats *pStats;
+};
+
+// Description: Works out the c whose Julia set a thumbnail shows: the point of
+//              the view under the center of the thumbnail, placed the way the
+//              escape time renders place their pixels.
+// Parameters: iWidth, iHeight - The size of the image.
+//             sOptions - The render options (iAtlasSize is the size of the
+//                        thumbnails).
+//             iThumbnail - The index of the thumbnail (row major).
+//             dCReal, dCImag - Set to c.
+////////////////////////////////////////////////////////////////////////////////
+void Get_Atlas_Parameter( const int iWidth,
+			  const int iHeight,
+			  const sRenderOptions &sOptions,
+			  const int iThumbnail,
+			  double &dCReal,
+			  double &dCImag )
+{
+    // Local Variables
+    const sViewport &sView = sOptions.sView;
+    const int iSize = sOptions.iAtlasSize;
+    const int iColumns = ( iWidth + iSize - 1 ) / iSize;
+    const double dX = (double)( iThumbnail % iColumns * iSize ) + (double)( iSize - 1 ) / 2.0;
+    const double dY = (double)( iThumbnail / iColumns * iSize ) + (double)( iSize - 1 ) / 2.0;
+
+    dCReal = sView.dXMin + dX / max( (double)( iWidth ) - 1.0, 1.0 ) * ( sView.dXMax - sView.dXMin );
+    dCImag = sView.dYMin + dY / max( (double)( iHeight ) - 1.0, 1.0 ) * ( sView.dYMax - sView.dYMin );
+}
+
+// Description: Turns the escape time of a pixel into its color weight: the
+//              iteration count (or the continuous escape time when coloring
+//              smoothly) over the iteration limit, and 1 inside the set.
+////////////////////////////////////////////////////////////////////////////////
+static inline float Get_Atlas_Weight( const sAtlasSchedule &sSchedule,
+				      const int iterations,
+				      const float fSmooth )
+{
+    if( iterations >= sSchedule.iMax_Iterations )
+	return 1.0f;
+
+    if( sSchedule.sOptions.eColoring == eCOLOR_LINEAR )
+	return (float)( iterations ) / (float)( sSchedule.iMax_Iterations );
+
+    return min( fSmooth / (float)( sSchedule.iMax_Iterations ), 1.0f );
+}
+
+// Description: Draws one group of up to iKERNEL_LANES thumbnails.
+// Method: First the c of every thumbnail of the group is run through the
+//         formula's own escape time kernel (z starting at 0), all in one set
+//         of lanes.  When the orbit of 0 escapes, c is outside the set and
+//         the Julia set is a dust with nothing inside it, so the thumbnail is
+//         left at weight 0 without drawing it.  The rest of the thumbnails
+//         take a lane each and are drawn together, a row at a time: every
+//         pixel of the row is run for all of them at once (Get_Julia_Row),
+//         and the lanes' results are scattered to their thumbnails.  Lanes
+//         left over repeat the last thumbnail.  Rows and columns cut off by
+//         the edge of the image are only drawn while a thumbnail of the
+//         group still shows them.
+// Parameters: sSchedule - The shared schedule of the render.
+//             iGroup - The group to draw.
+//             iWorker - The index of the worker drawing it.
+//             vIterations, vSmooth - Scratch space for a row of every lane.
+////////////////////////////////////////////////////////////////////////////////
+void Draw_Atlas_Group( sAtlasSchedule &sSchedule,
+		       const int iGroup,
+		       const int iWorker,
+		       vector< int > &vIterations,
+		       vector< float > &vSmooth )
+{
+    // Local Variables
+    const int iSize = sSchedule.iThumbnailSize;
+    const int iFirst = iGroup * iKERNEL_LANES;
+    const int iThumbnails = min( iKERNEL_LANES, sSchedule.iColumns * sSchedule.iRows - iFirst );
+    const bool bSmooth = ( sSchedule.sOptions.eColoring != eCOLOR_LINEAR );
+    sIterationFormula sParameter = sSchedule.sOptions.sFormula;
+    vector< float > &vWeights = *sSchedule.pWeights;
+    sWorkerStats &sWorker = sSchedule.pStats->vWorkers[ iWorker ];
+    sTileStats sTile = { 0, 0, 0, 0, iWorker, 0, 0, 0, 0.0, 0.0 };
+    chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+    double dCReal[ iKERNEL_LANES ];
+    double dCImag[ iKERNEL_LANES ];
+    int iLaneIterations[ iKERNEL_LANES ];
+    int iLaneX[ iKERNEL_LANES ];
+    int iLaneY[ iKERNEL_LANES ];
+    int iLanes = 0;
+    int iDrawWidth = 0;
+    int iDrawHeight = 0;
+    long long llPixels = 0;
+
+    TRACE_SPAN( "thumbnails", "compute" );
+
+    sTile.iX = iFirst % sSchedule.iColumns * iSize;
+    sTile.iY = iFirst / sSchedule.iColumns * iSize;
+    sTile.iWidth = iThumbnails * iSize;
+    sTile.iHeight = iSize;
+
+    for( int t = 0; t < iKERNEL_LANES; ++t )
+	Get_Atlas_Parameter( sSchedule.iWidth, sSchedule.iHeight, sSchedule.sOptions,
+			     iFirst + min( t, iThumbnails - 1 ), dCReal[ t ], dCImag[ t ] );
+
+    // Only thumbnails whose c is in the set have anything to draw.
+    sParameter.bJulia = false;
+    Get_Escape_Lanes( sParameter, dCReal, dCImag, sSchedule.iMax_Iterations, iLaneIterations );
+
+    for( int t = 0; t < iThumbnails; ++t )
+    {
+	// Local Variables
+	const int iX = ( iFirst + t ) % sSchedule.iColumns * iSize;
+	const int iY = ( iFirst + t ) / sSchedule.iColumns * iSize;
+	const int iWidth = min( iSize, sSchedule.iWidth - iX );
+	const int iHeight = min( iSize, sSchedule.iHeight - iY );
+
+	llPixels += (long long)( iWidth ) * iHeight;
+
+	if( iLaneIterations[ t ] < sSchedule.iMax_Iterations )
+	{
+	    sTile.llEscaped += (long long)( iWidth ) * iHeight;
+	    sWorker.vHistogram[ Get_Histogram_Bucket( 0 ) ] += (long long)( iWidth ) * iHeight;
+	    continue;
+	}
+
+	dCReal[ iLanes ] = dCReal[ t ];
+	dCImag[ iLanes ] = dCImag[ t ];
+	iLaneX[ iLanes ] = iX;
+	iLaneY[ iLanes ] = iY;
+	iDrawWidth = max( iDrawWidth, iWidth );
+	iDrawHeight = max( iDrawHeight, iHeight );
+	++iLanes;
+    }
+
+    if( iLanes > 0 )
+	for( int l = iLanes; l < iKERNEL_LANES; ++l )
+	{
+	    dCReal[ l ] = dCReal[ iLanes - 1 ];
+	    dCImag[ l ] = dCImag[ iLanes - 1 ];
+	}
+
+    for( int v = 0; v < iDrawHeight; ++v )
+    {
+	Get_Julia_Row( sSchedule.sOptions.sFormula, &sSchedule.vZReal[ 0 ], sSchedule.vZReal[ v ],
+		       iDrawWidth, dCReal, dCImag, sSchedule.iMax_Iterations, &vIterations[ 0 ],
+		       bSmooth ? &vSmooth[ 0 ] : NULL );
+
+	for( int l = 0; l < iLanes; ++l )
+	{
+	    // Local Variables
+	    const int y = iLaneY[ l ] + v;
+	    const int iWidth = min( iDrawWidth, sSchedule.iWidth - iLaneX[ l ] );
+
+	    if( y >= sSchedule.iHeight )
+		continue;
+
+	    for( int u = 0; u < iWidth; ++u )
+	    {
+		// Local Variables
+		const int iterations = vIterations[ u * iKERNEL_LANES + l ];
+
+		vWeights[ (size_t)( y ) * sSchedule.iWidth + iLaneX[ l ] + u ] =
+		    Get_Atlas_Weight( sSchedule, iterations, bSmooth ? vSmooth[ u * iKERNEL_LANES + l ] : 0.0f );
+		sTile.llIterations += iterations;
+		++sWorker.vHistogram[ Get_Histogram_Bucket( iterations ) ];
+
+		if( iterations >= sSchedule.iMax_Iterations )
+		    ++sTile.llCapped;
+		else
+		    ++sTile.llEscaped;
+	    }
+	}
+    }
+
+    sTile.dKernelSeconds = Get_Seconds( tStart, chrono::steady_clock::now() );
+    sWorker.vTiles.push_back( sTile );
+    sWorker.dBusySeconds += sTile.dKernelSeconds;
+
+    Add_Progress( *sSchedule.pProgress, llPixels );
+}
+
+// Description: Body of each worker thread.
+// Method: Keep pulling the next group of thumbnails off of the shared counter
+//         and drawing it until every group has been handed out.
+// Parameters: pSchedule - The shared schedule of the render.
+//             iWorker - The index of this worker.
+////////////////////////////////////////////////////////////////////////////////
+void Atlas_Worker( sAtlasSchedule *pSchedule, const int iWorker )
+{
+    // Local Variables
+    vector< int > vIterations( (size_t)( pSchedule->iThumbnailSize ) * iKERNEL_LANES );
+    vector< float > vSmooth( (size_t)( pSchedule->iThumbnailSize ) * iKERNEL_LANES );
+    int iGroup = pSchedule->iNextGroup.fetch_add( 1 );
+
+    Set_Trace_Thread_Name( "worker", iWorker );
+
+    while( iGroup < pSchedule->iGroups )
+    {
+	Draw_Atlas_Group( *pSchedule, iGroup, iWorker, vIterations, vSmooth );
+	iGroup = pSchedule->iNextGroup.fetch_add( 1 );
+    }
+}
+
+// Description: Draws a Julia set atlas on the worker threads.
+// Method: The image is split into square thumbnails of sOptions.iAtlasSize
+//         pixels, each showing the Julia set (of sOptions.sFormula) of the c
+//         under its center (Get_Atlas_Parameter).  The thumbnails are handed
+//         out to the workers in groups of iKERNEL_LANES neighbours, so the
+//         vector kernel's lanes are spread over thumbnails rather than over
+//         the pixels of one (see Draw_Atlas_Group), and those whose Julia set
+//         is empty are skipped.  The escape times are turned into color
+//         weights by linear or smooth coloring; histogram and distance
+//         coloring fall back to smooth.
+// Parameters: iWidth, iHeight - The size of the image.
+//             iMax_Iterations - The escape time limit of each pixel (and of
+//                               the test of each thumbnail's c).
+//             sOptions - The render options.
+//             vWeights - Filled with the row major color weights (0 to 1).
+//             sReport - The progress of the render.
+//             sStats - Filled with the statistics of the render.  Each group
+//                      of thumbnails shows up as a tile as wide as the
+//                      thumbnails in it.
+////////////////////////////////////////////////////////////////////////////////
+void Render_Atlas( const int iWidth,
+		   const int iHeight,
+		   const int iMax_Iterations,
+		   const sRenderOptions &sOptions,
+		   vector< float > &vWeights,
+		   sProgress &sReport,
+		   sRenderStats &sStats )
+{
+    // Local Variables
+    const int iSize = max( sOptions.iAtlasSize, 2 );
+    vector< thread > vWorkers;
+    sAtlasSchedule sSchedule;
+    int iThreads = sOptions.iThreads;
+
+    sSchedule.iThumbnailSize = iSize;
+    sSchedule.iColumns = ( iWidth + iSize - 1 ) / iSize;
+    sSchedule.iRows = ( iHeight + iSize - 1 ) / iSize;
+    sSchedule.iGroups = ( sSchedule.iColumns * sSchedule.iRows + iKERNEL_LANES - 1 ) / iKERNEL_LANES;
+    sSchedule.iNextGroup.store( 0 );
+    sSchedule.iWidth = iWidth;
+    sSchedule.iHeight = iHeight;
+    sSchedule.iMax_Iterations = iMax_Iterations;
+    sSchedule.sOptions = sOptions;
+    sSchedule.sOptions.iAtlasSize = iSize;
+    sSchedule.pWeights = &vWeights;
+    sSchedule.pProgress = &sReport;
+    sSchedule.pStats = &sStats;
+
+    for( int u = 0; u < iSize; ++u )
+	sSchedule.vZReal.push_back( -dATLAS_RADIUS + (double)( u ) / ( (double)( iSize ) - 1.0 ) *
+				    ( 2.0 * dATLAS_RADIUS ) );
+
+    vWeights.assign( (size_t)( iWidth ) * iHeight, 0.0f );
+
+    if( iThreads <= 0 )
+	iThreads = (int)( thread::hardware_concurrency() );
+
+    iThreads = max( min( iThreads, sSchedule.iGroups ), 1 );
+
+    // Draw the thumbnails on the worker threads.
+    Init_Render_Stats( sStats, iWidth, iHeight, iMax_Iterations, iThreads, iSize );
+    Start_Progress( sReport, (long long)( iWidth ) * iHeight, sOptions.eProgress );
+
+    for( int i = 0; i < iThreads; ++i )
+	vWorkers.push_back( thread( Atlas_Worker, &sSchedule, i ) );
+
+    for( int i = 0; i < iThreads; ++i )
+	vWorkers[ i ].join();
+
+    Merge_Worker_Stats( sStats );
+    Stop_Progress( sReport );
+}
@@ -0,0 +1,37 @@
+// Name: Atlas.h
+// Description: Header for the Julia set atlas renderer.  The image is split
+//              into a grid of square thumbnails, each the Julia set of the
+//              value of c at its center in the view, so the atlas maps out the
+//              Julia sets over the parameter plane in a single render rather
+//              than one render per thumbnail.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ATLAS_H
+#define ATLAS_H
+
+// INCLUDES
+#include "Mandelbrot.h"
+#include <vector>
+
+// CONSTANTS
+// Each thumbnail shows [-dATLAS_RADIUS, dATLAS_RADIUS] along both axes, which
+// holds the whole filled Julia set of every c of the Mandelbrot set.
+const double dATLAS_RADIUS = 2.0;
+
+// FUNCTION DECLARATIONS
+void Get_Atlas_Parameter( const int iWidth,
+			  const int iHeight,
+			  const sRenderOptions &sOptions,
+			  const int iThumbnail,
+			  double &dCReal,
+			  double &dCImag );
+
+void Render_Atlas( const int iWidth,
+		   const int iHeight,
+		   const int iMax_Iterations,
+		   const sRenderOptions &sOptions,
+		   std::vector< float > &vWeights,
+		   sProgress &sReport,
+		   sRenderStats &sStats );
+
+#endif
@@ -0,0 +1,516 @@
+// Name: Buddhabrot.cpp
+// Description: Module implementation of the orbit density (Buddhabrot)
+//              renderer.
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "Buddhabrot.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Namespaces
+using namespace std;
+
+// CONSTANTS
+// Share of the samples drawn uniformly over the whole square rather than from
+// the importance map.  Mixing the two keeps every point reachable and caps the
+// weight of any one sample at 1 / dUNIFORM_SHARE, so the rare samples from the
+// dull cells don't turn into bright speckles.
+const double dUNIFORM_SHARE = 0.5;
+
+// Seed of the random numbers of the first chunk.
+const unsigned long long llORBIT_SEED = 0x5EED0B17ULL;
+
+// IMPORTANCE MAP STRUCTURE
+// Parts: vCDF - The running total of the cell weights, row major.
+//        vWeight - The weight of each cell.
+//        dTotal - The sum of the weights.
+//        dCellSize - The width and height of each cell on the plane.
+////////////////////////////////////////////////////////////////////////////////
+struct sImportanceMap
+{
+    vector< double > vCDF;
+    vector< double > vWeight;
+    double dTotal;
+    double dCellSize;
+};
+
+// ORBIT SCHEDULE STRUCTURE
+// Parts: llNextChunk - Lock-free counter of the next chunk of samples to hand
+//                      to a worker.
+//        llChunks - The number of chunks.
+//        llSamples - The number of points to sample.
+//        iWidth, iHeight - The size of the image.
+//        iMax_Iterations - Orbits that don't escape within this many
+//                          iterations aren't drawn.
+//        sView - The area of the complex plane the image covers.
+//        sFormula - The formula iterated.
+//        sMap - Where the samples are drawn from.
+//        vBuffers - The density buffers the workers add into.
+//        bShared - Set when there are fewer buffers than workers, so they're
+//                  added into atomically.
+//        pProgress - The progress counter bumped for each finished chunk.
+//        pStats - The statistics of the render.  Each worker only touches its
+//                 own entry of pStats->vWorkers.
+////////////////////////////////////////////////////////////////////////////////
+struct sOrbitSchedule
+{
+    atomic< long long > llNextChunk;
+    long long llChunks;
+    long long llSamples;
+    int iWidth;
+    int iHeight;
+    int iMax_Iterations;
+    sViewport sView;
+    sIterationFormula sFormula;
+    sImportanceMap sMap;
+    vector< vector< double > > vBuffers;
+    bool bShared;
+    sProgress *pProgress;
+    sRenderStats *pStats;
+};
+
+// Description: Steps a splitmix64 random number generator.
+// Parameters: llState - The state of the generator.
+// Return Value: Returns the next 64 random bits.
+////////////////////////////////////////////////////////////////////////////////
+static inline unsigned long long Next_Random( unsigned long long &llState )
+{
+    // Local Variables
+    unsigned long long llZ = ( llState += 0x9E3779B97F4A7C15ULL );
+
+    llZ = ( llZ ^ ( llZ >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    llZ = ( llZ ^ ( llZ >> 27 ) ) * 0x94D049BB133111EBULL;
+
+    return llZ ^ ( llZ >> 31 );
+}
+
+// Description: Returns a random double in [0, 1).
+////////////////////////////////////////////////////////////////////////////////
+static inline double Next_Uniform( unsigned long long &llState )
+{
+    return (double)( Next_Random( llState ) >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+// Description: Checks whether c is inside the main cardioid or the period 2
+//              bulb of the Mandelbrot set, where orbits never escape.
+// Parameters: dCReal, dCImag - c.
+// Return Value: Returns true if c is inside either of them.
+////////////////////////////////////////////////////////////////////////////////
+static inline bool Is_Inside_Bulbs( const double dCReal, const double dCImag )
+{
+    // Local Variables
+    const double dX = dCReal - 0.25;
+    const double dImag2 = dCImag * dCImag;
+    const double dQ = dX * dX + dImag2;
+
+    return ( dQ * ( dQ + dX ) <= 0.25 * dImag2 ) ||
+	( ( dCReal + 1.0 ) * ( dCReal + 1.0 ) + dImag2 <= 0.0625 );
+}
+
+// Description: Adds to a double that other threads add to as well.
+// Method: Compare and swap until nobody else got in between the load and the
+//         store.
+// Parameters: pValue - The double to add to.
+//             dAdd - The amount to add.
+////////////////////////////////////////////////////////////////////////////////
+static inline void Atomic_Add( double *pValue, const double dAdd )
+{
+    // Local Variables
+    double dOld, dNew;
+
+    __atomic_load( pValue, &dOld, __ATOMIC_RELAXED );
+
+    do
+    {
+	dNew = dOld + dAdd;
+    } while( !__atomic_compare_exchange( pValue, &dOld, &dNew, true,
+					 __ATOMIC_RELAXED, __ATOMIC_RELAXED ) );
+}
+
+// Description: Builds the map the points are sampled from, out of a low
+//              resolution escape time pass over the sampled square.
+// Method: The escape times of the corners of every cell are drawn with the
+//         regular tiled renderer.  A cell whose corners all stay bounded is
+//         most likely inside the set, where nothing escapes, and gets no
+//         importance.  Otherwise the importance grows with the longest escape
+//         time of its corners (long orbits draw the most) and is raised again
+//         when some corners escape and some don't, since the cell then holds
+//         the boundary.  The weight of each cell is its share of the
+//         importance mixed with a uniform share (see dUNIFORM_SHARE).  Each
+//         sample is later weighted by the average cell weight over the weight
+//         of its cell, so the density comes out the same as uniform sampling
+//         would give, with less noise.
+// Parameters: sSchedule - The schedule of the render; sMap is filled in.
+//             sOptions - The render options (threads, formula).
+////////////////////////////////////////////////////////////////////////////////
+void Build_Importance_Map( sOrbitSchedule &sSchedule, const sRenderOptions &sOptions )
+{
+    // Local Variables
+    const int iCorners = iIMPORTANCE_GRID + 1;
+    sImportanceMap &sMap = sSchedule.sMap;
+    sRenderOptions sCoarse = sOptions;
+    vector< int > vCorners;
+    double dImportance = 0.0;
+    double dTotal = 0.0;
+
+    sCoarse.sView.dXMin = -dORBIT_SAMPLE_RADIUS;
+    sCoarse.sView.dXMax = dORBIT_SAMPLE_RADIUS;
+    sCoarse.sView.dYMin = -dORBIT_SAMPLE_RADIUS;
+    sCoarse.sView.dYMax = dORBIT_SAMPLE_RADIUS;
+    sCoarse.eKernel = eKERNEL_VECTOR;
+    sCoarse.eTraversal = eTRAVERSAL_TILED;
+    sCoarse.eColoring = eCOLOR_LINEAR;
+    sCoarse.eProgress = ePROGRESS_NONE;
+    Render_Iterations( iCorners, iCorners, sSchedule.iMax_Iterations, sCoarse, vCorners );
+
+    sMap.dCellSize = 2.0 * dORBIT_SAMPLE_RADIUS / iIMPORTANCE_GRID;
+    sMap.vWeight.resize( (size_t)( iIMPORTANCE_GRID ) * iIMPORTANCE_GRID );
+    sMap.vCDF.resize( sMap.vWeight.size() );
+
+    for( int y = 0; y < iIMPORTANCE_GRID; ++y )
+    {
+	for( int x = 0; x < iIMPORTANCE_GRID; ++x )
+	{
+	    // Local Variables
+	    const size_t iCorner = (size_t)( y ) * iCorners + x;
+	    const int iCount[ 4 ] = { vCorners[ iCorner ], vCorners[ iCorner + 1 ],
+				      vCorners[ iCorner + iCorners ],
+				      vCorners[ iCorner + iCorners + 1 ] };
+	    const size_t iCell = (size_t)( y ) * iIMPORTANCE_GRID + x;
+	    int iCapped = 0;
+	    int iLongest = 0;
+	    double dWeight = 0.0;
+
+	    for( int i = 0; i < 4; ++i )
+	    {
+		if( iCount[ i ] >= sSchedule.iMax_Iterations )
+		    ++iCapped;
+		else
+		    iLongest = max( iLongest, iCount[ i ] );
+	    }
+
+	    if( iCapped < 4 )
+		dWeight = (double)( iLongest ) / sSchedule.iMax_Iterations +
+		    ( ( iCapped > 0 ) ? 1.0 : 0.0 );
+
+	    sMap.vWeight[ iCell ] = dWeight;
+	    dImportance += dWeight;
+	}
+    }
+
+    // Mix in the uniform share.
+    for( size_t i = 0; i < sMap.vWeight.size(); ++i )
+    {
+	if( dImportance > 0.0 )
+	    sMap.vWeight[ i ] = ( 1.0 - dUNIFORM_SHARE ) * sMap.vWeight[ i ] / dImportance +
+		dUNIFORM_SHARE / (double)( sMap.vWeight.size() );
+	else
+	    sMap.vWeight[ i ] = 1.0 / (double)( sMap.vWeight.size() );
+
+	dTotal += sMap.vWeight[ i ];
+	sMap.vCDF[ i ] = dTotal;
+    }
+
+    sMap.dTotal = dTotal;
+}
+
+// Description: Adds an escaping orbit into a density buffer.
+// Parameters: sSchedule - The schedule of the render.
+//             pBuffer - The density buffer.
+//             dOrbitReal[], dOrbitImag[] - The orbit.
+//             iCount - The length of the orbit.
+//             dWeight - The weight of the sample.
+////////////////////////////////////////////////////////////////////////////////
+template< bool bShared >
+void Plot_Orbit( const sOrbitSchedule &sSchedule,
+		 double *pBuffer,
+		 const double dOrbitReal[],
+		 const double dOrbitImag[],
+		 const int iCount,
+		 const double dWeight )
+{
+    // Local Variables
+    const sViewport &sView = sSchedule.sView;
+    const double dScaleX = (double)( sSchedule.iWidth - 1 ) / ( sView.dXMax - sView.dXMin );
+    const double dScaleY = (double)( sSchedule.iHeight - 1 ) / ( sView.dYMax - sView.dYMin );
+
+    for( int i = 0; i < iCount; ++i )
+    {
+	// Local Variables
+	const double dX = ( dOrbitReal[ i ] - sView.dXMin ) * dScaleX + 0.5;
+	const double dY = ( dOrbitImag[ i ] - sView.dYMin ) * dScaleY + 0.5;
+
+	// Written so NaNs are skipped as well: the retraced orbit can round
+	// differently from the vector kernel and run past its escape.
+	if( !( ( dX >= 0.0 ) && ( dX < sSchedule.iWidth ) && ( dY >= 0.0 ) &&
+	       ( dY < sSchedule.iHeight ) ) )
+	    continue;
+
+	double *pPixel = &pBuffer[ (size_t)( dY ) * sSchedule.iWidth + (size_t)( dX ) ];
+
+	if( bShared )
+	    Atomic_Add( pPixel, dWeight );
+	else
+	    *pPixel += dWeight;
+    }
+}
+
+// Description: Samples one chunk of points and adds their escaping orbits into
+//              a density buffer.
+// Method: Each point is drawn from the importance map: a cell is picked by a
+//         binary search of the running total of the weights, then a point
+//         uniformly inside it.  Points inside the main cardioid or the period
+//         2 bulb of the Mandelbrot set are known not to escape and are counted
+//         without iterating them.  The rest are gathered into lanes and run
+//         through the vector kernel together; only the orbits that escaped
+//         are traced again, point by point, into the buffer.
+// Parameters: sSchedule - The shared schedule of the render.
+//             llChunk - The chunk to draw.
+//             iWorker - The index of the worker drawing it.
+//             vOrbitReal, vOrbitImag - Scratch space for an orbit.
+////////////////////////////////////////////////////////////////////////////////
+void Draw_Orbit_Chunk( sOrbitSchedule &sSchedule,
+		       const long long llChunk,
+		       const int iWorker,
+		       vector< double > &vOrbitReal,
+		       vector< double > &vOrbitImag )
+{
+    // Local Variables
+    const sImportanceMap &sMap = sSchedule.sMap;
+    const long long llFirst = llChunk * iORBIT_CHUNK;
+    const int iCount = (int)( min( (long long)( iORBIT_CHUNK ), sSchedule.llSamples - llFirst ) );
+    const bool bBulbs = Is_Classic_Formula( sSchedule.sFormula );
+    const double dMeanWeight = sMap.dTotal / (double)( sMap.vWeight.size() );
+    double *pBuffer = &sSchedule.vBuffers[ iWorker % sSchedule.vBuffers.size() ][ 0 ];
+    sWorkerStats &sWorker = sSchedule.pStats->vWorkers[ iWorker ];
+    sTileStats sTile = { 0, 0, iCount, 1, iWorker, 0, 0, 0, 0.0, 0.0 };
+    unsigned long long llState = llORBIT_SEED ^ ( (unsigned long long)( llChunk ) * 0xD1B54A32D192ED03ULL );
+    chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+    int iDrawn = 0;
+
+    TRACE_SPAN( "orbits", "compute" );
+
+    while( iDrawn < iCount )
+    {
+	// Local Variables
+	double dLaneReal[ iKERNEL_LANES ];
+	double dLaneImag[ iKERNEL_LANES ];
+	double dLaneWeight[ iKERNEL_LANES ];
+	int iLaneIterations[ iKERNEL_LANES ];
+	int iLanes = 0;
+
+	while( ( iLanes < iKERNEL_LANES ) && ( iDrawn < iCount ) )
+	{
+	    // Local Variables
+	    const double dPick = Next_Uniform( llState ) * sMap.dTotal;
+	    const size_t iCell = min( (size_t)( upper_bound( sMap.vCDF.begin(), sMap.vCDF.end(), dPick ) -
+						sMap.vCDF.begin() ),
+				      sMap.vCDF.size() - 1 );
+	    const double dReal = -dORBIT_SAMPLE_RADIUS +
+		( (double)( iCell % iIMPORTANCE_GRID ) + Next_Uniform( llState ) ) * sMap.dCellSize;
+	    const double dImag = -dORBIT_SAMPLE_RADIUS +
+		( (double)( iCell / iIMPORTANCE_GRID ) + Next_Uniform( llState ) ) * sMap.dCellSize;
+
+	    ++iDrawn;
+
+	    if( bBulbs && Is_Inside_Bulbs( dReal, dImag ) )
+	    {
+		sTile.llCapped++;
+		sTile.llIterations += sSchedule.iMax_Iterations;
+		++sWorker.vHistogram[ Get_Histogram_Bucket( sSchedule.iMax_Iterations ) ];
+		continue;
+	    }
+
+	    dLaneReal[ iLanes ] = dReal;
+	    dLaneImag[ iLanes ] = dImag;
+	    dLaneWeight[ iLanes ] = dMeanWeight / sMap.vWeight[ iCell ];
+	    ++iLanes;
+	}
+
+	if( iLanes == 0 )
+	    break;
+
+	// Pad the last group by repeating its last point.
+	for( int l = iLanes; l < iKERNEL_LANES; ++l )
+	{
+	    dLaneReal[ l ] = dLaneReal[ iLanes - 1 ];
+	    dLaneImag[ l ] = dLaneImag[ iLanes - 1 ];
+	}
+
+	Get_Escape_Lanes( sSchedule.sFormula, dLaneReal, dLaneImag, sSchedule.iMax_Iterations,
+			  iLaneIterations );
+
+	for( int l = 0; l < iLanes; ++l )
+	{
+	    // Local Variables
+	    const int iIterations = iLaneIterations[ l ];
+
+	    sTile.llIterations += iIterations;
+	    ++sWorker.vHistogram[ Get_Histogram_Bucket( iIterations ) ];
+
+	    if( iIterations >= sSchedule.iMax_Iterations )
+	    {
+		sTile.llCapped++;
+		continue;
+	    }
+
+	    sTile.llEscaped++;
+	    Get_Orbit( sSchedule.sFormula, dLaneReal[ l ], dLaneImag[ l ], iIterations,
+		       &vOrbitReal[ 0 ], &vOrbitImag[ 0 ] );
+
+	    if( sSchedule.bShared )
+		Plot_Orbit< true >( sSchedule, pBuffer, &vOrbitReal[ 0 ], &vOrbitImag[ 0 ],
+				    iIterations, dLaneWeight[ l ] );
+	    else
+		Plot_Orbit< false >( sSchedule, pBuffer, &vOrbitReal[ 0 ], &vOrbitImag[ 0 ],
+				     iIterations, dLaneWeight[ l ] );
+	}
+    }
+
+    sTile.dKernelSeconds = Get_Seconds( tStart, chrono::steady_clock::now() );
+    sWorker.vTiles.push_back( sTile );
+    sWorker.dBusySeconds += sTile.dKernelSeconds;
+
+    Add_Progress( *sSchedule.pProgress, iCount );
+}
+
+// Description: Body of each worker thread.
+// Method: Keep pulling the next chunk of samples off of the shared counter and
+//         drawing it until every chunk has been handed out.
+// Parameters: pSchedule - The shared schedule of the render.
+//             iWorker - The index of this worker.
+////////////////////////////////////////////////////////////////////////////////
+void Orbit_Worker( sOrbitSchedule *pSchedule, const int iWorker )
+{
+    // Local Variables
+    vector< double > vOrbitReal( max( pSchedule->iMax_Iterations, 1 ) );
+    vector< double > vOrbitImag( max( pSchedule->iMax_Iterations, 1 ) );
+    long long llChunk = pSchedule->llNextChunk.fetch_add( 1 );
+
+    Set_Trace_Thread_Name( "worker", iWorker );
+
+    while( llChunk < pSchedule->llChunks )
+    {
+	Draw_Orbit_Chunk( *pSchedule, llChunk, iWorker, vOrbitReal, vOrbitImag );
+	llChunk = pSchedule->llNextChunk.fetch_add( 1 );
+    }
+}
+
+// Description: Adds a band of rows of every density buffer into the first one.
+// Parameters: pSchedule - The schedule of the (finished) render.
+//             iStartRow, iEndRow - The rows to add up ([start, end)).
+////////////////////////////////////////////////////////////////////////////////
+void Reduce_Rows( sOrbitSchedule *pSchedule, const int iStartRow, const int iEndRow )
+{
+    // Local Variables
+    vector< double > &vTotal = pSchedule->vBuffers[ 0 ];
+    const size_t iStart = (size_t)( iStartRow ) * pSchedule->iWidth;
+    const size_t iEnd = (size_t)( iEndRow ) * pSchedule->iWidth;
+
+    TRACE_SPAN( "reduce", "compute" );
+
+    for( size_t b = 1; b < pSchedule->vBuffers.size(); ++b )
+    {
+	const vector< double > &vBuffer = pSchedule->vBuffers[ b ];
+
+	for( size_t i = iStart; i < iEnd; ++i )
+	    vTotal[ i ] += vBuffer[ i ];
+    }
+}
+
+// Description: Draws the orbit density of an image on the worker threads.
+// Method: The importance map is built from a low resolution escape time pass,
+//         then the samples are split into chunks that the workers pull off of
+//         a shared counter, each worker adding the orbits it traces into its
+//         own density buffer so nothing is shared while sampling.  If one
+//         buffer per worker would take more than llMaxBytes, the workers
+//         share fewer buffers and add into them atomically instead.
+//         Once every chunk is drawn the buffers are added up, a band of rows
+//         per thread.
+// Parameters: iWidth, iHeight - The size of the image.
+//             iMax_Iterations - Orbits longer than this aren't drawn.
+//             sOptions - The render options (llOrbitSamples points are
+//                        sampled).
+//             vDensity - Filled with the row major orbit density.
+//             sReport - The progress of the render (counted in samples).
+//             sStats - Filled with the statistics of the render.  Each chunk
+//                      of samples shows up as a 1 row tile as wide as the
+//                      number of samples in it.
+//             llMaxBytes - The memory the density buffers may take (at least
+//                          one buffer is always used).  Verify makes it small
+//                          to have the workers share buffers.
+////////////////////////////////////////////////////////////////////////////////
+void Render_Buddhabrot( const int iWidth,
+			const int iHeight,
+			const int iMax_Iterations,
+			const sRenderOptions &sOptions,
+			vector< double > &vDensity,
+			sProgress &sReport,
+			sRenderStats &sStats,
+			const long long llMaxBytes )
+{
+    // Local Variables
+    const size_t iPixels = (size_t)( iWidth ) * iHeight;
+    vector< thread > vWorkers;
+    sOrbitSchedule sSchedule;
+    long long llBuffers = 0;
+    int iThreads = sOptions.iThreads;
+
+    sSchedule.llSamples = max( sOptions.llOrbitSamples, 1LL );
+    sSchedule.llChunks = ( sSchedule.llSamples + iORBIT_CHUNK - 1 ) / iORBIT_CHUNK;
+    sSchedule.llNextChunk.store( 0 );
+    sSchedule.iWidth = iWidth;
+    sSchedule.iHeight = iHeight;
+    sSchedule.iMax_Iterations = iMax_Iterations;
+    sSchedule.sView = sOptions.sView;
+    sSchedule.sFormula = sOptions.sFormula;
+    sSchedule.pProgress = &sReport;
+    sSchedule.pStats = &sStats;
+
+    Build_Importance_Map( sSchedule, sOptions );
+
+    if( iThreads <= 0 )
+	iThreads = (int)( thread::hardware_concurrency() );
+
+    iThreads = (int)( max( min( (long long)( iThreads ), sSchedule.llChunks ), 1LL ) );
+
+    // One buffer per worker unless that takes too much memory.
+    llBuffers = max( llMaxBytes / (long long)( iPixels * sizeof( double ) ), 1LL );
+    sSchedule.vBuffers.resize( (size_t)( min( llBuffers, (long long)( iThreads ) ) ) );
+    sSchedule.bShared = ( (int)( sSchedule.vBuffers.size() ) < iThreads );
+
+    for( size_t b = 0; b < sSchedule.vBuffers.size(); ++b )
+	sSchedule.vBuffers[ b ].assign( iPixels, 0.0 );
+
+    // Trace the orbits on the worker threads.
+    Init_Render_Stats( sStats, iWidth, iHeight, iMax_Iterations, iThreads, iORBIT_CHUNK );
+    Start_Progress( sReport, sSchedule.llSamples, sOptions.eProgress );
+
+    for( int i = 0; i < iThreads; ++i )
+	vWorkers.push_back( thread( Orbit_Worker, &sSchedule, i ) );
+
+    for( int i = 0; i < iThreads; ++i )
+	vWorkers[ i ].join();
+
+    Merge_Worker_Stats( sStats );
+
+    // Add the buffers up.
+    vWorkers.clear();
+
+    if( sSchedule.vBuffers.size() > 1 )
+    {
+	for( int i = 0; i < iThreads; ++i )
+	    vWorkers.push_back( thread( Reduce_Rows, &sSchedule, iHeight * i / iThreads,
+					iHeight * ( i + 1 ) / iThreads ) );
+
+	for( int i = 0; i < iThreads; ++i )
+	    vWorkers[ i ].join();
+    }
+
+    vDensity.swap( sSchedule.vBuffers[ 0 ] );
+    Stop_Progress( sReport );
+}
@@ -0,0 +1,44 @@
+// Name: Buddhabrot.h
+// Description: Header for the orbit density (Buddhabrot) renderer.  Rather
+//              than coloring each point by how long it takes to escape, many
+//              random points are iterated and every value their escaping
+//              orbits pass through is counted in the pixel it lands on.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef BUDDHABROT_H
+#define BUDDHABROT_H
+
+// INCLUDES
+#include "Mandelbrot.h"
+#include <vector>
+
+// CONSTANTS
+// The points are sampled from the square [-2, 2] x [-2, 2], which holds every
+// point whose orbit can stay bounded.
+const double dORBIT_SAMPLE_RADIUS = 2.0;
+
+// The low resolution escape time pass that guides the sampling is drawn on a
+// grid of this many cells across and down the sampled square.
+const int iIMPORTANCE_GRID = 256;
+
+// Samples are handed to the workers in chunks of this many.  Each chunk seeds
+// its own random numbers from its index, so a render comes out the same no
+// matter how many workers drew it.
+const int iORBIT_CHUNK = 16384;
+
+// Per worker density buffers are only used while they all fit in this many
+// bytes; past that the workers share fewer buffers and add into them
+// atomically.
+const long long llMAX_DENSITY_BYTES = 1LL << 30;
+
+// FUNCTION DECLARATIONS
+void Render_Buddhabrot( const int iWidth,
+			const int iHeight,
+			const int iMax_Iterations,
+			const sRenderOptions &sOptions,
+			std::vector< double > &vDensity,
+			sProgress &sReport,
+			sRenderStats &sStats,
+			const long long llMaxBytes = llMAX_DENSITY_BYTES );
+
+#endif
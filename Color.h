@@ -0,0 +1,57 @@
+// Name: Color.h
+// Description: Header for the coloring functions of the mandelbrot image
+//              making module, and for drawing the colors of a whole image for
+//              the output module (Output.h).  Kept apart from Mandelbrot.h
+//              since the embeddable renderer never deals in these colors.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COLOR_H
+#define COLOR_H
+
+// INCLUDES
+#include "Mandelbrot.h"
+#include <complex>
+#include <vector>
+
+struct sBandQueue;
+
+// PIXEL COLOR STRUCTURE
+// Parts: dRed, dGreen, dBlue - The intensity of each channel, from 0.0 to 1.0.
+//                              Converted to 8 bit samples or to Magick++ colors
+//                              only when the image is written.
+////////////////////////////////////////////////////////////////////////////////
+struct sPixelColor
+{
+    double dRed;
+    double dGreen;
+    double dBlue;
+};
+
+// FUNCTION DECLARATIONS
+sPixelColor Parse_Color( float fColorWeight,
+			 const sColorCode &sColor );
+
+sPixelColor Get_Iteration_Color( const int iterations,
+				 const int iMax_Iterations,
+				 const sColorCode &sColor );
+
+sPixelColor Get_Pixel_Color( std::complex< float > c,
+			     std::complex< float > z,
+			     int iterations,
+			     const int iMax_Iterations,
+			     const sColorCode &sColor );
+
+void Get_Palette( const sColorCode &sColor, unsigned char cPalette[] );
+
+void Draw_Bands( const int iWidth,
+		 const int iHeight,
+		 const int iMax_Iterations,
+		 const sColorCode &sColor,
+		 const sRenderOptions &sOptions,
+		 std::vector< sPixelColor > *pPixels,
+		 const sRaster *pRaster,
+		 sProgress &sReport,
+		 sRenderStats &sStats,
+		 sBandQueue &sBands );
+
+#endif
@@ -0,0 +1,818 @@
+// Name: Encoder.cpp
+// Description: Module implementation of the built in PPM, PAM, PNG,
+//              YUV4MPEG2 and raw RGB writers.
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "Encoder.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Namespaces
+using namespace std;
+
+// CONSTANTS
+const unsigned char cPNG_SIGNATURE[] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+
+// The PNG row filters tried on each row.
+const int iFILTER_NONE = 0;
+const int iFILTER_SUB = 1;
+const int iFILTER_UP = 2;
+
+// Description: Works out the format of an image from the extension of its file
+//              name (in any case).
+// Parameters: cpFileName[] - The name of the file.
+// Return Value: Returns eFORMAT_MAGICK for anything we don't write ourselves.
+////////////////////////////////////////////////////////////////////////////////
+eImageFormat Get_Image_Format( const char cpFileName[] )
+{
+    // Local Variables
+    const char *cpDot = strrchr( cpFileName, '.' );
+    char cExtension[ 5 ] = { };
+
+    if( ( cpDot == NULL ) || ( strlen( cpDot ) != 4 ) )
+	return eFORMAT_MAGICK;
+
+    for( int i = 0; i < 4; ++i )
+	cExtension[ i ] = (char)( tolower( (unsigned char)( cpDot[ i ] ) ) );
+
+    if( strcmp( cExtension, ".ppm" ) == 0 )
+	return eFORMAT_PPM;
+
+    if( strcmp( cExtension, ".pam" ) == 0 )
+	return eFORMAT_PAM;
+
+    if( strcmp( cExtension, ".png" ) == 0 )
+	return eFORMAT_PNG;
+
+    if( strcmp( cExtension, ".y4m" ) == 0 )
+	return eFORMAT_Y4M;
+
+    if( strcmp( cExtension, ".rgb" ) == 0 )
+	return eFORMAT_RGB;
+
+    return eFORMAT_MAGICK;
+}
+
+// Description: Checks whether a format is a stream of frames (and so can hold
+//              an animation).
+////////////////////////////////////////////////////////////////////////////////
+bool Is_Video_Format( const eImageFormat eFormat )
+{
+    return ( eFormat == eFORMAT_Y4M ) || ( eFormat == eFORMAT_RGB );
+}
+
+// Description: Writes a 32 bit number most significant byte first, the way
+//              PNG stores them.
+////////////////////////////////////////////////////////////////////////////////
+static void Put_Big_Endian( unsigned char cpOut[], const unsigned long ulValue )
+{
+    cpOut[ 0 ] = (unsigned char)( ( ulValue >> 24 ) & 0xFF );
+    cpOut[ 1 ] = (unsigned char)( ( ulValue >> 16 ) & 0xFF );
+    cpOut[ 2 ] = (unsigned char)( ( ulValue >> 8 ) & 0xFF );
+    cpOut[ 3 ] = (unsigned char)( ulValue & 0xFF );
+}
+
+// Description: Writes a PNG chunk whose CRC has already been worked out.
+// Parameters: sWriter - The writer.
+//             cpType - The four letter chunk type.
+//             cpData - The data of the chunk.
+//             iLength - The number of bytes of data.
+//             ulCRC - The CRC of the type and data.
+////////////////////////////////////////////////////////////////////////////////
+static void Write_Chunk( sImageWriter &sWriter,
+			 const char cpType[],
+			 const unsigned char cpData[],
+			 const size_t iLength,
+			 const uLong ulCRC )
+{
+    // Local Variables
+    unsigned char cHeader[ 8 ];
+    unsigned char cTrailer[ 4 ];
+
+    Put_Big_Endian( cHeader, (unsigned long)( iLength ) );
+    memcpy( cHeader + 4, cpType, 4 );
+    Put_Big_Endian( cTrailer, ulCRC );
+
+    if( ( fwrite( cHeader, 1, 8, sWriter.pFile ) != 8 ) ||
+	( ( iLength > 0 ) && ( fwrite( cpData, 1, iLength, sWriter.pFile ) != iLength ) ) ||
+	( fwrite( cTrailer, 1, 4, sWriter.pFile ) != 4 ) )
+	sWriter.bOk = false;
+}
+
+// Description: Writes a PNG chunk: its length, type, data and the CRC of the
+//              type and data.
+////////////////////////////////////////////////////////////////////////////////
+static void Write_Chunk( sImageWriter &sWriter,
+			 const char cpType[],
+			 const unsigned char cpData[],
+			 const size_t iLength )
+{
+    // Local Variables
+    uLong ulCRC = crc32( 0L, (const Bytef *)( cpType ), 4 );
+
+    if( iLength > 0 )
+	ulCRC = crc32( ulCRC, cpData, (uInt)( iLength ) );
+
+    Write_Chunk( sWriter, cpType, cpData, iLength, ulCRC );
+}
+
+// Description: Filters a row of pixels the way PNG encoders usually choose:
+//              each filter is tried, and the one whose output bytes (taken as
+//              signed) add up to the smallest magnitude is kept, since small
+//              differences compress best.
+// Parameters: cpRow - The row of pixels.
+//             cpPrior - The row above it (NULL for the first row).
+//             iBytes - The number of bytes in a row of pixels.
+//             iPixelBytes - The number of bytes in a pixel (how far back the
+//                           Sub filter looks).
+//             cpOut - Set to the filter type byte followed by the filtered
+//                     row (iBytes + 1 bytes).
+//             vTrial - Scratch space for trying out the filters.
+////////////////////////////////////////////////////////////////////////////////
+static void Filter_Row( const unsigned char cpRow[],
+			const unsigned char cpPrior[],
+			const size_t iBytes,
+			const size_t iPixelBytes,
+			unsigned char cpOut[],
+			vector< unsigned char > &vTrial )
+{
+    // Local Variables
+    long lBest = -1;
+
+    vTrial.resize( iBytes + 1 );
+
+    for( int iFilter = iFILTER_NONE; iFilter <= iFILTER_UP; ++iFilter )
+    {
+	// Local Variables
+	long lSum = 0;
+
+	// Up is the same as None on the first row.
+	if( ( cpPrior == NULL ) && ( iFilter == iFILTER_UP ) )
+	    continue;
+
+	vTrial[ 0 ] = (unsigned char)( iFilter );
+
+	for( size_t i = 0; i < iBytes; ++i )
+	{
+	    // Local Variables
+	    unsigned char cValue = cpRow[ i ];
+
+	    if( iFilter == iFILTER_SUB )
+		cValue = (unsigned char)( cValue - ( ( i >= iPixelBytes ) ? cpRow[ i - iPixelBytes ] : 0 ) );
+	    else if( iFilter == iFILTER_UP )
+		cValue = (unsigned char)( cValue - cpPrior[ i ] );
+
+	    vTrial[ i + 1 ] = cValue;
+	    lSum += ( cValue < 128 ) ? cValue : 256 - cValue;
+	}
+
+	if( ( lBest < 0 ) || ( lSum < lBest ) )
+	{
+	    lBest = lSum;
+	    memcpy( cpOut, &vTrial[ 0 ], iBytes + 1 );
+	}
+    }
+}
+
+// PNG BLOCK STRUCTURE
+// Parts: iStartRow, iEndRow - The rows compressed in the block ([start, end)).
+//        bLast - Set for the block that ends the deflate stream.
+//        vData - The compressed block (behind the zlib header for the first
+//                block).
+//        ulCRC - The CRC of "IDAT" and vData.
+//        ulAdler - The Adler-32 of the filtered rows.
+//        iLength - The number of filtered bytes.
+//        bOk - Cleared if zlib failed.
+////////////////////////////////////////////////////////////////////////////////
+struct sPngBlock
+{
+    int iStartRow;
+    int iEndRow;
+    bool bLast;
+    vector< unsigned char > vData;
+    uLong ulCRC;
+    uLong ulAdler;
+    size_t iLength;
+    bool bOk;
+};
+
+// Description: Filters a run of buffered rows.
+// Parameters: sWriter - The writer holding the rows.
+//             iStartRow, iEndRow - The image rows to filter ([start, end)).
+//             vFiltered - Set to the filtered rows.
+//             vTrial - Scratch space for Filter_Row.
+////////////////////////////////////////////////////////////////////////////////
+static void Filter_Rows( const sImageWriter &sWriter,
+			 const int iStartRow,
+			 const int iEndRow,
+			 vector< unsigned char > &vFiltered,
+			 vector< unsigned char > &vTrial )
+{
+    // Local Variables
+    const size_t iBytes = (size_t)( sWriter.iWidth ) * sWriter.iChannels;
+
+    vFiltered.resize( (size_t)( iEndRow - iStartRow ) * ( iBytes + 1 ) );
+
+    for( int y = iStartRow; y < iEndRow; ++y )
+    {
+	// Local Variables
+	const unsigned char *cpRow = &sWriter.vRows[ (size_t)( y - sWriter.iBufferRow ) * iBytes ];
+
+	Filter_Row( cpRow, ( y > 0 ) ? cpRow - iBytes : NULL, iBytes, sWriter.iChannels,
+		    &vFiltered[ (size_t)( y - iStartRow ) * ( iBytes + 1 ) ], vTrial );
+    }
+}
+
+// Description: Compresses one block of rows.
+// Method: The rows just before the block are filtered again and handed to
+//         the compressor as its dictionary, so matches can reach back into
+//         the previous block just as they would in a single stream.  The
+//         block is compressed as raw deflate data ending on a sync flush (an
+//         empty stored block that lines the output up on a byte boundary),
+//         which lets it be written straight after the previous block; the
+//         last block finishes the stream instead.
+// Parameters: sWriter - The writer holding the rows.
+//             sStream - A raw deflate stream, ready to use.
+//             vFiltered, vTrial - Scratch space.
+//             sBlock - The block.
+////////////////////////////////////////////////////////////////////////////////
+static void Compress_Block( const sImageWriter &sWriter,
+			    z_stream &sStream,
+			    vector< unsigned char > &vFiltered,
+			    vector< unsigned char > &vTrial,
+			    sPngBlock &sBlock )
+{
+    // Local Variables
+    size_t iHeader = 0;
+    int iStatus = Z_OK;
+
+    sBlock.bOk = ( deflateReset( &sStream ) == Z_OK );
+
+    if( sBlock.iStartRow > 0 )
+    {
+	Filter_Rows( sWriter, max( sBlock.iStartRow - sWriter.iDictionaryRows, 0 ), sBlock.iStartRow,
+		     vFiltered, vTrial );
+
+	if( vFiltered.size() > iPNG_DICTIONARY_SIZE )
+	    vFiltered.erase( vFiltered.begin(), vFiltered.end() - iPNG_DICTIONARY_SIZE );
+
+	if( !vFiltered.empty() &&
+	    ( deflateSetDictionary( &sStream, &vFiltered[ 0 ], (uInt)( vFiltered.size() ) ) != Z_OK ) )
+	    sBlock.bOk = false;
+    }
+
+    Filter_Rows( sWriter, sBlock.iStartRow, sBlock.iEndRow, vFiltered, vTrial );
+    sBlock.iLength = vFiltered.size();
+    sBlock.ulAdler = adler32( adler32( 0L, Z_NULL, 0 ), vFiltered.empty() ? Z_NULL : &vFiltered[ 0 ],
+			      (uInt)( sBlock.iLength ) );
+
+    // The zlib header (deflate, 32 KB window, default compression) goes in
+    // front of the first block.
+    sBlock.vData.clear();
+
+    if( sBlock.iStartRow == 0 )
+    {
+	sBlock.vData.push_back( 0x78 );
+	sBlock.vData.push_back( 0x9C );
+	iHeader = 2;
+    }
+
+    sBlock.vData.resize( iHeader + deflateBound( &sStream, (uLong)( sBlock.iLength ) ) + 16 );
+    sStream.next_in = vFiltered.empty() ? Z_NULL : &vFiltered[ 0 ];
+    sStream.avail_in = (uInt)( sBlock.iLength );
+    sStream.next_out = &sBlock.vData[ iHeader ];
+    sStream.avail_out = (uInt)( sBlock.vData.size() - iHeader );
+
+    while( sBlock.bOk )
+    {
+	iStatus = deflate( &sStream, sBlock.bLast ? Z_FINISH : Z_SYNC_FLUSH );
+
+	if( ( iStatus == Z_STREAM_ERROR ) ||
+	    ( sBlock.bLast ? ( iStatus == Z_STREAM_END ) : ( sStream.avail_out > 0 ) ) )
+	    break;
+
+	// Out of room (deflateBound makes this very unlikely): grow and go on.
+	{
+	    // Local Variables
+	    size_t iUsed = sBlock.vData.size() - sStream.avail_out;
+
+	    sBlock.vData.resize( sBlock.vData.size() * 2 );
+	    sStream.next_out = &sBlock.vData[ iUsed ];
+	    sStream.avail_out = (uInt)( sBlock.vData.size() - iUsed );
+	}
+    }
+
+    if( iStatus == Z_STREAM_ERROR )
+	sBlock.bOk = false;
+
+    sBlock.vData.resize( sBlock.vData.size() - sStream.avail_out );
+    sBlock.ulCRC = crc32( crc32( 0L, (const Bytef *)( "IDAT" ), 4 ), &sBlock.vData[ 0 ],
+			  (uInt)( sBlock.vData.size() ) );
+}
+
+// Description: Body of a compression thread: takes blocks in order until none
+//              are left.
+// Parameters: pWriter - The writer holding the rows.
+//             pBlocks - The blocks to compress.
+//             pNext - The index of the next block nobody has taken.
+////////////////////////////////////////////////////////////////////////////////
+static void Compress_Worker( const sImageWriter *pWriter,
+			     vector< sPngBlock > *pBlocks,
+			     atomic< size_t > *pNext )
+{
+    // Local Variables
+    z_stream sStream;
+    vector< unsigned char > vFiltered;
+    vector< unsigned char > vTrial;
+    size_t iBlock = 0;
+    bool bReady = false;
+
+    memset( &sStream, 0, sizeof( sStream ) );
+    bReady = ( deflateInit2( &sStream, iPNG_COMPRESSION_LEVEL, Z_DEFLATED, -15, 8,
+			     Z_DEFAULT_STRATEGY ) == Z_OK );
+
+    while( ( iBlock = pNext->fetch_add( 1 ) ) < pBlocks->size() )
+    {
+	if( bReady )
+	    Compress_Block( *pWriter, sStream, vFiltered, vTrial, ( *pBlocks )[ iBlock ] );
+	else
+	    ( *pBlocks )[ iBlock ].bOk = false;
+    }
+
+    if( bReady )
+	deflateEnd( &sStream );
+}
+
+// Description: Compresses the buffered rows up to a given row and writes them
+//              out as IDAT chunks.
+// Method: The rows are cut into blocks of iBlockRows rows, which are shared
+//         out between the compression threads.  Once they're all done, the
+//         blocks are written in order, each as its own IDAT chunk with the CRC
+//         its thread worked out, and the Adler-32 of each block is folded
+//         into the Adler-32 of the whole stream.  When finishing, the last
+//         block (which may have no rows at all) ends the stream, and that
+//         Adler-32 is added to the end of it, its CRC being extended to cover
+//         it with crc32_combine.  Only the rows the next block will refer
+//         back to are kept in the buffer.
+// Parameters: sWriter - The writer.
+//             iEndRow - Rows up to (not including) this one are compressed.
+//             bFinish - Set to end the stream.
+////////////////////////////////////////////////////////////////////////////////
+static void Compress_Rows( sImageWriter &sWriter, const int iEndRow, const bool bFinish )
+{
+    // Local Variables
+    const size_t iBytes = (size_t)( sWriter.iWidth ) * sWriter.iChannels;
+    vector< sPngBlock > vBlocks;
+    vector< thread > vWorkers;
+    atomic< size_t > iNext( 0 );
+    int iThreads = 0;
+    int iKeepRow = 0;
+
+    for( int y = sWriter.iRowsWritten; ( y < iEndRow ) || ( bFinish && vBlocks.empty() );
+	 y += sWriter.iBlockRows )
+    {
+	// Local Variables
+	sPngBlock sBlock;
+
+	sBlock.iStartRow = y;
+	sBlock.iEndRow = min( y + sWriter.iBlockRows, iEndRow );
+	sBlock.bLast = false;
+	sBlock.ulCRC = 0;
+	sBlock.ulAdler = 0;
+	sBlock.iLength = 0;
+	sBlock.bOk = false;
+	vBlocks.push_back( sBlock );
+    }
+
+    if( vBlocks.empty() )
+	return;
+
+    if( bFinish )
+	vBlocks.back().bLast = true;
+
+    iThreads = min( sWriter.iThreads, (int)( vBlocks.size() ) );
+
+    for( int i = 1; i < iThreads; ++i )
+	vWorkers.push_back( thread( Compress_Worker, &sWriter, &vBlocks, &iNext ) );
+
+    Compress_Worker( &sWriter, &vBlocks, &iNext );
+
+    for( size_t i = 0; i < vWorkers.size(); ++i )
+	vWorkers[ i ].join();
+
+    for( size_t b = 0; ( b < vBlocks.size() ) && sWriter.bOk; ++b )
+    {
+	// Local Variables
+	sPngBlock &sBlock = vBlocks[ b ];
+
+	if( !sBlock.bOk )
+	{
+	    sWriter.bOk = false;
+	    break;
+	}
+
+	sWriter.ulAdler = adler32_combine( sWriter.ulAdler, sBlock.ulAdler, (z_off_t)( sBlock.iLength ) );
+
+	if( sBlock.bLast )
+	{
+	    // Local Variables
+	    unsigned char cTrailer[ 4 ];
+
+	    Put_Big_Endian( cTrailer, sWriter.ulAdler );
+	    sBlock.vData.insert( sBlock.vData.end(), cTrailer, cTrailer + 4 );
+	    sBlock.ulCRC = crc32_combine( sBlock.ulCRC, crc32( 0L, cTrailer, 4 ), 4 );
+	}
+
+	Write_Chunk( sWriter, "IDAT", &sBlock.vData[ 0 ], sBlock.vData.size(), sBlock.ulCRC );
+    }
+
+    sWriter.iRowsWritten = iEndRow;
+
+    // Keep the rows the next block's dictionary (and their filter) refer to.
+    iKeepRow = max( iEndRow - sWriter.iDictionaryRows - 1, sWriter.iBufferRow );
+    sWriter.vRows.erase( sWriter.vRows.begin(),
+			 sWriter.vRows.begin() + (size_t)( iKeepRow - sWriter.iBufferRow ) * iBytes );
+    sWriter.iBufferRow = iKeepRow;
+}
+
+// Description: Converts rows of a YUV4MPEG2 frame from RGB and writes their
+//              luma; the chroma is kept until the frame is done, since the
+//              planes are stored one after the other.
+// Method: The BT.601 conversion to limited range (16 to 235) YCbCr that video
+//         tools assume for Y4M, in 8 bit fixed point.  Each frame starts with
+//         its FRAME marker and ends with its U and V planes.
+// Parameters: sWriter - The writer.
+//             cpPixels[] - The rows, 3 bytes per pixel.
+//             iRows - The number of rows (within one frame or across several).
+////////////////////////////////////////////////////////////////////////////////
+static void Write_Y4M_Rows( sImageWriter &sWriter, const unsigned char cpPixels[], const int iRows )
+{
+    // Local Variables
+    const size_t iPlane = (size_t)( sWriter.iWidth ) * sWriter.iHeight;
+    vector< unsigned char > vLuma( sWriter.iWidth );
+
+    for( int r = 0; ( r < iRows ) && sWriter.bOk; ++r )
+    {
+	// Local Variables
+	const int y = sWriter.iRowsWritten % sWriter.iHeight;
+	const unsigned char *pRGB = cpPixels + (size_t)( r ) * sWriter.iWidth * 3;
+	unsigned char *pU = &sWriter.vRows[ (size_t)( y ) * sWriter.iWidth ];
+	unsigned char *pV = pU + iPlane;
+
+	if( ( y == 0 ) && ( fputs( "FRAME\n", sWriter.pFile ) == EOF ) )
+	    sWriter.bOk = false;
+
+	for( int x = 0; x < sWriter.iWidth; ++x, pRGB += 3 )
+	{
+	    // Local Variables
+	    const int iR = pRGB[ 0 ];
+	    const int iG = pRGB[ 1 ];
+	    const int iB = pRGB[ 2 ];
+
+	    vLuma[ x ] = (unsigned char)( ( ( 66 * iR + 129 * iG + 25 * iB + 128 ) >> 8 ) + 16 );
+	    pU[ x ] = (unsigned char)( ( ( -38 * iR - 74 * iG + 112 * iB + 128 ) >> 8 ) + 128 );
+	    pV[ x ] = (unsigned char)( ( ( 112 * iR - 94 * iG - 18 * iB + 128 ) >> 8 ) + 128 );
+	}
+
+	if( fwrite( &vLuma[ 0 ], 1, vLuma.size(), sWriter.pFile ) != vLuma.size() )
+	    sWriter.bOk = false;
+
+	++sWriter.iRowsWritten;
+
+	if( ( sWriter.iRowsWritten % sWriter.iHeight == 0 ) &&
+	    ( fwrite( &sWriter.vRows[ 0 ], 1, iPlane * 2, sWriter.pFile ) != iPlane * 2 ) )
+	    sWriter.bOk = false;
+    }
+}
+
+// Description: Sets up a writer and creates its file.
+// Parameters: sWriter - The writer being opened.
+//             cpFileName[] - The name of the file (cSTANDARD_OUTPUT to write
+//                            to standard output).
+//             eFormat - The format to write.
+//             iWidth, iHeight - The size of the image.
+//             iThreads - The number of threads to compress PNG blocks on.
+//             iFrames - The number of frames that will be written.
+//             iChannels - The bytes per pixel of the rows.
+// Return Value: Returns false if the file couldn't be created.
+////////////////////////////////////////////////////////////////////////////////
+static bool Start_Image_Writer( sImageWriter &sWriter,
+				const char cpFileName[],
+				const eImageFormat eFormat,
+				const int iWidth,
+				const int iHeight,
+				const int iThreads,
+				const int iFrames,
+				const int iChannels )
+{
+    // Local Variables
+    const size_t iFilteredBytes = (size_t)( iWidth ) * iChannels + 1;
+
+    sWriter.eFormat = eFormat;
+    sWriter.iWidth = iWidth;
+    sWriter.iHeight = iHeight;
+    sWriter.iFrames = Is_Video_Format( eFormat ) ? iFrames : 1;
+    sWriter.iChannels = iChannels;
+    sWriter.iThreads = max( iThreads, 1 );
+    sWriter.iRowsWritten = 0;
+    sWriter.bOk = true;
+    sWriter.iBlockRows = (int)( max( iPNG_BLOCK_SIZE / iFilteredBytes, (size_t)( 1 ) ) );
+    sWriter.iDictionaryRows = (int)( min( ( iPNG_DICTIONARY_SIZE + iFilteredBytes - 1 ) / iFilteredBytes,
+					  (size_t)( sWriter.iBlockRows ) ) );
+    sWriter.iBufferRow = 0;
+    sWriter.vRows.clear();
+    sWriter.ulAdler = adler32( 0L, Z_NULL, 0 );
+    sWriter.pFile = ( strcmp( cpFileName, cSTANDARD_OUTPUT ) == 0 ) ? stdout : fopen( cpFileName, "wb" );
+
+    if( sWriter.pFile == NULL )
+	sWriter.bOk = false;
+
+    return sWriter.bOk;
+}
+
+// Description: Writes the signature and header chunk of a PNG file: 8 bits
+//              per sample, deflate, adaptive filtering, no interlacing.
+// Parameters: sWriter - The writer.
+//             cColorType - 2 for RGB or 3 for palette indices.
+////////////////////////////////////////////////////////////////////////////////
+static void Write_Png_Header( sImageWriter &sWriter, const unsigned char cColorType )
+{
+    // Local Variables
+    unsigned char cHeader[ 13 ];
+
+    Put_Big_Endian( cHeader, (unsigned long)( sWriter.iWidth ) );
+    Put_Big_Endian( cHeader + 4, (unsigned long)( sWriter.iHeight ) );
+    cHeader[ 8 ] = 8;
+    cHeader[ 9 ] = cColorType;
+    cHeader[ 10 ] = 0;
+    cHeader[ 11 ] = 0;
+    cHeader[ 12 ] = 0;
+
+    if( fwrite( cPNG_SIGNATURE, 1, sizeof( cPNG_SIGNATURE ), sWriter.pFile ) != sizeof( cPNG_SIGNATURE ) )
+	sWriter.bOk = false;
+
+    Write_Chunk( sWriter, "IHDR", cHeader, sizeof( cHeader ) );
+}
+
+// Description: Creates the file and writes the header of the image.
+// Parameters: sWriter - The writer being opened.
+//             cpFileName[] - The name of the file (cSTANDARD_OUTPUT to write
+//                            to standard output).  It may be a FIFO.
+//             eFormat - The format to write (not eFORMAT_MAGICK).
+//             iWidth, iHeight - The size of the image.
+//             iThreads - The number of threads to compress PNG blocks on.
+//             iFrames - The number of frames that will be written (video
+//                       formats only).
+//             iFrameRate - The frames per second (YUV4MPEG2 only).
+// Return Value: Returns false if the file couldn't be created.
+////////////////////////////////////////////////////////////////////////////////
+bool Open_Image_Writer( sImageWriter &sWriter,
+			const char cpFileName[],
+			const eImageFormat eFormat,
+			const int iWidth,
+			const int iHeight,
+			const int iThreads,
+			const int iFrames,
+			const int iFrameRate )
+{
+    if( !Start_Image_Writer( sWriter, cpFileName, eFormat, iWidth, iHeight, iThreads, iFrames, 3 ) )
+	return false;
+
+    if( eFormat == eFORMAT_PPM )
+    {
+	if( fprintf( sWriter.pFile, "P6\n%d %d\n255\n", iWidth, iHeight ) < 0 )
+	    sWriter.bOk = false;
+    }
+    else if( eFormat == eFORMAT_PAM )
+    {
+	if( fprintf( sWriter.pFile, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 3\nMAXVAL 255\nTUPLTYPE RGB\nENDHDR\n",
+		     iWidth, iHeight ) < 0 )
+	    sWriter.bOk = false;
+    }
+    else if( eFormat == eFORMAT_Y4M )
+    {
+	// Progressive, square pixels, no chroma subsampling.
+	if( fprintf( sWriter.pFile, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444 XCOLORRANGE=LIMITED\n",
+		     iWidth, iHeight, max( iFrameRate, 1 ) ) < 0 )
+	    sWriter.bOk = false;
+
+	sWriter.vRows.resize( (size_t)( iWidth ) * iHeight * 2 );
+    }
+    else if( eFormat == eFORMAT_PNG )
+	Write_Png_Header( sWriter, 2 );
+
+    return sWriter.bOk;
+}
+
+// Description: Creates a PNG file whose pixels are indices into a palette and
+//              writes its header and palette.
+// Method: Each pixel is a single byte, so there is a third as much to filter
+//         and compress as for RGB, and the files come out smaller.
+// Parameters: sWriter - The writer being opened.
+//             cpFileName[] - The name of the file (cSTANDARD_OUTPUT to write
+//                            to standard output).
+//             iWidth, iHeight - The size of the image.
+//             iThreads - The number of threads to compress PNG blocks on.
+//             cpPalette[] - The red, green and blue of each color.
+//             iColors - The number of colors (1 to iPNG_PALETTE_COLORS).
+// Return Value: Returns false if the file couldn't be created.
+////////////////////////////////////////////////////////////////////////////////
+bool Open_Indexed_Image_Writer( sImageWriter &sWriter,
+				const char cpFileName[],
+				const int iWidth,
+				const int iHeight,
+				const int iThreads,
+				const unsigned char cpPalette[],
+				const int iColors )
+{
+    if( !Start_Image_Writer( sWriter, cpFileName, eFORMAT_PNG, iWidth, iHeight, iThreads, 1, 1 ) )
+	return false;
+
+    Write_Png_Header( sWriter, 3 );
+    Write_Chunk( sWriter, "PLTE", cpPalette, (size_t)( iColors ) * 3 );
+
+    return sWriter.bOk;
+}
+
+// Description: Writes the next rows of the image.  PNG rows are buffered
+//              until there are enough of them to fill a block.
+// Parameters: sWriter - The writer.
+//             cpPixels[] - The rows, 3 bytes (red, green, blue) per pixel, or
+//                          a palette index for an indexed PNG, and no padding
+//                          between rows.
+//             iRows - The number of rows.  A video's frames simply follow one
+//                     another.
+// Return Value: Returns false once anything has failed.
+////////////////////////////////////////////////////////////////////////////////
+bool Write_Image_Rows( sImageWriter &sWriter, const unsigned char cpPixels[], const int iRows )
+{
+    // Local Variables
+    const size_t iBytes = (size_t)( sWriter.iWidth ) * sWriter.iChannels;
+    int iBuffered = 0;
+
+    if( !sWriter.bOk )
+	return false;
+
+    if( sWriter.eFormat == eFORMAT_Y4M )
+    {
+	Write_Y4M_Rows( sWriter, cpPixels, iRows );
+	return sWriter.bOk;
+    }
+
+    if( sWriter.eFormat != eFORMAT_PNG )
+    {
+	if( fwrite( cpPixels, iBytes, (size_t)( iRows ), sWriter.pFile ) != (size_t)( iRows ) )
+	    sWriter.bOk = false;
+
+	sWriter.iRowsWritten += iRows;
+	return sWriter.bOk;
+    }
+
+    sWriter.vRows.insert( sWriter.vRows.end(), cpPixels, cpPixels + (size_t)( iRows ) * iBytes );
+    iBuffered = sWriter.iBufferRow + (int)( sWriter.vRows.size() / iBytes ) - sWriter.iRowsWritten;
+
+    if( iBuffered >= sWriter.iBlockRows )
+	Compress_Rows( sWriter, sWriter.iRowsWritten + iBuffered - iBuffered % sWriter.iBlockRows, false );
+
+    return sWriter.bOk;
+}
+
+// Description: Finishes the image and closes the file.
+// Parameters: sWriter - The writer.
+// Return Value: Returns false if anything failed, including every row not
+//               having been written.
+////////////////////////////////////////////////////////////////////////////////
+bool Close_Image_Writer( sImageWriter &sWriter )
+{
+    if( sWriter.pFile == NULL )
+	return false;
+
+    if( ( sWriter.eFormat == eFORMAT_PNG ) && sWriter.bOk )
+    {
+	// Local Variables
+	int iEndRow = sWriter.iBufferRow + (int)( sWriter.vRows.size() / ( (size_t)( sWriter.iWidth ) * sWriter.iChannels ) );
+
+	Compress_Rows( sWriter, iEndRow, true );
+
+	Write_Chunk( sWriter, "IEND", NULL, 0 );
+    }
+
+    if( sWriter.pFile == stdout )
+    {
+	if( fflush( sWriter.pFile ) != 0 )
+	    sWriter.bOk = false;
+    }
+    else if( fclose( sWriter.pFile ) != 0 )
+	sWriter.bOk = false;
+
+    sWriter.pFile = NULL;
+
+    return sWriter.bOk && ( sWriter.iRowsWritten == sWriter.iHeight * sWriter.iFrames );
+}
+
+// Description: Creates a PPM or PAM file of the full size of the image and
+//              maps it into memory, header included, so the pixels can be
+//              written straight into it.
+// Method: The file's blocks are allocated up front, so running out of disk
+//         space is reported here rather than as a bus error in the middle of
+//         the render (file systems that can't allocate ahead of time are left
+//         with a sparse file).  The mapping is shared, so whatever is written
+//         into it reaches the file through the page cache on its own.
+// Parameters: sImage - The mapped image being opened.
+//             cpFileName[] - The name of the file.
+//             eFormat - eFORMAT_PPM or eFORMAT_PAM.
+//             iWidth, iHeight - The size of the image.
+// Return Value: Returns false if the file couldn't be created or mapped.
+////////////////////////////////////////////////////////////////////////////////
+bool Open_Mapped_Image( sMappedImage &sImage,
+			const char cpFileName[],
+			const eImageFormat eFormat,
+			const int iWidth,
+			const int iHeight )
+{
+    // Local Variables
+    char cHeader[ 128 ];
+    int iHeaderLength = 0;
+    int iStatus = 0;
+    void *pMapping = MAP_FAILED;
+
+    sImage.iFile = -1;
+    sImage.pMapping = NULL;
+    sImage.iMappingSize = 0;
+    sImage.pPixels = NULL;
+
+    if( eFormat == eFORMAT_PPM )
+	iHeaderLength = snprintf( cHeader, sizeof( cHeader ), "P6\n%d %d\n255\n", iWidth, iHeight );
+    else if( eFormat == eFORMAT_PAM )
+	iHeaderLength = snprintf( cHeader, sizeof( cHeader ),
+				  "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 3\nMAXVAL 255\nTUPLTYPE RGB\nENDHDR\n",
+				  iWidth, iHeight );
+    else
+	return false;
+
+    sImage.iMappingSize = (size_t)( iHeaderLength ) + (size_t)( iWidth ) * iHeight * 3;
+    sImage.iFile = open( cpFileName, O_RDWR | O_CREAT | O_TRUNC, 0666 );
+
+    if( sImage.iFile < 0 )
+	return false;
+
+    if( ftruncate( sImage.iFile, (off_t)( sImage.iMappingSize ) ) != 0 )
+    {
+	Close_Mapped_Image( sImage );
+	return false;
+    }
+
+    iStatus = posix_fallocate( sImage.iFile, 0, (off_t)( sImage.iMappingSize ) );
+
+    if( ( iStatus != 0 ) && ( iStatus != EOPNOTSUPP ) && ( iStatus != EINVAL ) )
+    {
+	Close_Mapped_Image( sImage );
+	return false;
+    }
+
+    pMapping = mmap( NULL, sImage.iMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, sImage.iFile, 0 );
+
+    if( pMapping == MAP_FAILED )
+    {
+	Close_Mapped_Image( sImage );
+	return false;
+    }
+
+    sImage.pMapping = (unsigned char *)( pMapping );
+    sImage.pPixels = sImage.pMapping + iHeaderLength;
+    memcpy( sImage.pMapping, cHeader, (size_t)( iHeaderLength ) );
+
+    return true;
+}
+
+// Description: Unmaps and closes a mapped image.  The pages still waiting to
+//              be written are left to the page cache; nothing waits for them.
+// Parameters: sImage - The mapped image.
+// Return Value: Returns false if anything failed.
+////////////////////////////////////////////////////////////////////////////////
+bool Close_Mapped_Image( sMappedImage &sImage )
+{
+    // Local Variables
+    bool bOk = true;
+
+    if( ( sImage.pMapping != NULL ) && ( munmap( sImage.pMapping, sImage.iMappingSize ) != 0 ) )
+	bOk = false;
+
+    if( ( sImage.iFile >= 0 ) && ( close( sImage.iFile ) != 0 ) )
+	bOk = false;
+
+    sImage.pMapping = NULL;
+    sImage.pPixels = NULL;
+    sImage.iFile = -1;
+
+    return bOk;
+}
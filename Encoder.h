@@ -0,0 +1,136 @@
+// Name: Encoder.h
+// Description: Header for the built in image writers.  Raw PPM and PAM files
+//              and PNG files (deflated with zlib) are written straight from
+//              rows of 8 bit RGB pixels, a band at a time, so the common
+//              formats never go through Magick++.  Any other file extension
+//              is left to Magick++.  PNG rows are compressed in independent
+//              blocks on several threads, the way pigz does it: each block
+//              ends on a sync flush so the blocks join into one deflate
+//              stream, and their checksums are combined afterwards.  PPM and
+//              PAM files can also be mapped into memory so the render workers
+//              color their tiles straight into the file.  Animations are
+//              streamed frame after frame as YUV4MPEG2 (converted from RGB as
+//              each row comes in) or as raw RGB, to a file, a FIFO or
+//              standard output, so they can be piped straight into a video
+//              encoder.  PNG files can also be written as 8 bit palette
+//              indices, a third of the bytes of RGB to buffer, filter and
+//              compress.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+// INCLUDES
+#include <cstdio>
+#include <vector>
+#include <zlib.h>
+
+// CONSTANTS
+// The zlib compression level of PNG files: the zlib default, which is close to
+// the smallest files at a fraction of the time of level 9.
+const int iPNG_COMPRESSION_LEVEL = 6;
+
+// PNG rows are compressed in blocks of about this many (filtered) bytes, each
+// written out as its own IDAT chunk.  Every block is primed with the last 32 KB
+// of the block before it, so splitting costs very little compression.
+const size_t iPNG_BLOCK_SIZE = 1 << 17;
+const size_t iPNG_DICTIONARY_SIZE = 1 << 15;
+
+// The most colors a PNG palette can hold.
+const int iPNG_PALETTE_COLORS = 256;
+
+// The file name that writes to standard output instead of a file.
+const char cSTANDARD_OUTPUT[] = "-";
+
+// ENUMERATIONS
+enum eImageFormat { eFORMAT_MAGICK=0, eFORMAT_PPM=1, eFORMAT_PAM=2, eFORMAT_PNG=3, eFORMAT_Y4M=4,
+		   eFORMAT_RGB=5 };
+
+// IMAGE WRITER STRUCTURE
+// Parts: eFormat - The format being written.
+//        pFile - The file being written.
+//        iWidth, iHeight - The size of the image (of each frame).
+//        iFrames - The number of frames (1 for anything but a video).
+//        iChannels - The bytes per pixel of the rows handed in: 3 for red,
+//                    green, blue or 1 for an index into the palette.
+//        iThreads - The number of threads PNG blocks are compressed on.
+//        iRowsWritten - The number of rows written (or, for PNG, compressed)
+//                       so far, counting every frame.
+//        bOk - Cleared as soon as anything fails.
+//        iBlockRows - The number of rows in each PNG block.
+//        iDictionaryRows - The number of rows before a block that are
+//                          filtered again to prime its compressor.
+//        iBufferRow - The image row vRows starts at.
+//        vRows - PNG rows not compressed yet, preceded by the rows the next
+//                block's filter and dictionary refer back to.  For YUV4MPEG2,
+//                the U and V planes of the frame being written.
+//        ulAdler - The Adler-32 of every PNG row compressed so far.
+////////////////////////////////////////////////////////////////////////////////
+struct sImageWriter
+{
+    eImageFormat eFormat;
+    FILE *pFile;
+    int iWidth;
+    int iHeight;
+    int iFrames;
+    int iChannels;
+    int iThreads;
+    int iRowsWritten;
+    bool bOk;
+    int iBlockRows;
+    int iDictionaryRows;
+    int iBufferRow;
+    std::vector< unsigned char > vRows;
+    unsigned long ulAdler;
+};
+
+// MAPPED IMAGE STRUCTURE
+// Parts: iFile - The descriptor of the open file (-1 when closed).
+//        pMapping - The whole file, mapped shared into memory.
+//        iMappingSize - The size of the file.
+//        pPixels - The pixels in the mapping, 3 bytes (red, green, blue) per
+//                  pixel, row after row.
+////////////////////////////////////////////////////////////////////////////////
+struct sMappedImage
+{
+    int iFile;
+    unsigned char *pMapping;
+    size_t iMappingSize;
+    unsigned char *pPixels;
+};
+
+// FUNCTION DECLARATIONS
+eImageFormat Get_Image_Format( const char cpFileName[] );
+
+bool Is_Video_Format( const eImageFormat eFormat );
+
+bool Open_Image_Writer( sImageWriter &sWriter,
+			const char cpFileName[],
+			const eImageFormat eFormat,
+			const int iWidth,
+			const int iHeight,
+			const int iThreads,
+			const int iFrames = 1,
+			const int iFrameRate = 30 );
+
+bool Open_Indexed_Image_Writer( sImageWriter &sWriter,
+				const char cpFileName[],
+				const int iWidth,
+				const int iHeight,
+				const int iThreads,
+				const unsigned char cpPalette[],
+				const int iColors );
+
+bool Write_Image_Rows( sImageWriter &sWriter, const unsigned char cpPixels[], const int iRows );
+
+bool Close_Image_Writer( sImageWriter &sWriter );
+
+bool Open_Mapped_Image( sMappedImage &sImage,
+			const char cpFileName[],
+			const eImageFormat eFormat,
+			const int iWidth,
+			const int iHeight );
+
+bool Close_Mapped_Image( sMappedImage &sImage );
+
+#endif
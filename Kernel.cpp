@@ -0,0 +1,1054 @@
+// Name: Kernel.cpp
+// Description: Module implementation of the escape time kernels.
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "Kernel.h"
+#include <math.h>
+
+// Namespaces
+using namespace std;
+
+// CONSTANTS
+// Iterations of 0 under a Julia set's c before c is taken to be in the
+// Mandelbrot set (so that its Julia set is connected).
+const int iCONNECTED_ITERATIONS = 10000;
+
+// Vector types for the vector kernel.
+typedef double vDouble __attribute__(( vector_size( iKERNEL_LANES * sizeof( double ) ) ));
+typedef long long vLong __attribute__(( vector_size( iKERNEL_LANES * sizeof( long long ) ) ));
+
+// Description: Negates a value wherever another value is negative.  There's
+//              one for doubles and one for vectors so the formulas below can
+//              be written once for both kernels.
+// Parameters: dValue - The value to negate.
+//             dSign - The value whose sign is used.
+// Return Value: Returns -dValue where dSign is negative, otherwise dValue.
+////////////////////////////////////////////////////////////////////////////////
+static inline double Flip( const double dValue, const double dSign )
+{
+    return ( dSign < 0.0 ) ? -dValue : dValue;
+}
+
+static inline vDouble Flip( const vDouble vValue, const vDouble vSign )
+{
+    const vDouble vZero = { };
+
+    return ( vSign < vZero ) ? -vValue : vValue;
+}
+
+// Description: Raises z to a fixed integer power.
+// Method: Binary exponentiation worked out by the compiler: z^n is
+//         ( z^(n/2) )^2, times z once more when n is odd.  The recursion is on
+//         the template argument, so every power ends up as a straight run of
+//         multiplies with no loop and no call to std::pow.
+// Parameters: tZReal, tZImag - z.
+//             tReal, tImag - Set to z^iPower.
+////////////////////////////////////////////////////////////////////////////////
+template< int iPower >
+struct sPower
+{
+    template< class T >
+    static inline void Raise( const T &tZReal, const T &tZImag, T &tReal, T &tImag )
+    {
+	// Local Variables
+	T tHalfReal, tHalfImag, tTemp;
+
+	sPower< iPower / 2 >::Raise( tZReal, tZImag, tHalfReal, tHalfImag );
+
+	tReal = tHalfReal * tHalfReal - tHalfImag * tHalfImag;
+	tImag = 2.0 * tHalfReal * tHalfImag;
+
+	if( ( iPower % 2 ) != 0 )
+	{
+	    tTemp = tReal * tZReal - tImag * tZImag;
+	    tImag = tReal * tZImag + tImag * tZReal;
+	    tReal = tTemp;
+	}
+    }
+};
+
+template<>
+struct sPower< 1 >
+{
+    template< class T >
+    static inline void Raise( const T &tZReal, const T &tZImag, T &tReal, T &tImag )
+    {
+	tReal = tZReal;
+	tImag = tZImag;
+    }
+};
+
+// FORMULA POLICIES
+// Each formula is a struct with:
+//   iDEGREE - How fast |z| grows once it is large (|z| -> |z|^iDEGREE), used
+//             for the continuous escape time.
+//   Iterate - Replaces z with the next value, given z, its squares (already
+//             worked out for the escape test) and c.
+//   Derive - Replaces dz with the next value of the derivative, given the z it
+//            is taken at and the constant term (1 for dz/dc, 0 for dz/dz0).
+// The kernels take the formula as a template argument, so each one is compiled
+// into its own specialized loop for both the scalar and the vector kernel.
+
+// Multibrot: z -> z^iPower + c.
+template< int iPower >
+struct sMultibrotFormula
+{
+    static const int iDEGREE = iPower;
+
+    template< class T >
+    static inline void Iterate( T &tZReal, T &tZImag, const T &tZReal2, const T &tZImag2,
+				const T &tCReal, const T &tCImag )
+    {
+	// Local Variables
+	T tReal, tImag;
+
+	sPower< iPower >::Raise( tZReal, tZImag, tReal, tImag );
+	tZReal = tReal + tCReal;
+	tZImag = tImag + tCImag;
+    }
+
+    // dz -> iPower z^(iPower-1) dz + k
+    template< class T >
+    static inline void Derive( const T &tZReal, const T &tZImag, T &tDZReal, T &tDZImag,
+			       const double dK )
+    {
+	// Local Variables
+	T tReal, tImag, tTemp;
+
+	sPower< iPower - 1 >::Raise( tZReal, tZImag, tReal, tImag );
+	tTemp = (double)( iPower ) * ( tReal * tDZReal - tImag * tDZImag ) + dK;
+	tDZImag = (double)( iPower ) * ( tReal * tDZImag + tImag * tDZReal );
+	tDZReal = tTemp;
+    }
+};
+
+// The square reuses the squares from the escape test, in the same order the
+// kernels always did it, so the classic set is unchanged to the last bit.
+template<>
+struct sMultibrotFormula< 2 >
+{
+    static const int iDEGREE = 2;
+
+    template< class T >
+    static inline void Iterate( T &tZReal, T &tZImag, const T &tZReal2, const T &tZImag2,
+				const T &tCReal, const T &tCImag )
+    {
+	tZImag = 2.0 * tZReal * tZImag + tCImag;
+	tZReal = tZReal2 - tZImag2 + tCReal;
+    }
+
+    template< class T >
+    static inline void Derive( const T &tZReal, const T &tZImag, T &tDZReal, T &tDZImag,
+			       const double dK )
+    {
+	// Local Variables
+	T tTemp = 2.0 * ( tZReal * tDZReal - tZImag * tDZImag ) + dK;
+
+	tDZImag = 2.0 * ( tZReal * tDZImag + tZImag * tDZReal );
+	tDZReal = tTemp;
+    }
+};
+
+// Burning Ship: z -> ( |Re z| + i |Im z| )^2 + c.
+struct sBurningShipFormula
+{
+    static const int iDEGREE = 2;
+
+    template< class T >
+    static inline void Iterate( T &tZReal, T &tZImag, const T &tZReal2, const T &tZImag2,
+				const T &tCReal, const T &tCImag )
+    {
+	// Folding doesn't change the squares, only the sign of the cross term.
+	tZImag = 2.0 * Flip( tZReal, tZReal ) * Flip( tZImag, tZImag ) + tCImag;
+	tZReal = tZReal2 - tZImag2 + tCReal;
+    }
+
+    // The fold flips dz along with z, then it's the same as the square.
+    template< class T >
+    static inline void Derive( const T &tZReal, const T &tZImag, T &tDZReal, T &tDZImag,
+			       const double dK )
+    {
+	// Local Variables
+	T tReal = Flip( tZReal, tZReal );
+	T tImag = Flip( tZImag, tZImag );
+	T tFoldReal = Flip( tDZReal, tZReal );
+	T tFoldImag = Flip( tDZImag, tZImag );
+
+	tDZReal = 2.0 * ( tReal * tFoldReal - tImag * tFoldImag ) + dK;
+	tDZImag = 2.0 * ( tReal * tFoldImag + tImag * tFoldReal );
+    }
+};
+
+// Description: Works out the continuous (normalized) escape time of a point
+//              that escaped, so colors can blend smoothly between iteration
+//              bands.
+// Method: z is iterated iSMOOTH_EXTRA_ITERATIONS more times from where it
+//         escaped, then N + 1 - log_d( ln|z| ) is taken, where N counts those
+//         extra iterations too and d is the degree of the formula.  Once |z| is
+//         large it is roughly raised to the power d each iteration, so the
+//         log-log term takes away what the extra iterations added and leaves
+//         the fraction of the band the point escaped at.
+// Parameters: iterations - The number of iterations it took to escape.
+//             dZReal, dZImag - z at the escape.
+//             dCReal, dCImag - c.
+// Return Value: Returns the continuous escape time (never below 0).
+////////////////////////////////////////////////////////////////////////////////
+template< class tFormula >
+float Get_Smooth_Iterations( const int iterations,
+			     double dZReal,
+			     double dZImag,
+			     const double dCReal,
+			     const double dCImag )
+{
+    // Local Variables
+    double dZReal2 = dZReal * dZReal;
+    double dZImag2 = dZImag * dZImag;
+    double dSmooth = 0.0;
+
+    for( int i = 0; i < iSMOOTH_EXTRA_ITERATIONS; ++i )
+    {
+	tFormula::Iterate( dZReal, dZImag, dZReal2, dZImag2, dCReal, dCImag );
+	dZReal2 = dZReal * dZReal;
+	dZImag2 = dZImag * dZImag;
+    }
+
+    // ln|z| = ln( |z|^2 ) / 2
+    dSmooth = (double)( iterations + iSMOOTH_EXTRA_ITERATIONS ) + 1.0 -
+	log2( 0.5 * log( dZReal2 + dZImag2 ) ) / log2( (double)( tFormula::iDEGREE ) );
+
+    return ( dSmooth > 0.0 ) ? (float)( dSmooth ) : 0.0f;
+}
+
+// Description: Works out the exterior distance estimate of a point that
+//              escaped: roughly how far it is from the nearest point of the
+//              set.
+// Method: z and its derivative are iterated iSMOOTH_EXTRA_ITERATIONS more
+//         times from where z escaped (the estimate gets better as |z| grows),
+//         then 2 |z| ln|z| / |dz| is taken.  For the Mandelbrot and Julia sets
+//         the true distance lies between a quarter of this and the estimate
+//         itself; for the other formulas it is only a guide.
+// Parameters: dZReal, dZImag - z at the escape.
+//             dDZReal, dDZImag - The derivative at the escape.
+//             dCReal, dCImag - c.
+//             dK - The constant term of the derivative (see Derive).
+// Return Value: Returns the distance estimate.
+////////////////////////////////////////////////////////////////////////////////
+template< class tFormula >
+float Get_Distance_Estimate( double dZReal,
+			     double dZImag,
+			     double dDZReal,
+			     double dDZImag,
+			     const double dCReal,
+			     const double dCImag,
+			     const double dK )
+{
+    // Local Variables
+    double dZMagnitude2 = 0.0;
+
+    for( int i = 0; i < iSMOOTH_EXTRA_ITERATIONS; ++i )
+    {
+	tFormula::Derive( dZReal, dZImag, dDZReal, dDZImag, dK );
+	tFormula::Iterate( dZReal, dZImag, dZReal * dZReal, dZImag * dZImag, dCReal, dCImag );
+    }
+
+    dZMagnitude2 = dZReal * dZReal + dZImag * dZImag;
+
+    // 2 |z| ln|z| = |z| ln( |z|^2 )
+    return (float)( sqrt( dZMagnitude2 ) * log( dZMagnitude2 ) /
+		    sqrt( dDZReal * dDZReal + dDZImag * dDZImag ) );
+}
+
+// Description: Iterates z -> z^2 + c until z escapes the Mandelbrot set or we
+//              reach the maximum number of iterations.
+// Method: This is the loop form of the recursion in Get_Pixel_Color and does
+//         the exact same float math in the exact same order, so the counts it
+//         returns are identical; it just doesn't need a stack frame for every
+//         iteration.
+// Parameters: c - complex number that contains the distance from the center of
+//                 the Mandelbrot set.
+//             iMax_Iterations - The maximum number of iterations to do.
+//             pSmooth - When not NULL, set to the continuous escape time
+//                       (iMax_Iterations if z never escaped).
+// Return Value: Returns the number of iterations done before z escaped, or
+//               iMax_Iterations if it never did.
+////////////////////////////////////////////////////////////////////////////////
+int Get_Escape_Iterations( const complex< float > c,
+			   const int iMax_Iterations,
+			   float *pSmooth )
+{
+    // Local Variables
+    complex< float > z = 0;
+    int iterations = 0;
+
+    while( ( iterations < iMax_Iterations ) && ( std::abs(z) < 2.0f ) )
+    {
+	z = ( z * z ) + c;
+	++iterations;
+    }
+
+    if( pSmooth != NULL )
+	*pSmooth = ( iterations < iMax_Iterations ) ?
+	    Get_Smooth_Iterations< sMultibrotFormula< 2 > >( iterations, z.real(), z.imag(),
+							     c.real(), c.imag() ) :
+	    (float)( iMax_Iterations );
+
+    return iterations;
+}
+
+// Description: Iterates a formula using doubles until z escapes or we reach the
+//              maximum number of iterations.
+// Method: The real and imaginary parts are kept separately so we can reuse
+//         the squares for both the escape test (|z|^2 < 4, no square root) and
+//         the next value of z.  When bDistance is set the derivative is worked
+//         out from each z before it is replaced; it's a template argument so
+//         the plain kernel doesn't pay for it.
+// Parameters: dZReal, dZImag - The starting value of z.
+//             dCReal, dCImag - c.
+//             iMax_Iterations - The maximum number of iterations to do.
+//             dDZStart - The starting value of the derivative: 0 for dz/dc
+//                        (Mandelbrot type sets), 1 for dz/dz0 (Julia sets).
+//                        The constant term of the derivative is 1 - dDZStart.
+//             pSmooth - When not NULL, set to the continuous escape time
+//                       (iMax_Iterations if z never escaped).
+//             pDistance - Set to the distance estimate (0 if z never escaped),
+//                         only when bDistance is set.
+// Return Value: Returns the number of iterations done before z escaped, or
+//               iMax_Iterations if it never did.
+////////////////////////////////////////////////////////////////////////////////
+template< class tFormula, bool bDistance >
+int Run_Scalar_Kernel( double dZReal,
+		       double dZImag,
+		       const double dCReal,
+		       const double dCImag,
+		       const int iMax_Iterations,
+		       const double dDZStart,
+		       float *pSmooth,
+		       float *pDistance )
+{
+    // Local Variables
+    double dZReal2 = dZReal * dZReal;
+    double dZImag2 = dZImag * dZImag;
+    double dDZReal = dDZStart;
+    double dDZImag = 0.0;
+    const double dK = 1.0 - dDZStart;
+    int iterations = 0;
+
+    while( ( iterations < iMax_Iterations ) && ( ( dZReal2 + dZImag2 ) < 4.0 ) )
+    {
+	if( bDistance )
+	    tFormula::Derive( dZReal, dZImag, dDZReal, dDZImag, dK );
+
+	tFormula::Iterate( dZReal, dZImag, dZReal2, dZImag2, dCReal, dCImag );
+	dZReal2 = dZReal * dZReal;
+	dZImag2 = dZImag * dZImag;
+	++iterations;
+    }
+
+    if( bDistance )
+	*pDistance = ( iterations < iMax_Iterations ) ?
+	    Get_Distance_Estimate< tFormula >( dZReal, dZImag, dDZReal, dDZImag,
+					       dCReal, dCImag, dK ) : 0.0f;
+
+    if( pSmooth != NULL )
+	*pSmooth = ( iterations < iMax_Iterations ) ?
+	    Get_Smooth_Iterations< tFormula >( iterations, dZReal, dZImag, dCReal, dCImag ) :
+	    (float)( iMax_Iterations );
+
+    return iterations;
+}
+
+// Description: Iterates z -> z^2 + c using doubles until z escapes the
+//              Mandelbrot set or we reach the maximum number of iterations
+//              (see Run_Scalar_Kernel).
+// Parameters: dCReal, dCImag - The real and imaginary parts of c.
+//             iMax_Iterations - The maximum number of iterations to do.
+//             pSmooth - When not NULL, set to the continuous escape time
+//                       (iMax_Iterations if z never escaped).
+// Return Value: Returns the number of iterations done before z escaped, or
+//               iMax_Iterations if it never did.
+////////////////////////////////////////////////////////////////////////////////
+int Get_Escape_Iterations_Scalar( const double dCReal,
+				  const double dCImag,
+				  const int iMax_Iterations,
+				  float *pSmooth )
+{
+    return Run_Scalar_Kernel< sMultibrotFormula< 2 >, false >( 0.0, 0.0, dCReal, dCImag,
+							      iMax_Iterations, 0.0,
+							      pSmooth, NULL );
+}
+
+// Description: The scalar kernel, also carrying the derivative dz/dc so the
+//              distance to the Mandelbrot set can be estimated.
+// Parameters: dCReal, dCImag - The real and imaginary parts of c.
+//             iMax_Iterations - The maximum number of iterations to do.
+//             pDistance - Set to the distance estimate (0 if z never escaped).
+//             pSmooth - When not NULL, set to the continuous escape time.
+// Return Value: Returns the number of iterations done before z escaped, or
+//               iMax_Iterations if it never did.
+////////////////////////////////////////////////////////////////////////////////
+int Get_Escape_Distance( const double dCReal,
+			 const double dCImag,
+			 const int iMax_Iterations,
+			 float *pDistance,
+			 float *pSmooth )
+{
+    return Run_Scalar_Kernel< sMultibrotFormula< 2 >, true >( 0.0, 0.0, dCReal, dCImag,
+							     iMax_Iterations, 0.0,
+							     pSmooth, pDistance );
+}
+
+// Description: The scalar kernel run on iKERNEL_LANES points at once.
+// Method: Every lane does the same math as Run_Scalar_Kernel.  Each lane keeps
+//         an active mask (all ones while it hasn't escaped) that is subtracted
+//         from its count, so escaped lanes stop counting while the others
+//         carry on.  We stop once every lane has escaped or we reach the
+//         maximum number of iterations.  When bSmooth is set, z is also kept
+//         for each lane as it escapes so the continuous escape time can be
+//         worked out afterwards.  When bDistance is set, the derivative is
+//         carried along as well and kept with z for the distance estimate.
+//         They're template arguments so the plain kernel doesn't pay for
+//         either.
+// Parameters: dZReal[], dZImag[] - iKERNEL_LANES starting values of z.
+//             dCReal[], dCImag[] - iKERNEL_LANES values of c.
+//             iMax_Iterations - The maximum number of iterations to do.
+//             dDZStart - The starting value of the derivative (see
+//                        Run_Scalar_Kernel).
+//             iIterations[] - Filled with the iteration count of each lane.
+//             fSmooth[] - Filled with the continuous escape time of each lane
+//                         (only when bSmooth is set).
+//             fDistance[] - Filled with the distance estimate of each lane
+//                           (only when bDistance is set).
+////////////////////////////////////////////////////////////////////////////////
+template< class tFormula, bool bSmooth, bool bDistance >
+void Run_Vector_Kernel( const double dZReal[],
+			const double dZImag[],
+			const double dCReal[],
+			const double dCImag[],
+			const int iMax_Iterations,
+			const double dDZStart,
+			int iIterations[],
+			float fSmooth[],
+			float fDistance[] )
+{
+    // Local Variables
+    vDouble vCReal, vCImag, vZReal, vZImag, vZReal2, vZImag2;
+    vDouble vDZReal = { }, vDZImag = { };
+    vDouble vEscapeReal, vEscapeImag;
+    vDouble vEscapeDZReal, vEscapeDZImag;
+    vLong vActive, vCount = { };
+    const vDouble vFour = vDZImag + 4.0;
+    const double dK = 1.0 - dDZStart;
+
+    for( int i = 0; i < iKERNEL_LANES; ++i )
+    {
+	vZReal[ i ] = dZReal[ i ];
+	vZImag[ i ] = dZImag[ i ];
+	vCReal[ i ] = dCReal[ i ];
+	vCImag[ i ] = dCImag[ i ];
+    }
+
+    vZReal2 = vZReal * vZReal;
+    vZImag2 = vZImag * vZImag;
+    vDZReal += dDZStart;
+
+    // A lane that starts out past the escape radius escapes with its start.
+    vEscapeReal = vZReal;
+    vEscapeImag = vZImag;
+    vEscapeDZReal = vDZReal;
+    vEscapeDZImag = vDZImag;
+    vActive = ( vZReal2 + vZImag2 ) < vFour;
+
+    for( int iterations = 0; iterations < iMax_Iterations; ++iterations )
+    {
+	// Local Variables
+	long long llAnyActive = 0;
+
+	if( bSmooth || bDistance )
+	{
+	    vLong vStillActive = vActive & ( ( vZReal2 + vZImag2 ) < vFour );
+	    vLong vEscaped = vActive & ~vStillActive;
+
+	    vEscapeReal = vEscaped ? vZReal : vEscapeReal;
+	    vEscapeImag = vEscaped ? vZImag : vEscapeImag;
+
+	    if( bDistance )
+	    {
+		vEscapeDZReal = vEscaped ? vDZReal : vEscapeDZReal;
+		vEscapeDZImag = vEscaped ? vDZImag : vEscapeDZImag;
+	    }
+
+	    vActive = vStillActive;
+	}
+	else
+	    vActive &= ( ( vZReal2 + vZImag2 ) < vFour );
+
+	// Stop once every lane has escaped.
+	for( int i = 0; i < iKERNEL_LANES; ++i )
+	    llAnyActive |= vActive[ i ];
+
+	if( llAnyActive == 0 )
+	    break;
+
+	vCount -= vActive;
+
+	if( bDistance )
+	    tFormula::Derive( vZReal, vZImag, vDZReal, vDZImag, dK );
+
+	tFormula::Iterate( vZReal, vZImag, vZReal2, vZImag2, vCReal, vCImag );
+	vZReal2 = vZReal * vZReal;
+	vZImag2 = vZImag * vZImag;
+    }
+
+    for( int i = 0; i < iKERNEL_LANES; ++i )
+    {
+	iIterations[ i ] = (int)( vCount[ i ] );
+
+	if( bSmooth )
+	    fSmooth[ i ] = ( iIterations[ i ] < iMax_Iterations ) ?
+		Get_Smooth_Iterations< tFormula >( iIterations[ i ], vEscapeReal[ i ],
+						   vEscapeImag[ i ], dCReal[ i ], dCImag[ i ] ) :
+		(float)( iMax_Iterations );
+
+	if( bDistance )
+	    fDistance[ i ] = ( iIterations[ i ] < iMax_Iterations ) ?
+		Get_Distance_Estimate< tFormula >( vEscapeReal[ i ], vEscapeImag[ i ],
+						   vEscapeDZReal[ i ], vEscapeDZImag[ i ],
+						   dCReal[ i ], dCImag[ i ], dK ) : 0.0f;
+    }
+}
+
+// Description: Runs the vector kernel of a formula with only the extras that
+//              were asked for.
+// Parameters: See Run_Vector_Kernel.  fSmooth[] and fDistance[] may be NULL.
+////////////////////////////////////////////////////////////////////////////////
+template< class tFormula >
+void Run_Vector_Lanes( const double dZReal[],
+		       const double dZImag[],
+		       const double dCReal[],
+		       const double dCImag[],
+		       const int iMax_Iterations,
+		       const double dDZStart,
+		       int iIterations[],
+		       float fSmooth[],
+		       float fDistance[] )
+{
+    if( fDistance != NULL )
+    {
+	if( fSmooth != NULL )
+	    Run_Vector_Kernel< tFormula, true, true >( dZReal, dZImag, dCReal, dCImag,
+						       iMax_Iterations, dDZStart, iIterations,
+						       fSmooth, fDistance );
+	else
+	    Run_Vector_Kernel< tFormula, false, true >( dZReal, dZImag, dCReal, dCImag,
+							iMax_Iterations, dDZStart, iIterations,
+							NULL, fDistance );
+    }
+    else if( fSmooth != NULL )
+	Run_Vector_Kernel< tFormula, true, false >( dZReal, dZImag, dCReal, dCImag,
+						    iMax_Iterations, dDZStart, iIterations,
+						    fSmooth, NULL );
+    else
+	Run_Vector_Kernel< tFormula, false, false >( dZReal, dZImag, dCReal, dCImag,
+						     iMax_Iterations, dDZStart, iIterations,
+						     NULL, NULL );
+}
+
+// Description: The z -> z^2 + c scalar kernel run on iKERNEL_LANES points at
+//              once (see Run_Vector_Kernel).
+// Parameters: dCReal[], dCImag[] - iKERNEL_LANES values of c.
+//             iMax_Iterations - The maximum number of iterations to do.
+//             iIterations[] - Filled with the iteration count of each lane.
+//             fSmooth[] - When not NULL, filled with the continuous escape
+//                         time of each lane.
+//             fDistance[] - When not NULL, filled with the distance estimate
+//                           of each lane.
+////////////////////////////////////////////////////////////////////////////////
+void Get_Escape_Iterations_Vector( const double dCReal[],
+				   const double dCImag[],
+				   const int iMax_Iterations,
+				   int iIterations[],
+				   float fSmooth[],
+				   float fDistance[] )
+{
+    // Local Variables
+    const double dZero[ iKERNEL_LANES ] = { };
+
+    Run_Vector_Lanes< sMultibrotFormula< 2 > >( dZero, dZero, dCReal, dCImag, iMax_Iterations,
+						0.0, iIterations, fSmooth, fDistance );
+}
+
+// Description: Runs the scalar or vector kernel of one formula over a row of
+//              points that share the same imaginary part.
+// Method: For a Julia set each point is the starting z and c is fixed; for
+//         everything else z starts at 0 and each point is c.  The vector
+//         kernel takes the row in groups of lanes; the last group is padded by
+//         repeating the last point.
+// Parameters: See Get_Escape_Row.
+////////////////////////////////////////////////////////////////////////////////
+template< class tFormula >
+void Run_Formula_Row( const eKernelType eKernel,
+		      const sIterationFormula &sFormula,
+		      const double dCReal[],
+		      const double dCImag,
+		      const int iCount,
+		      const int iMax_Iterations,
+		      int iIterations[],
+		      float fSmooth[],
+		      float fDistance[] )
+{
+    // Local Variables
+    const double dDZStart = sFormula.bJulia ? 1.0 : 0.0;
+    const double dZImag = sFormula.bJulia ? dCImag : 0.0;
+    const double dJuliaReal = sFormula.dJuliaReal;
+    const double dJuliaImag = sFormula.bJulia ? sFormula.dJuliaImag : dCImag;
+
+    if( eKernel != eKERNEL_VECTOR )
+    {
+	for( int i = 0; i < iCount; ++i )
+	{
+	    // Local Variables
+	    const double dZReal = sFormula.bJulia ? dCReal[ i ] : 0.0;
+	    const double dPointReal = sFormula.bJulia ? dJuliaReal : dCReal[ i ];
+	    float *pSmooth = ( fSmooth != NULL ) ? &fSmooth[ i ] : NULL;
+
+	    if( fDistance != NULL )
+		iIterations[ i ] = Run_Scalar_Kernel< tFormula, true >( dZReal, dZImag, dPointReal,
+									 dJuliaImag, iMax_Iterations,
+									 dDZStart, pSmooth,
+									 &fDistance[ i ] );
+	    else
+		iIterations[ i ] = Run_Scalar_Kernel< tFormula, false >( dZReal, dZImag, dPointReal,
+									  dJuliaImag, iMax_Iterations,
+									  dDZStart, pSmooth, NULL );
+	}
+    }
+    else
+    {
+	// Local Variables
+	double dLaneZReal[ iKERNEL_LANES ];
+	double dLaneZImag[ iKERNEL_LANES ];
+	double dLaneCReal[ iKERNEL_LANES ];
+	double dLaneCImag[ iKERNEL_LANES ];
+	int iLaneIterations[ iKERNEL_LANES ];
+	float fLaneSmooth[ iKERNEL_LANES ];
+	float fLaneDistance[ iKERNEL_LANES ];
+
+	for( int l = 0; l < iKERNEL_LANES; ++l )
+	{
+	    dLaneZReal[ l ] = 0.0;
+	    dLaneZImag[ l ] = dZImag;
+	    dLaneCReal[ l ] = dJuliaReal;
+	    dLaneCImag[ l ] = dJuliaImag;
+	}
+
+	for( int i = 0; i < iCount; i += iKERNEL_LANES )
+	{
+	    int iLanes = ( iCount - i < iKERNEL_LANES ) ? ( iCount - i ) : iKERNEL_LANES;
+
+	    for( int l = 0; l < iKERNEL_LANES; ++l )
+	    {
+		double dPoint = dCReal[ i + ( ( l < iLanes ) ? l : ( iLanes - 1 ) ) ];
+
+		if( sFormula.bJulia )
+		    dLaneZReal[ l ] = dPoint;
+		else
+		    dLaneCReal[ l ] = dPoint;
+	    }
+
+	    Run_Vector_Lanes< tFormula >( dLaneZReal, dLaneZImag, dLaneCReal, dLaneCImag,
+					  iMax_Iterations, dDZStart, iLaneIterations,
+					  ( fSmooth != NULL ) ? fLaneSmooth : NULL,
+					  ( fDistance != NULL ) ? fLaneDistance : NULL );
+
+	    for( int l = 0; l < iLanes; ++l )
+	    {
+		iIterations[ i + l ] = iLaneIterations[ l ];
+
+		if( fSmooth != NULL )
+		    fSmooth[ i + l ] = fLaneSmooth[ l ];
+
+		if( fDistance != NULL )
+		    fDistance[ i + l ] = fLaneDistance[ l ];
+	    }
+	}
+    }
+}
+
+// Description: Calls the Run< tFormula >() member of a visitor with the policy
+//              of a formula, so whatever the visitor does is compiled for every
+//              formula while the formula itself is only looked up once.
+// Parameters: sFormula - The formula.
+//             sVisitor - The visitor.
+////////////////////////////////////////////////////////////////////////////////
+template< class tVisitor >
+void Visit_Formula( const sIterationFormula &sFormula, tVisitor &sVisitor )
+{
+    if( sFormula.eType == eFORMULA_BURNING_SHIP )
+    {
+	sVisitor.template Run< sBurningShipFormula >();
+	return;
+    }
+
+    switch( sFormula.iPower )
+    {
+	case 3:
+	    sVisitor.template Run< sMultibrotFormula< 3 > >();
+	    break;
+	case 4:
+	    sVisitor.template Run< sMultibrotFormula< 4 > >();
+	    break;
+	case 5:
+	    sVisitor.template Run< sMultibrotFormula< 5 > >();
+	    break;
+	case 6:
+	    sVisitor.template Run< sMultibrotFormula< 6 > >();
+	    break;
+	case 7:
+	    sVisitor.template Run< sMultibrotFormula< 7 > >();
+	    break;
+	case 8:
+	    sVisitor.template Run< sMultibrotFormula< 8 > >();
+	    break;
+	default:
+	    sVisitor.template Run< sMultibrotFormula< 2 > >();
+	    break;
+    }
+}
+
+// ROW VISITOR STRUCTURE
+// Parts: The arguments of Get_Escape_Row, handed to Run_Formula_Row.
+////////////////////////////////////////////////////////////////////////////////
+struct sRowVisitor
+{
+    const eKernelType eKernel;
+    const sIterationFormula &sFormula;
+    const double *dCReal;
+    const double dCImag;
+    const int iCount;
+    const int iMax_Iterations;
+    int *iIterations;
+    float *fSmooth;
+    float *fDistance;
+
+    template< class tFormula >
+    void Run( )
+    {
+	Run_Formula_Row< tFormula >( eKernel, sFormula, dCReal, dCImag, iCount, iMax_Iterations,
+				     iIterations, fSmooth, fDistance );
+    }
+};
+
+// LANE VISITOR STRUCTURE
+// Parts: The arguments of Get_Escape_Lanes.
+////////////////////////////////////////////////////////////////////////////////
+struct sLaneVisitor
+{
+    const sIterationFormula &sFormula;
+    const double *dPointReal;
+    const double *dPointImag;
+    const int iMax_Iterations;
+    int *iIterations;
+
+    template< class tFormula >
+    void Run( )
+    {
+	// Local Variables
+	const double dZero[ iKERNEL_LANES ] = { };
+	double dJuliaReal[ iKERNEL_LANES ];
+	double dJuliaImag[ iKERNEL_LANES ];
+
+	if( !sFormula.bJulia )
+	{
+	    Run_Vector_Lanes< tFormula >( dZero, dZero, dPointReal, dPointImag, iMax_Iterations,
+					  0.0, iIterations, NULL, NULL );
+	    return;
+	}
+
+	for( int l = 0; l < iKERNEL_LANES; ++l )
+	{
+	    dJuliaReal[ l ] = sFormula.dJuliaReal;
+	    dJuliaImag[ l ] = sFormula.dJuliaImag;
+	}
+
+	Run_Vector_Lanes< tFormula >( dPointReal, dPointImag, dJuliaReal, dJuliaImag,
+				      iMax_Iterations, 1.0, iIterations, NULL, NULL );
+    }
+};
+
+// JULIA ROW VISITOR STRUCTURE
+// Parts: The arguments of Get_Julia_Row.
+////////////////////////////////////////////////////////////////////////////////
+struct sJuliaRowVisitor
+{
+    const double *dZReal;
+    const double dZImag;
+    const int iCount;
+    const double *dJuliaReal;
+    const double *dJuliaImag;
+    const int iMax_Iterations;
+    int *iIterations;
+    float *fSmooth;
+
+    template< class tFormula >
+    void Run( )
+    {
+	// Local Variables
+	double dLaneZReal[ iKERNEL_LANES ];
+	double dLaneZImag[ iKERNEL_LANES ];
+
+	for( int l = 0; l < iKERNEL_LANES; ++l )
+	    dLaneZImag[ l ] = dZImag;
+
+	for( int i = 0; i < iCount; ++i )
+	{
+	    for( int l = 0; l < iKERNEL_LANES; ++l )
+		dLaneZReal[ l ] = dZReal[ i ];
+
+	    Run_Vector_Lanes< tFormula >( dLaneZReal, dLaneZImag, dJuliaReal, dJuliaImag,
+					  iMax_Iterations, 1.0, &iIterations[ i * iKERNEL_LANES ],
+					  ( fSmooth != NULL ) ? &fSmooth[ i * iKERNEL_LANES ] : NULL,
+					  NULL );
+	}
+    }
+};
+
+// ORBIT VISITOR STRUCTURE
+// Parts: The arguments of Get_Orbit.
+////////////////////////////////////////////////////////////////////////////////
+struct sOrbitVisitor
+{
+    const sIterationFormula &sFormula;
+    const double dPointReal;
+    const double dPointImag;
+    const int iCount;
+    double *dOrbitReal;
+    double *dOrbitImag;
+
+    template< class tFormula >
+    void Run( )
+    {
+	// Local Variables
+	double dZReal = sFormula.bJulia ? dPointReal : 0.0;
+	double dZImag = sFormula.bJulia ? dPointImag : 0.0;
+	const double dCReal = sFormula.bJulia ? sFormula.dJuliaReal : dPointReal;
+	const double dCImag = sFormula.bJulia ? sFormula.dJuliaImag : dPointImag;
+
+	for( int i = 0; i < iCount; ++i )
+	{
+	    tFormula::Iterate( dZReal, dZImag, dZReal * dZReal, dZImag * dZImag, dCReal, dCImag );
+	    dOrbitReal[ i ] = dZReal;
+	    dOrbitImag[ i ] = dZImag;
+	}
+    }
+};
+
+// Description: Sets up a formula for the classic Mandelbrot set, z -> z^2 + c.
+// Return Value: Returns the formula.
+////////////////////////////////////////////////////////////////////////////////
+sIterationFormula Initiate_Formula( )
+{
+    // Local Variables
+    sIterationFormula sFormula;
+
+    sFormula.eType = eFORMULA_MULTIBROT;
+    sFormula.iPower = 2;
+    sFormula.bJulia = false;
+    sFormula.dJuliaReal = 0.0;
+    sFormula.dJuliaImag = 0.0;
+
+    return sFormula;
+}
+
+// Description: Checks whether a formula is the classic Mandelbrot set, the
+//              only one the float reference kernel does.
+// Parameters: sFormula - The formula to check.
+// Return Value: Returns true for z -> z^2 + c with z starting at 0.
+////////////////////////////////////////////////////////////////////////////////
+bool Is_Classic_Formula( const sIterationFormula &sFormula )
+{
+    return ( sFormula.eType == eFORMULA_MULTIBROT ) && ( sFormula.iPower == 2 ) &&
+	!sFormula.bJulia;
+}
+
+// Description: Checks whether a formula's distance estimate bounds the true
+//              distance to its set (see Get_Distance_Estimate), so that parts
+//              of the image can be known to be far from the set without being
+//              drawn.
+// Method: The bound (a quarter of the estimate) comes from the Koebe quarter
+//         theorem, which needs the set to be connected.  The Mandelbrot set
+//         is, and so is the Julia set of a c in it, but the Julia set of a c
+//         outside it is dust.  c is taken to be in the Mandelbrot set if the
+//         orbit of 0 stays within the escape radius for
+//         iCONNECTED_ITERATIONS iterations.
+// Parameters: sFormula - The formula to check.
+// Return Value: Returns true for the Mandelbrot set and the connected Julia
+//               sets of z -> z^2 + c.
+////////////////////////////////////////////////////////////////////////////////
+bool Has_Distance_Bound( const sIterationFormula &sFormula )
+{
+    // Local Variables
+    double dZReal = 0.0;
+    double dZImag = 0.0;
+
+    if( ( sFormula.eType != eFORMULA_MULTIBROT ) || ( sFormula.iPower != 2 ) )
+	return false;
+
+    if( !sFormula.bJulia )
+	return true;
+
+    for( int i = 0; i < iCONNECTED_ITERATIONS; ++i )
+    {
+	// Local Variables
+	const double dTemp = dZReal * dZReal - dZImag * dZImag + sFormula.dJuliaReal;
+
+	dZImag = 2.0 * dZReal * dZImag + sFormula.dJuliaImag;
+	dZReal = dTemp;
+
+	if( !( dZReal * dZReal + dZImag * dZImag <= 4.0 ) )
+	    return false;
+    }
+
+    return true;
+}
+
+// Description: Checks whether the set a formula draws is its own mirror image
+//              across the real axis.
+// Method: With a real polynomial, conj( z ) iterates to the conjugate of
+//         whatever z iterates to, so Multibrot sets are symmetric, and so are
+//         their Julia sets when c is real.  The Burning Ship's fold breaks the
+//         symmetry.
+// Parameters: sFormula - The formula to check.
+// Return Value: Returns true if the set is symmetric.
+////////////////////////////////////////////////////////////////////////////////
+bool Is_Mirror_Symmetric( const sIterationFormula &sFormula )
+{
+    return ( sFormula.eType == eFORMULA_MULTIBROT ) &&
+	( !sFormula.bJulia || ( sFormula.dJuliaImag == 0.0 ) );
+}
+
+// Description: Runs the requested kernel over a row of points that share the
+//              same imaginary part.
+// Method: The reference kernel works in floats, so c is rounded to floats
+//         first.  It only does the classic set without distances; anything
+//         else needs doubles, so the reference kernel runs the scalar one.
+//         Otherwise the formula is looked up once for the row and the row is
+//         handed to the kernel compiled for it.
+// Parameters: eKernel - The kernel to run.
+//             sFormula - The formula to iterate.
+//             dCReal[] - The real part of each point.
+//             dCImag - The imaginary part shared by the row.
+//             iCount - The number of points in the row.
+//             iMax_Iterations - The maximum number of iterations to do.
+//             iIterations[] - Filled with the iteration count of each point.
+//             fSmooth[] - When not NULL, filled with the continuous escape
+//                         time of each point.
+//             fDistance[] - When not NULL, filled with the distance estimate
+//                           of each point.
+////////////////////////////////////////////////////////////////////////////////
+void Get_Escape_Row( const eKernelType eKernel,
+		     const sIterationFormula &sFormula,
+		     const double dCReal[],
+		     const double dCImag,
+		     const int iCount,
+		     const int iMax_Iterations,
+		     int iIterations[],
+		     float fSmooth[],
+		     float fDistance[] )
+{
+    if( ( eKernel == eKERNEL_REFERENCE ) && ( fDistance == NULL ) &&
+	Is_Classic_Formula( sFormula ) )
+    {
+	for( int i = 0; i < iCount; ++i )
+	    iIterations[ i ] = Get_Escape_Iterations( complex< float >( (float)( dCReal[ i ] ),
+									(float)( dCImag ) ),
+						      iMax_Iterations,
+						      ( fSmooth != NULL ) ? &fSmooth[ i ] : NULL );
+    }
+    else
+    {
+	// Local Variables
+	sRowVisitor sVisitor = { eKernel, sFormula, dCReal, dCImag, iCount, iMax_Iterations,
+				 iIterations, fSmooth, fDistance };
+
+	Visit_Formula( sFormula, sVisitor );
+    }
+}
+
+// Description: Runs the vector kernel of a formula on iKERNEL_LANES points
+//              that each have their own imaginary part (see Run_Vector_Kernel).
+// Parameters: sFormula - The formula to iterate.
+//             dPointReal[], dPointImag[] - iKERNEL_LANES points: c, or the
+//                                          starting z of a Julia set.
+//             iMax_Iterations - The maximum number of iterations to do.
+//             iIterations[] - Filled with the iteration count of each lane.
+////////////////////////////////////////////////////////////////////////////////
+void Get_Escape_Lanes( const sIterationFormula &sFormula,
+		       const double dPointReal[],
+		       const double dPointImag[],
+		       const int iMax_Iterations,
+		       int iIterations[] )
+{
+    // Local Variables
+    sLaneVisitor sVisitor = { sFormula, dPointReal, dPointImag, iMax_Iterations, iIterations };
+
+    Visit_Formula( sFormula, sVisitor );
+}
+
+// Description: Runs the vector kernel of a formula over a row of starting
+//              points for iKERNEL_LANES Julia sets at once.
+// Method: Each lane has its own c, and every point of the row is run in all of
+//         the lanes together, so a group of lanes draws the same pixel of
+//         several Julia sets (see Run_Vector_Kernel).  When the sets are of
+//         neighbouring values of c their orbits take about as long, so the
+//         lanes rarely wait on each other.
+// Parameters: sFormula - The formula to iterate (its own c is ignored).
+//             dZReal[] - The real part of each starting point.
+//             dZImag - The imaginary part shared by the row.
+//             iCount - The number of points in the row.
+//             dJuliaReal[], dJuliaImag[] - The c of each of the iKERNEL_LANES
+//                                          lanes.
+//             iMax_Iterations - The maximum number of iterations to do.
+//             iIterations[] - Filled with the iteration count of each point in
+//                             each lane, lane by lane for each point
+//                             (iCount * iKERNEL_LANES long).
+//             fSmooth[] - When not NULL, filled with the continuous escape
+//                         time of each point in each lane, laid out the same.
+////////////////////////////////////////////////////////////////////////////////
+void Get_Julia_Row( const sIterationFormula &sFormula,
+		    const double dZReal[],
+		    const double dZImag,
+		    const int iCount,
+		    const double dJuliaReal[],
+		    const double dJuliaImag[],
+		    const int iMax_Iterations,
+		    int iIterations[],
+		    float fSmooth[] )
+{
+    // Local Variables
+    sJuliaRowVisitor sVisitor = { dZReal, dZImag, iCount, dJuliaReal, dJuliaImag, iMax_Iterations,
+				  iIterations, fSmooth };
+
+    Visit_Formula( sFormula, sVisitor );
+}
+
+// Description: Works out the orbit of a point: the values z takes after each
+//              of the first iCount iterations.
+// Parameters: sFormula - The formula to iterate.
+//             dPointReal, dPointImag - c, or the starting z of a Julia set.
+//             iCount - The number of iterations to do.
+//             dOrbitReal[], dOrbitImag[] - Filled with z after each iteration
+//                                          (iCount long).
+////////////////////////////////////////////////////////////////////////////////
+void Get_Orbit( const sIterationFormula &sFormula,
+		const double dPointReal,
+		const double dPointImag,
+		const int iCount,
+		double dOrbitReal[],
+		double dOrbitImag[] )
+{
+    // Local Variables
+    sOrbitVisitor sVisitor = { sFormula, dPointReal, dPointImag, iCount, dOrbitReal, dOrbitImag };
+
+    Visit_Formula( sFormula, sVisitor );
+}
@@ -0,0 +1,137 @@
+// Name: Kernel.h
+// Description: Header for the escape time kernels.  The kernels only work out
+//              how many iterations a point of the complex plane takes to
+//              escape (and, if asked, the continuous escape time and the
+//              distance to the set); turning that into a color is left to
+//              the caller.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef KERNEL_H
+#define KERNEL_H
+
+// INCLUDES
+#include <complex>
+#include <cstddef>
+
+// CONSTANTS
+// Points done at once by the vector kernel.  Matched to the widest vector
+// registers the compiler is targeting, since wider vectors than the hardware
+// has get split up and end up slower than the scalar kernel.
+#if defined( __AVX512F__ )
+const int iKERNEL_LANES = 8;
+#elif defined( __AVX__ )
+const int iKERNEL_LANES = 4;
+#else
+const int iKERNEL_LANES = 2;
+#endif
+
+// Extra iterations done past the escape before working out the continuous
+// escape time.  Letting |z| grow well past the escape radius is what makes the
+// fractional part continuous from one iteration band to the next.
+const int iSMOOTH_EXTRA_ITERATIONS = 4;
+
+// Highest power of z the Multibrot formula is compiled for.
+const int iMAX_FORMULA_POWER = 8;
+
+// Enum to identify the different escape time kernels.
+//   eKERNEL_REFERENCE - complex< float > math, identical to Get_Pixel_Color.
+//   eKERNEL_SCALAR - double math on the real and imaginary parts, comparing
+//                    |z|^2 against 4 so there's no square root.
+//   eKERNEL_VECTOR - The scalar kernel run on iKERNEL_LANES points at once
+//                    using the compiler's vector extensions.
+// The reference kernel only does the classic Mandelbrot set; for any other
+// formula it runs the scalar kernel.
+enum eKernelType
+{
+    eKERNEL_REFERENCE = 0,
+    eKERNEL_SCALAR = 1,
+    eKERNEL_VECTOR = 2
+};
+
+// Enum to identify the different iteration formulas.
+//   eFORMULA_MULTIBROT - z -> z^p + c (p = 2 is the Mandelbrot set).
+//   eFORMULA_BURNING_SHIP - z -> ( |Re z| + i |Im z| )^2 + c.
+enum eFormulaType
+{
+    eFORMULA_MULTIBROT = 0,
+    eFORMULA_BURNING_SHIP = 1
+};
+
+// FORMULA STRUCTURE
+// The formula the kernels iterate.  For a Julia set c is fixed at
+// dJuliaReal + i dJuliaImag and each point of the plane is the starting z;
+// otherwise z starts at 0 and each point is c.
+struct sIterationFormula
+{
+    eFormulaType eType;
+    int iPower;			// 2 to iMAX_FORMULA_POWER, Multibrot only
+    bool bJulia;
+    double dJuliaReal;
+    double dJuliaImag;
+};
+
+// FUNCTION DECLARATIONS
+sIterationFormula Initiate_Formula( );
+
+bool Is_Classic_Formula( const sIterationFormula &sFormula );
+
+bool Has_Distance_Bound( const sIterationFormula &sFormula );
+
+bool Is_Mirror_Symmetric( const sIterationFormula &sFormula );
+
+int Get_Escape_Iterations( const std::complex< float > c,
+			   const int iMax_Iterations,
+			   float *pSmooth = NULL );
+
+int Get_Escape_Iterations_Scalar( const double dCReal,
+				  const double dCImag,
+				  const int iMax_Iterations,
+				  float *pSmooth = NULL );
+
+int Get_Escape_Distance( const double dCReal,
+			 const double dCImag,
+			 const int iMax_Iterations,
+			 float *pDistance,
+			 float *pSmooth = NULL );
+
+void Get_Escape_Iterations_Vector( const double dCReal[],
+				   const double dCImag[],
+				   const int iMax_Iterations,
+				   int iIterations[],
+				   float fSmooth[] = NULL,
+				   float fDistance[] = NULL );
+
+void Get_Escape_Row( const eKernelType eKernel,
+		     const sIterationFormula &sFormula,
+		     const double dCReal[],
+		     const double dCImag,
+		     const int iCount,
+		     const int iMax_Iterations,
+		     int iIterations[],
+		     float fSmooth[] = NULL,
+		     float fDistance[] = NULL );
+
+void Get_Escape_Lanes( const sIterationFormula &sFormula,
+		       const double dPointReal[],
+		       const double dPointImag[],
+		       const int iMax_Iterations,
+		       int iIterations[] );
+
+void Get_Julia_Row( const sIterationFormula &sFormula,
+		    const double dZReal[],
+		    const double dZImag,
+		    const int iCount,
+		    const double dJuliaReal[],
+		    const double dJuliaImag[],
+		    const int iMax_Iterations,
+		    int iIterations[],
+		    float fSmooth[] = NULL );
+
+void Get_Orbit( const sIterationFormula &sFormula,
+		const double dPointReal,
+		const double dPointImag,
+		const int iCount,
+		double dOrbitReal[],
+		double dOrbitImag[] );
+
+#endif
@@ -1,109 +1,140 @@
 // Name: Mandelbrot.cpp
 // Description: Module implementation of the Mandelbrot Image making module.
-// Known Issues: Unsure how to get smoothing to work.  Don't entirely understand
-//               the algorithm and, therefore, it isn't implemented.
 // Written By: James Coté
 ////////////////////////////////////////////////////////////////////////////////
 
 // INCLUDES
 #include "Mandelbrot.h"
-#include <Magick++.h>
+#include "Atlas.h"
+#include "Buddhabrot.h"
+#include "Color.h"
+#include "Encoder.h"
+#include "Kernel.h"
+#include "Numa.h"
+#include "Pipeline.h"
+#include "ThreadPool.h"
+#include "Trace.h"
 #include <complex>
 #include <math.h>
-#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
 
 // Namespaces
-using namespace Magick;
 using namespace std;
 
 // CONSTANTS
-const int iPROGRESS_BAR_SIZE = 80;
-
-// Bounds of our complex Plane
+// Default bounds of our complex Plane
 const float fCXMIN = -2.5f;
 const float fCXMAX = 1.0f;
 const float fCYMIN = -1.0f;
 const float fCYMAX = 1.0f;
 
-// Description: Recursive function that outputs a Progress Bar based on a
-//              desired size constant and a percentage of completion of
-//              compiling the image.
-// Method: If it's the first iteration (special case), we output the start of
-//         the progress bar: '['.  For each subsequent iteration we determine if
-//         we output a space or a bar character depending on how much of the
-//         image we have left to fill.  This is modified based on the desired
-//         size of the bar to ensure the percentage complete is accurate,
-//         regardless of the bar size.  This function will iterate iPROGRESS_BAR
-//         _SIZE times and will output the closing ']' on the last iteration.
-//         NOTE: This function is only to output the Bar, it doesn't output the
-//         progress information that precedes the bar.  We also end our output
-//         with the character '\r' to reset our cursor to the beginning of the
-//         buffer.  We then flush the buffer to ensure it's properly cleared.
-// Parameters: iPercent - Integer that tells us how much of the image we have
-//                        completed.  Assumed to be already truncated to be
-//                        relative to the size of the progress bar when passed
-//                        in.
-//             iIterations - Recursive flag.  When we recursively call this 
-//                           function again, we add one to this variable and 
-//                           exit back through the stack once the iterations ==
-//                           the size of the progress bar.
-////////////////////////////////////////////////////////////////////////////////
-void Output_Progress_Bar( int iPercent, int iIterations = 0 )
-{
-    // Special case for start of bar
-    if( iIterations == 0 )
-	cout << '[';
-
-    // each node: determine whether we output a Bar character or a space.
-    if( iPercent >= iIterations )
-	cout << (char)(219);
-    else
-	cout << ' ';
+// Default width/height of the render tiles.
+const int iDEFAULT_TILE_SIZE = 64;
 
-    // Recursive Check
-    if( iIterations < iPROGRESS_BAR_SIZE )
-	Output_Progress_Bar( iPercent, ( iIterations + 1 ) );
-    else
-    {
-	cout << "]\r";
-	cout.flush();
-    }
+// Description: Returns the default viewport, which shows the whole set.
+////////////////////////////////////////////////////////////////////////////////
+sViewport Initiate_Viewport( )
+{
+    sViewport sReturnValue;
+
+    sReturnValue.dXMin = fCXMIN;
+    sReturnValue.dXMax = fCXMAX;
+    sReturnValue.dYMin = fCYMIN;
+    sReturnValue.dYMax = fCYMAX;
+
+    return sReturnValue;
+}
+
+// Description: This function initializes the sRenderOptions struct to the default
+//              settings and returns the newly created sRenderOptions.  Every
+//              caller (the program, the embeddable renderer and the tools)
+//              starts from these and overrides only what it needs.
+// Defaults: The whole set, one worker thread per hardware thread, 64x64 tiles,
+//           the reference kernel drawing every pixel of the Mandelbrot set,
+//           linear coloring, the progress bar shown on the console and no
+//           statistics output.
+// Return Value: Returns a sRenderOptions variable set to the default parameters.
+////////////////////////////////////////////////////////////////////////////////
+sRenderOptions Initiate_Render_Options( )
+{
+    sRenderOptions sReturnValue;
+
+    sReturnValue.sView     = Initiate_Viewport( );
+    sReturnValue.iThreads  = 0;
+    sReturnValue.iTileSize = iDEFAULT_TILE_SIZE;
+    sReturnValue.eKernel   = eKERNEL_REFERENCE;
+    sReturnValue.sFormula  = Initiate_Formula( );
+    sReturnValue.eTraversal = eTRAVERSAL_TILED;
+    sReturnValue.eColoring = eCOLOR_LINEAR;
+    sReturnValue.eProgress = ePROGRESS_BAR;
+    sReturnValue.eStats    = eSTATS_NONE;
+    sReturnValue.cpStatsFile = NULL;
+    sReturnValue.cpTraceFile = NULL;
+    sReturnValue.llOrbitSamples = 0;
+    sReturnValue.bMapped = false;
+    sReturnValue.bStdout = false;
+    sReturnValue.iFrames = 1;
+    sReturnValue.dFrameZoom = 1.0;
+    sReturnValue.iFrameRate = 30;
+    sReturnValue.bIndexed = false;
+    sReturnValue.bNuma = false;
+    sReturnValue.iAtlasSize = 0;
+    sReturnValue.pPool = NULL;
+
+    return sReturnValue;
 }
 
-// Description: Isolated function to output progress text then call the
-//              recursive "Output_Progress_Bar" function to visually show the
-//              current progress of the program.
-// Method: Fairly simple.  Output the total Progress as a percent then call on
-//         the Output_Progress_Bar function to recursively draw the visual
-//         progress of the program.
-// Parameters: iPercentComplete - True percentage of completion.  We output this
-//                                to the user then pass it into the Progress Bar
-//                                function.
+// Description: Builds a viewport around a point of the complex plane.
+// Method: The width of the plane to show is given and the height is worked
+//         out from the shape of the image so the pixels stay square.
+// Parameters: dCenterX, dCenterY - The point of the plane in the middle of
+//                                  the image.
+//             dSpanX - The width of the plane to show.
+//             iWidth, iHeight - The size of the image.
+// Return Value: Returns the new viewport.
 ////////////////////////////////////////////////////////////////////////////////
-void Show_Progress( int iPercentComplete )
+sViewport Get_Centered_Viewport( const double dCenterX,
+				 const double dCenterY,
+				 const double dSpanX,
+				 const int iWidth,
+				 const int iHeight )
 {
-    cout << "Progress: " << iPercentComplete << "%";
-    Output_Progress_Bar( ( iPercentComplete * iPROGRESS_BAR_SIZE ) / 100 );
+    // Local Variables
+    sViewport sReturnValue;
+    double dSpanY = dSpanX * (double)( iHeight ) / (double)( iWidth );
+
+    sReturnValue.dXMin = dCenterX - dSpanX / 2.0;
+    sReturnValue.dXMax = dCenterX + dSpanX / 2.0;
+    sReturnValue.dYMin = dCenterY - dSpanY / 2.0;
+    sReturnValue.dYMax = dCenterY + dSpanY / 2.0;
+
+    return sReturnValue;
 }
 
-// Description: Inverts the color values of a provided ColorRGB object.  Used
+// Description: Inverts the color values of a provided sPixelColor.  Used
 //              multiple times in the program.
 // Method: Take the colors and subtract them from 1.0f to get the opposite value
 //         (.70 -> .30, 1.0 -> 0.0, etc.).
-// Parameters: Color - A ColorRGB object that's passed by reference.  Each value
-//                     of the object is manipulated then the function returns.
+// Parameters: Color - An sPixelColor that's passed by reference.  Each value
+//                     of it is manipulated then the function returns.
 ////////////////////////////////////////////////////////////////////////////////
-void Invert_Colors( ColorRGB &Color )
+void Invert_Colors( sPixelColor &Color )
 {
-    Color.red( 1.0f - Color.red() );
-    Color.green( 1.0f - Color.green() );
-    Color.blue( 1.0f - Color.blue() );
+    Color.dRed = 1.0f - Color.dRed;
+    Color.dGreen = 1.0f - Color.dGreen;
+    Color.dBlue = 1.0f - Color.dBlue;
 }
 
 // Description: Takes a calculated weight that's to be used for the RGB values
 //              of the pixel and applies any Color Filters that were specified
 //              by the user.
-// Method: First, start by initializing a local ColorRGB variable that is to be
+// Method: First, start by initializing a local sPixelColor that is to be
 //         passed back from the function after all the filters have been applied.
 //         Second, apply any filters.  If a Grey Scale has been specified, don't
 //         apply any filters since each RGB value has been set to the same weight.
@@ -114,15 +145,15 @@ void Invert_Colors( ColorRGB &Color )
 //                            escape time algorithm.
 //             sColor - a constant reference to our Color Filters that were
 //                      specified by the user.
-// Return Value: Returns a ColorRGB variable for the current pixel.
+// Return Value: Returns an sPixelColor for the current pixel.
 ////////////////////////////////////////////////////////////////////////////////
-ColorRGB Parse_Color( float fColorWeight, 
-		      const sColorCode &sColor )
+sPixelColor Parse_Color( float fColorWeight, 
+			 const sColorCode &sColor )
 {
     // Local Variables
-    ColorRGB ReturnColor = ColorRGB( fColorWeight, 
-				     fColorWeight, 
-				     fColorWeight );
+    sPixelColor ReturnColor = { fColorWeight, 
+				fColorWeight, 
+				fColorWeight };
     
     // Apply Filters
     if( sColor.bInvertColors )
@@ -132,9 +163,9 @@ ColorRGB Parse_Color( float fColorWeight,
 
     if( !sColor.bGreyScale )
     {
-	ReturnColor.red( ReturnColor.red() *  sColor.fRGBMask[ 0 ] );
-	ReturnColor.green( ReturnColor.green() *  sColor.fRGBMask[ 1 ] );
-	ReturnColor.blue( ReturnColor.blue() *  sColor.fRGBMask[ 2 ] );
+	ReturnColor.dRed = ReturnColor.dRed *  sColor.fRGBMask[ 0 ];
+	ReturnColor.dGreen = ReturnColor.dGreen *  sColor.fRGBMask[ 1 ];
+	ReturnColor.dBlue = ReturnColor.dBlue *  sColor.fRGBMask[ 2 ];
     }	
     
     if( sColor.bInvertSpectrum )
@@ -145,6 +176,30 @@ ColorRGB Parse_Color( float fColorWeight,
     return ReturnColor;
 }
 
+// Description: Determines the color of a pixel from the number of iterations
+//              it took to escape the Mandelbrot set.
+// Method: If we reached max iterations, the pixel is in the set and gets the
+//         full weight.  Otherwise, the weight is the fraction of the maximum
+//         iterations we took to escape.  Either way, we call the Parse Color
+//         function to apply any color filters set by the user.
+// Parameters: iterations - The number of iterations it took to escape.
+//             iMax_Iterations - The maximum number of iterations.
+//             sColor - a Constant reference to our color filters, specified
+//                      by the user.
+// Return Value: Returns an sPixelColor for the current pixel.
+////////////////////////////////////////////////////////////////////////////////
+sPixelColor Get_Iteration_Color( const int iterations,
+				 const int iMax_Iterations,
+				 const sColorCode &sColor )
+{
+    if( iterations == iMax_Iterations )
+	return Parse_Color( 1.0, sColor );
+    else
+	return Parse_Color( ( (float)(iterations) / 
+			      (float)(iMax_Iterations) ), 
+			    sColor );
+}
+
 // Description: Implements the recursive logic of determining the Mandelbrot set
 //              z -> z^2 + c where z and c are complex numbers.  c is the distance
 //              from the center of the Mandelbrot set and z is the iterating 
@@ -154,8 +209,8 @@ ColorRGB Parse_Color( float fColorWeight,
 // Method: Since c and z are set in the caller, we can simply check if we are
 //         still within the bounds of the Mandelbrot set.  Once we reach max
 //         iterations or we escape outside the Mandelbrot set (abs(z) < 2.0f),
-//         we can then determine the weight of color on the pixel and call the
-//         Parse Color function to apply any color filters set by the user.
+//         we can then determine the color of the pixel from the number of
+//         iterations we took.
 // Parameters: c - complex number that contains the distance from the center of
 //                 the Mandelbrot set.
 //             z - complex number that helps us check when we've escaped the
@@ -163,16 +218,16 @@ ColorRGB Parse_Color( float fColorWeight,
 //             iterations - The number of recursive iterations we've done.
 //             sColor - a Constant reference to our color filters, specified
 //                      by the user. 
-// Return Value: Returns a ColorRGB variable for the current pixel.
+// Return Value: Returns an sPixelColor for the current pixel.
 ////////////////////////////////////////////////////////////////////////////////
-ColorRGB Get_Pixel_Color( complex< float > c, 
-			  complex< float > z, 
-			  int iterations,
-			  const int iMax_Iterations,
-			  const sColorCode &sColor )
+sPixelColor Get_Pixel_Color( complex< float > c, 
+			     complex< float > z, 
+			     int iterations,
+			     const int iMax_Iterations,
+			     const sColorCode &sColor )
 {
     // Local Variables
-    ColorRGB ReturnColor = ColorRGB( 0.0, 0.0, 0.0 );
+    sPixelColor ReturnColor = { 0.0, 0.0, 0.0 };
 
     // Iterate until we've escaped the Mandelbrot set.
     if( ( iterations < iMax_Iterations ) && ( std::abs(z) < 2.0f ) )
@@ -181,156 +236,1991 @@ ColorRGB Get_Pixel_Color( complex< float > c,
 				       ( iterations + 1 ), 
 				       iMax_Iterations,
 				       sColor );
-    else if( iterations == iMax_Iterations )
-	ReturnColor = Parse_Color( 1.0, sColor );
     else
-	ReturnColor = Parse_Color( ( (float)(iterations) / 
-				     (float)(iMax_Iterations) ), 
-				   sColor );
+	ReturnColor = Get_Iteration_Color( iterations, iMax_Iterations, sColor );
 
     // Return the parsed color of the pixel.
     return ReturnColor;
 }
 
-// Description: Part 2 of the recursion algorithm that follows down the Y axis
-//              for each x in the X-axis and draws each pixel.  This function
-//              calls the Show_Progress function as well as the Get_Pixel_Color
-//              function.
-// Method: It starts by generating a complex c variable based on the current 
-//         pixel being looked at, the maximum size of the image and the bounds
-//         of the complex plane.  it also sets a pixel color variable that grabs
-//         the pixel color that's parsed from the Get_Pixel_Color function, 
-//         assuming that we haven't reached the bottom of the image.  Otherwise,
-//         we call this function again and increment the current Y value until we
-//         get to the bottom.  Then we follow back through the function calls to
-//         the draw image function.
-// Parameters: magImage - A reference to our Image file that we will use to draw
-//                        the pixels and write the image.
-//             fCurrentX - A floating point value of the x position of the
-//                         current pixel. 
-//             fCurrentY - A floating point value of the y position of the 
-//                         current pixel.
-//             fMaxX - The maximum width of the image.  Since we are working with
-//                     a 0-based algorithm, we need to use fMaxX - 1.0f when
-//                     doing comparisons to the current x value.
-//             fMaxY - The maximum height of the image.  Since we are working
-//                     with a 0-based algorithm, we need to use fMaxY - 1.0f when
-//                     doing comparisons to the current y value.
-//             sColor - A constant reference to our color filters, specified
-//                      by the user. 
+// ITERATION FIELD STRUCTURE
+// Parts: bWide - Set when the counts are held in 32 bits (iMax_Iterations is
+//                above iNARROW_MAX_ITERATIONS); otherwise they are held in 16.
+//        vNarrow - The row major counts when not bWide.
+//        vWide - The row major counts when bWide.
 ////////////////////////////////////////////////////////////////////////////////
-void Draw_Y_Line( Image &magImage, 
-		  const float fCurrentX, 
-		  const float fCurrentY, 
-		  const float fMaxX, 
-		  const float fMaxY,
-		  const int iMax_Iterations,
-		  const sColorCode &sColor )
+struct sIterationField
+{
+    bool bWide;
+    vector< unsigned short, sUntouchedAllocator< unsigned short > > vNarrow;
+    vector< int, sUntouchedAllocator< int > > vWide;
+};
+
+// NUMA PLACEMENT STRUCTURE
+// Parts: sTopology - The nodes the workers are spread over: worker i runs on
+//                    node i % the number of nodes.
+//        iThreads - The number of workers.
+//        vBandStart, vBandEnd - The tiles of each node's band ([start, end)),
+//                               a run of whole rows of tiles.
+//        vNextTile - The next tile of each node's band to hand out.
+//        vOrder - For each node, the nodes whose bands its workers take tiles
+//                 from: its own, then the others nearest first.
+////////////////////////////////////////////////////////////////////////////////
+struct sNumaPlacement
+{
+    sNumaTopology sTopology;
+    int iThreads;
+    vector< int > vBandStart;
+    vector< int > vBandEnd;
+    vector< atomic< int > > vNextTile;
+    vector< vector< int > > vOrder;
+};
+
+// SCHEDULE STRUCTURE
+// Parts: iNextTile - Lock-free counter of the next tile to hand to a worker.
+//        iTilesX, iTilesY - The number of tiles across and down the image.
+//        iTileSize - The width and height of each tile (edge tiles may be
+//                    smaller).
+//        iWidth, iHeight - The size of the image.
+//        iDrawHeight - The number of rows the tiles cover.  Less than iHeight
+//                      when the rest of the rows are mirrored.
+//        sView - The area of the complex plane the image covers.
+//        iMax_Iterations - The escape time limit of each pixel.
+//        eKernel - The escape time kernel to run.
+//        sFormula - The formula the kernel iterates.
+//        eTraversal - How the pixels of each tile are traversed.
+//        eColoring - How the iteration counts are turned into colors.
+//        pColor - The color filters specified by the user.
+//        pIterations - The iteration counts of each pixel.
+//        pSmooth - The row major continuous escape times of each pixel (NULL
+//                  when the coloring doesn't need them).
+//        pDistance - The row major distance estimates of each pixel (NULL
+//                    unless shading by distance).
+//        dPixelSize - The distance between neighbouring pixels on the plane.
+//        pPixels - The row major buffer the workers draw into (NULL when only
+//                  the iteration counts are wanted, or when drawing into
+//                  pRaster).
+//        pRaster - The 8 bit pixels the workers draw straight into instead
+//                  (a mapped image file or the caller's memory; NULL when
+//                  drawing into pPixels).
+//        pPool - The threads the workers run on (NULL to start threads).
+//        pPlacement - Where the workers run and which tiles they draw when
+//                     placing them on NUMA nodes (NULL to hand out tiles from
+//                     iNextTile wherever the workers happen to run).
+//        pProgress - The progress counter bumped for each finished tile.
+//        pStats - The statistics of the render.  Each worker only touches its
+//                 own entry of pStats->vWorkers.
+//        pBands - The queue finished bands of pixels are handed to (NULL when
+//                 nobody is waiting for them).
+//        pTilesLeft - The number of tiles still to draw in each row of tiles,
+//                     when bands are handed over as soon as they're finished
+//                     (NULL when they have to wait for the whole image).
+//        pTiles - The queue the finished tiles are handed to when a program is
+//                 streaming them (NULL when nobody is waiting for them).  The
+//                 workers stop taking tiles once it is abandoned.
+//        bStreamTiles - Set when each tile is pushed onto pTiles as soon as
+//                       it is colored, rather than once the image is done.
+//        bOutOfMemory - Set by a worker that couldn't allocate its scratch
+//                       row; the workers stop and Render_Tiles throws
+//                       bad_alloc on the caller's thread.
+//        vBins - Per worker counts of the pixels at each number of iterations
+//                (only filled for histogram equalization).
+//        vCDF - The fraction of escaped pixels that escaped within each number
+//               of iterations, built from vBins.
+////////////////////////////////////////////////////////////////////////////////
+struct sTileSchedule
+{
+    atomic< int > iNextTile;
+    int iTilesX;
+    int iTilesY;
+    int iTileSize;
+    int iWidth;
+    int iHeight;
+    int iDrawHeight;
+    sViewport sView;
+    int iMax_Iterations;
+    eKernelType eKernel;
+    sIterationFormula sFormula;
+    eTraversalType eTraversal;
+    eColorMode eColoring;
+    const sColorCode *pColor;
+    sIterationField *pIterations;
+    vector< float, sUntouchedAllocator< float > > *pSmooth;
+    vector< float, sUntouchedAllocator< float > > *pDistance;
+    double dPixelSize;
+    vector< sPixelColor > *pPixels;
+    const sRaster *pRaster;
+    sThreadPool *pPool;
+    sNumaPlacement *pPlacement;
+    sProgress *pProgress;
+    sRenderStats *pStats;
+    sBandQueue *pBands;
+    atomic< int > *pTilesLeft;
+    sTileQueue *pTiles;
+    bool bStreamTiles;
+    atomic< bool > bOutOfMemory;
+    vector< vector< long long > > vBins;
+    vector< float > vCDF;
+};
+
+// CONSTANTS
+// Boxes this narrow (or short) are drawn outright rather than split again when
+// tracing boundaries.
+const int iMIN_TRACE_BOX = 6;
+
+// Distance shading fades from full weight at one pixel from the set to nothing
+// at fDISTANCE_FADE_PIXELS.  Boxes whose every pixel is known to be at least
+// that far out (by the estimate at their middle and by their drawn border) are
+// filled in without being drawn, since they'd all come out with no weight
+// anyway.  Boxes with fewer than iMIN_ESTIMATE_PIXELS pixels are just drawn.
+const float fDISTANCE_FADE_PIXELS = 16.0f;
+const int iMIN_ESTIMATE_PIXELS = 16;
+
+// The brightest fraction of an orbit density image that is clipped to full
+// weight, so a handful of hot pixels don't leave the rest of it dark.
+const double dDENSITY_CLIP = 0.001;
+
+// The spacing of the samples of the first pass of a progressive render (a
+// power of two; each pass halves it), and the number of samples drawn between
+// checks of the deadline and cancellation.
+const int iPROGRESSIVE_STEP = 8;
+const int iPROGRESSIVE_CHUNK = 32;
+
+// Iteration counts up to iNARROW_MAX_ITERATIONS are kept in 16 bits, halving
+// the memory (and bandwidth) of the field the kernel, coloring and mirroring
+// passes all stream through.  The kernels count in ints, so narrow rows are
+// drawn iNARROW_SPAN pixels at a time through a buffer on the stack.
+const int iNARROW_MAX_ITERATIONS = 65535;
+const int iNARROW_SPAN = 64;
+
+// Description: Sizes an iteration field for an image, in 16 bits when the
+//              counts can't go past iNARROW_MAX_ITERATIONS.  The counts are
+//              left unset (and their pages untouched) for the workers to
+//              write.
+// Parameters: sField - The field.
+//             iPixels - The number of pixels in the image.
+//             iMax_Iterations - The escape time limit of each pixel.
+////////////////////////////////////////////////////////////////////////////////
+void Init_Iteration_Field( sIterationField &sField, const size_t iPixels, const int iMax_Iterations )
+{
+    sField.bWide = ( iMax_Iterations > iNARROW_MAX_ITERATIONS );
+    sField.vNarrow.resize( sField.bWide ? 0 : iPixels );
+    sField.vWide.resize( sField.bWide ? iPixels : 0 );
+}
+
+// Description: Returns the number of iterations of a pixel.
+////////////////////////////////////////////////////////////////////////////////
+static inline int Get_Iterations( const sIterationField &sField, const size_t iPixel )
+{
+    return sField.bWide ? sField.vWide[ iPixel ] : sField.vNarrow[ iPixel ];
+}
+
+// Description: Sets the number of iterations of a pixel.
+////////////////////////////////////////////////////////////////////////////////
+static inline void Set_Iterations( sIterationField &sField, const size_t iPixel, const int iterations )
+{
+    if( sField.bWide )
+	sField.vWide[ iPixel ] = iterations;
+    else
+	sField.vNarrow[ iPixel ] = (unsigned short)( iterations );
+}
+
+// Description: Sets the number of iterations of a run of pixels.
+////////////////////////////////////////////////////////////////////////////////
+static inline void Fill_Iterations( sIterationField &sField,
+				    const size_t iStart,
+				    const size_t iCount,
+				    const int iterations )
+{
+    if( sField.bWide )
+	fill( sField.vWide.begin() + iStart, sField.vWide.begin() + iStart + iCount, iterations );
+    else
+	fill( sField.vNarrow.begin() + iStart, sField.vNarrow.begin() + iStart + iCount,
+	      (unsigned short)( iterations ) );
+}
+
+// Description: Copies the number of iterations of a run of pixels.
+////////////////////////////////////////////////////////////////////////////////
+static inline void Copy_Iterations( sIterationField &sField,
+				    const size_t iTo,
+				    const size_t iFrom,
+				    const size_t iCount )
+{
+    if( sField.bWide )
+	copy( sField.vWide.begin() + iFrom, sField.vWide.begin() + iFrom + iCount,
+	      sField.vWide.begin() + iTo );
+    else
+	copy( sField.vNarrow.begin() + iFrom, sField.vNarrow.begin() + iFrom + iCount,
+	      sField.vNarrow.begin() + iTo );
+}
+
+// Description: Checks whether a render takes the reference kernel's own path:
+//              the classic set, drawn without distance estimates.
+// Parameters: sSchedule - The shared schedule of the render.
+// Return Value: Returns true if its pixels go through Get_Reference_Pixel.
+////////////////////////////////////////////////////////////////////////////////
+bool Is_Reference_Path( const sTileSchedule &sSchedule )
+{
+    return ( sSchedule.eKernel == eKERNEL_REFERENCE ) && ( sSchedule.pDistance == NULL ) &&
+	Is_Classic_Formula( sSchedule.sFormula );
+}
+
+// Description: Runs the reference kernel on one pixel, working out its c with
+//              the original float math so every path that draws with it (the
+//              tiles and the progressive samples) gets the same counts and
+//              continuous escape times.
+// Parameters: sSchedule - The shared schedule of the render.
+//             x, y - The pixel.
+//             pSmooth - Set to the continuous escape time (NULL if not
+//                       wanted).
+// Return Value: Returns the number of iterations.
+////////////////////////////////////////////////////////////////////////////////
+int Get_Reference_Pixel( const sTileSchedule &sSchedule, const int x, const int y, float *pSmooth )
+{
+    // Local Variables
+    const sViewport &sView = sSchedule.sView;
+    const float fMaxX = (float)( sSchedule.iWidth );
+    const float fMaxY = (float)( sSchedule.iHeight );
+    const float fXMin = (float)( sView.dXMin );
+    const float fXMax = (float)( sView.dXMax );
+    const float fYMin = (float)( sView.dYMin );
+    const float fYMax = (float)( sView.dYMax );
+    const float fCurrentX = (float)( x );
+    const float fCurrentY = (float)( y );
+    std::complex< float > c( ( fXMin + fCurrentX / ( fMaxX - 1.0f ) * ( fXMax - fXMin ) ),
+			     ( fYMin + fCurrentY / ( fMaxY - 1.0f ) * ( fYMax - fYMin ) ) );
+
+    return Get_Escape_Iterations( c, sSchedule.iMax_Iterations, pSmooth );
+}
+
+// Description: Runs the escape time kernel over part of a row of the image and
+//              stores the number of iterations (and, if wanted, the continuous
+//              escape time and distance estimate) of each pixel.
+// Method: For each pixel we generate a complex c variable based on the pixel
+//         being looked at, the maximum size of the image and the bounds of the
+//         complex plane.  The reference kernel keeps the original float math
+//         for c; the others work out the row in doubles and run it in one go.
+// Parameters: sSchedule - The shared schedule of the render.
+//             y - The row to draw.
+//             iStartX, iEndX - The pixels of the row to draw ([start, end)).
+//             dCReal[] - Scratch space for the real parts of c (at least
+//                        iEndX - iStartX long).
+////////////////////////////////////////////////////////////////////////////////
+void Draw_Span( const sTileSchedule &sSchedule,
+		const int y,
+		const int iStartX,
+		const int iEndX,
+		double dCReal[] )
+{
+    // Local Variables
+    const sViewport &sView = sSchedule.sView;
+    sIterationField &sField = *sSchedule.pIterations;
+    const size_t iRow = (size_t)( y ) * sSchedule.iWidth;
+    float *pSmoothRow = NULL;
+    float *pDistanceRow = NULL;
+
+    if( sSchedule.pSmooth != NULL )
+	pSmoothRow = &( *sSchedule.pSmooth )[ (size_t)( y ) * sSchedule.iWidth ];
+
+    if( sSchedule.pDistance != NULL )
+	pDistanceRow = &( *sSchedule.pDistance )[ (size_t)( y ) * sSchedule.iWidth ];
+
+    if( iStartX >= iEndX )
+	return;
+
+    if( Is_Reference_Path( sSchedule ) )
+    {
+	for( int x = iStartX; x < iEndX; ++x )
+	    Set_Iterations( sField, iRow + x,
+			    Get_Reference_Pixel( sSchedule, x, y,
+						 ( pSmoothRow != NULL ) ? &pSmoothRow[ x ] : NULL ) );
+    }
+    else
+    {
+	const double dMaxX = (double)( sSchedule.iWidth );
+	const double dMaxY = (double)( sSchedule.iHeight );
+	const double dCImag = sView.dYMin + (double)( y ) / ( dMaxY - 1.0 ) * ( sView.dYMax - sView.dYMin );
+
+	for( int x = iStartX; x < iEndX; ++x )
+	    dCReal[ x - iStartX ] = sView.dXMin + (double)( x ) / ( dMaxX - 1.0 ) * ( sView.dXMax - sView.dXMin );
+
+	if( sField.bWide )
+	    Get_Escape_Row( sSchedule.eKernel,
+			    sSchedule.sFormula,
+			    dCReal,
+			    dCImag,
+			    iEndX - iStartX,
+			    sSchedule.iMax_Iterations,
+			    &sField.vWide[ iRow + iStartX ],
+			    ( pSmoothRow != NULL ) ? pSmoothRow + iStartX : NULL,
+			    ( pDistanceRow != NULL ) ? pDistanceRow + iStartX : NULL );
+	else
+	{
+	    // Local Variables
+	    int iCounts[ iNARROW_SPAN ];
+
+	    for( int x = iStartX; x < iEndX; x += iNARROW_SPAN )
+	    {
+		// Local Variables
+		const int iCount = min( iNARROW_SPAN, iEndX - x );
+
+		Get_Escape_Row( sSchedule.eKernel,
+				sSchedule.sFormula,
+				dCReal + ( x - iStartX ),
+				dCImag,
+				iCount,
+				sSchedule.iMax_Iterations,
+				iCounts,
+				( pSmoothRow != NULL ) ? pSmoothRow + x : NULL,
+				( pDistanceRow != NULL ) ? pDistanceRow + x : NULL );
+
+		for( int i = 0; i < iCount; ++i )
+		    sField.vNarrow[ iRow + x + i ] = (unsigned short)( iCounts[ i ] );
+	    }
+	}
+    }
+}
+
+// Description: Runs the escape time kernel down part of a column of the image.
+// Parameters: sSchedule - The shared schedule of the render.
+//             x - The column to draw.
+//             iStartY, iEndY - The pixels of the column to draw ([start, end)).
+//             dCReal[] - Scratch space for Draw_Span.
+////////////////////////////////////////////////////////////////////////////////
+void Draw_Column( const sTileSchedule &sSchedule,
+		  const int x,
+		  const int iStartY,
+		  const int iEndY,
+		  double dCReal[] )
+{
+    for( int y = iStartY; y < iEndY; ++y )
+	Draw_Span( sSchedule, y, x, x + 1, dCReal );
+}
+
+// Description: Checks whether every pixel on the border of a box has the same
+//              number of iterations.
+// Parameters: sSchedule - The shared schedule of the render.
+//             iStartX, iStartY, iEndX, iEndY - The box ([start, end)).
+//             iValue - Set to the number of iterations of the border.
+// Return Value: Returns true if the border is uniform.
+////////////////////////////////////////////////////////////////////////////////
+bool Is_Uniform_Border( const sTileSchedule &sSchedule,
+			const int iStartX,
+			const int iStartY,
+			const int iEndX,
+			const int iEndY,
+			int &iValue )
+{
+    // Local Variables
+    const sIterationField &sField = *sSchedule.pIterations;
+    const size_t iTop = (size_t)( iStartY ) * sSchedule.iWidth;
+    const size_t iBottom = (size_t)( iEndY - 1 ) * sSchedule.iWidth;
+
+    iValue = Get_Iterations( sField, iTop + iStartX );
+
+    for( int x = iStartX; x < iEndX; ++x )
+	if( ( Get_Iterations( sField, iTop + x ) != iValue ) ||
+	    ( Get_Iterations( sField, iBottom + x ) != iValue ) )
+	    return false;
+
+    for( int y = iStartY + 1; y < iEndY - 1; ++y )
+    {
+	const size_t iRow = (size_t)( y ) * sSchedule.iWidth;
+
+	if( ( Get_Iterations( sField, iRow + iStartX ) != iValue ) ||
+	    ( Get_Iterations( sField, iRow + iEndX - 1 ) != iValue ) )
+	    return false;
+    }
+
+    return true;
+}
+
+// Description: Fills in the inside of a box whose border has already been
+//              drawn (Mariani-Silver).
+// Method: Since the set is connected, a box whose border is all one number
+//         of iterations can't hold anything else (short of detail finer than
+//         the pixels), so its inside is filled in with that number.  When the
+//         continuous escape time or the distance is wanted only boxes inside
+//         the set are filled, since those still vary inside the others.
+//         Otherwise the box is split in four by drawing a column and a row
+//         through the middle of it and each quarter is traced in turn.  Small
+//         boxes are simply drawn.
+// Parameters: sSchedule - The shared schedule of the render.
+//             iStartX, iStartY, iEndX, iEndY - The box ([start, end)).
+//             dCReal[] - Scratch space for Draw_Span.
+////////////////////////////////////////////////////////////////////////////////
+void Trace_Box( const sTileSchedule &sSchedule,
+		const int iStartX,
+		const int iStartY,
+		const int iEndX,
+		const int iEndY,
+		double dCReal[] )
+{
+    // Local Variables
+    sIterationField &sField = *sSchedule.pIterations;
+    int iValue = 0;
+    int iMidX = ( iStartX + iEndX ) / 2;
+    int iMidY = ( iStartY + iEndY ) / 2;
+
+    // Nothing inside the border.
+    if( ( iEndX - iStartX <= 2 ) || ( iEndY - iStartY <= 2 ) )
+	return;
+
+    if( Is_Uniform_Border( sSchedule, iStartX, iStartY, iEndX, iEndY, iValue ) &&
+	( ( ( sSchedule.pSmooth == NULL ) && ( sSchedule.pDistance == NULL ) ) ||
+	  ( iValue == sSchedule.iMax_Iterations ) ) )
+    {
+	for( int y = iStartY + 1; y < iEndY - 1; ++y )
+	{
+	    const size_t iRow = (size_t)( y ) * sSchedule.iWidth;
+
+	    Fill_Iterations( sField, iRow + iStartX + 1, (size_t)( iEndX - iStartX - 2 ), iValue );
+
+	    if( sSchedule.pSmooth != NULL )
+		fill( sSchedule.pSmooth->begin() + iRow + iStartX + 1,
+		      sSchedule.pSmooth->begin() + iRow + iEndX - 1, (float)( iValue ) );
+
+	    if( sSchedule.pDistance != NULL )
+		fill( sSchedule.pDistance->begin() + iRow + iStartX + 1,
+		      sSchedule.pDistance->begin() + iRow + iEndX - 1, 0.0f );
+	}
+    }
+    else if( ( iEndX - iStartX <= iMIN_TRACE_BOX ) || ( iEndY - iStartY <= iMIN_TRACE_BOX ) )
+    {
+	for( int y = iStartY + 1; y < iEndY - 1; ++y )
+	    Draw_Span( sSchedule, y, iStartX + 1, iEndX - 1, dCReal );
+    }
+    else
+    {
+	Draw_Column( sSchedule, iMidX, iStartY + 1, iEndY - 1, dCReal );
+	Draw_Span( sSchedule, iMidY, iStartX + 1, iMidX, dCReal );
+	Draw_Span( sSchedule, iMidY, iMidX + 1, iEndX - 1, dCReal );
+
+	Trace_Box( sSchedule, iStartX, iStartY, iMidX + 1, iMidY + 1, dCReal );
+	Trace_Box( sSchedule, iMidX, iStartY, iEndX, iMidY + 1, dCReal );
+	Trace_Box( sSchedule, iStartX, iMidY, iMidX + 1, iEndY, dCReal );
+	Trace_Box( sSchedule, iMidX, iMidY, iEndX, iEndY, dCReal );
+    }
+}
+
+// Description: Draws the border of a box and checks that all of it is past the
+//              fade distance of distance shading.
+// Parameters: sSchedule - The shared schedule of the render.
+//             iStartX, iStartY, iEndX, iEndY - The box ([start, end)).
+//             dCReal[] - Scratch space for Draw_Span.
+// Return Value: Returns true if every pixel of the border escaped with a
+//               distance estimate of at least fDISTANCE_FADE_PIXELS pixels.
+////////////////////////////////////////////////////////////////////////////////
+bool Is_Far_Border( const sTileSchedule &sSchedule,
+		    const int iStartX,
+		    const int iStartY,
+		    const int iEndX,
+		    const int iEndY,
+		    double dCReal[] )
+{
+    // Local Variables
+    const sIterationField &sField = *sSchedule.pIterations;
+    const vector< float, sUntouchedAllocator< float > > &vDistance = *sSchedule.pDistance;
+    const float fFar = fDISTANCE_FADE_PIXELS * (float)( sSchedule.dPixelSize );
+
+    Draw_Span( sSchedule, iStartY, iStartX, iEndX, dCReal );
+    Draw_Span( sSchedule, iEndY - 1, iStartX, iEndX, dCReal );
+    Draw_Column( sSchedule, iStartX, iStartY + 1, iEndY - 1, dCReal );
+    Draw_Column( sSchedule, iEndX - 1, iStartY + 1, iEndY - 1, dCReal );
+
+    for( int y = iStartY; y < iEndY; ++y )
+    {
+	const size_t iRow = (size_t)( y ) * sSchedule.iWidth;
+	const int iStep = ( ( y == iStartY ) || ( y == iEndY - 1 ) ) ? 1 : max( iEndX - 1 - iStartX, 1 );
+
+	for( int x = iStartX; x < iEndX; x += iStep )
+	    if( ( Get_Iterations( sField, iRow + x ) >= sSchedule.iMax_Iterations ) ||
+		!( vDistance[ iRow + x ] >= fFar ) )
+		return false;
+    }
+
+    return true;
+}
+
+// Description: Draws a box of the image for distance shading, filling in the
+//              parts that are far from the set without drawing them.
+// Method: Only used for formulas with Has_Distance_Bound: the Mandelbrot set
+//         and the connected Julia sets of z^2 + c.  The pixel in the middle
+//         of the box is drawn first.  For these sets the true distance to the
+//         set is at least a quarter of the distance estimate, so if that
+//         reaches past the corners of the box by the fade distance, no pixel
+//         of the box should be within the fade distance of the set.  That
+//         bound only holds for the exact estimate, though, and the one worked
+//         out with a finite escape radius and iteration cap can overshoot
+//         near the boundary, so the box's border is drawn as well and has to
+//         be past the fade too.  A connected set that reached into the box
+//         without covering the middle pixel would cross the border.  The
+//         inside of the box is then filled in with the middle pixel's count
+//         and, for each pixel, the distance it's known to be from the set
+//         (which is past the fade, so it gets the same color it would have if
+//         it had been drawn).  Otherwise the box is split in four and each
+//         quarter is tried again, down to small boxes which are just drawn.
+// Parameters: sSchedule - The shared schedule of the render.
+//             iStartX, iStartY, iEndX, iEndY - The box ([start, end)).
+//             dCReal[] - Scratch space for Draw_Span.
+////////////////////////////////////////////////////////////////////////////////
+void Estimate_Box( const sTileSchedule &sSchedule,
+		   const int iStartX,
+		   const int iStartY,
+		   const int iEndX,
+		   const int iEndY,
+		   double dCReal[] )
+{
+    // Local Variables
+    sIterationField &sField = *sSchedule.pIterations;
+    vector< float, sUntouchedAllocator< float > > &vDistance = *sSchedule.pDistance;
+    const double dPixel = sSchedule.dPixelSize;
+    int iMidX = ( iStartX + iEndX ) / 2;
+    int iMidY = ( iStartY + iEndY ) / 2;
+    size_t iMid = (size_t)( iMidY ) * sSchedule.iWidth + iMidX;
+    double dCorner = 0.0;
+    double dKnown = 0.0;
+
+    if( ( iEndX - iStartX ) * ( iEndY - iStartY ) <= iMIN_ESTIMATE_PIXELS )
+    {
+	for( int y = iStartY; y < iEndY; ++y )
+	    Draw_Span( sSchedule, y, iStartX, iEndX, dCReal );
+	return;
+    }
+
+    Draw_Span( sSchedule, iMidY, iMidX, iMidX + 1, dCReal );
+
+    dCorner = dPixel * sqrt( (double)( max( iMidX - iStartX, iEndX - 1 - iMidX ) ) *
+			     (double)( max( iMidX - iStartX, iEndX - 1 - iMidX ) ) +
+			     (double)( max( iMidY - iStartY, iEndY - 1 - iMidY ) ) *
+			     (double)( max( iMidY - iStartY, iEndY - 1 - iMidY ) ) );
+    dKnown = 0.25 * vDistance[ iMid ];
+
+    if( ( Get_Iterations( sField, iMid ) < sSchedule.iMax_Iterations ) &&
+	( dKnown - dCorner >= fDISTANCE_FADE_PIXELS * dPixel ) &&
+	Is_Far_Border( sSchedule, iStartX, iStartY, iEndX, iEndY, dCReal ) )
+    {
+	for( int y = iStartY + 1; y < iEndY - 1; ++y )
+	{
+	    const size_t iRow = (size_t)( y ) * sSchedule.iWidth;
+
+	    for( int x = iStartX + 1; x < iEndX - 1; ++x )
+	    {
+		double dOffset = dPixel * sqrt( (double)( ( x - iMidX ) * ( x - iMidX ) +
+							  ( y - iMidY ) * ( y - iMidY ) ) );
+
+		Set_Iterations( sField, iRow + x, Get_Iterations( sField, iMid ) );
+		vDistance[ iRow + x ] = (float)( dKnown - dOffset );
+	    }
+	}
+	return;
+    }
+
+    Estimate_Box( sSchedule, iStartX, iStartY, iMidX, iMidY, dCReal );
+    Estimate_Box( sSchedule, iMidX, iStartY, iEndX, iMidY, dCReal );
+    Estimate_Box( sSchedule, iStartX, iMidY, iMidX, iEndY, dCReal );
+    Estimate_Box( sSchedule, iMidX, iMidY, iEndX, iEndY, dCReal );
+}
+
+// Description: Works out the color weight of a pixel.
+// Method: Pixels in the set get the full weight.  Linear coloring divides the
+//         number of iterations by the maximum.  Distance shading gives full
+//         weight within a pixel of the set and fades out logarithmically to
+//         nothing at fDISTANCE_FADE_PIXELS.  Smooth coloring divides the
+//         continuous escape time by the maximum iterations.  Histogram
+//         equalization looks up the fraction of escaped pixels that escaped
+//         within the pixel's whole number of iterations and blends towards the
+//         next count by the fractional part of the escape time, so the
+//         equalized colors are smooth too.
+// Parameters: sSchedule - The shared schedule of the render.
+//             iPixel - The index of the pixel (row major).
+// Return Value: Returns the weight, from 0.0 to 1.0.
+////////////////////////////////////////////////////////////////////////////////
+float Get_Color_Weight( const sTileSchedule &sSchedule, const size_t iPixel )
+{
+    // Local Variables
+    const int iMax_Iterations = sSchedule.iMax_Iterations;
+    const int iterations = Get_Iterations( *sSchedule.pIterations, iPixel );
+    float fSmooth = 0.0f;
+    float fFraction = 0.0f;
+
+    if( iterations == iMax_Iterations )
+	return 1.0f;
+
+    if( sSchedule.eColoring == eCOLOR_LINEAR )
+	return (float)( iterations ) / (float)( iMax_Iterations );
+
+    if( sSchedule.eColoring == eCOLOR_DISTANCE )
+    {
+	float fPixels = ( *sSchedule.pDistance )[ iPixel ] / (float)( sSchedule.dPixelSize );
+
+	if( fPixels <= 1.0f )
+	    return 1.0f;
+
+	return max( 1.0f - log2( fPixels ) / log2( fDISTANCE_FADE_PIXELS ), 0.0f );
+    }
+
+    fSmooth = ( *sSchedule.pSmooth )[ iPixel ];
+
+    if( sSchedule.eColoring == eCOLOR_SMOOTH )
+	return min( fSmooth / (float)( iMax_Iterations ), 1.0f );
+
+    // The escape time is within a couple of iterations of the count.
+    fSmooth = min( max( fSmooth, 0.0f ), (float)( iMax_Iterations - 1 ) );
+    fFraction = fSmooth - floor( fSmooth );
+
+    return sSchedule.vCDF[ (int)( fSmooth ) ] * ( 1.0f - fFraction ) +
+	sSchedule.vCDF[ (int)( fSmooth ) + 1 ] * fFraction;
+}
+
+// Description: Turns a color channel (0 to 1) into an 8 bit sample.
+////////////////////////////////////////////////////////////////////////////////
+static inline unsigned char Get_Color_Byte( const double dChannel )
+{
+    if( !( dChannel > 0.0 ) )
+	return 0;
+
+    if( dChannel >= 1.0 )
+	return 255;
+
+    return (unsigned char)( dChannel * 255.0 + 0.5 );
+}
+
+// Description: Stores the color of a pixel, either in the pixel buffer or as 8
+//              bit samples in the raster.
+////////////////////////////////////////////////////////////////////////////////
+static inline void Put_Pixel( const sTileSchedule &sSchedule,
+			      const int x,
+			      const int y,
+			      const sPixelColor &cColor )
+{
+    if( sSchedule.pRaster != NULL )
+    {
+	// Local Variables
+	const sRaster &sTarget = *sSchedule.pRaster;
+	unsigned char *pSample = sTarget.pPixels + (size_t)( y ) * sTarget.iStride +
+	    (size_t)( x ) * sTarget.iChannels;
+
+	pSample[ 0 ] = Get_Color_Byte( cColor.dRed );
+	pSample[ 1 ] = Get_Color_Byte( cColor.dGreen );
+	pSample[ 2 ] = Get_Color_Byte( cColor.dBlue );
+
+	if( sTarget.iChannels == 4 )
+	    pSample[ 3 ] = 255;
+    }
+    else
+	( *sSchedule.pPixels )[ (size_t)( y ) * sSchedule.iWidth + x ] = cColor;
+}
+
+// Description: Stores the color of a pixel given its color weight: as the
+//              index of the weight's color in the palette (Get_Palette) when
+//              the raster holds indices, otherwise as the color itself.
+////////////////////////////////////////////////////////////////////////////////
+static inline void Put_Weight( const sTileSchedule &sSchedule,
+			       const int x,
+			       const int y,
+			       const float fWeight )
+{
+    if( ( sSchedule.pRaster != NULL ) && ( sSchedule.pRaster->iChannels == 1 ) )
+	sSchedule.pRaster->pPixels[ (size_t)( y ) * sSchedule.pRaster->iStride + x ] =
+	    Get_Color_Byte( fWeight );
+    else
+	Put_Pixel( sSchedule, x, y, Parse_Color( fWeight, *sSchedule.pColor ) );
+}
+
+// Description: Builds the palette of an indexed image: entry i is the color of
+//              the weight i / 255 (Put_Weight).
+// Parameters: sColor - The color filters.
+//             cPalette[] - Set to the red, green and blue bytes of the
+//                          iPNG_PALETTE_COLORS colors.
+////////////////////////////////////////////////////////////////////////////////
+void Get_Palette( const sColorCode &sColor, unsigned char cPalette[] )
+{
+    for( int i = 0; i < iPNG_PALETTE_COLORS; ++i )
+    {
+	// Local Variables
+	sPixelColor cColor = Parse_Color( (float)( i ) / (float)( iPNG_PALETTE_COLORS - 1 ), sColor );
+
+	cPalette[ i * 3 ] = Get_Color_Byte( cColor.dRed );
+	cPalette[ i * 3 + 1 ] = Get_Color_Byte( cColor.dGreen );
+	cPalette[ i * 3 + 2 ] = Get_Color_Byte( cColor.dBlue );
+    }
+}
+
+// Description: Colors every pixel of a box of the image from its number of
+//              iterations.
+// Parameters: sSchedule - The shared schedule of the render.
+//             iStartX, iStartY, iEndX, iEndY - The box ([start, end)).
+////////////////////////////////////////////////////////////////////////////////
+void Color_Box( const sTileSchedule &sSchedule,
+		const int iStartX,
+		const int iStartY,
+		const int iEndX,
+		const int iEndY )
+{
+    for( int y = iStartY; y < iEndY; ++y )
+    {
+	size_t iRow = (size_t)( y ) * sSchedule.iWidth;
+
+	for( int x = iStartX; x < iEndX; ++x )
+	    Put_Weight( sSchedule, x, y, Get_Color_Weight( sSchedule, iRow + x ) );
+    }
+}
+
+// Description: Draws every pixel of a single tile into the pixel buffer.
+// Method: The tile is drawn in two passes so we can time them separately.
+//         First, the escape time kernel is run over the tile (row by row, by
+//         tracing the tile's border when tracing boundaries, or by filling in
+//         what's far from the set when shading by distance) and the number
+//         of iterations of each pixel is added to the worker's statistics.
+//         Second, we color each pixel from its number of iterations (unless
+//         only the iterations are wanted, or the colors have to wait for the
+//         histogram of the whole image).  Each tile covers its own part of
+//         the buffers so no locking is needed.
+// Parameters: sSchedule - The shared schedule of the render.
+//             iTile - The index of the tile to draw (row major).
+//             iWorker - The index of the worker drawing the tile.
+//             dCReal[] - The worker's scratch row of real parts, iTileSize
+//                        long.
+////////////////////////////////////////////////////////////////////////////////
+void Draw_Tile( sTileSchedule &sSchedule, const int iTile, const int iWorker, double dCReal[] )
 {
     // Local Variables
-    std::complex< float > c( ( fCXMIN + fCurrentX / ( fMaxX - 1.0f ) * ( fCXMAX - fCXMIN ) ),
-			     ( fCYMIN + fCurrentY / ( fMaxY - 1.0f ) * ( fCYMAX - fCYMIN ) ) );
-    ColorRGB LocalPixelColor;
+    const int iMax_Iterations = sSchedule.iMax_Iterations;
+    int iStartX = ( iTile % sSchedule.iTilesX ) * sSchedule.iTileSize;
+    int iStartY = ( iTile / sSchedule.iTilesX ) * sSchedule.iTileSize;
+    int iEndX = min( iStartX + sSchedule.iTileSize, sSchedule.iWidth );
+    int iEndY = min( iStartY + sSchedule.iTileSize, sSchedule.iDrawHeight );
+    const sIterationField &sField = *sSchedule.pIterations;
+    sWorkerStats &sWorker = sSchedule.pStats->vWorkers[ iWorker ];
+    sTileStats sTile = sTileStats();
+    chrono::steady_clock::time_point tStart, tKernel, tColor;
+
+    sTile.iX = iStartX;
+    sTile.iY = iStartY;
+    sTile.iWidth = iEndX - iStartX;
+    sTile.iHeight = iEndY - iStartY;
+    sTile.iThread = iWorker;
+
+    // Kernel pass.
+    tStart = chrono::steady_clock::now();
+
+    {
+	TRACE_SPAN( "tile", "compute" );
+
+	// Only sets whose distance estimate is a bound can be filled in.
+	if( ( sSchedule.pDistance != NULL ) && ( sSchedule.eTraversal != eTRAVERSAL_BOUNDARY ) &&
+	    Has_Distance_Bound( sSchedule.sFormula ) )
+	    Estimate_Box( sSchedule, iStartX, iStartY, iEndX, iEndY, dCReal );
+	else if( sSchedule.eTraversal == eTRAVERSAL_BOUNDARY )
+	{
+	    Draw_Span( sSchedule, iStartY, iStartX, iEndX, dCReal );
+	    Draw_Span( sSchedule, iEndY - 1, iStartX, iEndX, dCReal );
+	    Draw_Column( sSchedule, iStartX, iStartY + 1, iEndY - 1, dCReal );
+	    Draw_Column( sSchedule, iEndX - 1, iStartY + 1, iEndY - 1, dCReal );
+	    Trace_Box( sSchedule, iStartX, iStartY, iEndX, iEndY, dCReal );
+	}
+	else
+	{
+	    for( int y = iStartY; y < iEndY; ++y )
+		Draw_Span( sSchedule, y, iStartX, iEndX, dCReal );
+	}
+
+	for( int y = iStartY; y < iEndY; ++y )
+	{
+	    const size_t iRow = (size_t)( y ) * sSchedule.iWidth;
+
+	    for( int x = iStartX; x < iEndX; ++x )
+	    {
+		// Local Variables
+		const int iterations = Get_Iterations( sField, iRow + x );
+
+		sTile.llIterations += iterations;
+		++sWorker.vHistogram[ Get_Histogram_Bucket( iterations ) ];
+
+		if( iterations == iMax_Iterations )
+		    ++sTile.llCapped;
+	    }
+
+	    if( !sSchedule.vBins.empty() )
+	    {
+		long long *pBins = &sSchedule.vBins[ iWorker ][ 0 ];
+
+		for( int x = iStartX; x < iEndX; ++x )
+		    ++pBins[ Get_Iterations( sField, iRow + x ) ];
+	    }
+	}
+    }
+
+    sTile.llEscaped = (long long)( sTile.iWidth ) * sTile.iHeight - sTile.llCapped;
+    tKernel = chrono::steady_clock::now();
+
+    // Coloring pass.
+    if( ( sSchedule.pColor != NULL ) && ( sSchedule.eColoring != eCOLOR_HISTOGRAM ) )
+    {
+	TRACE_SPAN( "coloring", "color" );
+
+	Color_Box( sSchedule, iStartX, iStartY, iEndX, iEndY );
+    }
+
+    tColor = chrono::steady_clock::now();
+
+    sTile.dKernelSeconds = Get_Seconds( tStart, tKernel );
+    sTile.dColorSeconds = Get_Seconds( tKernel, tColor );
+    sWorker.vTiles.push_back( sTile );
+    sWorker.dBusySeconds += Get_Seconds( tStart, tColor );
 
     // Show our Progress.
-//    Show_Progress( ( ( fCurrentY + ( ( fCurrentX - 1 ) * fMaxY ) ) / ( fMaxY * fMaxX ) ) * 100 );
-
-    if( fCurrentY != fMaxY )
-    {
-	// Draw Pixel Logic
-	LocalPixelColor = Get_Pixel_Color( c, 0, 0, iMax_Iterations, sColor );
-	magImage.pixelColor( fCurrentX, fCurrentY, LocalPixelColor );
-    }
-
-    // Recursive condition.
-    if( fCurrentY < (fMaxY - 1.0f) )
-	Draw_Y_Line( magImage, 
-		     fCurrentX, 
-		     (fCurrentY + 1.0f), 
-		     fMaxX, 
-		     fMaxY, 
-		     iMax_Iterations,
-		     sColor );
-}
-
-// Description: Part 1 of the Drawing Algorithm.  This function draws all the
-//              pixels in the Y axis for each position of X. 
-// Method: We have one special case in which we don't want to draw a line when
-//         we've reached the bounds of X.  Otherwise, we call the Draw_Y_Line
-//         function that will draw each pixel on the Y axis for the current
-//         value of X.  After we've drawn the line, we check our recursive 
-//         condition to ensure we're not at the last value of X (in a 0-based
-//         mapping) and if we aren't, we'll recursively call this function again
-//         and pass in the currentX + 1.0f as our iterator.
-// Parameters: magImage - A reference to our Image file that we will use to draw
-//                        the pixels and write the image.
-//             fCurrentX - A floating point value of the x position of the
-//                         current pixel. 
-//             fMaxX - The maximum width of the image.  Since we are working with
-//                     a 0-based algorithm, we need to use fMaxX - 1.0f when
-//                     doing comparisons to the current x value.
-//             fMaxY - The maximum height of the image.  Since we are working
-//                     with a 0-based algorithm, we need to use fMaxY - 1.0f when
-//                     doing comparisons to the current y value.
-//             sColor - A constant reference to our color filters, specified
-//                      by the user. 
+    Add_Progress( *sSchedule.pProgress, (long long)( sTile.iWidth ) * sTile.iHeight );
+
+    // Hand the band over once every tile of its row of tiles is done.
+    if( ( sSchedule.pTilesLeft != NULL ) &&
+	( sSchedule.pTilesLeft[ iStartY / sSchedule.iTileSize ].fetch_sub( 1 ) == 1 ) )
+	Push_Band( *sSchedule.pBands, iStartY, iEndY );
+
+    // Hand the tile to whoever is streaming them (they may have stopped).
+    if( sSchedule.bStreamTiles )
+    {
+	// Local Variables
+	sTileRect sDone = { iStartX, iStartY, sTile.iWidth, sTile.iHeight };
+
+	Push_Tile( *sSchedule.pTiles, sDone );
+    }
+}
+
+// Description: Splits the rows of tiles into one band per NUMA node, in
+//              proportion to the number of workers on each.
+// Parameters: sPlacement - The placement (its topology already found).
+//             sSchedule - The schedule of the render (its tiles laid out).
+//             iThreads - The number of workers.
 ////////////////////////////////////////////////////////////////////////////////
-void Draw_Image( Image &magImage, 
-		 const float fCurrentX, 
-		 const float fMaxX, 
-		 const float fMaxY,
-		 const int iMax_Iterations,
-		 const sColorCode &sColor )
+void Init_Numa_Placement( sNumaPlacement &sPlacement, const sTileSchedule &sSchedule, const int iThreads )
 {
     // Local Variables
-    if( fCurrentX != fMaxX )
-	Draw_Y_Line( magImage, fCurrentX, 0.0f, fMaxX, fMaxY, iMax_Iterations, sColor );
-    
-    if( fCurrentX < (fMaxX - 1) )
-	Draw_Image( magImage, (fCurrentX + 1.0f), fMaxX, fMaxY, iMax_Iterations, sColor );
-
-    // return
-    return;
-}
-
-// Description: Creates a mandelbrot image.  Saves it into a file with the
-//              provided file name and sizes the image to the provided width
-//              and height.
-// Method: This is our main interface with the caller.  We first create a new
-//         Image, set the bounds of the Geometry of the image (width & height),
-//         we then Draw the image using the Escape Time Algorithm.  After the 
-//         image is drawn, we output a completion prompt along with a buffer of
-//         space to clear any of the progress bar we're outputting over and we
-//         write the image to a specified file.
-// Parameters: cFileName[] - the name of the file to save the image to.
-//             iWidth - the desired width of the image.
-//             iHeight - the desired height of the image.
-//             sColor - A constant reference to the color filters specified from
-//                      the user.
-////////////////////////////////////////////////////////////////////////////////
-void Create_Image( char cFileName[], 
-		   const int iWidth, 
-		   const int iHeight,
-		   const int iMax_Iterations,
-		   const sColorCode &sColor )
+    const int iNodes = min( (int)( sPlacement.sTopology.vNodeCpus.size() ), iThreads );
+    int iRow = 0;
+
+    // Nodes no worker would run on get no band.
+    sPlacement.sTopology.vNodeCpus.resize( iNodes );
+    sPlacement.sTopology.vDistances.resize( iNodes );
+
+    for( int n = 0; n < iNodes; ++n )
+	sPlacement.sTopology.vDistances[ n ].resize( iNodes );
+
+    sPlacement.iThreads = iThreads;
+    sPlacement.vBandStart.resize( iNodes );
+    sPlacement.vBandEnd.resize( iNodes );
+    sPlacement.vNextTile = vector< atomic< int > >( iNodes );
+    sPlacement.vOrder.resize( iNodes );
+
+    for( int n = 0; n < iNodes; ++n )
+    {
+	// Local Variables
+	const int iWorkers = ( iThreads - n + iNodes - 1 ) / iNodes;
+	const int iWorkersBefore = n * ( iThreads / iNodes ) + min( n, iThreads % iNodes );
+	int iEndRow = (int)( (long long)( sSchedule.iTilesY ) * ( iWorkersBefore + iWorkers ) / iThreads );
+
+	sPlacement.vBandStart[ n ] = iRow * sSchedule.iTilesX;
+	sPlacement.vBandEnd[ n ] = iEndRow * sSchedule.iTilesX;
+	sPlacement.vNextTile[ n ].store( sPlacement.vBandStart[ n ] );
+	Get_Node_Order( sPlacement.sTopology, n, sPlacement.vOrder[ n ] );
+	iRow = iEndRow;
+    }
+}
+
+// Description: Hands a worker the next tile to draw.
+// Method: Without NUMA placement every worker takes the next tile off of the
+//         shared counter.  With it, a worker takes the next tile of its own
+//         node's band, and once that band is used up, steals the next tile of
+//         the nearest node's band that has any left.
+// Parameters: sSchedule - The shared schedule of the render.
+//             iWorker - The index of the worker.
+// Return Value: Returns the tile, or at least iTilesX * iTilesY once every
+//               tile has been handed out.
+////////////////////////////////////////////////////////////////////////////////
+int Get_Next_Tile( sTileSchedule &sSchedule, const int iWorker )
 {
     // Local Variables
-    Image magNewImage;
-    
-    // set up new image
-    magNewImage.extent( Geometry( iWidth, iHeight ) );
+    sNumaPlacement *pPlacement = sSchedule.pPlacement;
+
+    if( pPlacement == NULL )
+	return sSchedule.iNextTile.fetch_add( 1 );
+
+    {
+	// Local Variables
+	const vector< int > &vOrder = pPlacement->vOrder[ iWorker % (int)( pPlacement->vOrder.size() ) ];
+
+	for( size_t i = 0; i < vOrder.size(); ++i )
+	{
+	    // Local Variables
+	    const int iNode = vOrder[ i ];
 
-    // Call recursive function to draw mandelbrot image
-    Draw_Image( magNewImage, 
-		0.0f, 
-		(float)(iWidth), 
-		(float)(iHeight),
-		iMax_Iterations,
-		sColor );
+	    if( pPlacement->vNextTile[ iNode ].load() < pPlacement->vBandEnd[ iNode ] )
+	    {
+		// Local Variables
+		int iTile = pPlacement->vNextTile[ iNode ].fetch_add( 1 );
 
-    // Output Completion
-    cout << "Process Complete!" << string( iPROGRESS_BAR_SIZE, ' ' ) << "\n";
+		if( iTile < pPlacement->vBandEnd[ iNode ] )
+		    return iTile;
+	    }
+	}
+    }
 
-    // Write the image.
-    magNewImage.write( cFileName );
+    return sSchedule.iTilesX * sSchedule.iTilesY;
 }
+
+// Description: One worker's share of touching its node's band of the buffers
+//              before anything is drawn, so their pages are placed in the
+//              node's own memory.
+// Method: The worker pins itself to its node, takes its slice of the rows of
+//         the node's band (split evenly between the node's workers) and writes
+//         zeroes over them in every buffer the tiles will write: the iteration
+//         counts, the escape times or distances, and the 8 bit raster (only
+//         the pixels, never the padding between rows).  A page belongs to the
+//         node of the thread that first writes it.
+// Parameters: sSchedule - The shared schedule of the render.
+//             iWorker - The index of this worker.
+////////////////////////////////////////////////////////////////////////////////
+void Touch_Band( sTileSchedule *sSchedule, const int iWorker )
+{
+    // Local Variables
+    const sNumaPlacement &sPlacement = *sSchedule->pPlacement;
+    const int iNodes = (int)( sPlacement.vOrder.size() );
+    const int iNode = iWorker % iNodes;
+    const int iWorkers = ( sPlacement.iThreads - iNode + iNodes - 1 ) / iNodes;
+    const int iBandStart = min( sPlacement.vBandStart[ iNode ] / sSchedule->iTilesX * sSchedule->iTileSize,
+				sSchedule->iDrawHeight );
+    const int iBandEnd = min( sPlacement.vBandEnd[ iNode ] / sSchedule->iTilesX * sSchedule->iTileSize,
+			      sSchedule->iDrawHeight );
+    const int iStartY = iBandStart + ( iBandEnd - iBandStart ) * ( iWorker / iNodes ) / iWorkers;
+    const int iEndY = iBandStart + ( iBandEnd - iBandStart ) * ( iWorker / iNodes + 1 ) / iWorkers;
+    const size_t iStart = (size_t)( iStartY ) * sSchedule->iWidth;
+    const size_t iCount = (size_t)( iEndY - iStartY ) * sSchedule->iWidth;
+    sIterationField &sField = *sSchedule->pIterations;
+
+    Pin_Thread_To_Node( sPlacement.sTopology, iNode );
+
+    if( iCount == 0 )
+	return;
+
+    Fill_Iterations( sField, iStart, iCount, 0 );
+
+    if( sSchedule->pSmooth != NULL )
+	memset( &( *sSchedule->pSmooth )[ iStart ], 0, iCount * sizeof( float ) );
+
+    if( sSchedule->pDistance != NULL )
+	memset( &( *sSchedule->pDistance )[ iStart ], 0, iCount * sizeof( float ) );
+
+    if( sSchedule->pRaster != NULL )
+    {
+	// Local Variables
+	const sRaster &sTarget = *sSchedule->pRaster;
+
+	for( int y = iStartY; y < iEndY; ++y )
+	    memset( sTarget.pPixels + (size_t)( y ) * sTarget.iStride, 0,
+		    (size_t)( sSchedule->iWidth ) * sTarget.iChannels );
+    }
+}
+
+// Description: Body of each worker thread.
+// Method: Keep pulling the next tile (Get_Next_Tile) and drawing it until
+//         every tile has been handed out, or the program streaming the tiles
+//         has stopped listening.  Since the tiles are handed out dynamically,
+//         the workers that get cheap tiles (outside the set) simply pick up
+//         more of them.  With NUMA placement the worker first pins itself to
+//         its node.  The scratch row of real parts is allocated once up front;
+//         if that fails we flag it in the schedule rather than let bad_alloc
+//         escape the thread, and every worker stops.
+// Parameters: sSchedule - The shared schedule of the render.
+//             iWorker - The index of this worker.
+////////////////////////////////////////////////////////////////////////////////
+void Render_Worker( sTileSchedule *sSchedule, const int iWorker )
+{
+    // Local Variables
+    const int iTileCount = sSchedule->iTilesX * sSchedule->iTilesY;
+    int iTile = 0;
+    vector< double > vCReal;
+
+    Set_Trace_Thread_Name( "worker", iWorker );
+
+    try
+    {
+	vCReal.resize( sSchedule->iTileSize );
+    }
+    catch( const bad_alloc & )
+    {
+	sSchedule->bOutOfMemory.store( true );
+	return;
+    }
+
+    if( sSchedule->pPlacement != NULL )
+	Pin_Thread_To_Node( sSchedule->pPlacement->sTopology,
+			    iWorker % (int)( sSchedule->pPlacement->vOrder.size() ) );
+
+    iTile = Get_Next_Tile( *sSchedule, iWorker );
+
+    while( ( iTile < iTileCount ) && !sSchedule->bOutOfMemory.load() &&
+	   ( ( sSchedule->pTiles == NULL ) || !Is_Tile_Queue_Abandoned( *sSchedule->pTiles ) ) )
+    {
+	Draw_Tile( *sSchedule, iTile, iWorker, &vCReal[ 0 ] );
+	iTile = Get_Next_Tile( *sSchedule, iWorker );
+    }
+}
+
+// Description: Copies the rows below iDrawHeight (iterations, escape times,
+//              distances and colors) from their mirror images above the real
+//              axis and counts them in the statistics.
+// Method: Row y and row (iHeight - 1 - y) sample complex conjugates of each
+//         other, which escape after the same number of iterations.
+// Parameters: sSchedule - The shared schedule of the (finished) render.
+////////////////////////////////////////////////////////////////////////////////
+void Mirror_Rows( sTileSchedule &sSchedule )
+{
+    // Local Variables
+    sIterationField &sField = *sSchedule.pIterations;
+    sRenderStats &sStats = *sSchedule.pStats;
+    const size_t iWidth = (size_t)( sSchedule.iWidth );
+
+    for( int y = sSchedule.iDrawHeight; y < sSchedule.iHeight; ++y )
+    {
+	const size_t iRow = (size_t)( y ) * iWidth;
+	const size_t iMirror = (size_t)( sSchedule.iHeight - 1 - y ) * iWidth;
+
+	Copy_Iterations( sField, iRow, iMirror, iWidth );
+
+	if( sSchedule.pSmooth != NULL )
+	    copy( sSchedule.pSmooth->begin() + iMirror, sSchedule.pSmooth->begin() + iMirror + iWidth,
+		  sSchedule.pSmooth->begin() + iRow );
+
+	if( sSchedule.pDistance != NULL )
+	    copy( sSchedule.pDistance->begin() + iMirror,
+		  sSchedule.pDistance->begin() + iMirror + iWidth,
+		  sSchedule.pDistance->begin() + iRow );
+
+	if( sSchedule.pPixels != NULL )
+	    copy( sSchedule.pPixels->begin() + iMirror, sSchedule.pPixels->begin() + iMirror + iWidth,
+		  sSchedule.pPixels->begin() + iRow );
+
+	if( sSchedule.pRaster != NULL )
+	{
+	    // Local Variables
+	    const sRaster &sTarget = *sSchedule.pRaster;
+
+	    memcpy( sTarget.pPixels + (size_t)( y ) * sTarget.iStride,
+		    sTarget.pPixels + (size_t)( sSchedule.iHeight - 1 - y ) * sTarget.iStride,
+		    iWidth * sTarget.iChannels );
+	}
+
+	for( size_t x = 0; x < iWidth; ++x )
+	{
+	    // Local Variables
+	    const int iterations = Get_Iterations( sField, iRow + x );
+
+	    sStats.llIterations += iterations;
+	    ++sStats.vHistogram[ Get_Histogram_Bucket( iterations ) ];
+
+	    if( iterations == sSchedule.iMax_Iterations )
+		++sStats.llCapped;
+	    else
+		++sStats.llEscaped;
+
+	    if( !sSchedule.vBins.empty() )
+		++sSchedule.vBins[ 0 ][ iterations ];
+	}
+
+	Add_Progress( *sSchedule.pProgress, (long long)( iWidth ) );
+    }
+}
+
+// Description: One worker's share of building the histogram equalization
+//              table out of the per worker bins.
+// Method: The bins are split into one chunk per worker and built with a two
+//         pass parallel prefix sum.  In the first pass each worker adds up the
+//         bins of every worker for its chunk (and the chunk's total).  In the
+//         second pass each worker starts from the totals of the chunks before
+//         its own and runs the prefix sum over its chunk, dividing by the
+//         number of escaped pixels.  The bin at iMax_Iterations holds the
+//         pixels in the set and is left out.
+// Parameters: sSchedule - The shared schedule of the render.
+//             iPass - 0 to add up the bins, 1 for the prefix sum.
+//             iChunk, iChunks - This worker's chunk and the number of chunks.
+//             pTotals - The bins added up over every worker.
+//             pChunkSums - The escaped pixels in each chunk.
+////////////////////////////////////////////////////////////////////////////////
+void Scan_Bins( sTileSchedule *sSchedule,
+		const int iPass,
+		const int iChunk,
+		const int iChunks,
+		vector< long long > *pTotals,
+		vector< long long > *pChunkSums )
+{
+    // Local Variables
+    const int iBins = sSchedule->iMax_Iterations + 1;
+    const int iChunkSize = ( iBins + iChunks - 1 ) / iChunks;
+    const int iStart = min( iChunk * iChunkSize, iBins );
+    const int iEnd = min( iStart + iChunkSize, iBins );
+    long long llRunning = 0;
+    long long llEscaped = 0;
+
+    if( iPass == 0 )
+    {
+	for( int k = iStart; k < iEnd; ++k )
+	{
+	    long long llTotal = 0;
+
+	    for( size_t w = 0; w < sSchedule->vBins.size(); ++w )
+		llTotal += sSchedule->vBins[ w ][ k ];
+
+	    ( *pTotals )[ k ] = llTotal;
+
+	    if( k < sSchedule->iMax_Iterations )
+		llRunning += llTotal;
+	}
+
+	( *pChunkSums )[ iChunk ] = llRunning;
+	return;
+    }
+
+    for( int c = 0; c < iChunks; ++c )
+    {
+	llEscaped += ( *pChunkSums )[ c ];
+
+	if( c < iChunk )
+	    llRunning += ( *pChunkSums )[ c ];
+    }
+
+    for( int k = iStart; ( k < iEnd ) && ( k < sSchedule->iMax_Iterations ); ++k )
+    {
+	llRunning += ( *pTotals )[ k ];
+	sSchedule->vCDF[ k ] = ( llEscaped > 0 ) ?
+	    (float)( (double)( llRunning ) / (double)( llEscaped ) ) : 1.0f;
+    }
+}
+
+// Description: Body of each worker thread of the histogram equalized coloring
+//              pass.  Pulls tiles off of the shared counter like Render_Worker
+//              and colors them.
+// Parameters: sSchedule - The shared schedule of the render.
+//             iWorker - The index of this worker.
+//             pSeconds - Set to the time this worker spent coloring.
+////////////////////////////////////////////////////////////////////////////////
+void Color_Worker( sTileSchedule *sSchedule, const int iWorker, double *pSeconds )
+{
+    // Local Variables
+    const int iTileCount = sSchedule->iTilesX * sSchedule->iTilesY;
+    const int iTileSize = sSchedule->iTileSize;
+    chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+    int iTile = sSchedule->iNextTile.fetch_add( 1 );
+
+    Set_Trace_Thread_Name( "worker", iWorker );
+
+    while( iTile < iTileCount )
+    {
+	TRACE_SPAN( "coloring", "color" );
+	int iStartX = ( iTile % sSchedule->iTilesX ) * iTileSize;
+	int iStartY = ( iTile / sSchedule->iTilesX ) * iTileSize;
+
+	Color_Box( *sSchedule, iStartX, iStartY, min( iStartX + iTileSize, sSchedule->iWidth ),
+		   min( iStartY + iTileSize, sSchedule->iHeight ) );
+	iTile = sSchedule->iNextTile.fetch_add( 1 );
+    }
+
+    *pSeconds = Get_Seconds( tStart, chrono::steady_clock::now() );
+}
+
+// Description: Runs a worker function on a number of threads at once and waits
+//              for them all: on the pool's threads when there is a pool, or on
+//              threads started just for this.
+// Parameters: pPool - The pool (or NULL).
+//             iThreads - The number of workers.
+//             fnWorker - The worker, passed its index.
+////////////////////////////////////////////////////////////////////////////////
+void Run_Workers( sThreadPool *pPool, const int iThreads, const function< void( int ) > &fnWorker )
+{
+    // Local Variables
+    vector< thread > vWorkers;
+
+    if( pPool != NULL )
+    {
+	Run_On_Pool( *pPool, iThreads, fnWorker );
+	return;
+    }
+
+    for( int i = 0; i < iThreads; ++i )
+	vWorkers.push_back( thread( fnWorker, i ) );
+
+    for( int i = 0; i < iThreads; ++i )
+	vWorkers[ i ].join();
+}
+
+// Description: Colors the whole image by histogram equalization once every
+//              pixel's number of iterations is known.
+// Method: The per worker bins filled in while drawing are turned into the
+//         equalization table (Scan_Bins), then the tiles (now covering every
+//         row, mirrored or not) are handed out to the workers again to be
+//         colored.  The time spent is added to the coloring statistics.
+// Parameters: sSchedule - The shared schedule of the (drawn) render.
+//             iThreads - The number of worker threads to use.
+////////////////////////////////////////////////////////////////////////////////
+void Equalize_Colors( sTileSchedule &sSchedule, const int iThreads )
+{
+    // Local Variables
+    TRACE_SPAN( "equalize", "color" );
+    const int iBins = sSchedule.iMax_Iterations + 1;
+    vector< long long > vTotals( iBins );
+    vector< long long > vChunkSums( iThreads );
+    vector< double > vSeconds( iThreads );
+
+    sSchedule.vCDF.assign( iBins, 1.0f );
+
+    for( int iPass = 0; iPass < 2; ++iPass )
+	Run_Workers( sSchedule.pPool, iThreads, [ & ]( int i )
+		     { Scan_Bins( &sSchedule, iPass, i, iThreads, &vTotals, &vChunkSums ); } );
+
+    sSchedule.iDrawHeight = sSchedule.iHeight;
+    sSchedule.iTilesY = ( sSchedule.iHeight + sSchedule.iTileSize - 1 ) / sSchedule.iTileSize;
+    sSchedule.iNextTile.store( 0 );
+
+    Run_Workers( sSchedule.pPool, iThreads, [ & ]( int i )
+		 { Color_Worker( &sSchedule, i, &vSeconds[ i ] ); } );
+
+    for( int i = 0; i < iThreads; ++i )
+    {
+	sSchedule.pStats->dColorSeconds += vSeconds[ i ];
+	sSchedule.pStats->vWorkers[ i ].dBusySeconds += vSeconds[ i ];
+    }
+}
+
+// Description: Works out how many worker threads to use for a render.
+// Parameters: iRequested - Threads requested by the user (0 = automatic).
+//             iTileCount - The number of tiles in the render.  There's no
+//                          point in starting more workers than tiles.
+// Return Value: Returns the number of worker threads (at least 1).
+////////////////////////////////////////////////////////////////////////////////
+int Get_Thread_Count( const int iRequested, const int iTileCount )
+{
+    // Local Variables
+    int iThreads = iRequested;
+
+    if( iThreads <= 0 )
+	iThreads = (int)( thread::hardware_concurrency() );
+
+    if( iThreads > iTileCount )
+	iThreads = iTileCount;
+
+    return max( iThreads, 1 );
+}
+
+// Description: Draws the iteration counts (and, if asked for, the colors) of
+//              every pixel of an image on the worker threads.
+// Method: We split the image up into tiles and start the worker threads (and
+//         the progress reporter) that draw the tiles using the Escape Time
+//         Algorithm.  When mirroring a view that is symmetric about the real
+//         axis, the tiles only cover the top half and the bottom half is
+//         copied from it once the workers finish.  Histogram equalized colors
+//         are only worked out after that, since they depend on every pixel.
+//         When there's a band queue, each row of tiles is pushed onto it as
+//         soon as its last tile is colored; if the colors have to wait for
+//         the whole image (mirroring, histogram equalization), the whole
+//         image is pushed once it is done.  Tiles are streamed onto a tile
+//         queue the same way: each as soon as it is colored, or every tile,
+//         in order, once the image is done.  With NUMA placement each node
+//         gets a band of rows of tiles, its workers are pinned to it and
+//         touch the band's part of the buffers before any tile is drawn, and
+//         they draw their own band's tiles before stealing other nodes'.  The
+//         histogram coloring pass still takes its tiles off of the shared
+//         counter.
+// Parameters: iWidth, iHeight - The size of the image.
+//             iMax_Iterations - The escape time limit of each pixel.
+//             pColor - The color filters (NULL when only the iteration counts
+//                      are wanted).
+//             sOptions - The render options.
+//             sField - Filled with the iteration counts (16 bit when they
+//                      fit).
+//             pPixels - Filled with the row major colors (or NULL).
+//             pRaster - When not NULL, the colors are written here as 8 bit
+//                       samples (or palette indices) instead of into
+//                       pPixels.
+//             sReport - The progress of the render.
+//             sStats - Filled with the (merged) statistics of the render.
+//             pBands - When not NULL, the finished bands of pPixels are pushed
+//                      onto this queue (it is left open).
+//             pTiles - When not NULL, the finished tiles are pushed onto this
+//                      queue (it is left open).  Once it is abandoned the
+//                      render stops early, leaving the rest undrawn.
+////////////////////////////////////////////////////////////////////////////////
+void Render_Tiles( const int iWidth,
+		   const int iHeight,
+		   const int iMax_Iterations,
+		   const sColorCode *pColor,
+		   const sRenderOptions &sOptions,
+		   sIterationField &sField,
+		   vector< sPixelColor > *pPixels,
+		   const sRaster *pRaster,
+		   sProgress &sReport,
+		   sRenderStats &sStats,
+		   sBandQueue *pBands,
+		   sTileQueue *pTiles )
+{
+    // Local Variables
+    vector< float, sUntouchedAllocator< float > > vSmooth;
+    vector< float, sUntouchedAllocator< float > > vDistance;
+    sTileSchedule sSchedule;
+    sNumaPlacement sPlacement;
+    int iThreads = sOptions.iThreads;
+
+    Init_Iteration_Field( sField, (size_t)( iWidth ) * iHeight, iMax_Iterations );
+
+    if( pPixels != NULL )
+	pPixels->resize( (size_t)( iWidth ) * iHeight );
+
+    // The smooth and equalized colorings need the continuous escape times,
+    // distance shading needs the distance estimates.
+    sSchedule.eColoring = ( pColor != NULL ) ? sOptions.eColoring : eCOLOR_LINEAR;
+    sSchedule.pSmooth = NULL;
+    sSchedule.pDistance = NULL;
+    sSchedule.dPixelSize = max( ( sOptions.sView.dXMax - sOptions.sView.dXMin ) / max( iWidth - 1, 1 ),
+				( sOptions.sView.dYMax - sOptions.sView.dYMin ) / max( iHeight - 1, 1 ) );
+
+    if( ( sSchedule.eColoring == eCOLOR_SMOOTH ) || ( sSchedule.eColoring == eCOLOR_HISTOGRAM ) )
+    {
+	vSmooth.resize( (size_t)( iWidth ) * iHeight );
+	sSchedule.pSmooth = &vSmooth;
+    }
+    else if( sSchedule.eColoring == eCOLOR_DISTANCE )
+    {
+	vDistance.resize( (size_t)( iWidth ) * iHeight );
+	sSchedule.pDistance = &vDistance;
+    }
+
+    // Only draw the top half of a symmetric view of a symmetric set when
+    // mirroring.
+    sSchedule.iDrawHeight = iHeight;
+
+    if( ( sOptions.eTraversal == eTRAVERSAL_MIRROR ) &&
+	( sOptions.sView.dYMin == -sOptions.sView.dYMax ) &&
+	Is_Mirror_Symmetric( sOptions.sFormula ) )
+	sSchedule.iDrawHeight = ( iHeight + 1 ) / 2;
+
+    // Split the image up into tiles.
+    sSchedule.iTileSize = max( sOptions.iTileSize, 1 );
+    sSchedule.iTilesX = ( iWidth + sSchedule.iTileSize - 1 ) / sSchedule.iTileSize;
+    sSchedule.iTilesY = ( sSchedule.iDrawHeight + sSchedule.iTileSize - 1 ) / sSchedule.iTileSize;
+    sSchedule.iNextTile.store( 0 );
+    sSchedule.iWidth = iWidth;
+    sSchedule.iHeight = iHeight;
+    sSchedule.sView = sOptions.sView;
+    sSchedule.iMax_Iterations = iMax_Iterations;
+    sSchedule.eKernel = sOptions.eKernel;
+    sSchedule.sFormula = sOptions.sFormula;
+    sSchedule.eTraversal = sOptions.eTraversal;
+    sSchedule.pColor = pColor;
+    sSchedule.pIterations = &sField;
+    sSchedule.pPixels = pPixels;
+    sSchedule.pRaster = pRaster;
+    sSchedule.pPool = sOptions.pPool;
+    sSchedule.pPlacement = NULL;
+    sSchedule.pProgress = &sReport;
+    sSchedule.pStats = &sStats;
+    sSchedule.pBands = pBands;
+    sSchedule.pTilesLeft = NULL;
+    sSchedule.pTiles = pTiles;
+    sSchedule.bStreamTiles = false;
+    sSchedule.bOutOfMemory.store( false );
+
+    // Bands (and tiles) can only go out early when nothing is left to do to
+    // them once their tiles are drawn.
+    vector< atomic< int > > vTilesLeft( sSchedule.iTilesY );
+
+    if( ( pBands != NULL ) && ( ( pPixels != NULL ) || ( pRaster != NULL ) ) &&
+	( sSchedule.iDrawHeight == iHeight ) &&
+	( sSchedule.eColoring != eCOLOR_HISTOGRAM ) )
+    {
+	for( int i = 0; i < sSchedule.iTilesY; ++i )
+	    vTilesLeft[ i ].store( sSchedule.iTilesX );
+
+	sSchedule.pTilesLeft = &vTilesLeft[ 0 ];
+    }
+
+    if( ( pTiles != NULL ) && ( ( pPixels != NULL ) || ( pRaster != NULL ) ) &&
+	( sSchedule.iDrawHeight == iHeight ) &&
+	( sSchedule.eColoring != eCOLOR_HISTOGRAM ) )
+	sSchedule.bStreamTiles = true;
+
+    // Draw the tiles on the worker threads.
+    if( sOptions.pPool != NULL )
+	iThreads = ( iThreads > 0 ) ? min( iThreads, Get_Pool_Size( *sOptions.pPool ) ) :
+	    Get_Pool_Size( *sOptions.pPool );
+
+    iThreads = Get_Thread_Count( iThreads, sSchedule.iTilesX * sSchedule.iTilesY );
+    Init_Render_Stats( sStats, iWidth, iHeight, iMax_Iterations, iThreads, sSchedule.iTileSize );
+    Start_Progress( sReport, (long long)( iWidth ) * iHeight, sOptions.eProgress );
+
+    if( sSchedule.eColoring == eCOLOR_HISTOGRAM )
+	sSchedule.vBins.assign( iThreads, vector< long long >( iMax_Iterations + 1, 0 ) );
+
+    if( sOptions.bNuma )
+    {
+	Get_Numa_Topology( sPlacement.sTopology );
+	Init_Numa_Placement( sPlacement, sSchedule, iThreads );
+	sSchedule.pPlacement = &sPlacement;
+	Run_Workers( sSchedule.pPool, iThreads, [ & ]( int i ) { Touch_Band( &sSchedule, i ); } );
+    }
+
+    Run_Workers( sSchedule.pPool, iThreads, [ & ]( int i ) { Render_Worker( &sSchedule, i ); } );
+
+    if( sSchedule.bOutOfMemory.load() )
+	throw bad_alloc();
+
+    Merge_Worker_Stats( sStats );
+    Mirror_Rows( sSchedule );
+
+    if( sSchedule.eColoring == eCOLOR_HISTOGRAM )
+	Equalize_Colors( sSchedule, iThreads );
+
+    if( ( pBands != NULL ) && ( sSchedule.pTilesLeft == NULL ) )
+	Push_Band( *pBands, 0, iHeight );
+
+    if( ( pTiles != NULL ) && !sSchedule.bStreamTiles )
+	for( int y = 0; y < iHeight; y += sSchedule.iTileSize )
+	    for( int x = 0; x < iWidth; x += sSchedule.iTileSize )
+	    {
+		// Local Variables
+		sTileRect sDone = { x, y, min( sSchedule.iTileSize, iWidth - x ),
+				    min( sSchedule.iTileSize, iHeight - y ) };
+
+		if( !Push_Tile( *pTiles, sDone ) )
+		{
+		    Stop_Progress( sReport );
+		    return;
+		}
+	    }
+
+    Stop_Progress( sReport );
+}
+
+// Description: Draws the number of iterations of every pixel of an image
+//              without coloring or saving it.  Used to compare the kernels and
+//              traversals with each other, so the counts are handed back as
+//              ints whatever width they were drawn in.
+// Parameters: iWidth, iHeight - The size of the image.
+//             iMax_Iterations - The escape time limit of each pixel.
+//             sOptions - The render options (statistics and tracing are not
+//                        output).
+//             vIterations - Filled with the row major iteration counts.
+////////////////////////////////////////////////////////////////////////////////
+void Render_Iterations( const int iWidth,
+			const int iHeight,
+			const int iMax_Iterations,
+			const sRenderOptions &sOptions,
+			vector< int > &vIterations )
+{
+    // Local Variables
+    sIterationField sField;
+    sProgress sReport;
+    sRenderStats sStats;
+
+    Render_Tiles( iWidth, iHeight, iMax_Iterations, NULL, sOptions, sField, NULL, NULL,
+		  sReport, sStats, NULL, NULL );
+
+    if( sField.bWide )
+	vIterations.assign( sField.vWide.begin(), sField.vWide.end() );
+    else
+	vIterations.assign( sField.vNarrow.begin(), sField.vNarrow.end() );
+}
+
+// Description: Colors an orbit density image.
+// Method: The density runs over several orders of magnitude, so it is scaled
+//         to the density the brightest dDENSITY_CLIP of the lit pixels start
+//         at (anything above is clipped) and square rooted before being used
+//         as the color weight.
+// Parameters: vDensity - The row major orbit density.
+//             sColor - The color filters specified by the user.
+//             vPixels - Filled with the colors.
+////////////////////////////////////////////////////////////////////////////////
+void Color_Density( const vector< double > &vDensity,
+		    const sColorCode &sColor,
+		    vector< sPixelColor > &vPixels )
+{
+    TRACE_SPAN( "coloring", "color" );
+
+    // Local Variables
+    vector< double > vLit;
+    double dScale = 0.0;
+
+    for( size_t i = 0; i < vDensity.size(); ++i )
+	if( vDensity[ i ] > 0.0 )
+	    vLit.push_back( vDensity[ i ] );
+
+    if( !vLit.empty() )
+    {
+	vector< double >::iterator itClip = vLit.begin() +
+	    (ptrdiff_t)( (double)( vLit.size() - 1 ) * ( 1.0 - dDENSITY_CLIP ) );
+
+	nth_element( vLit.begin(), itClip, vLit.end() );
+	dScale = 1.0 / *itClip;
+    }
+
+    vPixels.resize( vDensity.size() );
+
+    for( size_t i = 0; i < vDensity.size(); ++i )
+	vPixels[ i ] = Parse_Color( (float)( sqrt( min( vDensity[ i ] * dScale, 1.0 ) ) ), sColor );
+}
+
+// Description: Checks whether an image is drawn whole into a buffer of colors
+//              (Draw_Color_Buffer) rather than tile by tile: an orbit density
+//              image or a Julia atlas.
+// Return Value: Returns true if it is.
+////////////////////////////////////////////////////////////////////////////////
+bool Is_Buffered_Render( const sRenderOptions &sOptions )
+{
+    return ( sOptions.llOrbitSamples > 0 ) || ( sOptions.iAtlasSize > 0 );
+}
+
+// Description: Draws an orbit density image or a Julia atlas (which takes
+//              precedence) and colors it into a buffer.
+// Parameters: iWidth, iHeight - The size of the image.
+//             iMax_Iterations - The escape time limit of each pixel.
+//             sColor - The color filters.
+//             sOptions - The render options.
+//             vPixels - Filled with the row major colors.
+//             sReport - The progress of the render.
+//             sStats - The statistics of the render.
+////////////////////////////////////////////////////////////////////////////////
+void Draw_Color_Buffer( const int iWidth,
+			const int iHeight,
+			const int iMax_Iterations,
+			const sColorCode &sColor,
+			const sRenderOptions &sOptions,
+			vector< sPixelColor > &vPixels,
+			sProgress &sReport,
+			sRenderStats &sStats )
+{
+    if( sOptions.iAtlasSize > 0 )
+    {
+	// Local Variables
+	vector< float > vWeights;
+
+	Render_Atlas( iWidth, iHeight, iMax_Iterations, sOptions, vWeights, sReport, sStats );
+
+	TRACE_SPAN( "coloring", "color" );
+
+	vPixels.resize( vWeights.size() );
+
+	for( size_t i = 0; i < vWeights.size(); ++i )
+	    vPixels[ i ] = Parse_Color( vWeights[ i ], sColor );
+    }
+    else
+    {
+	// Local Variables
+	vector< double > vDensity;
+
+	Render_Buddhabrot( iWidth, iHeight, iMax_Iterations, sOptions, vDensity, sReport, sStats );
+	Color_Density( vDensity, sColor, vPixels );
+    }
+}
+
+// Description: Draws the image into a tightly packed 8 bit RGB raster: the
+//              workers color each tile straight into it, or an orbit density
+//              image (the densities are only known at the end) or a Julia
+//              atlas is colored into a buffer first and then copied in.
+// Parameters: iWidth, iHeight - the size of the image.
+//             iMax_Iterations - the escape time limit of each pixel.
+//             sColor - the color filters.
+//             sOptions - the render options.
+//             pRaster - the raster, iWidth * 3 bytes per row.
+//             sReport - the progress of the render.
+//             sStats - the statistics of the render.
+////////////////////////////////////////////////////////////////////////////////
+void Draw_Raster( const int iWidth,
+		  const int iHeight,
+		  const int iMax_Iterations,
+		  const sColorCode &sColor,
+		  const sRenderOptions &sOptions,
+		  unsigned char *pRaster,
+		  sProgress &sReport,
+		  sRenderStats &sStats )
+{
+    // Local Variables
+    sIterationField sField;
+    chrono::steady_clock::time_point tStart;
+
+    if( Is_Buffered_Render( sOptions ) )
+    {
+	// Local Variables
+	vector< sPixelColor > vPixels;
+
+	Draw_Color_Buffer( iWidth, iHeight, iMax_Iterations, sColor, sOptions, vPixels, sReport,
+			   sStats );
+
+	tStart = chrono::steady_clock::now();
+
+	for( size_t i = 0; i < vPixels.size(); ++i )
+	{
+	    pRaster[ i * 3 ] = Get_Color_Byte( vPixels[ i ].dRed );
+	    pRaster[ i * 3 + 1 ] = Get_Color_Byte( vPixels[ i ].dGreen );
+	    pRaster[ i * 3 + 2 ] = Get_Color_Byte( vPixels[ i ].dBlue );
+	}
+
+	sStats.dEncodeSeconds += Get_Seconds( tStart, chrono::steady_clock::now() );
+    }
+    else
+    {
+	// Local Variables
+	sRaster sTarget = { pRaster, (size_t)( iWidth ) * 3, 3 };
+
+	Render_Tiles( iWidth, iHeight, iMax_Iterations, &sColor, sOptions, sField, NULL,
+		      &sTarget, sReport, sStats, NULL, NULL );
+    }
+}
+
+// Description: Draws the image for a file's encode stage, handing each band of
+//              it over through a queue as soon as it is finished.
+// Method: An image drawn tile by tile goes through Render_Tiles, which pushes
+//         each row of tiles once its last tile is colored.  An orbit density
+//         image or a Julia atlas can only be colored once all of it is drawn
+//         (Draw_Raster, Draw_Color_Buffer), so it is pushed whole.
+// Parameters: iWidth, iHeight - the size of the image.
+//             iMax_Iterations - the escape time limit of each pixel.
+//             sColor - the color filters.
+//             sOptions - the render options.
+//             pPixels - filled with the row major colors (or NULL).
+//             pRaster - when not NULL, the colors are written here as 8 bit
+//                       samples (or palette indices) instead of into pPixels.
+//             sReport - the progress of the render.
+//             sStats - the statistics of the render.
+//             sBands - the queue the finished bands are pushed onto (it is
+//                      left open).
+////////////////////////////////////////////////////////////////////////////////
+void Draw_Bands( const int iWidth,
+		 const int iHeight,
+		 const int iMax_Iterations,
+		 const sColorCode &sColor,
+		 const sRenderOptions &sOptions,
+		 vector< sPixelColor > *pPixels,
+		 const sRaster *pRaster,
+		 sProgress &sReport,
+		 sRenderStats &sStats,
+		 sBandQueue &sBands )
+{
+    // Local Variables
+    sIterationField sField;
+
+    if( !Is_Buffered_Render( sOptions ) )
+    {
+	Render_Tiles( iWidth, iHeight, iMax_Iterations, &sColor, sOptions, sField, pPixels,
+		      pRaster, sReport, sStats, &sBands, NULL );
+	return;
+    }
+
+    if( pRaster != NULL )
+	Draw_Raster( iWidth, iHeight, iMax_Iterations, sColor, sOptions, pRaster->pPixels, sReport,
+		     sStats );
+    else
+	Draw_Color_Buffer( iWidth, iHeight, iMax_Iterations, sColor, sOptions, *pPixels, sReport,
+			   sStats );
+
+    Push_Band( sBands, 0, iHeight );
+}
+
+// Description: Draws the image into the caller's memory.
+// Method: This is the interface for programs embedding the renderer.  It does
+//         no file or console I/O and keeps no state between calls; the workers
+//         color each tile straight into the caller's raster, on the caller's
+//         pool when there is one.  Orbit density images aren't drawn here.
+// Parameters: iWidth, iHeight - the size of the image.
+//             iMax_Iterations - the escape time limit of each pixel.
+//             sColor - the color filters.
+//             sOptions - the render options (progress, statistics and tracing
+//                        are ignored).
+//             sTarget - the raster to draw into, iHeight rows of iWidth pixels.
+//             pTiles - when not NULL, each tile is pushed onto this queue once
+//                      it is drawn (see Render_Tiles).
+////////////////////////////////////////////////////////////////////////////////
+void Render_Raster( const int iWidth,
+		    const int iHeight,
+		    const int iMax_Iterations,
+		    const sColorCode &sColor,
+		    const sRenderOptions &sOptions,
+		    const sRaster &sTarget,
+		    sTileQueue *pTiles )
+{
+    // Local Variables
+    sIterationField sField;
+    sRenderOptions sQuiet = sOptions;
+    sProgress sReport;
+    sRenderStats sStats;
+
+    sQuiet.eProgress = ePROGRESS_NONE;
+    sQuiet.eStats = eSTATS_NONE;
+    sQuiet.cpStatsFile = NULL;
+    sQuiet.cpTraceFile = NULL;
+
+    Render_Tiles( iWidth, iHeight, iMax_Iterations, &sColor, sQuiet, sField, NULL, &sTarget,
+		  sReport, sStats, NULL, pTiles );
+}
+
+// PROGRESSIVE SCHEDULE STRUCTURE
+// Parts: sTiles - The schedule the samples are drawn and colored with.  Its
+//                 buffers cover the whole image, but only the samples are set.
+//        pLimit - When to give up.
+//        pCompleteness - One byte per pixel (iWidth per row) telling how its
+//                        color was found (NULL when not wanted).
+//        iStep - The spacing of the samples of the current pass.
+//        bFirstPass - Set during the coarsest pass, which draws every sample
+//                     on the grid rather than only the new ones.
+//        iNextRow - The next row of samples to hand out.
+//        bStopped - Set once the deadline has passed or the render has been
+//                   cancelled.
+////////////////////////////////////////////////////////////////////////////////
+struct sProgressiveSchedule
+{
+    sTileSchedule sTiles;
+    const sRenderLimit *pLimit;
+    unsigned char *pCompleteness;
+    int iStep;
+    bool bFirstPass;
+    atomic< int > iNextRow;
+    atomic< bool > bStopped;
+};
+
+// Description: Checks whether a render has been cancelled or run out of time.
+////////////////////////////////////////////////////////////////////////////////
+bool Is_Render_Stopped( const sRenderLimit &sLimit )
+{
+    if( ( sLimit.pCancel != NULL ) && sLimit.pCancel->load( memory_order_relaxed ) )
+	return true;
+
+    return sLimit.bDeadline && ( chrono::steady_clock::now() >= sLimit.tDeadline );
+}
+
+// Description: Draws some samples of a row of the current pass and fills the
+//              block below and to the right of each with its color.
+// Parameters: sProgressive - The shared schedule of the render.
+//             y - The row of the samples.
+//             iStartX - The column of the first sample.
+//             iSpacing - The columns between the samples.
+//             iCount - The number of samples.
+//             dCReal[] - Scratch space for the real parts of c.
+//             iIterations[], fSmooth[], fDistance[] - Scratch space for the
+//                                                      kernel's results.
+////////////////////////////////////////////////////////////////////////////////
+void Draw_Samples( sProgressiveSchedule &sProgressive,
+		   const int y,
+		   const int iStartX,
+		   const int iSpacing,
+		   const int iCount,
+		   double dCReal[],
+		   int iIterations[],
+		   float fSmooth[],
+		   float fDistance[] )
+{
+    // Local Variables
+    const sTileSchedule &sSchedule = sProgressive.sTiles;
+    const sViewport &sView = sSchedule.sView;
+    const int iStep = sProgressive.iStep;
+    const double dMaxX = (double)( sSchedule.iWidth );
+    const double dMaxY = (double)( sSchedule.iHeight );
+    const int iEndY = min( y + iStep, sSchedule.iHeight );
+
+    if( Is_Reference_Path( sSchedule ) )
+    {
+	for( int i = 0; i < iCount; ++i )
+	    iIterations[ i ] = Get_Reference_Pixel( sSchedule, iStartX + i * iSpacing, y,
+						    ( sSchedule.pSmooth != NULL ) ? &fSmooth[ i ] : NULL );
+    }
+    else
+    {
+	for( int i = 0; i < iCount; ++i )
+	    dCReal[ i ] = sView.dXMin + (double)( iStartX + i * iSpacing ) / ( dMaxX - 1.0 ) *
+		( sView.dXMax - sView.dXMin );
+
+	Get_Escape_Row( sSchedule.eKernel,
+			sSchedule.sFormula,
+			dCReal,
+			sView.dYMin + (double)( y ) / ( dMaxY - 1.0 ) * ( sView.dYMax - sView.dYMin ),
+			iCount,
+			sSchedule.iMax_Iterations,
+			iIterations,
+			( sSchedule.pSmooth != NULL ) ? fSmooth : NULL,
+			( sSchedule.pDistance != NULL ) ? fDistance : NULL );
+    }
+
+    for( int i = 0; i < iCount; ++i )
+    {
+	// Local Variables
+	const int x = iStartX + i * iSpacing;
+	const int iEndX = min( x + iStep, sSchedule.iWidth );
+	const size_t iPixel = (size_t)( y ) * sSchedule.iWidth + x;
+	sPixelColor cColor;
+
+	Set_Iterations( *sSchedule.pIterations, iPixel, iIterations[ i ] );
+
+	if( sSchedule.pSmooth != NULL )
+	    ( *sSchedule.pSmooth )[ iPixel ] = fSmooth[ i ];
+
+	if( sSchedule.pDistance != NULL )
+	    ( *sSchedule.pDistance )[ iPixel ] = fDistance[ i ];
+
+	cColor = Parse_Color( Get_Color_Weight( sSchedule, iPixel ), *sSchedule.pColor );
+
+	for( int yFill = y; yFill < iEndY; ++yFill )
+	{
+	    for( int xFill = x; xFill < iEndX; ++xFill )
+		Put_Pixel( sSchedule, xFill, yFill, cColor );
+
+	    if( sProgressive.pCompleteness != NULL )
+		memset( sProgressive.pCompleteness + (size_t)( yFill ) * sSchedule.iWidth + x, iStep,
+			iEndX - x );
+	}
+
+	if( sProgressive.pCompleteness != NULL )
+	    sProgressive.pCompleteness[ iPixel ] = 1;
+    }
+}
+
+// Description: Body of each worker thread of a progressive render.
+// Method: Keep pulling the next row of samples of the pass off of the shared
+//         counter and drawing it, iPROGRESSIVE_CHUNK samples at a time.
+//         Before each chunk we check the limit, so a cancelled or late render
+//         frees its workers within a chunk's worth of work.
+// Parameters: sProgressive - The shared schedule of the render.
+////////////////////////////////////////////////////////////////////////////////
+void Progressive_Worker( sProgressiveSchedule *sProgressive )
+{
+    // Local Variables
+    const int iStep = sProgressive->iStep;
+    const int iWidth = sProgressive->sTiles.iWidth;
+    const int iRows = ( sProgressive->sTiles.iHeight + iStep - 1 ) / iStep;
+    double dCReal[ iPROGRESSIVE_CHUNK ];
+    int iIterations[ iPROGRESSIVE_CHUNK ];
+    float fSmooth[ iPROGRESSIVE_CHUNK ];
+    float fDistance[ iPROGRESSIVE_CHUNK ];
+    int iRow = sProgressive->iNextRow.fetch_add( 1 );
+
+    while( ( iRow < iRows ) && !sProgressive->bStopped.load() )
+    {
+	// Local Variables
+	const int y = iRow * iStep;
+	bool bNewRow = sProgressive->bFirstPass || ( y % ( iStep * 2 ) != 0 );
+	int iStartX = bNewRow ? 0 : iStep;
+	int iSpacing = bNewRow ? iStep : iStep * 2;
+
+	for( int x = iStartX; x < iWidth; x += iSpacing * iPROGRESSIVE_CHUNK )
+	{
+	    if( Is_Render_Stopped( *sProgressive->pLimit ) )
+	    {
+		sProgressive->bStopped.store( true );
+		return;
+	    }
+
+	    Draw_Samples( *sProgressive, y, x, iSpacing,
+			  min( iPROGRESSIVE_CHUNK, ( iWidth - x + iSpacing - 1 ) / iSpacing ),
+			  dCReal, iIterations, fSmooth, fDistance );
+	}
+
+	iRow = sProgressive->iNextRow.fetch_add( 1 );
+    }
+}
+
+// Description: Draws the image into the caller's memory coarse to fine, giving
+//              up when the time runs out or the render is cancelled.
+// Method: The first pass draws every iPROGRESSIVE_STEP'th pixel of every
+//         iPROGRESSIVE_STEP'th row and fills the block around each with its
+//         color, so the whole image is roughed in quickly.  Each later pass
+//         halves the spacing and draws only the new samples (like the passes
+//         of an interlaced image), until the last pass draws the pixels that
+//         are left.  If the limit is hit the image holds the best estimate so
+//         far: every block drawn has the color of its top left corner.  The
+//         completeness map has a byte per pixel: 1 when the pixel's own color
+//         was drawn, the size of the block it was filled from when it is an
+//         estimate, and 0 (the pixel left as it was) when the render stopped
+//         before reaching it.  Histogram equalization needs every pixel, so
+//         it is drawn with the smooth coloring instead.
+// Parameters: iWidth, iHeight - the size of the image.
+//             iMax_Iterations - the escape time limit of each pixel.
+//             sColor - the color filters.
+//             sOptions - the render options (the traversal, progress,
+//                        statistics and tracing are ignored).
+//             sTarget - the raster to draw into, iHeight rows of iWidth pixels.
+//             sLimit - when to give up.
+//             pCompleteness - Filled with the completeness map, iWidth bytes
+//                             per row (or NULL).
+// Return Value: Returns true if every pixel was drawn.
+////////////////////////////////////////////////////////////////////////////////
+bool Render_Progressive( const int iWidth,
+			 const int iHeight,
+			 const int iMax_Iterations,
+			 const sColorCode &sColor,
+			 const sRenderOptions &sOptions,
+			 const sRaster &sTarget,
+			 const sRenderLimit &sLimit,
+			 unsigned char *pCompleteness )
+{
+    // Local Variables
+    sIterationField sField;
+    vector< float, sUntouchedAllocator< float > > vSmooth;
+    vector< float, sUntouchedAllocator< float > > vDistance;
+    sProgressiveSchedule sProgressive;
+    sTileSchedule &sSchedule = sProgressive.sTiles;
+    int iThreads = sOptions.iThreads;
+
+    sSchedule.eColoring = ( sOptions.eColoring == eCOLOR_HISTOGRAM ) ? eCOLOR_SMOOTH : sOptions.eColoring;
+    sSchedule.pSmooth = NULL;
+    sSchedule.pDistance = NULL;
+    sSchedule.dPixelSize = max( ( sOptions.sView.dXMax - sOptions.sView.dXMin ) / max( iWidth - 1, 1 ),
+				( sOptions.sView.dYMax - sOptions.sView.dYMin ) / max( iHeight - 1, 1 ) );
+
+    if( sSchedule.eColoring == eCOLOR_SMOOTH )
+    {
+	vSmooth.resize( (size_t)( iWidth ) * iHeight );
+	sSchedule.pSmooth = &vSmooth;
+    }
+    else if( sSchedule.eColoring == eCOLOR_DISTANCE )
+    {
+	vDistance.resize( (size_t)( iWidth ) * iHeight );
+	sSchedule.pDistance = &vDistance;
+    }
+
+    sSchedule.iWidth = iWidth;
+    sSchedule.iHeight = iHeight;
+    sSchedule.iDrawHeight = iHeight;
+    sSchedule.sView = sOptions.sView;
+    sSchedule.iMax_Iterations = iMax_Iterations;
+    sSchedule.eKernel = sOptions.eKernel;
+    sSchedule.sFormula = sOptions.sFormula;
+    sSchedule.eTraversal = eTRAVERSAL_TILED;
+    sSchedule.pColor = &sColor;
+    Init_Iteration_Field( sField, (size_t)( iWidth ) * iHeight, iMax_Iterations );
+    sSchedule.pIterations = &sField;
+    sSchedule.pPixels = NULL;
+    sSchedule.pRaster = &sTarget;
+    sSchedule.pPool = sOptions.pPool;
+    sSchedule.pPlacement = NULL;
+    sSchedule.pTiles = NULL;
+    sSchedule.bStreamTiles = false;
+    sSchedule.bOutOfMemory.store( false );
+    sProgressive.pLimit = &sLimit;
+    sProgressive.pCompleteness = pCompleteness;
+    sProgressive.bStopped.store( false );
+
+    if( pCompleteness != NULL )
+	memset( pCompleteness, 0, (size_t)( iWidth ) * iHeight );
+
+    if( sOptions.pPool != NULL )
+	iThreads = ( iThreads > 0 ) ? min( iThreads, Get_Pool_Size( *sOptions.pPool ) ) :
+	    Get_Pool_Size( *sOptions.pPool );
+
+    iThreads = Get_Thread_Count( iThreads, ( iHeight + iPROGRESSIVE_STEP - 1 ) / iPROGRESSIVE_STEP );
+
+    for( int iStep = iPROGRESSIVE_STEP; ( iStep >= 1 ) && !sProgressive.bStopped.load(); iStep /= 2 )
+    {
+	sProgressive.iStep = iStep;
+	sProgressive.bFirstPass = ( iStep == iPROGRESSIVE_STEP );
+	sProgressive.iNextRow.store( 0 );
+
+	Run_Workers( sSchedule.pPool, iThreads, [ & ]( int ) { Progressive_Worker( &sProgressive ); } );
+    }
+
+    return !sProgressive.bStopped.load();
+}
\ No newline at end of file
@@ -6,6 +6,18 @@
 #ifndef MANDELBROT_H
 #define MANDELBROT_H
 
+// INCLUDES
+#include "Kernel.h"
+#include "Progress.h"
+#include "Stats.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+struct sThreadPool;
+struct sTileQueue;
+
 // Enum to easily identify the different RGB values in the fRGBMask array.
 enum eColorCodes
 {
@@ -31,11 +43,184 @@ struct sColorCode
     bool bGreyScale;
 };
 
+// Enum of the ways the workers can traverse the image.
+// eTRAVERSAL_TILED - Every pixel of every tile is run through the kernel.
+// eTRAVERSAL_MIRROR - When the view is symmetric about the real axis only the
+//                     top half is drawn and the bottom half is mirrored from it.
+// eTRAVERSAL_BOUNDARY - The border of each tile is drawn first and boxes with a
+//                       uniform border are filled in, otherwise the box is split
+//                       in four and traced again (Mariani-Silver).
+enum eTraversalType
+{
+    eTRAVERSAL_TILED = 0,
+    eTRAVERSAL_MIRROR = 1,
+    eTRAVERSAL_BOUNDARY = 2
+};
+
+// Enum of the ways the number of iterations is turned into a color weight.
+// eCOLOR_LINEAR - iterations / iMax_Iterations, as the program always has.
+// eCOLOR_SMOOTH - The continuous (normalized) escape time / iMax_Iterations,
+//                 so there are no bands between iteration counts.
+// eCOLOR_HISTOGRAM - The fraction of escaped pixels that escaped sooner
+//                    (histogram equalization), which spreads the palette over
+//                    the counts that are actually in the image.
+// eCOLOR_DISTANCE - Shades by the estimated distance to the set, so the thin
+//                   filaments near the boundary show up at low iteration
+//                   counts.  Pixels far from the set are filled in bulk.
+enum eColorMode
+{
+    eCOLOR_LINEAR = 0,
+    eCOLOR_SMOOTH = 1,
+    eCOLOR_HISTOGRAM = 2,
+    eCOLOR_DISTANCE = 3
+};
+
+// VIEWPORT STRUCTURE
+// Parts: dXMin, dXMax - The real bounds of the complex plane in the image.
+//        dYMin, dYMax - The imaginary bounds of the complex plane in the image.
+////////////////////////////////////////////////////////////////////////////////
+struct sViewport
+{
+    double dXMin;
+    double dXMax;
+    double dYMin;
+    double dYMax;
+};
+
+// RASTER STRUCTURE
+// Parts: pPixels - The first byte of the top row of 8 bit pixels.
+//        iStride - The number of bytes from the start of one row to the next
+//                  (at least iWidth * iChannels).
+//        iChannels - 3 for red, green, blue or 4 to add an (opaque) alpha.  1
+//                    holds the color weight of each pixel as an index into
+//                    a palette of iPNG_PALETTE_COLORS colors instead.
+////////////////////////////////////////////////////////////////////////////////
+struct sRaster
+{
+    unsigned char *pPixels;
+    size_t iStride;
+    int iChannels;
+};
+
+// RENDER LIMIT STRUCTURE
+// Parts: bDeadline - Set when the render has to stop at tDeadline.
+//        tDeadline - When to stop.
+//        pCancel - Set (from any thread) to stop as soon as possible (NULL
+//                  when the render can't be cancelled).
+////////////////////////////////////////////////////////////////////////////////
+struct sRenderLimit
+{
+    bool bDeadline;
+    std::chrono::steady_clock::time_point tDeadline;
+    const std::atomic< bool > *pCancel;
+};
+
+// RENDER OPTIONS STRUCTURE
+// Parts: sView - The area of the complex plane to draw.
+//        iThreads - The number of worker threads to render with.  0 uses one
+//                   worker per hardware thread.
+//        iTileSize - The width and height of the square tiles that the workers
+//                    pull from the shared tile counter.
+//        eKernel - The escape time kernel used to draw the pixels.
+//        sFormula - The formula iterated for each pixel.
+//        eTraversal - How the workers traverse the pixels of the image.
+//        eColoring - How the number of iterations is turned into a color.
+//        eProgress - How the progress of the render is reported.
+//        eStats - The format to output the statistics of the render in.
+//        cpStatsFile - The file to write the statistics to (NULL = stderr).
+//        cpTraceFile - When set, the render is traced and the timeline is
+//                      written to this file as Chrome trace-event JSON.
+//        llOrbitSamples - When above 0, the image is the orbit density
+//                         (Buddhabrot) of this many sampled points instead
+//                         of the escape times.
+//        bMapped - Draw PPM and PAM images straight into the file, mapped
+//                  into memory, instead of encoding them from a buffer.
+//        bStdout - Write the image to standard output; the file name only
+//                  picks the format.
+//        iFrames - The number of frames of a video (.y4m or .rgb) output.
+//        dFrameZoom - The width of the view of each frame relative to the
+//                     frame before it, around the same center (below 1
+//                     zooms in).
+//        iFrameRate - The frames per second of a video.
+//        bIndexed - Write PNG images as 8 bit palette indices instead of RGB.
+//        bNuma - Spread the workers over the NUMA nodes, pinned, and give each
+//                node its own band of tiles, placed in its own memory.
+//        iAtlasSize - When above 0, the image is an atlas of Julia sets instead:
+//                     thumbnails this many pixels square, each the Julia set
+//                     of the c under its center (see Render_Atlas).
+//        pPool - The threads to render on (NULL to start iThreads threads for
+//                the render alone).  iThreads is capped at the pool's size.
+////////////////////////////////////////////////////////////////////////////////
+struct sRenderOptions
+{
+    sViewport sView;
+    int iThreads;
+    int iTileSize;
+    eKernelType eKernel;
+    sIterationFormula sFormula;
+    eTraversalType eTraversal;
+    eColorMode eColoring;
+    eProgressMode eProgress;
+    eStatsFormat eStats;
+    const char *cpStatsFile;
+    const char *cpTraceFile;
+    long long llOrbitSamples;
+    bool bMapped;
+    bool bStdout;
+    int iFrames;
+    double dFrameZoom;
+    int iFrameRate;
+    bool bIndexed;
+    bool bNuma;
+    int iAtlasSize;
+    sThreadPool *pPool;
+};
+
 // FUNCTION DECLARATIONS
-void Create_Image( char cFileName[], 
-		   const int iWidth, 
-		   const int iHeight, 
-		   const int iMax_Iterations,
-		   const sColorCode &sColor );
+sViewport Initiate_Viewport( );
+
+sRenderOptions Initiate_Render_Options( );
+
+sViewport Get_Centered_Viewport( const double dCenterX,
+				 const double dCenterY,
+				 const double dSpanX,
+				 const int iWidth,
+				 const int iHeight );
+
+int Get_Thread_Count( const int iRequested, const int iTileCount );
+
+bool Is_Buffered_Render( const sRenderOptions &sOptions );
+
+void Render_Iterations( const int iWidth,
+			const int iHeight,
+			const int iMax_Iterations,
+			const sRenderOptions &sOptions,
+			std::vector< int > &vIterations );
+
+void Render_Raster( const int iWidth,
+		    const int iHeight,
+		    const int iMax_Iterations,
+		    const sColorCode &sColor,
+		    const sRenderOptions &sOptions,
+		    const sRaster &sTarget,
+		    sTileQueue *pTiles );
+
+void Draw_Raster( const int iWidth,
+		  const int iHeight,
+		  const int iMax_Iterations,
+		  const sColorCode &sColor,
+		  const sRenderOptions &sOptions,
+		  unsigned char *pRaster,
+		  sProgress &sReport,
+		  sRenderStats &sStats );
+
+bool Render_Progressive( const int iWidth,
+			 const int iHeight,
+			 const int iMax_Iterations,
+			 const sColorCode &sColor,
+			 const sRenderOptions &sOptions,
+			 const sRaster &sTarget,
+			 const sRenderLimit &sLimit,
+			 unsigned char *pCompleteness );
 
 #endif
@@ -0,0 +1,195 @@
+// Name: Numa.cpp
+// Description: Module implementation of the NUMA topology and thread pinning.
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "Numa.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+
+// Namespaces
+using namespace std;
+
+// CONSTANTS
+// Where Linux describes the nodes: a nodeN directory for each, holding its
+// cpulist ("0-7,16-23") and its distance to every node ("10 21").
+const char cNODE_DIRECTORY[] = "/sys/devices/system/node";
+
+// The distance the firmware gives a node to itself.
+const int iLOCAL_DISTANCE = 10;
+
+// Description: Reads a CPU list ("0-3,8,10-11") into the CPUs it names.
+// Parameters: sList - The list.
+//             vCpus - Set to the CPUs.
+////////////////////////////////////////////////////////////////////////////////
+static void Parse_Cpu_List( const string &sList, vector< int > &vCpus )
+{
+    // Local Variables
+    stringstream ssList( sList );
+    string sRange;
+
+    vCpus.clear();
+
+    while( getline( ssList, sRange, ',' ) )
+    {
+	// Local Variables
+	char *cpEnd = NULL;
+	long lFirst = strtol( sRange.c_str(), &cpEnd, 10 );
+	long lLast = ( *cpEnd == '-' ) ? strtol( cpEnd + 1, NULL, 10 ) : lFirst;
+
+	if( cpEnd == sRange.c_str() )
+	    continue;
+
+	for( long l = lFirst; l <= lLast; ++l )
+	    vCpus.push_back( (int)( l ) );
+    }
+}
+
+// Description: Finds the NUMA nodes and the CPUs of each that this process may
+//              run on.
+// Method: The node directories are listed and each node's CPU list is read
+//         and cut down to the CPUs of the process's affinity mask.  The
+//         distances of the nodes kept are read out of their distance files
+//         (which list every node, in order of node number).  If there are no
+//         node directories, or none has an allowed CPU, the machine is taken
+//         to be a single node of every allowed CPU.
+// Parameters: sTopology - Set to the topology.
+////////////////////////////////////////////////////////////////////////////////
+void Get_Numa_Topology( sNumaTopology &sTopology )
+{
+    // Local Variables
+    cpu_set_t sAllowed;
+    vector< int > vNodes;
+    vector< int > vKept;
+    DIR *pDirectory = opendir( cNODE_DIRECTORY );
+
+    sTopology.vNodeCpus.clear();
+    sTopology.vDistances.clear();
+    CPU_ZERO( &sAllowed );
+
+    if( sched_getaffinity( 0, sizeof( sAllowed ), &sAllowed ) != 0 )
+	for( int i = 0; i < CPU_SETSIZE; ++i )
+	    CPU_SET( i, &sAllowed );
+
+    if( pDirectory != NULL )
+    {
+	// Local Variables
+	struct dirent *pEntry = NULL;
+
+	while( ( pEntry = readdir( pDirectory ) ) != NULL )
+	    if( ( strncmp( pEntry->d_name, "node", 4 ) == 0 ) && isdigit( pEntry->d_name[ 4 ] ) )
+		vNodes.push_back( atoi( pEntry->d_name + 4 ) );
+
+	closedir( pDirectory );
+	sort( vNodes.begin(), vNodes.end() );
+    }
+
+    for( size_t n = 0; n < vNodes.size(); ++n )
+    {
+	// Local Variables
+	ostringstream ssPath;
+	ifstream fCpuList;
+	string sList;
+	vector< int > vCpus;
+	vector< int > vAllowedCpus;
+
+	ssPath << cNODE_DIRECTORY << "/node" << vNodes[ n ] << "/cpulist";
+	fCpuList.open( ssPath.str().c_str() );
+	getline( fCpuList, sList );
+	Parse_Cpu_List( sList, vCpus );
+
+	for( size_t i = 0; i < vCpus.size(); ++i )
+	    if( ( vCpus[ i ] < CPU_SETSIZE ) && CPU_ISSET( vCpus[ i ], &sAllowed ) )
+		vAllowedCpus.push_back( vCpus[ i ] );
+
+	if( !vAllowedCpus.empty() )
+	{
+	    vKept.push_back( vNodes[ n ] );
+	    sTopology.vNodeCpus.push_back( vAllowedCpus );
+	}
+    }
+
+    if( sTopology.vNodeCpus.empty() )
+    {
+	sTopology.vNodeCpus.push_back( vector< int >() );
+
+	for( int i = 0; i < CPU_SETSIZE; ++i )
+	    if( CPU_ISSET( i, &sAllowed ) )
+		sTopology.vNodeCpus[ 0 ].push_back( i );
+
+	sTopology.vDistances.assign( 1, vector< int >( 1, iLOCAL_DISTANCE ) );
+	return;
+    }
+
+    // Keep the distances between the nodes kept (assume remote when unknown).
+    for( size_t n = 0; n < vKept.size(); ++n )
+    {
+	// Local Variables
+	ostringstream ssPath;
+	ifstream fDistance;
+	vector< int > vAll;
+	int iDistance = 0;
+
+	ssPath << cNODE_DIRECTORY << "/node" << vKept[ n ] << "/distance";
+	fDistance.open( ssPath.str().c_str() );
+
+	while( fDistance >> iDistance )
+	    vAll.push_back( iDistance );
+
+	sTopology.vDistances.push_back( vector< int >( vKept.size(), iLOCAL_DISTANCE * 2 ) );
+
+	for( size_t m = 0; m < vKept.size(); ++m )
+	    if( (size_t)( vKept[ m ] ) < vAll.size() )
+		sTopology.vDistances[ n ][ m ] = vAll[ vKept[ m ] ];
+
+	sTopology.vDistances[ n ][ n ] = iLOCAL_DISTANCE;
+    }
+}
+
+// Description: Lists the nodes in the order a node's threads should look for
+//              work on them: the node itself, then the others nearest first.
+// Parameters: sTopology - The topology.
+//             iNode - The node (an index into sTopology.vNodeCpus).
+//             vOrder - Set to the node indices.
+////////////////////////////////////////////////////////////////////////////////
+void Get_Node_Order( const sNumaTopology &sTopology, const int iNode, vector< int > &vOrder )
+{
+    // Local Variables
+    const vector< int > &vDistance = sTopology.vDistances[ iNode ];
+
+    vOrder.clear();
+
+    for( int i = 0; i < (int)( sTopology.vNodeCpus.size() ); ++i )
+	vOrder.push_back( ( iNode + i ) % (int)( sTopology.vNodeCpus.size() ) );
+
+    // Ties keep the round robin order, so the stealing spreads out.
+    stable_sort( vOrder.begin() + 1, vOrder.end(),
+		 [ & ]( int iLeft, int iRight ) { return vDistance[ iLeft ] < vDistance[ iRight ]; } );
+}
+
+// Description: Pins the calling thread to the CPUs of a node.  The scheduler
+//              is still free to move it between them.
+// Parameters: sTopology - The topology.
+//             iNode - The node (an index into sTopology.vNodeCpus).
+// Return Value: Returns false if the thread couldn't be pinned.
+////////////////////////////////////////////////////////////////////////////////
+bool Pin_Thread_To_Node( const sNumaTopology &sTopology, const int iNode )
+{
+    // Local Variables
+    cpu_set_t sCpus;
+
+    CPU_ZERO( &sCpus );
+
+    for( size_t i = 0; i < sTopology.vNodeCpus[ iNode ].size(); ++i )
+	CPU_SET( sTopology.vNodeCpus[ iNode ][ i ], &sCpus );
+
+    return pthread_setaffinity_np( pthread_self(), sizeof( sCpus ), &sCpus ) == 0;
+}
@@ -0,0 +1,80 @@
+// Name: Numa.h
+// Description: Header for finding the NUMA nodes of the machine and pinning
+//              threads to them.  On a machine with several sockets each socket
+//              has its own memory, and a page lives on the node of the thread
+//              that first writes it, so a render that keeps each node's
+//              workers on their own part of the image (and has them touch
+//              that part first) keeps its memory traffic off of the links
+//              between the sockets.  Buffers that are to be placed this way
+//              use sUntouchedAllocator, so allocating them doesn't touch them.
+//              Machines without NUMA (or without /sys) look like a single
+//              node holding every CPU the process may run on.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef NUMA_H
+#define NUMA_H
+
+// INCLUDES
+#include <memory>
+#include <utility>
+#include <vector>
+
+// NUMA TOPOLOGY STRUCTURE
+// Parts: vNodeCpus - The CPUs of each node that the process may run on.  Nodes
+//                    with no such CPUs (memory only nodes) are left out.
+//        vDistances - The relative distance from each node to each other node
+//                     (10 to itself, the way the firmware reports them).
+////////////////////////////////////////////////////////////////////////////////
+struct sNumaTopology
+{
+    std::vector< std::vector< int > > vNodeCpus;
+    std::vector< std::vector< int > > vDistances;
+};
+
+// UNTOUCHED ALLOCATOR STRUCTURE
+// An allocator for vectors of plain numbers that leaves the elements a resize
+// adds uninitialized instead of zeroing them.  Large buffers come straight
+// from the kernel as pages that don't exist until they are first written, so
+// they end up on the node of whichever thread writes them first rather than
+// all on the node of the thread that allocated them.  Every element has to be
+// written before it is read.
+////////////////////////////////////////////////////////////////////////////////
+template< class T >
+struct sUntouchedAllocator : public std::allocator< T >
+{
+    template< class U >
+    struct rebind
+    {
+	typedef sUntouchedAllocator< U > other;
+    };
+
+    sUntouchedAllocator( )
+    {
+    }
+
+    template< class U >
+    sUntouchedAllocator( const sUntouchedAllocator< U > & )
+    {
+    }
+
+    template< class U >
+    void construct( U *pElement )
+    {
+	::new( (void *)( pElement ) ) U;
+    }
+
+    template< class U, class... Args >
+    void construct( U *pElement, Args &&... args )
+    {
+	::new( (void *)( pElement ) ) U( std::forward< Args >( args )... );
+    }
+};
+
+// FUNCTION DECLARATIONS
+void Get_Numa_Topology( sNumaTopology &sTopology );
+
+void Get_Node_Order( const sNumaTopology &sTopology, const int iNode, std::vector< int > &vOrder );
+
+bool Pin_Thread_To_Node( const sNumaTopology &sTopology, const int iNode );
+
+#endif
@@ -0,0 +1,543 @@
+// Name: Output.cpp
+// Description: Module implementation of the file output of the mandelbrot
+//              image making module.
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "Output.h"
+#include "Color.h"
+#include "Encoder.h"
+#include "Numa.h"
+#include "Pipeline.h"
+#include "Trace.h"
+#include <Magick++.h>
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+// Namespaces
+using namespace Magick;
+using namespace std;
+
+// Description: Writes the statistics of a render out in the format the user
+//              asked for, either to the requested file or to stderr.
+// Parameters: sStats - The (merged) statistics of the render.
+//             sOptions - The render options holding the format and file name.
+////////////////////////////////////////////////////////////////////////////////
+void Output_Stats( const sRenderStats &sStats, const sRenderOptions &sOptions )
+{
+    // Local Variables
+    ofstream fsOut;
+    ostream *pOut = &cerr;
+
+    if( sOptions.eStats == eSTATS_NONE )
+	return;
+
+    if( sOptions.cpStatsFile != NULL )
+    {
+	fsOut.open( sOptions.cpStatsFile );
+
+	if( !fsOut )
+	{
+	    cerr << "Unable to write the statistics to '" << sOptions.cpStatsFile << "'." << endl;
+	    return;
+	}
+
+	pOut = &fsOut;
+    }
+
+    if( sOptions.eStats == eSTATS_JSON )
+	Write_Stats_JSON( *pOut, sStats );
+    else
+	Write_Stats_Prometheus( *pOut, sStats );
+}
+
+// ENCODE STAGE STRUCTURE
+// Parts: pBands - The queue of finished bands.
+//        pPixels - The colors of the image (Magick++ formats).
+//        pRaster - The 8 bit pixels of the image, packed row after row (the
+//                  formats we write ourselves).
+//        cpPalette - The palette pRaster indexes into (NULL when it is RGB).
+//        cpFileName - The file the image is written to.
+//        eFormat - The format of the file.
+//        iWidth, iHeight - The size of the image.
+//        iThreads - The number of threads PNG blocks are compressed on.
+//        bAbandoned - Set (before the queue is closed) when the image will
+//                     never be finished, so Magick++ doesn't write it out.
+//        bWritten - Set once the whole image has been written.
+//        dSeconds - Set to the time the stage spent encoding and writing.
+////////////////////////////////////////////////////////////////////////////////
+struct sEncodeStage
+{
+    sBandQueue *pBands;
+    const vector< sPixelColor > *pPixels;
+    const unsigned char *pRaster;
+    const unsigned char *cpPalette;
+    const char *cpFileName;
+    eImageFormat eFormat;
+    int iWidth;
+    int iHeight;
+    int iThreads;
+    bool bAbandoned;
+    bool bWritten;
+    double dSeconds;
+};
+
+// Description: Body of the encode thread when Magick++ writes the file.
+// Method: Copies each band into the image as the workers finish it (as
+//         Magick++ colors), then writes the image out once the queue is
+//         closed.
+// Parameters: pStage - The stage.
+////////////////////////////////////////////////////////////////////////////////
+void Encode_Magick_Image( sEncodeStage *pStage )
+{
+    // Local Variables
+    const vector< sPixelColor > &vPixels = *pStage->pPixels;
+    Image magNewImage;
+    chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+    sBand sNext;
+
+    magNewImage.extent( Geometry( pStage->iWidth, pStage->iHeight ) );
+    pStage->dSeconds += Get_Seconds( tStart, chrono::steady_clock::now() );
+
+    while( Pop_Band( *pStage->pBands, sNext ) )
+    {
+	TRACE_SPAN( "encode", "encode" );
+
+	tStart = chrono::steady_clock::now();
+
+	for( int y = sNext.iStartRow; y < sNext.iEndRow; ++y )
+	    for( int x = 0; x < pStage->iWidth; ++x )
+	    {
+		// Local Variables
+		const sPixelColor &cPixel = vPixels[ (size_t)( y ) * pStage->iWidth + x ];
+
+		magNewImage.pixelColor( x, y, ColorRGB( cPixel.dRed, cPixel.dGreen, cPixel.dBlue ) );
+	    }
+
+	pStage->dSeconds += Get_Seconds( tStart, chrono::steady_clock::now() );
+    }
+
+    if( pStage->bAbandoned )
+	return;
+
+    // Write the image.
+    {
+	TRACE_SPAN( "write", "io" );
+
+	tStart = chrono::steady_clock::now();
+	magNewImage.write( pStage->cpFileName );
+	pStage->dSeconds += Get_Seconds( tStart, chrono::steady_clock::now() );
+    }
+
+    pStage->bWritten = true;
+}
+
+// Description: Body of the encode thread when we write the file ourselves.
+// Method: The bands come in whatever order the workers finish them, but the
+//         file has to be written top to bottom, so each band is only marked
+//         as ready; every time the rows below the last one written are ready,
+//         they're handed straight from the raster to the writer.  The
+//         queue is drained even if the file couldn't be created, so the
+//         workers never wait on a stage that has given up.
+// Parameters: pStage - The stage.
+////////////////////////////////////////////////////////////////////////////////
+void Encode_Native_Image( sEncodeStage *pStage )
+{
+    // Local Variables
+    const size_t iRowBytes = (size_t)( pStage->iWidth ) * ( ( pStage->cpPalette != NULL ) ? 1 : 3 );
+    sImageWriter sWriter;
+    vector< char > vReady( pStage->iHeight, 0 );
+    int iNextRow = 0;
+    chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+    sBand sNext;
+    bool bOk = ( pStage->cpPalette != NULL ) ?
+	Open_Indexed_Image_Writer( sWriter, pStage->cpFileName, pStage->iWidth, pStage->iHeight,
+				   pStage->iThreads, pStage->cpPalette, iPNG_PALETTE_COLORS ) :
+	Open_Image_Writer( sWriter, pStage->cpFileName, pStage->eFormat,
+			   pStage->iWidth, pStage->iHeight, pStage->iThreads );
+
+    pStage->dSeconds += Get_Seconds( tStart, chrono::steady_clock::now() );
+
+    while( Pop_Band( *pStage->pBands, sNext ) )
+    {
+	// Local Variables
+	int iEndRow = iNextRow;
+
+	for( int y = sNext.iStartRow; y < sNext.iEndRow; ++y )
+	    vReady[ y ] = 1;
+
+	while( ( iEndRow < pStage->iHeight ) && vReady[ iEndRow ] )
+	    ++iEndRow;
+
+	if( !bOk || ( iEndRow == iNextRow ) )
+	    continue;
+
+	TRACE_SPAN( "encode", "encode" );
+
+	tStart = chrono::steady_clock::now();
+	bOk = Write_Image_Rows( sWriter, pStage->pRaster + (size_t)( iNextRow ) * iRowBytes,
+				iEndRow - iNextRow );
+	iNextRow = iEndRow;
+	pStage->dSeconds += Get_Seconds( tStart, chrono::steady_clock::now() );
+    }
+
+    {
+	TRACE_SPAN( "write", "io" );
+
+	tStart = chrono::steady_clock::now();
+	pStage->bWritten = Close_Image_Writer( sWriter ) && bOk;
+	pStage->dSeconds += Get_Seconds( tStart, chrono::steady_clock::now() );
+    }
+}
+
+// Description: Body of the encode thread.
+// Parameters: pStage - The stage.
+////////////////////////////////////////////////////////////////////////////////
+void Encode_Stage( sEncodeStage *pStage )
+{
+    Set_Trace_Thread_Name( "encoder" );
+    pStage->bWritten = false;
+    pStage->dSeconds = 0.0;
+
+    if( pStage->eFormat == eFORMAT_MAGICK )
+	Encode_Magick_Image( pStage );
+    else
+	Encode_Native_Image( pStage );
+}
+
+// Description: Draws the image and hands it to the encode stage, which writes
+//              it to a file.
+// Method: We start the encode stage on its own thread, then the image is drawn
+//         on the worker threads (Draw_Bands).  Each band of it is handed to
+//         the encode stage through a bounded queue as soon as it is
+//         finished, so encoding overlaps with drawing the rest.  PPM, PAM and
+//         PNG files are written by our own writers as the bands come in,
+//         straight from an 8 bit raster the workers color into (a byte per
+//         pixel, indexing a palette of the color weights, for an indexed
+//         PNG); any other format is colored into a buffer of colors and
+//         goes through a Magick++ Image (sized to the width and height) that
+//         is written once the last band is in.
+// Parameters: cFileName[] - the name of the file to save the image to (or
+//                           cSTANDARD_OUTPUT).
+//             eFormat - the format to write it in.
+//             bIndexed - write a PNG of palette indices (escape times only).
+//             iWidth, iHeight - the size of the image.
+//             iMax_Iterations - the escape time limit of each pixel.
+//             sColor - the color filters.
+//             sOptions - the render options.
+//             sReport - the progress of the render.
+//             sStats - the statistics of the render.
+// Return Value: Returns true if the image was written.
+////////////////////////////////////////////////////////////////////////////////
+bool Draw_Encoded_Image( const char cFileName[],
+			 const eImageFormat eFormat,
+			 const bool bIndexed,
+			 const int iWidth,
+			 const int iHeight,
+			 const int iMax_Iterations,
+			 const sColorCode &sColor,
+			 const sRenderOptions &sOptions,
+			 sProgress &sReport,
+			 sRenderStats &sStats )
+{
+    // Local Variables
+    const int iChannels = bIndexed ? 1 : 3;
+    vector< sPixelColor > vPixels;
+    vector< unsigned char, sUntouchedAllocator< unsigned char > > vRaster;
+    unsigned char cPalette[ iPNG_PALETTE_COLORS * 3 ];
+    sBandQueue sBands;
+    sEncodeStage sStage;
+    thread thEncoder;
+
+    if( eFormat != eFORMAT_MAGICK )
+	vRaster.resize( (size_t)( iWidth ) * iHeight * iChannels );
+
+    if( bIndexed )
+	Get_Palette( sColor, cPalette );
+
+    Init_Band_Queue( sBands, iBAND_QUEUE_CAPACITY );
+    sStage.pBands = &sBands;
+    sStage.pPixels = &vPixels;
+    sStage.pRaster = vRaster.empty() ? NULL : &vRaster[ 0 ];
+    sStage.cpPalette = bIndexed ? cPalette : NULL;
+    sStage.cpFileName = cFileName;
+    sStage.eFormat = eFormat;
+    sStage.iWidth = iWidth;
+    sStage.iHeight = iHeight;
+    sStage.iThreads = Get_Thread_Count( sOptions.iThreads, iHeight );
+    sStage.bAbandoned = false;
+    thEncoder = thread( Encode_Stage, &sStage );
+
+    // If drawing throws (runs out of memory), the encode stage still has to be
+    // stopped and joined before the exception goes on to the caller.
+    try
+    {
+	if( eFormat != eFORMAT_MAGICK )
+	{
+	    // Local Variables
+	    sRaster sTarget = { &vRaster[ 0 ], (size_t)( iWidth ) * iChannels, iChannels };
+
+	    Draw_Bands( iWidth, iHeight, iMax_Iterations, sColor, sOptions, NULL, &sTarget, sReport,
+			sStats, sBands );
+	}
+	else
+	    Draw_Bands( iWidth, iHeight, iMax_Iterations, sColor, sOptions, &vPixels, NULL, sReport,
+			sStats, sBands );
+    }
+    catch( ... )
+    {
+	sStage.bAbandoned = true;
+	Close_Band_Queue( sBands );
+	thEncoder.join();
+	throw;
+    }
+
+    // Wait for the encode stage to write the image.
+    Close_Band_Queue( sBands );
+    thEncoder.join();
+
+    sStats.dEncodeSeconds += sStage.dSeconds;
+
+    return sStage.bWritten;
+}
+
+// Description: Draws the image straight into a memory mapped PPM or PAM file.
+// Method: The file is created at its full size and mapped, and the workers
+//         color each tile straight into it as 8 bit samples (Draw_Raster), so
+//         there is no pixel buffer, copy or encoding at all; the page cache
+//         writes the pages back whenever it likes.
+// Parameters: cFileName[] - the name of the file to save the image to.
+//             eFormat - eFORMAT_PPM or eFORMAT_PAM.
+//             iWidth, iHeight - the size of the image.
+//             iMax_Iterations - the escape time limit of each pixel.
+//             sColor - the color filters.
+//             sOptions - the render options.
+//             sReport - the progress of the render.
+//             sStats - the statistics of the render.
+// Return Value: Returns true if the image was written.
+////////////////////////////////////////////////////////////////////////////////
+bool Draw_Mapped_Image( const char cFileName[],
+			const eImageFormat eFormat,
+			const int iWidth,
+			const int iHeight,
+			const int iMax_Iterations,
+			const sColorCode &sColor,
+			const sRenderOptions &sOptions,
+			sProgress &sReport,
+			sRenderStats &sStats )
+{
+    // Local Variables
+    sMappedImage sImage;
+    chrono::steady_clock::time_point tStart;
+    bool bWritten = false;
+
+    if( !Open_Mapped_Image( sImage, cFileName, eFormat, iWidth, iHeight ) )
+    {
+	Init_Render_Stats( sStats, iWidth, iHeight, iMax_Iterations, 0, sOptions.iTileSize );
+	return false;
+    }
+
+    Draw_Raster( iWidth, iHeight, iMax_Iterations, sColor, sOptions, sImage.pPixels, sReport,
+		 sStats );
+
+    {
+	TRACE_SPAN( "write", "io" );
+
+	tStart = chrono::steady_clock::now();
+	bWritten = Close_Mapped_Image( sImage );
+	sStats.dEncodeSeconds += Get_Seconds( tStart, chrono::steady_clock::now() );
+    }
+
+    return bWritten;
+}
+
+// Description: Body of the writer thread of a video: writes one frame.
+// Parameters: pWriter - The video's writer.
+//             pRaster - The frame, 8 bit RGB.
+//             pOk - Cleared if the frame couldn't be written.
+//             pSeconds - The time spent writing is added to this.
+////////////////////////////////////////////////////////////////////////////////
+void Write_Frame( sImageWriter *pWriter, const unsigned char *pRaster, bool *pOk, double *pSeconds )
+{
+    TRACE_SPAN( "write", "io" );
+
+    // Local Variables
+    chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+
+    if( !Write_Image_Rows( *pWriter, pRaster, pWriter->iHeight ) )
+	*pOk = false;
+
+    *pSeconds += Get_Seconds( tStart, chrono::steady_clock::now() );
+}
+
+// Description: Draws the frames of a zoom and streams them to a video file,
+//              FIFO or standard output as YUV4MPEG2 or raw RGB.
+// Method: Each frame is drawn straight into one of two 8 bit rasters
+//         (Draw_Raster) and handed to a writer thread, which converts and
+//         writes it while the next frame is drawn into the other raster.
+//         There are no files per frame and nothing is encoded or decoded on
+//         the way to the video encoder reading the stream.  The view of each
+//         frame is the view of the one before, dFrameZoom times as wide and
+//         high, around the same center.  The statistics are those of the
+//         last frame, with the time spent writing every frame.
+// Parameters: cpOutput - the name of the file (or cSTANDARD_OUTPUT).
+//             eFormat - eFORMAT_Y4M or eFORMAT_RGB.
+//             iWidth, iHeight - the size of each frame.
+//             iMax_Iterations - the escape time limit of each pixel.
+//             sColor - the color filters.
+//             sOptions - the render options.
+//             sReport - the progress of the render of each frame.
+//             sStats - the statistics of the render.
+// Return Value: Returns true if every frame was written.
+////////////////////////////////////////////////////////////////////////////////
+bool Draw_Video( const char cpOutput[],
+		 const eImageFormat eFormat,
+		 const int iWidth,
+		 const int iHeight,
+		 const int iMax_Iterations,
+		 const sColorCode &sColor,
+		 const sRenderOptions &sOptions,
+		 sProgress &sReport,
+		 sRenderStats &sStats )
+{
+    // Local Variables
+    const int iFrames = max( sOptions.iFrames, 1 );
+    const double dCenterX = ( sOptions.sView.dXMin + sOptions.sView.dXMax ) / 2.0;
+    const double dCenterY = ( sOptions.sView.dYMin + sOptions.sView.dYMax ) / 2.0;
+    sRenderOptions sFrame = sOptions;
+    sImageWriter sWriter;
+    vector< unsigned char > vRasters[ 2 ];
+    thread thWriter;
+    double dHalfWidth = ( sOptions.sView.dXMax - sOptions.sView.dXMin ) / 2.0;
+    double dHalfHeight = ( sOptions.sView.dYMax - sOptions.sView.dYMin ) / 2.0;
+    double dWriteSeconds = 0.0;
+    bool bOk = Open_Image_Writer( sWriter, cpOutput, eFormat, iWidth, iHeight,
+				  Get_Thread_Count( sOptions.iThreads, iHeight ), iFrames,
+				  sOptions.iFrameRate );
+
+    if( !bOk )
+    {
+	Init_Render_Stats( sStats, iWidth, iHeight, iMax_Iterations, 0, sOptions.iTileSize );
+	return false;
+    }
+
+    for( int i = 0; i < 2; ++i )
+	vRasters[ i ].resize( (size_t)( iWidth ) * iHeight * 3 );
+
+    for( int f = 0; f < iFrames; ++f )
+    {
+	// Local Variables
+	unsigned char *pRaster = &vRasters[ f % 2 ][ 0 ];
+
+	sFrame.sView.dXMin = dCenterX - dHalfWidth;
+	sFrame.sView.dXMax = dCenterX + dHalfWidth;
+	sFrame.sView.dYMin = dCenterY - dHalfHeight;
+	sFrame.sView.dYMax = dCenterY + dHalfHeight;
+	dHalfWidth *= sOptions.dFrameZoom;
+	dHalfHeight *= sOptions.dFrameZoom;
+
+	Draw_Raster( iWidth, iHeight, iMax_Iterations, sColor, sFrame, pRaster, sReport, sStats );
+
+	// The frame before has to be out before its raster is drawn over.
+	if( thWriter.joinable() )
+	    thWriter.join();
+
+	thWriter = thread( Write_Frame, &sWriter, pRaster, &bOk, &dWriteSeconds );
+    }
+
+    thWriter.join();
+
+    bOk = Close_Image_Writer( sWriter ) && bOk;
+    sStats.dEncodeSeconds += dWriteSeconds;
+
+    return bOk;
+}
+
+// Description: Creates a mandelbrot image.  Saves it into a file with the
+//              provided file name and sizes the image to the provided width
+//              and height.
+// Method: This is our main interface with the caller.  Video files (.y4m and
+//         .rgb) are streamed a frame at a time (Draw_Video).  When asked to
+//         map the output (and the file is a PPM or PAM file), the workers
+//         draw straight into the mapped file (Draw_Mapped_Image); otherwise
+//         the image is drawn into a pixel buffer and encoded alongside
+//         (Draw_Encoded_Image).  Any of our own formats can be written to
+//         standard output instead of the file, for piping into another
+//         program.  We then output a completion prompt.  Finally,
+//         the statistics (and the trace) collected along the way are output if
+//         the user asked for them.
+// Parameters: cFileName[] - the name of the file to save the image to.
+//             iWidth - the desired width of the image.
+//             iHeight - the desired height of the image.
+//             sColor - A constant reference to the color filters specified from
+//                      the user.
+//             sOptions - A constant reference to the render options (viewport,
+//                        threads, tile size, traversal, output, progress,
+//                        statistics and tracing).
+////////////////////////////////////////////////////////////////////////////////
+void Create_Image( char cFileName[], 
+		   const int iWidth, 
+		   const int iHeight,
+		   const int iMax_Iterations,
+		   const sColorCode &sColor,
+		   const sRenderOptions &sOptions )
+{
+    // Local Variables
+    eImageFormat eFormat = Get_Image_Format( cFileName );
+    bool bMappable = ( ( eFormat == eFORMAT_PPM ) || ( eFormat == eFORMAT_PAM ) ) &&
+	!sOptions.bStdout;
+    bool bIndexable = ( eFormat == eFORMAT_PNG ) && !Is_Buffered_Render( sOptions );
+    const char *cpOutput = sOptions.bStdout ? cSTANDARD_OUTPUT : cFileName;
+    sProgress sReport;
+    sRenderStats sStats;
+    bool bWritten = false;
+    chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+
+    if( sOptions.cpTraceFile != NULL )
+    {
+	Enable_Tracing();
+	Set_Trace_Thread_Name( "main" );
+    }
+
+    if( sOptions.bMapped && !bMappable )
+	cerr << "Only .ppm and .pam files can be mapped; writing '" << cFileName
+	     << "' the usual way." << endl;
+
+    if( sOptions.bIndexed && !bIndexable )
+	cerr << "Only .png images drawn a tile at a time can be indexed; writing '" << cFileName
+	     << "' in RGB." << endl;
+
+    if( ( sOptions.iFrames > 1 ) && !Is_Video_Format( eFormat ) )
+	cerr << "Only .y4m and .rgb files can hold more than one frame; drawing the first." << endl;
+
+    if( Is_Video_Format( eFormat ) )
+	bWritten = Draw_Video( cpOutput, eFormat, iWidth, iHeight, iMax_Iterations, sColor, sOptions,
+			       sReport, sStats );
+    else if( sOptions.bMapped && bMappable )
+	bWritten = Draw_Mapped_Image( cFileName, eFormat, iWidth, iHeight, iMax_Iterations, sColor,
+				      sOptions, sReport, sStats );
+    else if( sOptions.bStdout && ( eFormat == eFORMAT_MAGICK ) )
+    {
+	cerr << "Only .ppm, .pam, .png, .y4m and .rgb images can be written to standard output." << endl;
+	Init_Render_Stats( sStats, iWidth, iHeight, iMax_Iterations, 0, sOptions.iTileSize );
+    }
+    else
+	bWritten = Draw_Encoded_Image( cpOutput, eFormat, sOptions.bIndexed && bIndexable, iWidth, iHeight,
+				       iMax_Iterations, sColor, sOptions, sReport, sStats );
+
+    // Output Completion
+    if( bWritten )
+	cout << "Process Complete!\n";
+    else
+	cerr << "Unable to write the image to '" << cpOutput << "'." << endl;
+
+    sStats.dWallSeconds = Get_Seconds( tStart, chrono::steady_clock::now() );
+    Output_Stats( sStats, sOptions );
+
+    if( ( sOptions.cpTraceFile != NULL ) && !Write_Trace_JSON( sOptions.cpTraceFile ) )
+	cerr << "Unable to write the trace to '" << sOptions.cpTraceFile << "'." << endl;
+}
@@ -0,0 +1,24 @@
+// Name: Output.h
+// Description: Header for the file output of the mandelbrot image making
+//              module: drawing an image (or the frames of a video) and writing
+//              it out with our own writers (Encoder.h) or Magick++, then
+//              reporting the statistics and the trace.  Kept apart from the
+//              renderer itself so the embeddable renderer (Renderer.h) links
+//              neither Magick++ nor the file writers.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+// INCLUDES
+#include "Mandelbrot.h"
+
+// FUNCTION DECLARATIONS
+void Create_Image( char cFileName[], 
+		   const int iWidth, 
+		   const int iHeight, 
+		   const int iMax_Iterations,
+		   const sColorCode &sColor,
+		   const sRenderOptions &sOptions );
+
+#endif
@@ -0,0 +1,182 @@
+// Name: Pipeline.cpp
+// Description: Module implementation of the band queue between the render
+//              workers and the encode stage, and of the tile queue between the
+//              render workers and a program streaming the tiles.
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "Pipeline.h"
+
+// Namespaces
+using namespace std;
+
+// Description: Sets up an empty, open queue.
+// Parameters: sQueue - The queue.
+//             iCapacity - The most bands that can be waiting (at least 1).
+////////////////////////////////////////////////////////////////////////////////
+void Init_Band_Queue( sBandQueue &sQueue, const size_t iCapacity )
+{
+    sQueue.dqBands.clear();
+    sQueue.iCapacity = ( iCapacity > 0 ) ? iCapacity : 1;
+    sQueue.bClosed = false;
+}
+
+// Description: Adds a finished band to the queue, waiting first while the
+//              queue is full.
+// Parameters: sQueue - The queue.
+//             iStartRow, iEndRow - The finished rows ([start, end)).
+////////////////////////////////////////////////////////////////////////////////
+void Push_Band( sBandQueue &sQueue, const int iStartRow, const int iEndRow )
+{
+    // Local Variables
+    unique_lock< mutex > lock( sQueue.mtxQueue );
+    sBand sNew = { iStartRow, iEndRow };
+
+    while( sQueue.dqBands.size() >= sQueue.iCapacity )
+	sQueue.cvNotFull.wait( lock );
+
+    sQueue.dqBands.push_back( sNew );
+    lock.unlock();
+    sQueue.cvNotEmpty.notify_one();
+}
+
+// Description: Takes the oldest band off of the queue, waiting for one if the
+//              queue is empty.
+// Parameters: sQueue - The queue.
+//             sNext - Set to the band.
+// Return Value: Returns false once the queue is closed and every band has been
+//               taken.
+////////////////////////////////////////////////////////////////////////////////
+bool Pop_Band( sBandQueue &sQueue, sBand &sNext )
+{
+    // Local Variables
+    unique_lock< mutex > lock( sQueue.mtxQueue );
+
+    while( sQueue.dqBands.empty() && !sQueue.bClosed )
+	sQueue.cvNotEmpty.wait( lock );
+
+    if( sQueue.dqBands.empty() )
+	return false;
+
+    sNext = sQueue.dqBands.front();
+    sQueue.dqBands.pop_front();
+    lock.unlock();
+    sQueue.cvNotFull.notify_one();
+
+    return true;
+}
+
+// Description: Marks the queue as finished; Pop_Band returns false once the
+//              bands still in it are taken.
+// Parameters: sQueue - The queue.
+////////////////////////////////////////////////////////////////////////////////
+void Close_Band_Queue( sBandQueue &sQueue )
+{
+    {
+	lock_guard< mutex > lock( sQueue.mtxQueue );
+
+	sQueue.bClosed = true;
+    }
+
+    sQueue.cvNotEmpty.notify_all();
+}
+
+// Description: Sets up an empty, open queue.
+// Parameters: sQueue - The queue.
+//             iCapacity - The most tiles that can be waiting (at least 1).
+////////////////////////////////////////////////////////////////////////////////
+void Init_Tile_Queue( sTileQueue &sQueue, const size_t iCapacity )
+{
+    sQueue.dqTiles.clear();
+    sQueue.iCapacity = ( iCapacity > 0 ) ? iCapacity : 1;
+    sQueue.bClosed = false;
+    sQueue.bAbandoned.store( false );
+}
+
+// Description: Adds a finished tile to the queue, waiting first while the
+//              queue is full.
+// Parameters: sQueue - The queue.
+//             sTile - The finished tile.
+// Return Value: Returns false, without waiting, once the queue is abandoned.
+////////////////////////////////////////////////////////////////////////////////
+bool Push_Tile( sTileQueue &sQueue, const sTileRect &sTile )
+{
+    // Local Variables
+    unique_lock< mutex > lock( sQueue.mtxQueue );
+
+    while( ( sQueue.dqTiles.size() >= sQueue.iCapacity ) && !sQueue.bAbandoned.load() )
+	sQueue.cvNotFull.wait( lock );
+
+    if( sQueue.bAbandoned.load() )
+	return false;
+
+    sQueue.dqTiles.push_back( sTile );
+    lock.unlock();
+    sQueue.cvNotEmpty.notify_one();
+
+    return true;
+}
+
+// Description: Takes the oldest tile off of the queue, waiting for one if the
+//              queue is empty.
+// Parameters: sQueue - The queue.
+//             sNext - Set to the tile.
+// Return Value: Returns false once the queue is closed and every tile has been
+//               taken.
+////////////////////////////////////////////////////////////////////////////////
+bool Pop_Tile( sTileQueue &sQueue, sTileRect &sNext )
+{
+    // Local Variables
+    unique_lock< mutex > lock( sQueue.mtxQueue );
+
+    while( sQueue.dqTiles.empty() && !sQueue.bClosed )
+	sQueue.cvNotEmpty.wait( lock );
+
+    if( sQueue.dqTiles.empty() )
+	return false;
+
+    sNext = sQueue.dqTiles.front();
+    sQueue.dqTiles.pop_front();
+    lock.unlock();
+    sQueue.cvNotFull.notify_one();
+
+    return true;
+}
+
+// Description: Marks the queue as finished; Pop_Tile returns false once the
+//              tiles still in it are taken.
+// Parameters: sQueue - The queue.
+////////////////////////////////////////////////////////////////////////////////
+void Close_Tile_Queue( sTileQueue &sQueue )
+{
+    {
+	lock_guard< mutex > lock( sQueue.mtxQueue );
+
+	sQueue.bClosed = true;
+    }
+
+    sQueue.cvNotEmpty.notify_all();
+}
+
+// Description: Drops the tiles waiting in the queue and wakes any worker
+//              waiting to push one; from now on Push_Tile refuses tiles.
+// Parameters: sQueue - The queue.
+////////////////////////////////////////////////////////////////////////////////
+void Abandon_Tile_Queue( sTileQueue &sQueue )
+{
+    {
+	lock_guard< mutex > lock( sQueue.mtxQueue );
+
+	sQueue.bAbandoned.store( true );
+	sQueue.dqTiles.clear();
+    }
+
+    sQueue.cvNotFull.notify_all();
+}
+
+// Description: Returns true once the queue has been abandoned.
+////////////////////////////////////////////////////////////////////////////////
+bool Is_Tile_Queue_Abandoned( const sTileQueue &sQueue )
+{
+    return sQueue.bAbandoned.load();
+}
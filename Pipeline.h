@@ -0,0 +1,109 @@
+// Name: Pipeline.h
+// Description: Header for the band queue that hands finished parts of an
+//              image from the render workers over to the background stage
+//              that encodes and writes it, so the encoding runs while the rest
+//              of the image is still being drawn.  The queue is bounded: once
+//              it is full, whoever finishes the next band waits for the stage
+//              to catch up.  The tile queue does the same for single tiles,
+//              handed to a program streaming them as they are finished, and
+//              can also be abandoned when the program stops listening.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+// INCLUDES
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+// CONSTANTS
+// The number of finished bands that can be waiting for the encode stage.
+const size_t iBAND_QUEUE_CAPACITY = 8;
+
+// BAND STRUCTURE
+// Parts: iStartRow, iEndRow - The rows of the image that are finished
+//                             ([start, end)).
+////////////////////////////////////////////////////////////////////////////////
+struct sBand
+{
+    int iStartRow;
+    int iEndRow;
+};
+
+// BAND QUEUE STRUCTURE
+// Parts: mtxQueue - Guards the rest of the queue.
+//        cvNotEmpty - Signalled when a band is pushed or the queue is closed.
+//        cvNotFull - Signalled when a band is popped.
+//        dqBands - The bands waiting to be encoded, oldest first.
+//        iCapacity - The most bands that can be waiting.
+//        bClosed - Set once every band has been pushed.
+////////////////////////////////////////////////////////////////////////////////
+struct sBandQueue
+{
+    std::mutex mtxQueue;
+    std::condition_variable cvNotEmpty;
+    std::condition_variable cvNotFull;
+    std::deque< sBand > dqBands;
+    size_t iCapacity;
+    bool bClosed;
+};
+
+// TILE RECTANGLE STRUCTURE
+// Parts: iX, iY - The top left pixel of the tile.
+//        iWidth, iHeight - The size of the tile in pixels.
+////////////////////////////////////////////////////////////////////////////////
+struct sTileRect
+{
+    int iX;
+    int iY;
+    int iWidth;
+    int iHeight;
+};
+
+// TILE QUEUE STRUCTURE
+// Parts: mtxQueue - Guards the rest of the queue (except bAbandoned).
+//        cvNotEmpty - Signalled when a tile is pushed or the queue is closed.
+//        cvNotFull - Signalled when a tile is popped or the queue is
+//                    abandoned.
+//        dqTiles - The finished tiles nobody has taken yet, oldest first.
+//        iCapacity - The most tiles that can be waiting.
+//        bClosed - Set once every tile has been pushed.
+//        bAbandoned - Set when nobody will take any more tiles, so the workers
+//                     can stop drawing them.  Read without the lock.
+////////////////////////////////////////////////////////////////////////////////
+struct sTileQueue
+{
+    std::mutex mtxQueue;
+    std::condition_variable cvNotEmpty;
+    std::condition_variable cvNotFull;
+    std::deque< sTileRect > dqTiles;
+    size_t iCapacity;
+    bool bClosed;
+    std::atomic< bool > bAbandoned;
+};
+
+// FUNCTION DECLARATIONS
+void Init_Band_Queue( sBandQueue &sQueue, const size_t iCapacity );
+
+void Push_Band( sBandQueue &sQueue, const int iStartRow, const int iEndRow );
+
+bool Pop_Band( sBandQueue &sQueue, sBand &sNext );
+
+void Close_Band_Queue( sBandQueue &sQueue );
+
+void Init_Tile_Queue( sTileQueue &sQueue, const size_t iCapacity );
+
+bool Push_Tile( sTileQueue &sQueue, const sTileRect &sTile );
+
+bool Pop_Tile( sTileQueue &sQueue, sTileRect &sNext );
+
+void Close_Tile_Queue( sTileQueue &sQueue );
+
+void Abandon_Tile_Queue( sTileQueue &sQueue );
+
+bool Is_Tile_Queue_Abandoned( const sTileQueue &sQueue );
+
+#endif
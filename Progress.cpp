@@ -0,0 +1,228 @@
+// Name: Progress.cpp
+// Description: Module implementation of the progress reporting module.  The
+//              workers only ever touch an atomic counter; all of the drawing
+//              happens on a reporter thread that wakes at a fixed rate.
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "Progress.h"
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+
+// Namespaces
+using namespace std;
+
+// CONSTANTS
+const int iPROGRESS_BAR_SIZE = 40;
+const int iPROGRESS_LINE_WIDTH = 79;
+const int iBAR_INTERVAL_MS = 100;       // 10 redraws a second.
+const int iMACHINE_INTERVAL_MS = 1000;  // One record a second.
+
+// Description: Recursive function that outputs a Progress Bar based on a
+//              desired size constant and a percentage of completion of
+//              compiling the image.
+// Method: If it's the first iteration (special case), we output the start of
+//         the progress bar: '['.  For each subsequent iteration we determine if
+//         we output a space or a bar character depending on how much of the
+//         image we have left to fill.  This is modified based on the desired
+//         size of the bar to ensure the percentage complete is accurate,
+//         regardless of the bar size.  This function will iterate iPROGRESS_BAR
+//         _SIZE times and will output the closing ']' on the last iteration.
+//         NOTE: This function is only to output the Bar, it doesn't output the
+//         progress information that precedes or follows the bar.
+// Parameters: iPercent - Integer that tells us how much of the image we have
+//                        completed.  Assumed to be already truncated to be
+//                        relative to the size of the progress bar when passed
+//                        in.
+//             iIterations - Recursive flag.  When we recursively call this
+//                           function again, we add one to this variable and
+//                           exit back through the stack once the iterations ==
+//                           the size of the progress bar.
+////////////////////////////////////////////////////////////////////////////////
+void Output_Progress_Bar( int iPercent, int iIterations = 0 )
+{
+    // Special case for start of bar
+    if( iIterations == 0 )
+	cout << '[';
+
+    // each node: determine whether we output a Bar character or a space.
+    if( iPercent > iIterations )
+	cout << (char)(219);
+    else
+	cout << ' ';
+
+    // Recursive Check
+    if( iIterations < ( iPROGRESS_BAR_SIZE - 1 ) )
+	Output_Progress_Bar( iPercent, ( iIterations + 1 ) );
+    else
+	cout << ']';
+}
+
+// Description: Formats a number of seconds as h:mm:ss (or m:ss when under an
+//              hour) for the ETA output.
+// Parameters: dSeconds - The number of seconds to format.
+// Return Value: Returns the formatted time as a string.
+////////////////////////////////////////////////////////////////////////////////
+string Format_Time( double dSeconds )
+{
+    // Local Variables
+    char cBuffer[ 32 ];
+    long lTotal = (long)( dSeconds + 0.5 );
+
+    if( lTotal >= 3600 )
+	snprintf( cBuffer, sizeof( cBuffer ), "%ld:%02ld:%02ld",
+		  lTotal / 3600, ( lTotal / 60 ) % 60, lTotal % 60 );
+    else
+	snprintf( cBuffer, sizeof( cBuffer ), "%ld:%02ld", lTotal / 60, lTotal % 60 );
+
+    return string( cBuffer );
+}
+
+// Description: Isolated function to output progress text then call the
+//              recursive "Output_Progress_Bar" function to visually show the
+//              current progress of the program.
+// Method: Output the total Progress as a percent, call on the
+//         Output_Progress_Bar function to recursively draw the visual
+//         progress of the program, then follow it with the throughput and the
+//         estimated time remaining.  We end our output with the character '\r'
+//         to reset our cursor to the beginning of the line and flush the
+//         buffer to ensure it's properly drawn.
+// Parameters: iPercentComplete - True percentage of completion.  We output this
+//                                to the user then pass it into the Progress Bar
+//                                function.
+//             dPixelsPerSecond - Current throughput of the render.
+//             dETASeconds - Estimated seconds remaining (< 0 if unknown).
+////////////////////////////////////////////////////////////////////////////////
+void Show_Progress( int iPercentComplete,
+		    double dPixelsPerSecond,
+		    double dETASeconds )
+{
+    cout << "Progress: " << setw( 3 ) << iPercentComplete << "% ";
+    Output_Progress_Bar( ( iPercentComplete * iPROGRESS_BAR_SIZE ) / 100 );
+    cout << ' ' << fixed << setprecision( 2 ) << ( dPixelsPerSecond / 1.0e6 ) << " Mpx/s";
+    cout.unsetf( ios_base::floatfield );
+
+    if( dETASeconds >= 0.0 )
+	cout << "  ETA " << Format_Time( dETASeconds ) << "   ";
+
+    cout << '\r';
+    cout.flush();
+}
+
+// Description: Outputs a single machine-readable progress record on stderr.
+// Method: Each record is a self-contained JSON object on its own line so that
+//         an orchestrator can simply read the stream line by line.
+// Parameters: cEvent - The kind of record ("progress" or "complete").
+//             llDone, llTotal - Pixels complete and pixels in the render.
+//             dElapsed - Seconds since the render started.
+//             dPixelsPerSecond - Current throughput of the render.
+//             dETASeconds - Estimated seconds remaining (< 0 if unknown).
+////////////////////////////////////////////////////////////////////////////////
+void Show_Machine_Progress( const char cEvent[],
+			    long long llDone,
+			    long long llTotal,
+			    double dElapsed,
+			    double dPixelsPerSecond,
+			    double dETASeconds )
+{
+    // Local Variables
+    char cBuffer[ 256 ];
+    double dPercent = ( llTotal > 0 ) ? ( 100.0 * (double)llDone / (double)llTotal ) : 100.0;
+
+    snprintf( cBuffer, sizeof( cBuffer ),
+	      "{\"event\":\"%s\",\"pixels_done\":%lld,\"pixels_total\":%lld,"
+	      "\"percent\":%.2f,\"elapsed_seconds\":%.3f,"
+	      "\"pixels_per_second\":%.0f,\"eta_seconds\":%.3f}\n",
+	      cEvent, llDone, llTotal, dPercent, dElapsed,
+	      dPixelsPerSecond, ( dETASeconds < 0.0 ) ? -1.0 : dETASeconds );
+
+    cerr << cBuffer;
+    cerr.flush();
+}
+
+// Description: Takes a snapshot of the counter and outputs it in the current
+//              mode.
+// Parameters: sReport - The progress being reported.
+//             bFinal - Set when the render has finished.
+////////////////////////////////////////////////////////////////////////////////
+void Report_Progress( sProgress &sReport, bool bFinal )
+{
+    // Local Variables
+    long long llDone = sReport.llPixelsDone.load( memory_order_relaxed );
+    double dElapsed = chrono::duration< double >( chrono::steady_clock::now() -
+						  sReport.tStart ).count();
+    double dRate = ( dElapsed > 0.0 ) ? ( (double)llDone / dElapsed ) : 0.0;
+    double dETA = ( dRate > 0.0 ) ? ( (double)( sReport.llPixelsTotal - llDone ) / dRate ) : -1.0;
+    int iPercent = ( sReport.llPixelsTotal > 0 ) ?
+	(int)( ( 100 * llDone ) / sReport.llPixelsTotal ) : 100;
+
+    if( sReport.eMode == ePROGRESS_BAR )
+	Show_Progress( iPercent, dRate, dETA );
+    else if( sReport.eMode == ePROGRESS_MACHINE )
+	Show_Machine_Progress( bFinal ? "complete" : "progress",
+			       llDone, sReport.llPixelsTotal, dElapsed, dRate, dETA );
+}
+
+// Description: Body of the reporter thread.
+// Method: Sleep on the condition variable for the mode's interval and redraw
+//         each time it times out.  Stop_Progress wakes us early by clearing
+//         bRunning.
+// Parameters: sReport - The progress being reported.
+////////////////////////////////////////////////////////////////////////////////
+void Run_Reporter( sProgress *sReport )
+{
+    // Local Variables
+    chrono::milliseconds msInterval( sReport->eMode == ePROGRESS_MACHINE ?
+				     iMACHINE_INTERVAL_MS : iBAR_INTERVAL_MS );
+    unique_lock< mutex > lock( sReport->mtxStop );
+
+    while( sReport->bRunning )
+    {
+	if( !sReport->cvStop.wait_for( lock, msInterval, [sReport]{ return !sReport->bRunning; } ) )
+	    Report_Progress( *sReport, false );
+    }
+}
+
+// Description: Resets the counter and, unless progress is turned off, launches
+//              the reporter thread.
+// Parameters: sReport - The progress structure to start.
+//             llPixelsTotal - The number of pixels in the render.
+//             eMode - How the progress should be reported.
+////////////////////////////////////////////////////////////////////////////////
+void Start_Progress( sProgress &sReport,
+		     const long long llPixelsTotal,
+		     const eProgressMode eMode )
+{
+    sReport.llPixelsDone.store( 0 );
+    sReport.llPixelsTotal = llPixelsTotal;
+    sReport.eMode = eMode;
+    sReport.tStart = chrono::steady_clock::now();
+    sReport.bRunning = ( eMode != ePROGRESS_NONE );
+
+    if( sReport.bRunning )
+	sReport.thReporter = thread( Run_Reporter, &sReport );
+}
+
+// Description: Stops the reporter thread.  Machine-readable progress gets a
+//              final "complete" record, while the progress bar line is cleared
+//              so the caller can output over it.
+// Parameters: sReport - The progress structure to stop.
+////////////////////////////////////////////////////////////////////////////////
+void Stop_Progress( sProgress &sReport )
+{
+    if( sReport.thReporter.joinable() )
+    {
+	{
+	    lock_guard< mutex > lock( sReport.mtxStop );
+	    sReport.bRunning = false;
+	}
+	sReport.cvStop.notify_one();
+	sReport.thReporter.join();
+
+	if( sReport.eMode == ePROGRESS_MACHINE )
+	    Report_Progress( sReport, true );
+	else
+	    cout << string( iPROGRESS_LINE_WIDTH, ' ' ) << '\r';
+    }
+}
@@ -0,0 +1,67 @@
+// Name: Progress.h
+// Description: Header for the progress reporting module.  Render workers bump
+//              a lock-free pixel counter once per finished tile and a separate
+//              reporter thread redraws the progress at a fixed rate.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+// INCLUDES
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Enum to identify how progress is reported to the user.
+//   ePROGRESS_NONE - Nothing is output.
+//   ePROGRESS_BAR - The console progress bar along with pixels/s and an ETA.
+//   ePROGRESS_MACHINE - One JSON object per line on stderr for job
+//                       orchestrators to parse.
+enum eProgressMode
+{
+    ePROGRESS_NONE = 0,
+    ePROGRESS_BAR = 1,
+    ePROGRESS_MACHINE = 2
+};
+
+// PROGRESS STRUCTURE
+// Parts: llPixelsDone - Lock-free counter of the pixels that have been
+//                       completed.  Only ever incremented by the workers.
+//        llPixelsTotal - The number of pixels in the whole render.
+//        eMode - How the reporter thread outputs the progress.
+//        bRunning - Set while the reporter thread should keep redrawing.
+//        tStart - The time the render started, used for the rate and ETA.
+//        thReporter - The reporter thread.
+//        mtxStop, cvStop - Used to wake the reporter thread when stopping.
+////////////////////////////////////////////////////////////////////////////////
+struct sProgress
+{
+    std::atomic< long long > llPixelsDone;
+    long long llPixelsTotal;
+    eProgressMode eMode;
+    bool bRunning;
+    std::chrono::steady_clock::time_point tStart;
+    std::thread thReporter;
+    std::mutex mtxStop;
+    std::condition_variable cvStop;
+};
+
+// FUNCTION DECLARATIONS
+void Start_Progress( sProgress &sReport,
+		     const long long llPixelsTotal,
+		     const eProgressMode eMode );
+
+void Stop_Progress( sProgress &sReport );
+
+// Description: Called by the workers once per completed tile.  A relaxed
+//              increment is all that's needed since the reporter only ever
+//              reads an approximate snapshot.
+////////////////////////////////////////////////////////////////////////////////
+inline void Add_Progress( sProgress &sReport, const long long llPixels )
+{
+    sReport.llPixelsDone.fetch_add( llPixels, std::memory_order_relaxed );
+}
+
+#endif
@@ -0,0 +1,543 @@
+// Name: Renderer.cpp
+// Description: Module implementation of the embeddable renderer.  The calls
+//              are thin wrappers that check the request, turn it into the
+//              render options and color filters the rest of the program uses,
+//              and run the usual tile renderer into the caller's buffer.  A
+//              tile stream runs the tile renderer on a thread of its own and
+//              hands its tiles over through a bounded tile queue.
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "Renderer.h"
+#include "Mandelbrot.h"
+#include "Pipeline.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Namespaces
+using namespace std;
+
+// POOL STRUCTURE
+// Parts: sThreads - The threads the renders run on.
+////////////////////////////////////////////////////////////////////////////////
+struct sMandelbrotPool
+{
+    sThreadPool sThreads;
+};
+
+// CANCEL STRUCTURE
+// Parts: bCancelled - Set once the renders given it should stop.
+////////////////////////////////////////////////////////////////////////////////
+struct sMandelbrotCancel
+{
+    atomic< bool > bCancelled;
+};
+
+// TILE STREAM STRUCTURE
+// Parts: sOptions - The render options of the request.
+//        sColor - The color filters of the request.
+//        iWidth, iHeight, iMaxIterations - The size and escape time limit of
+//                                          the image.
+//        vPixels - The whole image, which the tiles point into.
+//        sTarget - The raster over vPixels.
+//        sTiles - The finished tiles nobody has taken yet.
+//        thRender - The thread running the render.
+//        iStatus - The eMandelbrotStatus of the render, set by thRender before
+//                  it closes sTiles.
+//        bDrained - Set once every tile has been taken.
+////////////////////////////////////////////////////////////////////////////////
+struct sMandelbrotTileStream
+{
+    sRenderOptions sOptions;
+    sColorCode sColor;
+    int iWidth;
+    int iHeight;
+    int iMaxIterations;
+    vector< unsigned char > vPixels;
+    sRaster sTarget;
+    sTileQueue sTiles;
+    thread thRender;
+    int iStatus;
+    bool bDrained;
+};
+
+// Description: Checks that a request describes an image that can be drawn.
+// Return Value: Returns true if it does.
+////////////////////////////////////////////////////////////////////////////////
+static bool Is_Valid_Request( const sMandelbrotRequest *pRequest )
+{
+    return ( pRequest != NULL ) &&
+	( pRequest->iWidth > 0 ) && ( pRequest->iHeight > 0 ) &&
+	( pRequest->iMaxIterations > 0 ) &&
+	( pRequest->dXMin < pRequest->dXMax ) && ( pRequest->dYMin < pRequest->dYMax ) &&
+	( pRequest->iColoring >= eMANDELBROT_LINEAR ) &&
+	( pRequest->iColoring <= eMANDELBROT_DISTANCE ) &&
+	( pRequest->iPower >= 2 ) && ( pRequest->iPower <= iMAX_FORMULA_POWER ) &&
+	( pRequest->iTileSize > 0 ) && ( pRequest->iThreads >= 0 ) &&
+	( pRequest->iKernel >= eMANDELBROT_REFERENCE ) && ( pRequest->iKernel <= eMANDELBROT_VECTOR );
+}
+
+// Description: Turns a request into the render options the tile renderer uses.
+// Parameters: pRequest - The (valid) request.
+//             pPool - The pool to render on (or NULL).
+// Return Value: The render options.
+////////////////////////////////////////////////////////////////////////////////
+static sRenderOptions Get_Request_Options( const sMandelbrotRequest *pRequest,
+					   sMandelbrotPool *pPool )
+{
+    sRenderOptions sReturnValue = Initiate_Render_Options();
+
+    sReturnValue.sView.dXMin = pRequest->dXMin;
+    sReturnValue.sView.dXMax = pRequest->dXMax;
+    sReturnValue.sView.dYMin = pRequest->dYMin;
+    sReturnValue.sView.dYMax = pRequest->dYMax;
+    sReturnValue.iThreads = pRequest->iThreads;
+    sReturnValue.iTileSize = pRequest->iTileSize;
+    sReturnValue.eKernel = (eKernelType)( pRequest->iKernel );
+    sReturnValue.sFormula.eType = pRequest->bBurningShip ? eFORMULA_BURNING_SHIP : eFORMULA_MULTIBROT;
+    sReturnValue.sFormula.iPower = pRequest->iPower;
+    sReturnValue.sFormula.bJulia = ( pRequest->bJulia != 0 );
+    sReturnValue.sFormula.dJuliaReal = pRequest->dJuliaReal;
+    sReturnValue.sFormula.dJuliaImag = pRequest->dJuliaImag;
+    sReturnValue.eColoring = (eColorMode)( pRequest->iColoring );
+    sReturnValue.eProgress = ePROGRESS_NONE;
+    sReturnValue.pPool = ( pPool != NULL ) ? &pPool->sThreads : NULL;
+
+    return sReturnValue;
+}
+
+// Description: Checks that a buffer can hold a request's pixels and fills in
+//              the raster describing it.
+// Parameters: pRequest - The (valid) request.
+//             pPixels - The top row of the caller's buffer.
+//             iStride - The bytes from the start of one row to the next.
+//             iFormat - An eMandelbrotPixelFormat.
+//             sTarget - Filled in with the raster.
+// Return Value: Returns true if the buffer is usable.
+////////////////////////////////////////////////////////////////////////////////
+static bool Get_Request_Raster( const sMandelbrotRequest *pRequest,
+				unsigned char *pPixels,
+				const size_t iStride,
+				const int iFormat,
+				sRaster &sTarget )
+{
+    if( ( pPixels == NULL ) ||
+	( ( iFormat != eMANDELBROT_RGB8 ) && ( iFormat != eMANDELBROT_RGBA8 ) ) )
+	return false;
+
+    sTarget.pPixels = pPixels;
+    sTarget.iStride = iStride;
+    sTarget.iChannels = ( iFormat == eMANDELBROT_RGBA8 ) ? 4 : 3;
+
+    return ( iStride >= (size_t)( pRequest->iWidth ) * sTarget.iChannels );
+}
+
+// Description: Turns a request into the color filters.
+////////////////////////////////////////////////////////////////////////////////
+static sColorCode Get_Request_Color( const sMandelbrotRequest *pRequest )
+{
+    sColorCode sReturnValue;
+
+    for( int i = 0; i < eRGB; ++i )
+	sReturnValue.fRGBMask[ i ] = pRequest->fRGBMask[ i ];
+
+    sReturnValue.bInvertColors = ( pRequest->bInvertColors != 0 );
+    sReturnValue.bInvertSpectrum = ( pRequest->bInvertSpectrum != 0 );
+    sReturnValue.bGreyScale = ( pRequest->bGreyScale != 0 );
+
+    return sReturnValue;
+}
+
+// Description: Fills in a request with the program's defaults: the whole
+//              Mandelbrot set (fitted to the image), 100 iterations, white,
+//              linear coloring, the reference kernel and every available
+//              thread.
+// Parameters: pRequest - The request to fill in.
+//             iWidth, iHeight - The size of the image.
+////////////////////////////////////////////////////////////////////////////////
+void Mandelbrot_Init_Request( sMandelbrotRequest *pRequest, const int iWidth, const int iHeight )
+{
+    // Local Variables
+    sViewport sView = Get_Centered_Viewport( -0.5, 0.0, 3.0, iWidth, iHeight );
+
+    memset( pRequest, 0, sizeof( sMandelbrotRequest ) );
+    pRequest->dXMin = sView.dXMin;
+    pRequest->dXMax = sView.dXMax;
+    pRequest->dYMin = sView.dYMin;
+    pRequest->dYMax = sView.dYMax;
+    pRequest->iWidth = iWidth;
+    pRequest->iHeight = iHeight;
+    pRequest->iMaxIterations = 100;
+    pRequest->fRGBMask[ eRED ] = 1.0f;
+    pRequest->fRGBMask[ eGREEN ] = 1.0f;
+    pRequest->fRGBMask[ eBLUE ] = 1.0f;
+    pRequest->iColoring = eMANDELBROT_LINEAR;
+    pRequest->iPower = 2;
+    pRequest->iTileSize = 64;
+    pRequest->iThreads = 0;
+    pRequest->iKernel = eMANDELBROT_REFERENCE;
+}
+
+// Description: Starts a pool of threads for renders to share.
+// Parameters: iThreads - The number of threads (0 = one per hardware thread).
+// Return Value: The pool, or NULL if it couldn't be started.
+////////////////////////////////////////////////////////////////////////////////
+sMandelbrotPool *Mandelbrot_Create_Pool( const int iThreads )
+{
+    // Local Variables
+    sMandelbrotPool *pReturnValue = NULL;
+
+    if( iThreads < 0 )
+	return NULL;
+
+    try
+    {
+	pReturnValue = new sMandelbrotPool;
+	Start_Thread_Pool( pReturnValue->sThreads, iThreads );
+    }
+    catch( ... )
+    {
+	if( pReturnValue != NULL )
+	{
+	    Stop_Thread_Pool( pReturnValue->sThreads );
+	    delete pReturnValue;
+	}
+
+	return NULL;
+    }
+
+    return pReturnValue;
+}
+
+// Description: Stops a pool's threads and frees it.  No render may be using it.
+// Parameters: pPool - The pool (NULL is ignored).
+////////////////////////////////////////////////////////////////////////////////
+void Mandelbrot_Destroy_Pool( sMandelbrotPool *pPool )
+{
+    if( pPool == NULL )
+	return;
+
+    Stop_Thread_Pool( pPool->sThreads );
+    delete pPool;
+}
+
+// Description: Draws the colored image into the caller's buffer.
+// Parameters: pRequest - What to draw.
+//             pPool - The pool to draw on (NULL starts threads for the call).
+//             pPixels - The top row of the caller's buffer.
+//             iStride - The bytes from the start of one row to the next (at
+//                       least iWidth times the bytes per pixel).
+//             iFormat - An eMandelbrotPixelFormat.
+// Return Value: An eMandelbrotStatus.
+////////////////////////////////////////////////////////////////////////////////
+int Mandelbrot_Render_Pixels( const sMandelbrotRequest *pRequest,
+			      sMandelbrotPool *pPool,
+			      unsigned char *pPixels,
+			      const size_t iStride,
+			      const int iFormat )
+{
+    // Local Variables
+    sRaster sTarget;
+
+    if( !Is_Valid_Request( pRequest ) ||
+	!Get_Request_Raster( pRequest, pPixels, iStride, iFormat, sTarget ) )
+	return eMANDELBROT_INVALID;
+
+    try
+    {
+	Render_Raster( pRequest->iWidth, pRequest->iHeight, pRequest->iMaxIterations,
+		       Get_Request_Color( pRequest ), Get_Request_Options( pRequest, pPool ), sTarget, NULL );
+    }
+    catch( const bad_alloc & )
+    {
+	return eMANDELBROT_NO_MEMORY;
+    }
+    catch( ... )
+    {
+	return eMANDELBROT_FAILED;
+    }
+
+    return eMANDELBROT_OK;
+}
+
+// Description: Stores each pixel's number of iterations (iMaxIterations for
+//              the points in the set) in the caller's buffer.
+// Parameters: pRequest - What to draw (the color parts are ignored).
+//             pPool - The pool to draw on (NULL starts threads for the call).
+//             pIterations - The top row of the caller's buffer.
+//             iStride - The bytes from the start of one row to the next (at
+//                       least iWidth ints, and a multiple of an int).
+// Return Value: An eMandelbrotStatus.
+////////////////////////////////////////////////////////////////////////////////
+int Mandelbrot_Render_Iterations( const sMandelbrotRequest *pRequest,
+				  sMandelbrotPool *pPool,
+				  int *pIterations,
+				  const size_t iStride )
+{
+    // Local Variables
+    vector< int > vIterations;
+
+    if( !Is_Valid_Request( pRequest ) || ( pIterations == NULL ) ||
+	( iStride < (size_t)( pRequest->iWidth ) * sizeof( int ) ) || ( iStride % sizeof( int ) != 0 ) )
+	return eMANDELBROT_INVALID;
+
+    try
+    {
+	Render_Iterations( pRequest->iWidth, pRequest->iHeight, pRequest->iMaxIterations,
+			   Get_Request_Options( pRequest, pPool ), vIterations );
+    }
+    catch( const bad_alloc & )
+    {
+	return eMANDELBROT_NO_MEMORY;
+    }
+    catch( ... )
+    {
+	return eMANDELBROT_FAILED;
+    }
+
+    for( int y = 0; y < pRequest->iHeight; ++y )
+	memcpy( (char *)( pIterations ) + (size_t)( y ) * iStride,
+		&vIterations[ (size_t)( y ) * pRequest->iWidth ], pRequest->iWidth * sizeof( int ) );
+
+    return eMANDELBROT_OK;
+}
+
+// Description: Creates a cancellation token (not cancelled yet).
+// Return Value: The token, or NULL if it couldn't be allocated.
+////////////////////////////////////////////////////////////////////////////////
+sMandelbrotCancel *Mandelbrot_Create_Cancel( void )
+{
+    // Local Variables
+    sMandelbrotCancel *pReturnValue = new( nothrow ) sMandelbrotCancel;
+
+    if( pReturnValue != NULL )
+	pReturnValue->bCancelled.store( false );
+
+    return pReturnValue;
+}
+
+// Description: Cancels every progressive render given the token.  May be
+//              called from any thread, while the renders are running.
+// Parameters: pCancel - The token (NULL is ignored).
+////////////////////////////////////////////////////////////////////////////////
+void Mandelbrot_Cancel( sMandelbrotCancel *pCancel )
+{
+    if( pCancel != NULL )
+	pCancel->bCancelled.store( true );
+}
+
+// Description: Frees a cancellation token.  No render may be using it.
+// Parameters: pCancel - The token (NULL is ignored).
+////////////////////////////////////////////////////////////////////////////////
+void Mandelbrot_Destroy_Cancel( sMandelbrotCancel *pCancel )
+{
+    delete pCancel;
+}
+
+// Description: Draws the colored image into the caller's buffer coarse to
+//              fine (see Render_Progressive), stopping early when the time
+//              runs out or the token is cancelled.
+// Parameters: pRequest - What to draw.
+//             pPool - The pool to draw on (NULL starts threads for the call).
+//             pPixels, iStride, iFormat - The caller's buffer, as for
+//                                         Mandelbrot_Render_Pixels.
+//             dSeconds - The time allowed, from the call (0 = no limit).
+//             pCancel - The cancellation token (or NULL).
+//             pCompleteness - Filled with a byte per pixel, iWidth per row: 1
+//                             where the pixel was drawn, the size of the block
+//                             it was estimated from, or 0 where the render
+//                             never got to it (or NULL).
+// Return Value: eMANDELBROT_OK when every pixel was drawn, eMANDELBROT_PARTIAL
+//               when the render stopped early, or another eMandelbrotStatus.
+////////////////////////////////////////////////////////////////////////////////
+int Mandelbrot_Render_Progressive( const sMandelbrotRequest *pRequest,
+				   sMandelbrotPool *pPool,
+				   unsigned char *pPixels,
+				   const size_t iStride,
+				   const int iFormat,
+				   const double dSeconds,
+				   sMandelbrotCancel *pCancel,
+				   unsigned char *pCompleteness )
+{
+    // Local Variables
+    sRaster sTarget;
+    sRenderLimit sLimit;
+    bool bComplete = false;
+
+    if( !Is_Valid_Request( pRequest ) || ( dSeconds < 0.0 ) ||
+	!Get_Request_Raster( pRequest, pPixels, iStride, iFormat, sTarget ) )
+	return eMANDELBROT_INVALID;
+
+    sLimit.bDeadline = ( dSeconds > 0.0 );
+    sLimit.tDeadline = chrono::steady_clock::now() +
+	chrono::duration_cast< chrono::steady_clock::duration >( chrono::duration< double >( dSeconds ) );
+    sLimit.pCancel = ( pCancel != NULL ) ? &pCancel->bCancelled : NULL;
+
+    try
+    {
+	bComplete = Render_Progressive( pRequest->iWidth, pRequest->iHeight, pRequest->iMaxIterations,
+					Get_Request_Color( pRequest ),
+					Get_Request_Options( pRequest, pPool ), sTarget, sLimit,
+					pCompleteness );
+    }
+    catch( const bad_alloc & )
+    {
+	return eMANDELBROT_NO_MEMORY;
+    }
+    catch( ... )
+    {
+	return eMANDELBROT_FAILED;
+    }
+
+    return bComplete ? eMANDELBROT_OK : eMANDELBROT_PARTIAL;
+}
+
+// Description: Body of a tile stream's render thread.  Draws the image,
+//              pushing each tile onto the stream's queue as it is finished,
+//              then closes the queue.
+// Parameters: pStream - The stream.
+////////////////////////////////////////////////////////////////////////////////
+static void Stream_Tiles( sMandelbrotTileStream *pStream )
+{
+    try
+    {
+	Render_Raster( pStream->iWidth, pStream->iHeight, pStream->iMaxIterations, pStream->sColor,
+		       pStream->sOptions, pStream->sTarget, &pStream->sTiles );
+    }
+    catch( const bad_alloc & )
+    {
+	pStream->iStatus = eMANDELBROT_NO_MEMORY;
+    }
+    catch( ... )
+    {
+	pStream->iStatus = eMANDELBROT_FAILED;
+    }
+
+    Close_Tile_Queue( pStream->sTiles );
+}
+
+// Description: Starts drawing an image whose tiles are taken, as they are
+//              finished, with Mandelbrot_Next_Tile.
+// Method: The image is drawn into the stream's own buffer by the usual tile
+//         renderer, on a thread of its own.  Each tile is pushed onto a queue
+//         of at most iCapacity tiles as soon as it is colored; once the queue
+//         is full, the workers that finish more tiles wait until the caller
+//         takes some, so a slow caller holds the render back instead of
+//         letting it run ahead.  Tiles come out in the order they finish,
+//         except when the colors depend on the whole image (histogram
+//         coloring) or the bottom half is mirrored, when they all come out in
+//         row major order once the image is done.  While the stream is open,
+//         the pool (if any) is busy with it: another call on the same pool
+//         from the thread taking the tiles would never start.
+// Parameters: pRequest - What to draw.
+//             pPool - The pool to draw on (NULL starts threads for the call).
+//             iFormat - An eMandelbrotPixelFormat for the tiles.
+//             iCapacity - The most finished tiles that can be waiting to be
+//                         taken (at least 1).
+// Return Value: The stream, or NULL if the request is invalid or the render
+//               couldn't be started.
+////////////////////////////////////////////////////////////////////////////////
+sMandelbrotTileStream *Mandelbrot_Open_Tile_Stream( const sMandelbrotRequest *pRequest,
+						    sMandelbrotPool *pPool,
+						    const int iFormat,
+						    const int iCapacity )
+{
+    // Local Variables
+    sMandelbrotTileStream *pReturnValue = NULL;
+    const int iChannels = ( iFormat == eMANDELBROT_RGBA8 ) ? 4 : 3;
+
+    if( !Is_Valid_Request( pRequest ) || ( iCapacity < 1 ) ||
+	( ( iFormat != eMANDELBROT_RGB8 ) && ( iFormat != eMANDELBROT_RGBA8 ) ) )
+	return NULL;
+
+    try
+    {
+	pReturnValue = new sMandelbrotTileStream;
+	pReturnValue->sOptions = Get_Request_Options( pRequest, pPool );
+	pReturnValue->sColor = Get_Request_Color( pRequest );
+	pReturnValue->iWidth = pRequest->iWidth;
+	pReturnValue->iHeight = pRequest->iHeight;
+	pReturnValue->iMaxIterations = pRequest->iMaxIterations;
+	pReturnValue->vPixels.resize( (size_t)( pRequest->iWidth ) * pRequest->iHeight * iChannels );
+	pReturnValue->sTarget.pPixels = &pReturnValue->vPixels[ 0 ];
+	pReturnValue->sTarget.iStride = (size_t)( pRequest->iWidth ) * iChannels;
+	pReturnValue->sTarget.iChannels = iChannels;
+	pReturnValue->iStatus = eMANDELBROT_OK;
+	pReturnValue->bDrained = false;
+	Init_Tile_Queue( pReturnValue->sTiles, (size_t)( iCapacity ) );
+	pReturnValue->thRender = thread( Stream_Tiles, pReturnValue );
+    }
+    catch( ... )
+    {
+	delete pReturnValue;
+	return NULL;
+    }
+
+    return pReturnValue;
+}
+
+// Description: Takes the next finished tile of a stream, waiting for one if
+//              none is finished yet.
+// Parameters: pStream - The stream.
+//             pTile - Filled in with the tile.
+// Return Value: Returns 1 when a tile was taken, or 0 once every tile has been
+//               taken (or the render failed; see Mandelbrot_Close_Tile_Stream).
+////////////////////////////////////////////////////////////////////////////////
+int Mandelbrot_Next_Tile( sMandelbrotTileStream *pStream, sMandelbrotTile *pTile )
+{
+    // Local Variables
+    sTileRect sNext;
+
+    if( ( pStream == NULL ) || ( pTile == NULL ) || pStream->bDrained )
+	return 0;
+
+    if( !Pop_Tile( pStream->sTiles, sNext ) )
+    {
+	pStream->bDrained = true;
+	return 0;
+    }
+
+    pTile->iX = sNext.iX;
+    pTile->iY = sNext.iY;
+    pTile->iWidth = sNext.iWidth;
+    pTile->iHeight = sNext.iHeight;
+    pTile->iStride = pStream->sTarget.iStride;
+    pTile->pPixels = pStream->sTarget.pPixels + (size_t)( sNext.iY ) * pStream->sTarget.iStride +
+	(size_t)( sNext.iX ) * pStream->sTarget.iChannels;
+
+    return 1;
+}
+
+// Description: Stops a stream and frees it, along with its tiles' pixels.  If
+//              tiles are still to come, the render is stopped: the workers
+//              finish the tiles they are drawing and take no more.
+// Parameters: pStream - The stream (NULL is ignored).
+// Return Value: eMANDELBROT_OK when every tile was taken, eMANDELBROT_PARTIAL
+//               when the stream was closed before that, or the
+//               eMandelbrotStatus of a render that failed.
+////////////////////////////////////////////////////////////////////////////////
+int Mandelbrot_Close_Tile_Stream( sMandelbrotTileStream *pStream )
+{
+    // Local Variables
+    int iReturnValue = eMANDELBROT_OK;
+
+    if( pStream == NULL )
+	return eMANDELBROT_INVALID;
+
+    Abandon_Tile_Queue( pStream->sTiles );
+    pStream->thRender.join();
+
+    iReturnValue = pStream->iStatus;
+
+    if( ( iReturnValue == eMANDELBROT_OK ) && !pStream->bDrained )
+	iReturnValue = eMANDELBROT_PARTIAL;
+
+    delete pStream;
+
+    return iReturnValue;
+}
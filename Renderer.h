@@ -0,0 +1,191 @@
+// Name: Renderer.h
+// Description: Header for the embeddable renderer, the interface for programs
+//              that draw fractals into their own memory (a game texture, a
+//              GUI widget, a tile server) instead of running Assignment3.  It
+//              is plain C so it can be called from C and other languages, does
+//              no file or console I/O, and keeps no global state: every call
+//              is described fully by its request, so calls on different
+//              threads don't interfere.  A pool of threads can be created once
+//              and handed to every call, so a program drawing many images
+//              doesn't start its threads for each one.  For interactive use
+//              there is also a progressive render that draws the image coarse
+//              to fine and can be given a deadline and a cancellation token,
+//              and for streaming consumers (a network sender, an encoder, a
+//              preview window) a tile stream that hands over each tile as soon
+//              as it is finished, so they can start on the first tiles while
+//              the rest are still being drawn.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+// INCLUDES
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The pool of threads renders run on.  Only used through a pointer.
+typedef struct sMandelbrotPool sMandelbrotPool;
+
+// A flag that cancels the progressive renders given it, from any thread.
+typedef struct sMandelbrotCancel sMandelbrotCancel;
+
+// A render whose finished tiles are taken one at a time.  Only used through a
+// pointer.
+typedef struct sMandelbrotTileStream sMandelbrotTileStream;
+
+// Enum of the pixel layouts the caller's buffer can have.
+// eMANDELBROT_RGB8 - 3 bytes per pixel: red, green, blue.
+// eMANDELBROT_RGBA8 - 4 bytes per pixel: red, green, blue and alpha (always
+//                     255).
+enum eMandelbrotPixelFormat
+{
+    eMANDELBROT_RGB8 = 0,
+    eMANDELBROT_RGBA8 = 1
+};
+
+// Enum of the ways the escape times are colored (see eColorMode).
+enum eMandelbrotColoring
+{
+    eMANDELBROT_LINEAR = 0,
+    eMANDELBROT_SMOOTH = 1,
+    eMANDELBROT_HISTOGRAM = 2,
+    eMANDELBROT_DISTANCE = 3
+};
+
+// Enum of the escape time kernels a request can be drawn with (see
+// eKernelType).  The reference kernel is the default, so a request draws the
+// same image Assignment3 does; the double precision kernels are faster but
+// round differently, so a few pixels near the boundary come out different.
+enum eMandelbrotKernel
+{
+    eMANDELBROT_REFERENCE = 0,
+    eMANDELBROT_SCALAR = 1,
+    eMANDELBROT_VECTOR = 2
+};
+
+// Enum of the results of a call.
+// eMANDELBROT_OK - The buffer has been drawn.
+// eMANDELBROT_INVALID - A part of the request or buffer doesn't make sense;
+//                       nothing was drawn.
+// eMANDELBROT_NO_MEMORY - The render's own buffers couldn't be allocated.
+// eMANDELBROT_FAILED - Anything else went wrong (threads couldn't start...).
+// eMANDELBROT_PARTIAL - A progressive render ran out of time or was cancelled;
+//                       the buffer holds the best image drawn so far.  Or a
+//                       tile stream was closed before every tile was taken.
+enum eMandelbrotStatus
+{
+    eMANDELBROT_OK = 0,
+    eMANDELBROT_INVALID = 1,
+    eMANDELBROT_NO_MEMORY = 2,
+    eMANDELBROT_FAILED = 3,
+    eMANDELBROT_PARTIAL = 4
+};
+
+// REQUEST STRUCTURE
+// Parts: dXMin, dXMax - The real bounds of the complex plane drawn.
+//        dYMin, dYMax - The imaginary bounds of the complex plane drawn.
+//        iWidth, iHeight - The size of the image in pixels.
+//        iMaxIterations - The escape time limit of each pixel.
+//        fRGBMask[] - The red, green and blue filters (0 to 1).
+//        bInvertColors, bInvertSpectrum, bGreyScale - The color flags.
+//        iColoring - An eMandelbrotColoring.
+//        iPower - The power of z (2 to 8; 2 is the Mandelbrot set).
+//        bBurningShip - Iterate the Burning Ship instead of a Multibrot.
+//        bJulia, dJuliaReal, dJuliaImag - Draw the Julia set of this c.
+//        iTileSize - The size of the tiles the threads share out.
+//        iThreads - The threads to draw with (0 = all of the pool's, or one
+//                   per hardware thread without a pool).
+//        iKernel - An eMandelbrotKernel.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct sMandelbrotRequest
+{
+    double dXMin;
+    double dXMax;
+    double dYMin;
+    double dYMax;
+    int iWidth;
+    int iHeight;
+    int iMaxIterations;
+    float fRGBMask[ 3 ];
+    int bInvertColors;
+    int bInvertSpectrum;
+    int bGreyScale;
+    int iColoring;
+    int iPower;
+    int bBurningShip;
+    int bJulia;
+    double dJuliaReal;
+    double dJuliaImag;
+    int iTileSize;
+    int iThreads;
+    int iKernel;
+} sMandelbrotRequest;
+
+// TILE STRUCTURE
+// Parts: iX, iY - The top left pixel of the tile in the image.
+//        iWidth, iHeight - The size of the tile in pixels.
+//        pPixels - The tile's top left pixel, in the stream's pixel format.
+//                  The pixels stay valid (and unchanged) until the stream is
+//                  closed.
+//        iStride - The bytes from the start of one row of the tile to the next.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct sMandelbrotTile
+{
+    int iX;
+    int iY;
+    int iWidth;
+    int iHeight;
+    const unsigned char *pPixels;
+    size_t iStride;
+} sMandelbrotTile;
+
+// FUNCTION DECLARATIONS
+void Mandelbrot_Init_Request( sMandelbrotRequest *pRequest, const int iWidth, const int iHeight );
+
+sMandelbrotPool *Mandelbrot_Create_Pool( const int iThreads );
+
+void Mandelbrot_Destroy_Pool( sMandelbrotPool *pPool );
+
+int Mandelbrot_Render_Pixels( const sMandelbrotRequest *pRequest,
+			      sMandelbrotPool *pPool,
+			      unsigned char *pPixels,
+			      const size_t iStride,
+			      const int iFormat );
+
+int Mandelbrot_Render_Iterations( const sMandelbrotRequest *pRequest,
+				  sMandelbrotPool *pPool,
+				  int *pIterations,
+				  const size_t iStride );
+
+sMandelbrotCancel *Mandelbrot_Create_Cancel( void );
+
+void Mandelbrot_Cancel( sMandelbrotCancel *pCancel );
+
+void Mandelbrot_Destroy_Cancel( sMandelbrotCancel *pCancel );
+
+int Mandelbrot_Render_Progressive( const sMandelbrotRequest *pRequest,
+				   sMandelbrotPool *pPool,
+				   unsigned char *pPixels,
+				   const size_t iStride,
+				   const int iFormat,
+				   const double dSeconds,
+				   sMandelbrotCancel *pCancel,
+				   unsigned char *pCompleteness );
+
+sMandelbrotTileStream *Mandelbrot_Open_Tile_Stream( const sMandelbrotRequest *pRequest,
+						    sMandelbrotPool *pPool,
+						    const int iFormat,
+						    const int iCapacity );
+
+int Mandelbrot_Next_Tile( sMandelbrotTileStream *pStream, sMandelbrotTile *pTile );
+
+int Mandelbrot_Close_Tile_Stream( sMandelbrotTileStream *pStream );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
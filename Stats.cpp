@@ -0,0 +1,249 @@
+// Name: Stats.cpp
+// Description: Module implementation of the render statistics module.
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "Stats.h"
+#include <cstdio>
+#include <string>
+
+// Namespaces
+using namespace std;
+
+// CONSTANTS
+// Upper bounds of the tile time histogram in the Prometheus output (seconds).
+const double dTILE_SECONDS_BOUNDS[] = { 0.0001, 0.001, 0.01, 0.1, 1.0, 10.0 };
+const int iTILE_SECONDS_BUCKETS = sizeof( dTILE_SECONDS_BOUNDS ) / sizeof( double );
+
+// Description: Resets the statistics for a new render and sets up the
+//              histogram buckets and one sWorkerStats per worker.
+// Parameters: sStats - The statistics to initialize.
+//             iWidth, iHeight - The size of the image.
+//             iMax_Iterations - The iteration cap of the render.
+//             iThreads - The number of workers in the render.
+//             iTileSize - The size of the tiles handed to the workers.
+////////////////////////////////////////////////////////////////////////////////
+void Init_Render_Stats( sRenderStats &sStats,
+			const int iWidth,
+			const int iHeight,
+			const int iMax_Iterations,
+			const int iThreads,
+			const int iTileSize )
+{
+    // Local Variables
+    const int iBuckets = Get_Histogram_Bucket( iMax_Iterations ) + 1;
+
+    sStats.iWidth = iWidth;
+    sStats.iHeight = iHeight;
+    sStats.iMax_Iterations = iMax_Iterations;
+    sStats.iThreads = iThreads;
+    sStats.iTileSize = iTileSize;
+    sStats.llIterations = 0;
+    sStats.llEscaped = 0;
+    sStats.llCapped = 0;
+    sStats.dKernelSeconds = 0.0;
+    sStats.dColorSeconds = 0.0;
+    sStats.dEncodeSeconds = 0.0;
+    sStats.dWallSeconds = 0.0;
+
+    sStats.vBucketBounds.assign( iBuckets, 0 );
+    for( int i = 0; i < iBuckets; ++i )
+	sStats.vBucketBounds[ i ] = ( i < 31 && ( 1 << i ) < iMax_Iterations ) ? ( 1 << i ) : iMax_Iterations;
+
+    sStats.vHistogram.assign( iBuckets, 0 );
+    sStats.vWorkers.assign( iThreads, sWorkerStats() );
+
+    for( int i = 0; i < iThreads; ++i )
+    {
+	sStats.vWorkers[ i ].vHistogram.assign( iBuckets, 0 );
+	sStats.vWorkers[ i ].dBusySeconds = 0.0;
+    }
+}
+
+// Description: Folds every worker's statistics into the render totals.
+// Method: Called once the workers have been joined, so nothing needs to be
+//         locked.  The histograms are summed bucket by bucket and each tile's
+//         counts and times are added to the totals.
+// Parameters: sStats - The statistics of the render.
+////////////////////////////////////////////////////////////////////////////////
+void Merge_Worker_Stats( sRenderStats &sStats )
+{
+    for( size_t w = 0; w < sStats.vWorkers.size(); ++w )
+    {
+	const sWorkerStats &sWorker = sStats.vWorkers[ w ];
+
+	for( size_t i = 0; i < sStats.vHistogram.size(); ++i )
+	    sStats.vHistogram[ i ] += sWorker.vHistogram[ i ];
+
+	for( size_t t = 0; t < sWorker.vTiles.size(); ++t )
+	{
+	    sStats.llIterations += sWorker.vTiles[ t ].llIterations;
+	    sStats.llEscaped += sWorker.vTiles[ t ].llEscaped;
+	    sStats.llCapped += sWorker.vTiles[ t ].llCapped;
+	    sStats.dKernelSeconds += sWorker.vTiles[ t ].dKernelSeconds;
+	    sStats.dColorSeconds += sWorker.vTiles[ t ].dColorSeconds;
+	}
+    }
+}
+
+// Description: Returns the number of seconds between two points in time, the
+//              unit every timing field of the statistics is kept in.
+////////////////////////////////////////////////////////////////////////////////
+double Get_Seconds( const chrono::steady_clock::time_point &tStart,
+		    const chrono::steady_clock::time_point &tEnd )
+{
+    return chrono::duration< double >( tEnd - tStart ).count();
+}
+
+// Description: Formats a double for the JSON and Prometheus output.
+////////////////////////////////////////////////////////////////////////////////
+string Format_Number( double dValue )
+{
+    // Local Variables
+    char cBuffer[ 32 ];
+
+    snprintf( cBuffer, sizeof( cBuffer ), "%.9g", dValue );
+    return string( cBuffer );
+}
+
+// Description: Writes the statistics out as a single JSON object.
+// Method: The render totals come first, then the iteration histogram, each
+//         worker's busy time and finally an entry for every tile.
+// Parameters: osOut - The stream to write to.
+//             sStats - The (merged) statistics of the render.
+////////////////////////////////////////////////////////////////////////////////
+void Write_Stats_JSON( ostream &osOut, const sRenderStats &sStats )
+{
+    osOut << "{\n";
+    osOut << "  \"width\": " << sStats.iWidth << ",\n";
+    osOut << "  \"height\": " << sStats.iHeight << ",\n";
+    osOut << "  \"max_iterations\": " << sStats.iMax_Iterations << ",\n";
+    osOut << "  \"threads\": " << sStats.iThreads << ",\n";
+    osOut << "  \"tile_size\": " << sStats.iTileSize << ",\n";
+    osOut << "  \"iterations\": " << sStats.llIterations << ",\n";
+    osOut << "  \"pixels_escaped\": " << sStats.llEscaped << ",\n";
+    osOut << "  \"pixels_capped\": " << sStats.llCapped << ",\n";
+    osOut << "  \"seconds\": { \"wall\": " << Format_Number( sStats.dWallSeconds )
+	  << ", \"kernel\": " << Format_Number( sStats.dKernelSeconds )
+	  << ", \"coloring\": " << Format_Number( sStats.dColorSeconds )
+	  << ", \"encode\": " << Format_Number( sStats.dEncodeSeconds ) << " },\n";
+
+    osOut << "  \"iteration_histogram\": [";
+    for( size_t i = 0; i < sStats.vHistogram.size(); ++i )
+	osOut << ( i ? ", " : " " ) << "{ \"le\": " << sStats.vBucketBounds[ i ]
+	      << ", \"pixels\": " << sStats.vHistogram[ i ] << " }";
+    osOut << " ],\n";
+
+    osOut << "  \"workers\": [";
+    for( size_t w = 0; w < sStats.vWorkers.size(); ++w )
+	osOut << ( w ? ", " : " " ) << "{ \"thread\": " << w
+	      << ", \"tiles\": " << sStats.vWorkers[ w ].vTiles.size()
+	      << ", \"busy_seconds\": " << Format_Number( sStats.vWorkers[ w ].dBusySeconds ) << " }";
+    osOut << " ],\n";
+
+    osOut << "  \"tiles\": [";
+    for( size_t w = 0; w < sStats.vWorkers.size(); ++w )
+    {
+	for( size_t t = 0; t < sStats.vWorkers[ w ].vTiles.size(); ++t )
+	{
+	    const sTileStats &sTile = sStats.vWorkers[ w ].vTiles[ t ];
+
+	    osOut << ( ( w || t ) ? ",\n    " : "\n    " )
+		  << "{ \"x\": " << sTile.iX << ", \"y\": " << sTile.iY
+		  << ", \"width\": " << sTile.iWidth << ", \"height\": " << sTile.iHeight
+		  << ", \"thread\": " << sTile.iThread
+		  << ", \"iterations\": " << sTile.llIterations
+		  << ", \"escaped\": " << sTile.llEscaped
+		  << ", \"capped\": " << sTile.llCapped
+		  << ", \"kernel_seconds\": " << Format_Number( sTile.dKernelSeconds )
+		  << ", \"coloring_seconds\": " << Format_Number( sTile.dColorSeconds ) << " }";
+	}
+    }
+    osOut << "\n  ]\n";
+    osOut << "}\n";
+}
+
+// Description: Writes the statistics out in the Prometheus text exposition
+//              format.
+// Method: Per-tile numbers would give every render its own label set, so the
+//         tiles are summarized as a histogram of tile times instead.  The
+//         iteration histogram is cumulative, as Prometheus expects.
+// Parameters: osOut - The stream to write to.
+//             sStats - The (merged) statistics of the render.
+////////////////////////////////////////////////////////////////////////////////
+void Write_Stats_Prometheus( ostream &osOut, const sRenderStats &sStats )
+{
+    // Local Variables
+    long long llCumulative = 0;
+    long long llTileCounts[ iTILE_SECONDS_BUCKETS ] = { };
+    long long llTiles = 0;
+    double dTileSeconds = 0.0;
+
+    osOut << "# HELP mandelbrot_render_info Settings of the render.\n";
+    osOut << "# TYPE mandelbrot_render_info gauge\n";
+    osOut << "mandelbrot_render_info{width=\"" << sStats.iWidth
+	  << "\",height=\"" << sStats.iHeight
+	  << "\",max_iterations=\"" << sStats.iMax_Iterations
+	  << "\",threads=\"" << sStats.iThreads
+	  << "\",tile_size=\"" << sStats.iTileSize << "\"} 1\n";
+
+    osOut << "# HELP mandelbrot_render_iterations_total Escape time iterations done.\n";
+    osOut << "# TYPE mandelbrot_render_iterations_total counter\n";
+    osOut << "mandelbrot_render_iterations_total " << sStats.llIterations << "\n";
+
+    osOut << "# HELP mandelbrot_render_pixels_total Pixels that escaped or hit the iteration cap.\n";
+    osOut << "# TYPE mandelbrot_render_pixels_total counter\n";
+    osOut << "mandelbrot_render_pixels_total{state=\"escaped\"} " << sStats.llEscaped << "\n";
+    osOut << "mandelbrot_render_pixels_total{state=\"capped\"} " << sStats.llCapped << "\n";
+
+    osOut << "# HELP mandelbrot_render_pixel_iterations Iterations each pixel took.\n";
+    osOut << "# TYPE mandelbrot_render_pixel_iterations histogram\n";
+    for( size_t i = 0; i < sStats.vHistogram.size(); ++i )
+    {
+	llCumulative += sStats.vHistogram[ i ];
+	osOut << "mandelbrot_render_pixel_iterations_bucket{le=\"" << sStats.vBucketBounds[ i ]
+	      << "\"} " << llCumulative << "\n";
+    }
+    osOut << "mandelbrot_render_pixel_iterations_bucket{le=\"+Inf\"} " << llCumulative << "\n";
+    osOut << "mandelbrot_render_pixel_iterations_sum " << sStats.llIterations << "\n";
+    osOut << "mandelbrot_render_pixel_iterations_count " << llCumulative << "\n";
+
+    osOut << "# HELP mandelbrot_render_phase_seconds Time spent in each phase (kernel and coloring are summed over workers).\n";
+    osOut << "# TYPE mandelbrot_render_phase_seconds gauge\n";
+    osOut << "mandelbrot_render_phase_seconds{phase=\"wall\"} " << Format_Number( sStats.dWallSeconds ) << "\n";
+    osOut << "mandelbrot_render_phase_seconds{phase=\"kernel\"} " << Format_Number( sStats.dKernelSeconds ) << "\n";
+    osOut << "mandelbrot_render_phase_seconds{phase=\"coloring\"} " << Format_Number( sStats.dColorSeconds ) << "\n";
+    osOut << "mandelbrot_render_phase_seconds{phase=\"encode\"} " << Format_Number( sStats.dEncodeSeconds ) << "\n";
+
+    osOut << "# HELP mandelbrot_render_thread_busy_seconds Time each worker spent rendering tiles.\n";
+    osOut << "# TYPE mandelbrot_render_thread_busy_seconds gauge\n";
+    for( size_t w = 0; w < sStats.vWorkers.size(); ++w )
+	osOut << "mandelbrot_render_thread_busy_seconds{thread=\"" << w << "\"} "
+	      << Format_Number( sStats.vWorkers[ w ].dBusySeconds ) << "\n";
+
+    // Summarize the tiles.
+    for( size_t w = 0; w < sStats.vWorkers.size(); ++w )
+    {
+	for( size_t t = 0; t < sStats.vWorkers[ w ].vTiles.size(); ++t )
+	{
+	    const sTileStats &sTile = sStats.vWorkers[ w ].vTiles[ t ];
+	    double dSeconds = sTile.dKernelSeconds + sTile.dColorSeconds;
+
+	    for( int i = 0; i < iTILE_SECONDS_BUCKETS; ++i )
+		if( dSeconds <= dTILE_SECONDS_BOUNDS[ i ] )
+		    ++llTileCounts[ i ];
+
+	    dTileSeconds += dSeconds;
+	    ++llTiles;
+	}
+    }
+
+    osOut << "# HELP mandelbrot_render_tile_seconds Time taken by each tile.\n";
+    osOut << "# TYPE mandelbrot_render_tile_seconds histogram\n";
+    for( int i = 0; i < iTILE_SECONDS_BUCKETS; ++i )
+	osOut << "mandelbrot_render_tile_seconds_bucket{le=\"" << Format_Number( dTILE_SECONDS_BOUNDS[ i ] )
+	      << "\"} " << llTileCounts[ i ] << "\n";
+    osOut << "mandelbrot_render_tile_seconds_bucket{le=\"+Inf\"} " << llTiles << "\n";
+    osOut << "mandelbrot_render_tile_seconds_sum " << Format_Number( dTileSeconds ) << "\n";
+    osOut << "mandelbrot_render_tile_seconds_count " << llTiles << "\n";
+}
@@ -0,0 +1,124 @@
+// Name: Stats.h
+// Description: Header for the render statistics module.  The workers collect
+//              per-tile numbers into their own sWorkerStats (so nothing is
+//              shared while rendering) and they're merged into a single
+//              sRenderStats once the render is done, which can then be written
+//              out as a JSON report or as Prometheus exposition text.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef STATS_H
+#define STATS_H
+
+// INCLUDES
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+// Enum to identify how the statistics of a render are reported.
+enum eStatsFormat
+{
+    eSTATS_NONE = 0,
+    eSTATS_JSON = 1,
+    eSTATS_PROMETHEUS = 2
+};
+
+// TILE STATISTICS STRUCTURE
+// Parts: iX, iY, iWidth, iHeight - The area of the image the tile covers.
+//        iThread - The worker that rendered the tile.
+//        llIterations - Total iterations done over the tile.
+//        llEscaped, llCapped - Pixels that escaped vs. hit the iteration cap.
+//        dKernelSeconds - Time spent in the escape time kernel.
+//        dColorSeconds - Time spent coloring the tile.
+////////////////////////////////////////////////////////////////////////////////
+struct sTileStats
+{
+    int iX;
+    int iY;
+    int iWidth;
+    int iHeight;
+    int iThread;
+    long long llIterations;
+    long long llEscaped;
+    long long llCapped;
+    double dKernelSeconds;
+    double dColorSeconds;
+};
+
+// WORKER STATISTICS STRUCTURE
+// Parts: vHistogram - Pixel counts in each iteration bucket (see
+//                     Get_Histogram_Bucket).
+//        vTiles - The statistics of every tile the worker rendered.
+//        dBusySeconds - Time the worker spent rendering tiles.
+////////////////////////////////////////////////////////////////////////////////
+struct sWorkerStats
+{
+    std::vector< long long > vHistogram;
+    std::vector< sTileStats > vTiles;
+    double dBusySeconds;
+};
+
+// RENDER STATISTICS STRUCTURE
+// Parts: iWidth, iHeight, iMax_Iterations, iThreads, iTileSize - The settings
+//                                                                of the render.
+//        llIterations - Total iterations done over the image.
+//        llEscaped, llCapped - Pixels that escaped vs. hit the iteration cap.
+//        vBucketBounds - Upper (inclusive) iteration count of each histogram
+//                        bucket.  Powers of two, with the last bucket ending at
+//                        iMax_Iterations.
+//        vHistogram - Pixel counts in each bucket.
+//        vWorkers - Each worker's statistics (and busy time).
+//        dKernelSeconds, dColorSeconds - Kernel and coloring time summed over
+//                                        every worker (CPU seconds).
+//        dEncodeSeconds - Time the encode stage spent handing the pixels over
+//                         to the image and writing it out (mostly overlapped
+//                         with the workers).
+//        dWallSeconds - Wall clock time of the whole render.
+////////////////////////////////////////////////////////////////////////////////
+struct sRenderStats
+{
+    int iWidth;
+    int iHeight;
+    int iMax_Iterations;
+    int iThreads;
+    int iTileSize;
+    long long llIterations;
+    long long llEscaped;
+    long long llCapped;
+    std::vector< int > vBucketBounds;
+    std::vector< long long > vHistogram;
+    std::vector< sWorkerStats > vWorkers;
+    double dKernelSeconds;
+    double dColorSeconds;
+    double dEncodeSeconds;
+    double dWallSeconds;
+};
+
+// FUNCTION DECLARATIONS
+void Init_Render_Stats( sRenderStats &sStats,
+			const int iWidth,
+			const int iHeight,
+			const int iMax_Iterations,
+			const int iThreads,
+			const int iTileSize );
+
+void Merge_Worker_Stats( sRenderStats &sStats );
+
+void Write_Stats_JSON( std::ostream &osOut, const sRenderStats &sStats );
+
+void Write_Stats_Prometheus( std::ostream &osOut, const sRenderStats &sStats );
+
+double Get_Seconds( const std::chrono::steady_clock::time_point &tStart,
+		    const std::chrono::steady_clock::time_point &tEnd );
+
+// Description: Works out which histogram bucket an iteration count falls in.
+//              Bucket 0 holds 0 and 1 iterations and bucket k holds
+//              (2^(k-1), 2^k], so this is just the bit length of n - 1.
+// Parameters: iIterations - The iteration count of the pixel.
+// Return Value: Returns the index of the bucket.
+////////////////////////////////////////////////////////////////////////////////
+inline int Get_Histogram_Bucket( const int iIterations )
+{
+    return ( iIterations <= 1 ) ? 0 : ( 32 - __builtin_clz( (unsigned)( iIterations - 1 ) ) );
+}
+
+#endif
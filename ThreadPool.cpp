@@ -0,0 +1,114 @@
+// Name: ThreadPool.cpp
+// Description: Module implementation of the reusable worker thread pool.
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "ThreadPool.h"
+#include <algorithm>
+
+// Namespaces
+using namespace std;
+
+// Description: Body of each of the pool's threads.  Waits for a job it hasn't
+//              run yet, runs its part if it takes part in it, and reports back.
+// Parameters: pPool - The pool.
+//             iIndex - The index of this thread in the pool.
+////////////////////////////////////////////////////////////////////////////////
+void Pool_Thread( sThreadPool *pPool, const int iIndex )
+{
+    // Local Variables
+    long long llLastJob = 0;
+
+    while( true )
+    {
+	// Local Variables
+	unique_lock< mutex > lock( pPool->mtxPool );
+
+	while( !pPool->bStopping && ( pPool->llJob == llLastJob ) )
+	    pPool->cvWork.wait( lock );
+
+	if( pPool->bStopping )
+	    return;
+
+	llLastJob = pPool->llJob;
+
+	if( iIndex >= pPool->iWorkers )
+	    continue;
+
+	lock.unlock();
+	pPool->fnWork( iIndex );
+	lock.lock();
+
+	if( --pPool->iRunning == 0 )
+	    pPool->cvDone.notify_all();
+    }
+}
+
+// Description: Starts the pool's threads.
+// Parameters: sPool - The pool (not started yet).
+//             iThreads - The number of threads (0 = one per hardware thread).
+////////////////////////////////////////////////////////////////////////////////
+void Start_Thread_Pool( sThreadPool &sPool, const int iThreads )
+{
+    // Local Variables
+    int iCount = ( iThreads > 0 ) ? iThreads : (int)( thread::hardware_concurrency() );
+
+    sPool.iWorkers = 0;
+    sPool.iRunning = 0;
+    sPool.llJob = 0;
+    sPool.bStopping = false;
+
+    for( int i = 0; i < max( iCount, 1 ); ++i )
+	sPool.vThreads.push_back( thread( Pool_Thread, &sPool, i ) );
+}
+
+// Description: Returns the number of threads in the pool.
+////////////////////////////////////////////////////////////////////////////////
+int Get_Pool_Size( const sThreadPool &sPool )
+{
+    return (int)( sPool.vThreads.size() );
+}
+
+// Description: Runs a function on a number of the pool's threads at once and
+//              waits for all of them to return.
+// Parameters: sPool - The pool.
+//             iWorkers - The number of threads to run it on (no more than the
+//                        pool's size).
+//             fnWork - The function, passed the index of the thread running it
+//                      (0 to iWorkers - 1).
+////////////////////////////////////////////////////////////////////////////////
+void Run_On_Pool( sThreadPool &sPool, const int iWorkers, const function< void( int ) > &fnWork )
+{
+    // Local Variables
+    lock_guard< mutex > lockJobs( sPool.mtxJobs );
+    unique_lock< mutex > lock( sPool.mtxPool );
+
+    sPool.fnWork = fnWork;
+    sPool.iWorkers = min( iWorkers, Get_Pool_Size( sPool ) );
+    sPool.iRunning = sPool.iWorkers;
+    ++sPool.llJob;
+    sPool.cvWork.notify_all();
+
+    while( sPool.iRunning > 0 )
+	sPool.cvDone.wait( lock );
+}
+
+// Description: Stops the pool's threads and waits for them to exit.  No job
+//              may be running.
+// Parameters: sPool - The pool.
+////////////////////////////////////////////////////////////////////////////////
+void Stop_Thread_Pool( sThreadPool &sPool )
+{
+    {
+	lock_guard< mutex > lock( sPool.mtxPool );
+
+	sPool.bStopping = true;
+    }
+
+    sPool.cvWork.notify_all();
+
+    for( size_t i = 0; i < sPool.vThreads.size(); ++i )
+	sPool.vThreads[ i ].join();
+
+    sPool.vThreads.clear();
+}
@@ -0,0 +1,56 @@
+// Name: ThreadPool.h
+// Description: Header for a pool of worker threads that are started once and
+//              reused for render after render, so a program drawing many
+//              images doesn't start and stop its threads for every one.  A job
+//              runs the same function on a number of the pool's threads at
+//              once (each told its index) and waits for all of them, which is
+//              how the render workers are run anyway.  Jobs on the same pool
+//              run one after another.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+// INCLUDES
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// THREAD POOL STRUCTURE
+// Parts: mtxJobs - Held for the whole of a job, so jobs take turns.
+//        mtxPool - Guards the rest of the pool.
+//        cvWork - Signalled when a job starts or the pool is stopping.
+//        cvDone - Signalled when a thread finishes its part of a job.
+//        vThreads - The pool's threads.
+//        fnWork - The function of the current job.
+//        iWorkers - The number of threads taking part in the current job.
+//        iRunning - The number of those that haven't finished yet.
+//        llJob - Counts the jobs started, so each thread runs each job once.
+//        bStopping - Set when the threads should exit.
+////////////////////////////////////////////////////////////////////////////////
+struct sThreadPool
+{
+    std::mutex mtxJobs;
+    std::mutex mtxPool;
+    std::condition_variable cvWork;
+    std::condition_variable cvDone;
+    std::vector< std::thread > vThreads;
+    std::function< void( int ) > fnWork;
+    int iWorkers;
+    int iRunning;
+    long long llJob;
+    bool bStopping;
+};
+
+// FUNCTION DECLARATIONS
+void Start_Thread_Pool( sThreadPool &sPool, const int iThreads );
+
+int Get_Pool_Size( const sThreadPool &sPool );
+
+void Run_On_Pool( sThreadPool &sPool, const int iWorkers, const std::function< void( int ) > &fnWork );
+
+void Stop_Thread_Pool( sThreadPool &sPool );
+
+#endif
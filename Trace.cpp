@@ -0,0 +1,215 @@
+// Name: Trace.cpp
+// Description: Module implementation of the timeline tracing module.
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "Trace.h"
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include <unistd.h>
+
+// Namespaces
+using namespace std;
+
+// The switch tested by every span.
+bool bTraceEnabled = false;
+
+// Every buffer ever handed out, in the order the threads first traced.  The
+// buffers outlive their threads so the dump can still see them, and are
+// reused by later threads of the same name.
+static mutex mtxRegistry;
+static vector< sTraceBuffer * > vRegistry;
+static chrono::steady_clock::time_point tEpoch;
+
+// LOCAL BUFFER STRUCTURE
+// Description: Holds the calling thread's buffer (NULL until it traces) and
+//              gives it back when the thread exits.
+////////////////////////////////////////////////////////////////////////////////
+struct sLocalBuffer
+{
+    sTraceBuffer *pBuffer;
+
+    ~sLocalBuffer( )
+    {
+	if( pBuffer != NULL )
+	{
+	    lock_guard< mutex > lock( mtxRegistry );
+
+	    pBuffer->bInUse = false;
+	}
+    }
+};
+
+static thread_local sLocalBuffer sLocal = { NULL };
+
+// Description: Turns tracing on and starts the trace clock.
+////////////////////////////////////////////////////////////////////////////////
+void Enable_Tracing( )
+{
+    tEpoch = chrono::steady_clock::now();
+    bTraceEnabled = true;
+}
+
+// Description: Returns the number of nanoseconds since tracing was enabled.
+////////////////////////////////////////////////////////////////////////////////
+long long Get_Trace_Time( )
+{
+    return chrono::duration_cast< chrono::nanoseconds >( chrono::steady_clock::now() -
+							 tEpoch ).count();
+}
+
+// Description: Hands the calling thread a buffer of the given name: one whose
+//              thread has exited if there is one, otherwise a new one.  The
+//              registry must be locked.
+// Parameters: cName - The name of the thread.
+// Return Value: Returns the buffer, owned by the calling thread.
+////////////////////////////////////////////////////////////////////////////////
+static sTraceBuffer *Claim_Buffer( const char cName[] )
+{
+    // Local Variables
+    sTraceBuffer *pBuffer = NULL;
+
+    for( size_t b = 0; b < vRegistry.size(); ++b )
+	if( !vRegistry[ b ]->bInUse && ( strcmp( vRegistry[ b ]->cThreadName, cName ) == 0 ) )
+	{
+	    pBuffer = vRegistry[ b ];
+	    break;
+	}
+
+    if( pBuffer == NULL )
+    {
+	pBuffer = new sTraceBuffer;
+	pBuffer->uHead.store( 0 );
+	pBuffer->iThreadId = (int)( vRegistry.size() );
+	snprintf( pBuffer->cThreadName, sizeof( pBuffer->cThreadName ), "%s", cName );
+	vRegistry.push_back( pBuffer );
+    }
+
+    if( sLocal.pBuffer != NULL )
+	sLocal.pBuffer->bInUse = false;
+
+    pBuffer->bInUse = true;
+    sLocal.pBuffer = pBuffer;
+
+    return pBuffer;
+}
+
+// Description: Returns the calling thread's buffer, claiming one the first
+//              time the thread traces.  This is the only place a lock is taken
+//              and it only happens once per thread.  Threads that never name
+//              themselves share the "thread" buffers.
+////////////////////////////////////////////////////////////////////////////////
+sTraceBuffer *Get_Local_Buffer( )
+{
+    if( sLocal.pBuffer == NULL )
+    {
+	lock_guard< mutex > lock( mtxRegistry );
+
+	Claim_Buffer( "thread" );
+    }
+
+    return sLocal.pBuffer;
+}
+
+// Description: Names the calling thread in the trace, e.g. "worker 3".
+// Method: The thread takes over the buffer of an earlier, finished thread of
+//         the same name, so each logical worker is one track however many
+//         threads it ran on.  A thread named again under another name (a
+//         pool thread running a different job) gives its buffer up and moves
+//         to one of the new name.
+// Parameters: cName - The name of the thread.
+//             iIndex - Appended to the name when >= 0.
+////////////////////////////////////////////////////////////////////////////////
+void Set_Trace_Thread_Name( const char cName[], int iIndex )
+{
+    // Local Variables
+    char cFullName[ iTRACE_NAME_LENGTH ];
+
+    if( !bTraceEnabled )
+	return;
+
+    if( iIndex >= 0 )
+	snprintf( cFullName, sizeof( cFullName ), "%s %d", cName, iIndex );
+    else
+	snprintf( cFullName, sizeof( cFullName ), "%s", cName );
+
+    lock_guard< mutex > lock( mtxRegistry );
+
+    if( ( sLocal.pBuffer == NULL ) || ( strcmp( sLocal.pBuffer->cThreadName, cFullName ) != 0 ) )
+	Claim_Buffer( cFullName );
+}
+
+// Description: Appends a finished span to the calling thread's ring buffer.
+// Method: The thread owns its buffer so the slot can be written without any
+//         locking; the release store of the head publishes the event to the
+//         dump.  Once the ring is full the oldest events are overwritten.
+// Parameters: cpName, cpCategory - The name and category of the span.
+//             llStartNs - When the span started.
+////////////////////////////////////////////////////////////////////////////////
+void Record_Trace_Event( const char *cpName,
+			 const char *cpCategory,
+			 long long llStartNs )
+{
+    // Local Variables
+    sTraceBuffer *pBuffer = Get_Local_Buffer();
+    unsigned long uHead = pBuffer->uHead.load( memory_order_relaxed );
+    sTraceEvent &sEvent = pBuffer->vEvents[ uHead % iTRACE_BUFFER_EVENTS ];
+
+    sEvent.cpName = cpName;
+    sEvent.cpCategory = cpCategory;
+    sEvent.llStartNs = llStartNs;
+    sEvent.llDurationNs = Get_Trace_Time() - llStartNs;
+
+    pBuffer->uHead.store( uHead + 1, memory_order_release );
+}
+
+// Description: Writes every recorded span out as Chrome trace-event JSON.
+// Method: Each thread gets a thread_name metadata event followed by a
+//         complete ("X") event for each span still in its ring.  Times are
+//         written in microseconds, as the format expects.
+// Parameters: cFileName - The file to write the trace to.
+// Return Value: Returns false if the file couldn't be written.
+////////////////////////////////////////////////////////////////////////////////
+bool Write_Trace_JSON( const char cFileName[] )
+{
+    // Local Variables
+    FILE *pFile = fopen( cFileName, "w" );
+    int iPid = (int)( getpid() );
+    bool bFirst = true;
+
+    if( pFile == NULL )
+	return false;
+
+    lock_guard< mutex > lock( mtxRegistry );
+
+    fprintf( pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" );
+
+    for( size_t b = 0; b < vRegistry.size(); ++b )
+    {
+	const sTraceBuffer *pBuffer = vRegistry[ b ];
+	unsigned long uHead = pBuffer->uHead.load( memory_order_acquire );
+	unsigned long uStart = ( uHead > (unsigned long)iTRACE_BUFFER_EVENTS ) ?
+	    ( uHead - iTRACE_BUFFER_EVENTS ) : 0;
+
+	fprintf( pFile, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+		 "\"args\":{\"name\":\"%s\"}}",
+		 bFirst ? "" : ",", iPid, pBuffer->iThreadId, pBuffer->cThreadName );
+	bFirst = false;
+
+	for( unsigned long e = uStart; e < uHead; ++e )
+	{
+	    const sTraceEvent &sEvent = pBuffer->vEvents[ e % iTRACE_BUFFER_EVENTS ];
+
+	    fprintf( pFile, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+		     "\"ts\":%.3f,\"dur\":%.3f}",
+		     sEvent.cpName, sEvent.cpCategory, iPid, pBuffer->iThreadId,
+		     sEvent.llStartNs / 1000.0, sEvent.llDurationNs / 1000.0 );
+	}
+    }
+
+    fprintf( pFile, "\n]}\n" );
+
+    return ( fclose( pFile ) == 0 );
+}
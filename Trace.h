@@ -0,0 +1,109 @@
+// Name: Trace.h
+// Description: Header for the timeline tracing module.  Spans are recorded
+//              into a per-thread ring buffer that only its own thread writes
+//              to, and the buffers are dumped as Chrome trace-event JSON
+//              (viewable in chrome://tracing or Perfetto) once the work is
+//              done.  Tracing costs a single predicted branch per span while
+//              it's turned off and can be compiled out entirely by defining
+//              MANDELBROT_NO_TRACE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TRACE_H
+#define TRACE_H
+
+// INCLUDES
+#include <atomic>
+#include <chrono>
+
+// CONSTANTS
+const int iTRACE_BUFFER_EVENTS = 1 << 16;   // Per thread, oldest are overwritten.
+const int iTRACE_NAME_LENGTH = 32;
+
+// TRACE EVENT STRUCTURE
+// Parts: cpName - The name of the span (must be a string literal).
+//        cpCategory - The category of the span (must be a string literal).
+//        llStartNs - Start of the span, in nanoseconds since tracing started.
+//        llDurationNs - Length of the span in nanoseconds.
+////////////////////////////////////////////////////////////////////////////////
+struct sTraceEvent
+{
+    const char *cpName;
+    const char *cpCategory;
+    long long llStartNs;
+    long long llDurationNs;
+};
+
+// TRACE BUFFER STRUCTURE
+// Parts: vEvents - The ring of events.
+//        uHead - The number of events ever written.  Only the owning thread
+//                stores to it; the release store publishes the event.
+//        iThreadId - The id the thread shows up as in the trace.
+//        cThreadName - The name the thread shows up as in the trace.
+//        bInUse - Set while a thread owns the buffer.  Once its thread exits
+//                 the buffer is handed to the next thread with the same name
+//                 (the same logical worker), so a render that starts new
+//                 threads for every pass or frame keeps one track per worker.
+//                 Guarded by the registry's lock.
+////////////////////////////////////////////////////////////////////////////////
+struct sTraceBuffer
+{
+    sTraceEvent vEvents[ iTRACE_BUFFER_EVENTS ];
+    std::atomic< unsigned long > uHead;
+    int iThreadId;
+    char cThreadName[ iTRACE_NAME_LENGTH ];
+    bool bInUse;
+};
+
+// Set while tracing is turned on.  Only changed while no spans are open.
+extern bool bTraceEnabled;
+
+// FUNCTION DECLARATIONS
+void Enable_Tracing( );
+
+bool Write_Trace_JSON( const char cFileName[] );
+
+void Set_Trace_Thread_Name( const char cName[], int iIndex = -1 );
+
+long long Get_Trace_Time( );
+
+void Record_Trace_Event( const char *cpName,
+			 const char *cpCategory,
+			 long long llStartNs );
+
+// TRACE SPAN STRUCTURE
+// Description: Records the time between its construction and destruction as
+//              a span on the calling thread's timeline.  Use the TRACE_SPAN
+//              macro rather than this directly.
+////////////////////////////////////////////////////////////////////////////////
+struct sTraceSpan
+{
+    const char *cpName;
+    const char *cpCategory;
+    long long llStartNs;
+
+    sTraceSpan( const char *cpSpanName, const char *cpSpanCategory )
+	: cpName( cpSpanName ), cpCategory( cpSpanCategory ), llStartNs( -1 )
+    {
+	if( __builtin_expect( bTraceEnabled, 0 ) )
+	    llStartNs = Get_Trace_Time( );
+    }
+
+    ~sTraceSpan( )
+    {
+	if( __builtin_expect( llStartNs >= 0, 0 ) )
+	    Record_Trace_Event( cpName, cpCategory, llStartNs );
+    }
+};
+
+// DEFINES
+#define TRACE_CONCAT_( a, b ) a##b
+#define TRACE_CONCAT( a, b ) TRACE_CONCAT_( a, b )
+
+#ifdef MANDELBROT_NO_TRACE
+#define TRACE_SPAN( cpName, cpCategory )
+#else
+#define TRACE_SPAN( cpName, cpCategory ) \
+    sTraceSpan TRACE_CONCAT( sSpan_, __LINE__ )( cpName, cpCategory )
+#endif
+
+#endif
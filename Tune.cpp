@@ -0,0 +1,335 @@
+// Name: Tune.cpp
+// Description: Module implementation of the autotuner and its profile file.
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "Tune.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+
+// Namespaces
+using namespace std;
+
+// CONSTANTS
+const char cDEFAULT_PROFILE_FILE[] = ".mandelbrot-profile";
+
+// The regions timed: the whole set (mostly fast escapes, plus the cardioid),
+// Seahorse Valley (long escape times next to the cap, so the tiles are very
+// uneven) and a window inside the main cardioid (every pixel hits the cap).
+const sViewport sCALIBRATION_VIEWS[] =
+{
+    { -2.0, 1.0, -1.0, 1.0 },
+    { -0.8, -0.7, 0.05, 0.1167 },
+    { -0.5, -0.1, -0.133, 0.133 }
+};
+const int iCALIBRATION_VIEW_COUNT = sizeof( sCALIBRATION_VIEWS ) / sizeof( sViewport );
+
+// The size and iteration cap of each calibration render: big enough to have
+// hundreds of tiles at the smallest tile size, small enough that the search
+// takes seconds.
+const int iCALIBRATION_WIDTH = 320;
+const int iCALIBRATION_HEIGHT = 240;
+const int iCALIBRATION_ITERATIONS = 300;
+
+// The configuration the search starts from (the built in tile size, with a
+// thread per hardware thread, on the caller's kernel).
+const int iSTART_TILE_SIZE = 64;
+
+// Each region is drawn this many times and the fastest is kept, to keep
+// another process's time slice from picking the winner.
+const int iCALIBRATION_REPEATS = 3;
+
+// The tile sizes tried.
+const int iTUNING_TILE_SIZES[] = { 16, 32, 64, 128, 256 };
+const int iTUNING_TILE_SIZE_COUNT = sizeof( iTUNING_TILE_SIZES ) / sizeof( int );
+
+// The kernels tried with --autotune=kernel.  The double precision ones round
+// differently from the reference, so picking one changes the image the way
+// --kernel does.
+const eKernelType eTUNING_KERNELS[] = { eKERNEL_REFERENCE, eKERNEL_SCALAR, eKERNEL_VECTOR };
+const int iTUNING_KERNEL_COUNT = sizeof( eTUNING_KERNELS ) / sizeof( eKernelType );
+
+// Description: Returns the name --kernel knows a kernel by.
+////////////////////////////////////////////////////////////////////////////////
+const char *Get_Kernel_Name( const eKernelType eKernel )
+{
+    switch( eKernel )
+    {
+    case eKERNEL_REFERENCE:
+	return "reference";
+    case eKERNEL_SCALAR:
+	return "scalar";
+    default:
+	return "vector";
+    }
+}
+
+// Description: Returns the number of hardware threads of the host (at least 1).
+////////////////////////////////////////////////////////////////////////////////
+static int Get_Hardware_Threads( )
+{
+    return max( (int)( thread::hardware_concurrency() ), 1 );
+}
+
+// Description: Times one configuration over every calibration region.
+// Parameters: sOptions - The options to render with (the configuration set).
+//             vIterations - Scratch space for the iteration counts.
+// Return Value: Returns the sum over the regions of the fastest render of each.
+////////////////////////////////////////////////////////////////////////////////
+static double Time_Configuration( sRenderOptions sOptions, vector< int > &vIterations )
+{
+    // Local Variables
+    double dTotal = 0.0;
+
+    for( int v = 0; v < iCALIBRATION_VIEW_COUNT; ++v )
+    {
+	// Local Variables
+	double dFastest = 0.0;
+
+	sOptions.sView = sCALIBRATION_VIEWS[ v ];
+
+	for( int r = 0; r < iCALIBRATION_REPEATS; ++r )
+	{
+	    // Local Variables
+	    chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+	    double dSeconds = 0.0;
+
+	    Render_Iterations( iCALIBRATION_WIDTH, iCALIBRATION_HEIGHT, iCALIBRATION_ITERATIONS,
+			       sOptions, vIterations );
+	    dSeconds = chrono::duration< double >( chrono::steady_clock::now() - tStart ).count();
+
+	    if( ( r == 0 ) || ( dSeconds < dFastest ) )
+		dFastest = dSeconds;
+	}
+
+	dTotal += dFastest;
+    }
+
+    return dTotal;
+}
+
+// Description: Times a configuration unless it has been timed already.
+// Parameters: sProfile - The configuration.
+//             sCalibration - The options to render with (changed to it).
+//             vIterations - Scratch space for the iteration counts.
+//             vResults - The configurations timed so far; it is added to.
+// Return Value: Returns the configuration's index in vResults.
+////////////////////////////////////////////////////////////////////////////////
+static size_t Time_Candidate( const sTuningProfile &sProfile,
+			      sRenderOptions &sCalibration,
+			      vector< int > &vIterations,
+			      vector< sTuningResult > &vResults )
+{
+    // Local Variables
+    sTuningResult sResult;
+
+    for( size_t i = 0; i < vResults.size(); ++i )
+	if( ( vResults[ i ].sProfile.eKernel == sProfile.eKernel ) &&
+	    ( vResults[ i ].sProfile.iTileSize == sProfile.iTileSize ) &&
+	    ( vResults[ i ].sProfile.iThreads == sProfile.iThreads ) )
+	    return i;
+
+    Apply_Tuning_Profile( sProfile, sCalibration );
+    sResult.sProfile = sProfile;
+    sResult.dSeconds = Time_Configuration( sCalibration, vIterations );
+    vResults.push_back( sResult );
+
+    return vResults.size() - 1;
+}
+
+// Description: Finds the fastest configuration for this host.
+// Method: The settings are searched one at a time, keeping the fastest of
+//         each before moving on to the next: the kernel when asked for (at
+//         the default tile size on every hardware thread), then the tile
+//         size, then the thread count (1, 2, 4... and the hardware thread
+//         count).  Without bTuneKernel every configuration uses the caller's
+//         kernel, and the profile doesn't hold one.  They hardly
+//         depend on each other, and this times a dozen configurations where
+//         every combination would be a hundred on a large machine.  Each
+//         configuration draws the calibration regions without coloring or
+//         saving them, after one untimed render to fault in the buffers.  The
+//         formula, traversal and --numa setting are the caller's, so a host
+//         can be tuned for the kind of image it will be drawing.
+// Parameters: sOptions - The caller's render options.
+//             bTuneKernel - Time the kernels too, and keep the fastest.
+//             vResults - Filled with the time of every configuration tried.
+//             sBest - Set to the fastest of them.
+////////////////////////////////////////////////////////////////////////////////
+void Run_Autotune( const sRenderOptions &sOptions,
+		   const bool bTuneKernel,
+		   vector< sTuningResult > &vResults,
+		   sTuningProfile &sBest )
+{
+    // Local Variables
+    sRenderOptions sCalibration = sOptions;
+    vector< int > vThreadCounts;
+    vector< int > vIterations;
+    int iHardwareThreads = Get_Hardware_Threads();
+    size_t iFastest = 0;
+    sTuningProfile sCandidate;
+
+    sCalibration.eColoring = eCOLOR_LINEAR;
+    sCalibration.eProgress = ePROGRESS_NONE;
+    sCalibration.eStats = eSTATS_NONE;
+    sCalibration.cpTraceFile = NULL;
+    sCalibration.pPool = NULL;
+
+    for( int i = 1; i < iHardwareThreads; i *= 2 )
+	vThreadCounts.push_back( i );
+
+    vThreadCounts.push_back( iHardwareThreads );
+    vResults.clear();
+
+    sCalibration.sView = sCALIBRATION_VIEWS[ 0 ];
+    Render_Iterations( iCALIBRATION_WIDTH, iCALIBRATION_HEIGHT, iCALIBRATION_ITERATIONS,
+		       sCalibration, vIterations );
+
+    sBest.eKernel = sOptions.eKernel;
+    sBest.bKernel = bTuneKernel;
+    sBest.iTileSize = iSTART_TILE_SIZE;
+    sBest.iThreads = iHardwareThreads;
+    sBest.iHardwareThreads = iHardwareThreads;
+    iFastest = Time_Candidate( sBest, sCalibration, vIterations, vResults );
+
+    for( int iSetting = bTuneKernel ? 0 : 1; iSetting < 3; ++iSetting )
+    {
+	// Local Variables
+	int iChoices = ( iSetting == 0 ) ? iTUNING_KERNEL_COUNT :
+	    ( iSetting == 1 ) ? iTUNING_TILE_SIZE_COUNT : (int)( vThreadCounts.size() );
+
+	for( int i = 0; i < iChoices; ++i )
+	{
+	    // Local Variables
+	    size_t iTimed = 0;
+
+	    sCandidate = sBest;
+
+	    if( iSetting == 0 )
+		sCandidate.eKernel = eTUNING_KERNELS[ i ];
+	    else if( iSetting == 1 )
+		sCandidate.iTileSize = iTUNING_TILE_SIZES[ i ];
+	    else
+		sCandidate.iThreads = vThreadCounts[ i ];
+
+	    iTimed = Time_Candidate( sCandidate, sCalibration, vIterations, vResults );
+
+	    if( vResults[ iTimed ].dSeconds < vResults[ iFastest ].dSeconds )
+		iFastest = iTimed;
+	}
+
+	sBest = vResults[ iFastest ].sProfile;
+    }
+}
+
+// Description: Writes a profile as lines of name=value.
+// Parameters: cFileName - The file to write (replaced if it exists).
+//             sProfile - The profile.
+// Return Value: Returns false if the file couldn't be written.
+////////////////////////////////////////////////////////////////////////////////
+bool Save_Tuning_Profile( const char cFileName[], const sTuningProfile &sProfile )
+{
+    // Local Variables
+    ofstream fProfile( cFileName );
+
+    fProfile << "# Mandelbrot tuning profile, written by --autotune." << endl;
+    fProfile << "hardware_threads=" << sProfile.iHardwareThreads << endl;
+
+    if( sProfile.bKernel )
+	fProfile << "kernel=" << Get_Kernel_Name( sProfile.eKernel ) << endl;
+
+    fProfile << "tile=" << sProfile.iTileSize << endl;
+    fProfile << "threads=" << sProfile.iThreads << endl;
+    fProfile.close();
+
+    return !fProfile.fail();
+}
+
+// Description: Reads a profile written by Save_Tuning_Profile.
+// Method: Blank lines, comments (#) and names we don't know are skipped, so a
+//         profile from a later version still loads.  Every setting but the
+//         kernel has to be there, and each one given has to make sense.
+// Parameters: cFileName - The file to read.
+//             sProfile - Set to the profile.
+// Return Value: Returns false if the file is missing or isn't a whole profile.
+////////////////////////////////////////////////////////////////////////////////
+bool Load_Tuning_Profile( const char cFileName[], sTuningProfile &sProfile )
+{
+    // Local Variables
+    ifstream fProfile( cFileName );
+    string sLine;
+    bool bKernelValid = true;
+
+    sProfile.eKernel = eKERNEL_REFERENCE;
+    sProfile.bKernel = false;
+    sProfile.iTileSize = 0;
+    sProfile.iThreads = -1;
+    sProfile.iHardwareThreads = 0;
+
+    if( !fProfile )
+	return false;
+
+    while( getline( fProfile, sLine ) )
+    {
+	// Local Variables
+	size_t iEquals = sLine.find( '=' );
+	string sName;
+	const char *cpValue = NULL;
+
+	if( sLine.empty() || ( sLine[ 0 ] == '#' ) || ( iEquals == string::npos ) )
+	    continue;
+
+	sName = sLine.substr( 0, iEquals );
+	cpValue = sLine.c_str() + iEquals + 1;
+
+	if( sName == "hardware_threads" )
+	    sProfile.iHardwareThreads = atoi( cpValue );
+	else if( sName == "tile" )
+	    sProfile.iTileSize = atoi( cpValue );
+	else if( sName == "threads" )
+	    sProfile.iThreads = atoi( cpValue );
+	else if( sName == "kernel" )
+	{
+	    sProfile.bKernel = true;
+
+	    if( strcmp( cpValue, "reference" ) == 0 )
+		sProfile.eKernel = eKERNEL_REFERENCE;
+	    else if( strcmp( cpValue, "scalar" ) == 0 )
+		sProfile.eKernel = eKERNEL_SCALAR;
+	    else if( strcmp( cpValue, "vector" ) == 0 )
+		sProfile.eKernel = eKERNEL_VECTOR;
+	    else
+		bKernelValid = false;
+	}
+    }
+
+    return bKernelValid && ( sProfile.iTileSize > 0 ) && ( sProfile.iThreads >= 0 ) &&
+	( sProfile.iHardwareThreads > 0 );
+}
+
+// Description: Returns true if a profile was tuned on a host with as many
+//              hardware threads as this one.  Anything else (a copied file, a
+//              container given fewer CPUs) needs tuning again.
+////////////////////////////////////////////////////////////////////////////////
+bool Is_Profile_Current( const sTuningProfile &sProfile )
+{
+    return sProfile.iHardwareThreads == Get_Hardware_Threads();
+}
+
+// Description: Sets the render options the profile covers: the tile size and
+//              thread count, and the kernel only if the profile holds one.
+// Parameters: sProfile - The profile.
+//             sOptions - The options to change.
+////////////////////////////////////////////////////////////////////////////////
+void Apply_Tuning_Profile( const sTuningProfile &sProfile, sRenderOptions &sOptions )
+{
+    if( sProfile.bKernel )
+	sOptions.eKernel = sProfile.eKernel;
+
+    sOptions.iTileSize = sProfile.iTileSize;
+    sOptions.iThreads = sProfile.iThreads;
+}
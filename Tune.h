@@ -0,0 +1,71 @@
+// Name: Tune.h
+// Description: Header for the autotuner.  The fastest tile size, thread count
+//              and kernel depend on the host (its caches, its core count, how
+//              wide its vector registers are), so rather than guessing,
+//              --autotune times short renders of a few representative regions
+//              with each combination and saves the fastest to a profile file.
+//              Later runs load the profile before reading the command line, so
+//              it replaces the built in defaults but not options given
+//              explicitly.  Only the tile size and thread count are tuned
+//              unless asked for (--autotune=kernel): they don't change the
+//              image, but the kernel does, and a profile shouldn't quietly
+//              change the output of a command line.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TUNE_H
+#define TUNE_H
+
+// INCLUDES
+#include "Mandelbrot.h"
+#include <vector>
+
+// CONSTANTS
+// Where the profile is kept when no --profile is given: the current directory,
+// so each checkout (or each machine sharing a home directory) tunes for itself.
+extern const char cDEFAULT_PROFILE_FILE[];
+
+// TUNING PROFILE STRUCTURE
+// Parts: eKernel, iTileSize, iThreads - The configuration to render with.
+//        bKernel - Set when the profile holds a kernel (--autotune=kernel);
+//                  otherwise eKernel was only timed and isn't applied.
+//        iHardwareThreads - The hardware threads of the host it was tuned on.
+//                           A profile from a host with a different count is
+//                           stale and isn't used.
+////////////////////////////////////////////////////////////////////////////////
+struct sTuningProfile
+{
+    eKernelType eKernel;
+    bool bKernel;
+    int iTileSize;
+    int iThreads;
+    int iHardwareThreads;
+};
+
+// TUNING RESULT STRUCTURE
+// Parts: sProfile - The configuration timed.
+//        dSeconds - Its time: the sum over the regions of the fastest of the
+//                   repeated renders of each.
+////////////////////////////////////////////////////////////////////////////////
+struct sTuningResult
+{
+    sTuningProfile sProfile;
+    double dSeconds;
+};
+
+// FUNCTION DECLARATIONS
+const char *Get_Kernel_Name( const eKernelType eKernel );
+
+void Run_Autotune( const sRenderOptions &sOptions,
+		   const bool bTuneKernel,
+		   std::vector< sTuningResult > &vResults,
+		   sTuningProfile &sBest );
+
+bool Save_Tuning_Profile( const char cFileName[], const sTuningProfile &sProfile );
+
+bool Load_Tuning_Profile( const char cFileName[], sTuningProfile &sProfile );
+
+bool Is_Profile_Current( const sTuningProfile &sProfile );
+
+void Apply_Tuning_Profile( const sTuningProfile &sProfile, sRenderOptions &sOptions );
+
+#endif
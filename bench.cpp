@@ -0,0 +1,430 @@
+// Name: bench.cpp
+// Description: Microbenchmarks for the escape time kernels, the coloring
+//              functions and the PNG writer, each measured in isolation over
+//              fixed workloads so variants can be compared and regressions
+//              caught.
+// Usage: Benchmark [--size=N] [--iterations=N] [--min-time=SECONDS] [--json]
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "Color.h"
+#include "Encoder.h"
+#include "Kernel.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Namespaces
+using namespace std;
+
+// WORKLOAD STRUCTURE
+// Parts: cpName - The name the workload is reported under.
+//        dXMin, dXMax, dYMin, dYMax - The area of the complex plane sampled.
+////////////////////////////////////////////////////////////////////////////////
+struct sWorkload
+{
+    const char *cpName;
+    double dXMin;
+    double dXMax;
+    double dYMin;
+    double dYMax;
+};
+
+// CONSTANTS
+// interior - Entirely inside the main cardioid, every pixel hits the cap.
+// exterior - Entirely outside the set, every pixel escapes within a few
+//            iterations.
+// boundary - Seahorse Valley, a mix of both with long escape times.
+const sWorkload sWORKLOADS[] =
+{
+    { "interior", -0.5, -0.1, -0.2, 0.2 },
+    { "exterior", 0.6, 1.0, 0.6, 1.0 },
+    { "boundary", -0.8, -0.7, 0.05, 0.15 }
+};
+const int iWORKLOAD_COUNT = sizeof( sWORKLOADS ) / sizeof( sWorkload );
+
+// FORMULA WORKLOAD STRUCTURE
+// Parts: sWork - The area of the complex plane sampled.
+//        sFormula - The formula iterated over it.
+////////////////////////////////////////////////////////////////////////////////
+struct sFormulaWorkload
+{
+    sWorkload sWork;
+    sIterationFormula sFormula;
+};
+
+// CONSTANTS
+// The boundaries of the other formulas, to check each keeps its vector speedup.
+const sFormulaWorkload sFORMULA_WORKLOADS[] =
+{
+    { { "cubic", -0.6, 0.2, 0.6, 1.4 }, { eFORMULA_MULTIBROT, 3, false, 0.0, 0.0 } },
+    { { "power-8", 0.4, 1.0, -0.3, 0.3 }, { eFORMULA_MULTIBROT, 8, false, 0.0, 0.0 } },
+    { { "julia", -0.6, 0.6, -0.6, 0.6 }, { eFORMULA_MULTIBROT, 2, true, -0.8, 0.156 } },
+    { { "ship", -1.8, -1.7, -0.08, 0.02 }, { eFORMULA_BURNING_SHIP, 2, false, 0.0, 0.0 } }
+};
+const int iFORMULA_WORKLOAD_COUNT = sizeof( sFORMULA_WORKLOADS ) / sizeof( sFormulaWorkload );
+
+// BENCH SETTINGS STRUCTURE
+// Parts: iSize - The width and height of each workload's grid of points.
+//        iMax_Iterations - The iteration cap of every kernel run.
+//        dMinSeconds - Each measurement repeats until it has run this long.
+//        bJSON - Output one JSON object per result instead of a table.
+////////////////////////////////////////////////////////////////////////////////
+struct sBenchSettings
+{
+    int iSize;
+    int iMax_Iterations;
+    double dMinSeconds;
+    bool bJSON;
+};
+
+// Stops the compiler from throwing away the results being timed.
+volatile long long llSink = 0;
+
+// Description: Returns the seconds elapsed since tStart.
+////////////////////////////////////////////////////////////////////////////////
+double Seconds_Since( const chrono::steady_clock::time_point &tStart )
+{
+    return chrono::duration< double >( chrono::steady_clock::now() - tStart ).count();
+}
+
+// Description: Outputs a single result.
+// Parameters: sSettings - The settings of the run (for the output format).
+//             cpGroup - "kernel", "color" or "encode".
+//             cpName - The name of the kernel or coloring function.
+//             cpWorkload - The name of the workload.
+//             dSeconds - The time taken for all the repetitions.
+//             llPixels - Pixels processed over all the repetitions.
+//             llIterations - Iterations done over all the repetitions (0 when
+//                            it doesn't apply).
+////////////////////////////////////////////////////////////////////////////////
+void Report( const sBenchSettings &sSettings,
+	     const char *cpGroup,
+	     const char *cpName,
+	     const char *cpWorkload,
+	     double dSeconds,
+	     long long llPixels,
+	     long long llIterations )
+{
+    // Local Variables
+    double dMPixels = (double)llPixels / dSeconds / 1.0e6;
+    double dMIters = (double)llIterations / dSeconds / 1.0e6;
+
+    if( sSettings.bJSON )
+	printf( "{\"group\":\"%s\",\"name\":\"%s\",\"workload\":\"%s\",\"seconds\":%.6f,"
+		"\"mpixels_per_second\":%.3f,\"miterations_per_second\":%.3f}\n",
+		cpGroup, cpName, cpWorkload, dSeconds, dMPixels, dMIters );
+    else if( llIterations > 0 )
+	printf( "%-6s %-10s %-9s %12.3f Mpixel/s %12.3f Miter/s\n",
+		cpGroup, cpName, cpWorkload, dMPixels, dMIters );
+    else
+	printf( "%-6s %-10s %-9s %12.3f Mpixel/s\n",
+		cpGroup, cpName, cpWorkload, dMPixels );
+}
+
+// Description: Fills in the grid of c values of a workload.
+// Parameters: sWork - The workload.
+//             iSize - The width and height of the grid.
+//             vCReal - Filled with the real part of each column.
+//             vCImag - Filled with the imaginary part of each row.
+////////////////////////////////////////////////////////////////////////////////
+void Build_Grid( const sWorkload &sWork,
+		 const int iSize,
+		 vector< double > &vCReal,
+		 vector< double > &vCImag )
+{
+    vCReal.resize( iSize );
+    vCImag.resize( iSize );
+
+    for( int i = 0; i < iSize; ++i )
+    {
+	vCReal[ i ] = sWork.dXMin + ( sWork.dXMax - sWork.dXMin ) * i / ( iSize - 1 );
+	vCImag[ i ] = sWork.dYMin + ( sWork.dYMax - sWork.dYMin ) * i / ( iSize - 1 );
+    }
+}
+
+// Description: Times one of the row kernels over a workload.
+// Method: The whole grid is run through the kernel over and over until we've
+//         run for at least the minimum time.  The iteration counts are summed
+//         on every pass so the kernel can't be optimized away, and that sum
+//         is also what the Miter/s figure is based on.
+// Parameters: sSettings - The settings of the run.
+//             eKernel - The kernel to time.
+//             sFormula - The formula the kernel iterates.
+//             cpName - The name to report the kernel under.
+//             sWork - The workload.
+//             vIterations - Filled with the iteration counts of the grid.
+////////////////////////////////////////////////////////////////////////////////
+void Bench_Kernel( const sBenchSettings &sSettings,
+		   const eKernelType eKernel,
+		   const sIterationFormula &sFormula,
+		   const char *cpName,
+		   const sWorkload &sWork,
+		   vector< int > &vIterations )
+{
+    // Local Variables
+    vector< double > vCReal, vCImag;
+    long long llPixels = 0;
+    long long llIterations = 0;
+    double dSeconds = 0.0;
+    chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+
+    Build_Grid( sWork, sSettings.iSize, vCReal, vCImag );
+    vIterations.assign( (size_t)( sSettings.iSize ) * sSettings.iSize, 0 );
+
+    do
+    {
+	for( int y = 0; y < sSettings.iSize; ++y )
+	{
+	    int *pRow = &vIterations[ (size_t)( y ) * sSettings.iSize ];
+
+	    Get_Escape_Row( eKernel, sFormula, &vCReal[ 0 ], vCImag[ y ], sSettings.iSize,
+			    sSettings.iMax_Iterations, pRow );
+
+	    for( int x = 0; x < sSettings.iSize; ++x )
+		llIterations += pRow[ x ];
+	}
+
+	llPixels += (long long)( sSettings.iSize ) * sSettings.iSize;
+	dSeconds = Seconds_Since( tStart );
+    } while( dSeconds < sSettings.dMinSeconds );
+
+    llSink += llIterations;
+    Report( sSettings, "kernel", cpName, sWork.cpName, dSeconds, llPixels, llIterations );
+}
+
+// Description: Times the original recursive Get_Pixel_Color over a workload.
+//              It colors as it goes, so it's reported against the iteration
+//              counts the reference kernel found for the same grid.
+// Parameters: sSettings - The settings of the run.
+//             sWork - The workload.
+//             vReference - The reference kernel's counts for the grid.
+//             sColor - The color filters to color with.
+////////////////////////////////////////////////////////////////////////////////
+void Bench_Recursive( const sBenchSettings &sSettings,
+		      const sWorkload &sWork,
+		      const vector< int > &vReference,
+		      const sColorCode &sColor )
+{
+    // Local Variables
+    vector< double > vCReal, vCImag;
+    long long llPixels = 0;
+    long long llIterations = 0;
+    long long llGridIterations = 0;
+    double dSeconds = 0.0;
+    double dSum = 0.0;
+    chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+
+    Build_Grid( sWork, sSettings.iSize, vCReal, vCImag );
+
+    for( size_t i = 0; i < vReference.size(); ++i )
+	llGridIterations += vReference[ i ];
+
+    do
+    {
+	for( int y = 0; y < sSettings.iSize; ++y )
+	    for( int x = 0; x < sSettings.iSize; ++x )
+		dSum += Get_Pixel_Color( complex< float >( (float)( vCReal[ x ] ), (float)( vCImag[ y ] ) ),
+					 0, 0, sSettings.iMax_Iterations, sColor ).dRed;
+
+	llPixels += (long long)( sSettings.iSize ) * sSettings.iSize;
+	llIterations += llGridIterations;
+	dSeconds = Seconds_Since( tStart );
+    } while( dSeconds < sSettings.dMinSeconds );
+
+    llSink += (long long)( dSum );
+    Report( sSettings, "kernel", "recursive", sWork.cpName, dSeconds, llPixels, llIterations );
+}
+
+// Description: Times the palette mapping of a workload's iteration counts:
+//              Get_Iteration_Color (which goes through Parse_Color) for every
+//              pixel.
+// Parameters: sSettings - The settings of the run.
+//             sWork - The workload.
+//             vIterations - The iteration counts to color.
+//             sColor - The color filters to color with.
+////////////////////////////////////////////////////////////////////////////////
+void Bench_Coloring( const sBenchSettings &sSettings,
+		     const sWorkload &sWork,
+		     const vector< int > &vIterations,
+		     const sColorCode &sColor )
+{
+    // Local Variables
+    long long llPixels = 0;
+    double dSeconds = 0.0;
+    double dSum = 0.0;
+    chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+
+    do
+    {
+	for( size_t i = 0; i < vIterations.size(); ++i )
+	    dSum += Get_Iteration_Color( vIterations[ i ], sSettings.iMax_Iterations, sColor ).dGreen;
+
+	llPixels += (long long)( vIterations.size() );
+	dSeconds = Seconds_Since( tStart );
+    } while( dSeconds < sSettings.dMinSeconds );
+
+    llSink += (long long)( dSum );
+    Report( sSettings, "color", "iteration", sWork.cpName, dSeconds, llPixels, 0 );
+}
+
+// Description: Times Parse_Color on its own over a ramp of weights.
+// Parameters: sSettings - The settings of the run.
+//             cpName - The name to report the filters under.
+//             sColor - The color filters to color with.
+////////////////////////////////////////////////////////////////////////////////
+void Bench_Parse_Color( const sBenchSettings &sSettings,
+			const char *cpName,
+			const sColorCode &sColor )
+{
+    // Local Variables
+    const int iRamp = sSettings.iSize * sSettings.iSize;
+    long long llPixels = 0;
+    double dSeconds = 0.0;
+    double dSum = 0.0;
+    chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+
+    do
+    {
+	for( int i = 0; i < iRamp; ++i )
+	    dSum += Parse_Color( (float)( i ) / (float)( iRamp ), sColor ).dBlue;
+
+	llPixels += iRamp;
+	dSeconds = Seconds_Since( tStart );
+    } while( dSeconds < sSettings.dMinSeconds );
+
+    llSink += (long long)( dSum );
+    Report( sSettings, "color", "parse", cpName, dSeconds, llPixels, 0 );
+}
+
+// Description: Reads the settings off of the command line.
+// Return Value: Returns false if the command line couldn't be parsed.
+////////////////////////////////////////////////////////////////////////////////
+bool Parse_Bench_Arguments( int argc, char *argv[], sBenchSettings &sSettings )
+{
+    for( int i = 1; i < argc; ++i )
+    {
+	if( strncmp( argv[ i ], "--size=", 7 ) == 0 )
+	    sSettings.iSize = atoi( argv[ i ] + 7 );
+	else if( strncmp( argv[ i ], "--iterations=", 13 ) == 0 )
+	    sSettings.iMax_Iterations = atoi( argv[ i ] + 13 );
+	else if( strncmp( argv[ i ], "--min-time=", 11 ) == 0 )
+	    sSettings.dMinSeconds = atof( argv[ i ] + 11 );
+	else if( strcmp( argv[ i ], "--json" ) == 0 )
+	    sSettings.bJSON = true;
+	else
+	    return false;
+    }
+
+    return ( sSettings.iSize > 1 ) && ( sSettings.iMax_Iterations > 0 );
+}
+
+// Description: Times the PNG writer over a colored workload.
+// Method: The workload is colored once, then written to a scratch file over
+//         and over on the given number of compression threads.
+// Parameters: sSettings - The settings of the run.
+//             sWork - The workload (for reporting).
+//             vIterations - The iteration counts of the workload.
+//             sColor - The color filters.
+//             iThreads - The number of compression threads.
+////////////////////////////////////////////////////////////////////////////////
+void Bench_Encode( const sBenchSettings &sSettings,
+		   const sWorkload &sWork,
+		   const vector< int > &vIterations,
+		   const sColorCode &sColor,
+		   const int iThreads )
+{
+    // Local Variables
+    const char *cpScratch = "Benchmark.png";
+    vector< unsigned char > vBytes( vIterations.size() * 3 );
+    sImageWriter sWriter;
+    long long llPixels = 0;
+    double dSeconds = 0.0;
+    char cName[ 16 ];
+    chrono::steady_clock::time_point tStart;
+
+    for( size_t i = 0; i < vIterations.size(); ++i )
+    {
+	sPixelColor cPixel = Get_Iteration_Color( vIterations[ i ], sSettings.iMax_Iterations, sColor );
+
+	vBytes[ i * 3 ] = (unsigned char)( cPixel.dRed * 255.0 + 0.5 );
+	vBytes[ i * 3 + 1 ] = (unsigned char)( cPixel.dGreen * 255.0 + 0.5 );
+	vBytes[ i * 3 + 2 ] = (unsigned char)( cPixel.dBlue * 255.0 + 0.5 );
+    }
+
+    tStart = chrono::steady_clock::now();
+
+    do
+    {
+	Open_Image_Writer( sWriter, cpScratch, eFORMAT_PNG, sSettings.iSize, sSettings.iSize, iThreads );
+	Write_Image_Rows( sWriter, &vBytes[ 0 ], sSettings.iSize );
+
+	if( !Close_Image_Writer( sWriter ) )
+	{
+	    fprintf( stderr, "Unable to write '%s'.\n", cpScratch );
+	    return;
+	}
+
+	llPixels += (long long)( vIterations.size() );
+	dSeconds = Seconds_Since( tStart );
+    } while( dSeconds < sSettings.dMinSeconds );
+
+    remove( cpScratch );
+    snprintf( cName, sizeof( cName ), "png-%dt", iThreads );
+    Report( sSettings, "encode", cName, sWork.cpName, dSeconds, llPixels, 0 );
+}
+
+// Description: Runs every kernel and coloring benchmark over every workload.
+////////////////////////////////////////////////////////////////////////////////
+int main( int argc, char *argv[] )
+{
+    // Local Variables
+    sBenchSettings sSettings = { 256, 1000, 0.25, false };
+    sColorCode sColor = { { 1.0f, 0.6f, 0.3f }, false, false, false };
+    sColorCode sGrey = { { 1.0f, 1.0f, 1.0f }, true, false, true };
+    sIterationFormula sMandelbrot = Initiate_Formula();
+    vector< int > vIterations;
+    int iCores = (int)( thread::hardware_concurrency() );
+
+    if( !Parse_Bench_Arguments( argc, argv, sSettings ) )
+    {
+	fprintf( stderr, "Usage: %s [--size=N] [--iterations=N] [--min-time=SECONDS] [--json]\n", argv[ 0 ] );
+	return 1;
+    }
+
+    if( !sSettings.bJSON )
+	printf( "%d x %d points per workload, %d iterations max\n\n",
+		sSettings.iSize, sSettings.iSize, sSettings.iMax_Iterations );
+
+    for( int w = 0; w < iWORKLOAD_COUNT; ++w )
+    {
+	Bench_Kernel( sSettings, eKERNEL_REFERENCE, sMandelbrot, "reference", sWORKLOADS[ w ],
+		      vIterations );
+	Bench_Recursive( sSettings, sWORKLOADS[ w ], vIterations, sColor );
+	Bench_Kernel( sSettings, eKERNEL_SCALAR, sMandelbrot, "scalar", sWORKLOADS[ w ], vIterations );
+	Bench_Kernel( sSettings, eKERNEL_VECTOR, sMandelbrot, "vector", sWORKLOADS[ w ], vIterations );
+	Bench_Coloring( sSettings, sWORKLOADS[ w ], vIterations, sColor );
+	Bench_Encode( sSettings, sWORKLOADS[ w ], vIterations, sColor, 1 );
+
+	if( iCores > 1 )
+	    Bench_Encode( sSettings, sWORKLOADS[ w ], vIterations, sColor, iCores );
+    }
+
+    for( int f = 0; f < iFORMULA_WORKLOAD_COUNT; ++f )
+    {
+	const sFormulaWorkload &sFormulaWork = sFORMULA_WORKLOADS[ f ];
+
+	Bench_Kernel( sSettings, eKERNEL_SCALAR, sFormulaWork.sFormula, "scalar", sFormulaWork.sWork,
+		      vIterations );
+	Bench_Kernel( sSettings, eKERNEL_VECTOR, sFormulaWork.sFormula, "vector", sFormulaWork.sWork,
+		      vIterations );
+    }
+
+    Bench_Parse_Color( sSettings, "masked", sColor );
+    Bench_Parse_Color( sSettings, "grey", sGrey );
+
+    return 0;
+}
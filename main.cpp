@@ -9,8 +9,15 @@
 
 // INCLUDES
 #include "Mandelbrot.h"
+#include "Output.h"
+#include "Tune.h"
 #include "ioutil.h"
+#include <iomanip>
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
 
 // NAMESPACES
 using namespace std;
@@ -22,6 +29,14 @@ const int iMAX_DIMENSION_ITERATIONS = 5;
 
 // FUNCTION DECLARATIONS
 sColorCode Initiate_Color_Code( );
+bool Parse_Arguments( int argc,
+		      char *argv[],
+		      sRenderOptions &sOptions,
+		      bool &bCentered,
+		      bool &bAutotune,
+		      bool &bTuneKernel );
+const char *Get_Profile_File( int argc, char *argv[] );
+bool Autotune( const sRenderOptions &sOptions, const bool bTuneKernel, const char cProfileFile[] );
 int Get_Recursive_Int( const char cPrompt[], bool &bEOF, int iIteration = 0 );
 void Get_Color_Code( sColorCode &sColor, bool &bEOF );
 float Get_RGB_Mask( const char cPrompt[], bool &bEOF );
@@ -50,17 +65,51 @@ bool Get_Informed_Bool( const char cReadBoolPrompt[],
 //         dimensions are set, we call a function that will set up any color 
 //         filters from the user.  If we didn't hit an end of file, we create the
 //         image and exit the program once complete.
+//         Any render options (threads, tile size, progress reporting) are taken
+//         from the command line before we prompt the user, on top of the
+//         tile size and thread count of the tuning profile (if there is one
+//         for this host), and its kernel if it was tuned with
+//         --autotune=kernel.  --autotune writes that profile and exits
+//         without prompting.
 // Assumptions: We assume the user enters a proper file extension for the file name.
 ////////////////////////////////////////////////////////////////////////////////////
-int main( )
+int main( int argc, char *argv[] )
 {
     // Local Variables
     sColorCode sColor = Initiate_Color_Code( );
+    sRenderOptions sOptions = Initiate_Render_Options( );
     char cFileName[ iMAX_FILE_NAME_LENGTH ] = { };
     int iXDimension = 0;
     int iYDimension = 0;
     int iMax_Iterations = 100;
     bool bEOF = false;
+    bool bCentered = false;
+    bool bAutotune = false;
+    bool bTuneKernel = false;
+    const char *cpProfileFile = Get_Profile_File( argc, argv );
+    sTuningProfile sProfile;
+
+    // The profile only replaces the defaults (the kernel only if it was tuned);
+    // the command line still wins.
+    if( Load_Tuning_Profile( cpProfileFile, sProfile ) )
+    {
+	if( Is_Profile_Current( sProfile ) )
+	    Apply_Tuning_Profile( sProfile, sOptions );
+	else
+	    cerr << "The tuning profile '" << cpProfileFile << "' is for a host with "
+		 << sProfile.iHardwareThreads << " hardware threads and won't be used.  "
+		 << "Run with --autotune to tune for this one." << endl;
+    }
+
+    if( !Parse_Arguments( argc, argv, sOptions, bCentered, bAutotune, bTuneKernel ) )
+	return 1;
+
+    if( bAutotune )
+	return Autotune( sOptions, bTuneKernel, cpProfileFile ) ? 0 : 1;
+
+    // Standard output carries the image, so the console goes to stderr.
+    if( sOptions.bStdout )
+	cout.rdbuf( cerr.rdbuf() );
 
     Formatting;
 
@@ -83,6 +132,14 @@ int main( )
     iYDimension = Get_Recursive_Int( "Please enter the height of the image (must be > 0): ", bEOF );
     iMax_Iterations = Get_Recursive_Int( "Please enter the maximum iterations to use when determining if a pixel lies in the Mandelbrot Set (a good default is 100): ", bEOF );
 
+    // A centered view only gets its height once we know the shape of the image.
+    if( bCentered )
+	sOptions.sView = Get_Centered_Viewport( ( sOptions.sView.dXMin + sOptions.sView.dXMax ) / 2.0,
+						( sOptions.sView.dYMin + sOptions.sView.dYMax ) / 2.0,
+						sOptions.sView.dXMax - sOptions.sView.dXMin,
+						max( iXDimension, 1 ),
+						max( iYDimension, 1 ) );
+
     if( !bEOF )
 	Formatting;
 
@@ -98,7 +155,8 @@ int main( )
 		      iXDimension, 
 		      iYDimension, 
 		      iMax_Iterations, 
-		      sColor );
+		      sColor,
+		      sOptions );
 
     if( !bEOF )
 	Formatting;
@@ -126,6 +184,304 @@ sColorCode Initiate_Color_Code( )
     return sReturnValue;
 }
 
+// Description: Reads the render options off of the command line.
+// Method: Each argument is of the form --name=value.  We compare the start of
+//         each argument against the options we know about and parse the value
+//         that follows the '='.  Anything we don't recognize (or a value that
+//         doesn't make sense) prints the usage and fails.
+// Options: --view=XMIN,XMAX,YMIN,YMAX
+//                                   The area of the complex plane to draw.
+//          --center=X,Y,WIDTH       Draw WIDTH of the plane around X + Yi (the
+//                                   height follows the shape of the image).
+//          --threads=N              Number of worker threads (0 = automatic).
+//          --tile=N                 Width/height of the render tiles.
+//          --numa                   Pin the workers to the NUMA nodes and give
+//                                   each node its own band of tiles and memory.
+//          --kernel=reference|scalar|vector
+//                                   The escape time kernel to draw with.
+//          --power=N                Iterate z -> z^N + c (2 to
+//                                   iMAX_FORMULA_POWER).
+//          --burning-ship           Iterate the Burning Ship instead.
+//          --julia=RE,IM            Draw the Julia set of c = RE + IMi.
+//          --traversal=tiled|mirror|boundary
+//                                   Draw every pixel, mirror symmetric views
+//                                   or trace the boundaries of the tiles.
+//          --coloring=linear|smooth|histogram|distance
+//                                   Color by iterations / max iterations, by
+//                                   the continuous escape time, by histogram
+//                                   equalization or by the distance to the set.
+//          --buddhabrot=SAMPLES     Draw the orbit density of SAMPLES random
+//                                   points (e.g. 1e9) instead.
+//          --atlas=SIZE             Draw an atlas of SIZE pixel Julia set
+//                                   thumbnails, one per c of the view, instead.
+//          --mmap                   Map .ppm/.pam output files into memory and
+//                                   have the workers draw straight into them.
+//          --indexed                Write .png files as 8 bit palette indices.
+//          --stdout                 Write the image to standard output (the
+//                                   file name only picks the format) and the
+//                                   prompts to stderr.
+//          --frames=N               Draw N frames into a .y4m or .rgb video.
+//          --zoom=FACTOR            Scale the view by FACTOR from one frame to
+//                                   the next (e.g. 0.98 zooms in).
+//          --fps=N                  The frame rate of a .y4m video.
+//          --progress=bar|machine|none
+//                                   How progress is reported.  "machine"
+//                                   writes one JSON record per line to stderr.
+//          --stats=json|prometheus  Output the statistics of the render.
+//          --stats-file=FILE        Where to write the statistics (default:
+//                                   stderr).
+//          --trace=FILE             Trace the render and write the timeline to
+//                                   FILE as Chrome trace-event JSON.
+//          --autotune[=kernel]      Time the tile sizes and thread counts (and
+//                                   with =kernel, the kernels) on this host,
+//                                   save the fastest to the tuning profile and
+//                                   exit.
+//          --profile=FILE           The tuning profile to load (and save) instead
+//                                   of cDEFAULT_PROFILE_FILE.  Read by
+//                                   Get_Profile_File before the rest.
+// Parameters: argc, argv - The command line passed into main.
+//             sOptions - A reference to the options to fill in.
+//             bCentered - Set if the view was given with --center.  The view
+//                         then only holds the center and width until the caller
+//                         knows the size of the image.
+//             bAutotune - Set if --autotune was given.
+//             bTuneKernel - Set if it was --autotune=kernel.
+// Return Value: Returns false if the command line couldn't be parsed.
+////////////////////////////////////////////////////////////////////////////////////
+bool Parse_Arguments( int argc,
+		      char *argv[],
+		      sRenderOptions &sOptions,
+		      bool &bCentered,
+		      bool &bAutotune,
+		      bool &bTuneKernel )
+{
+    // Local Variables
+    bool bReturnValue = true;
+    double dX = 0.0, dY = 0.0, dSpan = 0.0;
+
+    for( int i = 1; ( i < argc ) && bReturnValue; ++i )
+    {
+	const char *cpArg = argv[ i ];
+
+	if( strncmp( cpArg, "--view=", 7 ) == 0 )
+	{
+	    sViewport &sView = sOptions.sView;
+
+	    bReturnValue = ( sscanf( cpArg + 7, "%lf,%lf,%lf,%lf",
+				     &sView.dXMin, &sView.dXMax, &sView.dYMin, &sView.dYMax ) == 4 ) &&
+		( sView.dXMin < sView.dXMax ) && ( sView.dYMin < sView.dYMax );
+	    bCentered = false;
+	}
+	else if( strncmp( cpArg, "--center=", 9 ) == 0 )
+	{
+	    bReturnValue = ( sscanf( cpArg + 9, "%lf,%lf,%lf", &dX, &dY, &dSpan ) == 3 ) && ( dSpan > 0.0 );
+	    sOptions.sView = Get_Centered_Viewport( dX, dY, dSpan, 1, 1 );
+	    bCentered = true;
+	}
+	else if( strncmp( cpArg, "--threads=", 10 ) == 0 )
+	{
+	    char *cpEnd = NULL;
+
+	    sOptions.iThreads = (int)( strtol( cpArg + 10, &cpEnd, 10 ) );
+	    bReturnValue = ( cpEnd != cpArg + 10 ) && ( *cpEnd == '\0' ) && ( sOptions.iThreads >= 0 );
+	}
+	else if( strncmp( cpArg, "--tile=", 7 ) == 0 )
+	{
+	    sOptions.iTileSize = atoi( cpArg + 7 );
+	    bReturnValue = ( sOptions.iTileSize > 0 );
+	}
+	else if( strcmp( cpArg, "--kernel=reference" ) == 0 )
+	    sOptions.eKernel = eKERNEL_REFERENCE;
+	else if( strcmp( cpArg, "--kernel=scalar" ) == 0 )
+	    sOptions.eKernel = eKERNEL_SCALAR;
+	else if( strcmp( cpArg, "--kernel=vector" ) == 0 )
+	    sOptions.eKernel = eKERNEL_VECTOR;
+	else if( strncmp( cpArg, "--power=", 8 ) == 0 )
+	{
+	    sOptions.sFormula.eType = eFORMULA_MULTIBROT;
+	    sOptions.sFormula.iPower = atoi( cpArg + 8 );
+	    bReturnValue = ( sOptions.sFormula.iPower >= 2 ) &&
+		( sOptions.sFormula.iPower <= iMAX_FORMULA_POWER );
+	}
+	else if( strcmp( cpArg, "--burning-ship" ) == 0 )
+	{
+	    sOptions.sFormula.eType = eFORMULA_BURNING_SHIP;
+	    sOptions.sFormula.iPower = 2;
+	}
+	else if( strncmp( cpArg, "--julia=", 8 ) == 0 )
+	{
+	    sOptions.sFormula.bJulia = true;
+	    bReturnValue = ( sscanf( cpArg + 8, "%lf,%lf", &sOptions.sFormula.dJuliaReal,
+				     &sOptions.sFormula.dJuliaImag ) == 2 );
+	}
+	else if( strcmp( cpArg, "--traversal=tiled" ) == 0 )
+	    sOptions.eTraversal = eTRAVERSAL_TILED;
+	else if( strcmp( cpArg, "--traversal=mirror" ) == 0 )
+	    sOptions.eTraversal = eTRAVERSAL_MIRROR;
+	else if( strcmp( cpArg, "--traversal=boundary" ) == 0 )
+	    sOptions.eTraversal = eTRAVERSAL_BOUNDARY;
+	else if( strcmp( cpArg, "--coloring=linear" ) == 0 )
+	    sOptions.eColoring = eCOLOR_LINEAR;
+	else if( strcmp( cpArg, "--coloring=smooth" ) == 0 )
+	    sOptions.eColoring = eCOLOR_SMOOTH;
+	else if( strcmp( cpArg, "--coloring=histogram" ) == 0 )
+	    sOptions.eColoring = eCOLOR_HISTOGRAM;
+	else if( strcmp( cpArg, "--coloring=distance" ) == 0 )
+	    sOptions.eColoring = eCOLOR_DISTANCE;
+	else if( strncmp( cpArg, "--buddhabrot=", 13 ) == 0 )
+	{
+	    char *cpEnd = NULL;
+
+	    sOptions.llOrbitSamples = (long long)( strtod( cpArg + 13, &cpEnd ) );
+	    bReturnValue = ( *cpEnd == '\0' ) && ( sOptions.llOrbitSamples > 0 );
+	}
+	else if( strncmp( cpArg, "--atlas=", 8 ) == 0 )
+	{
+	    sOptions.iAtlasSize = atoi( cpArg + 8 );
+	    bReturnValue = ( sOptions.iAtlasSize >= 2 );
+	}
+	else if( strcmp( cpArg, "--mmap" ) == 0 )
+	    sOptions.bMapped = true;
+	else if( strcmp( cpArg, "--numa" ) == 0 )
+	    sOptions.bNuma = true;
+	else if( strcmp( cpArg, "--indexed" ) == 0 )
+	    sOptions.bIndexed = true;
+	else if( strcmp( cpArg, "--stdout" ) == 0 )
+	    sOptions.bStdout = true;
+	else if( strncmp( cpArg, "--frames=", 9 ) == 0 )
+	{
+	    sOptions.iFrames = atoi( cpArg + 9 );
+	    bReturnValue = ( sOptions.iFrames > 0 );
+	}
+	else if( strncmp( cpArg, "--zoom=", 7 ) == 0 )
+	{
+	    sOptions.dFrameZoom = atof( cpArg + 7 );
+	    bReturnValue = ( sOptions.dFrameZoom > 0.0 );
+	}
+	else if( strncmp( cpArg, "--fps=", 6 ) == 0 )
+	{
+	    sOptions.iFrameRate = atoi( cpArg + 6 );
+	    bReturnValue = ( sOptions.iFrameRate > 0 );
+	}
+	else if( strcmp( cpArg, "--progress=bar" ) == 0 )
+	    sOptions.eProgress = ePROGRESS_BAR;
+	else if( strcmp( cpArg, "--progress=machine" ) == 0 )
+	    sOptions.eProgress = ePROGRESS_MACHINE;
+	else if( strcmp( cpArg, "--progress=none" ) == 0 )
+	    sOptions.eProgress = ePROGRESS_NONE;
+	else if( strcmp( cpArg, "--stats=json" ) == 0 )
+	    sOptions.eStats = eSTATS_JSON;
+	else if( strcmp( cpArg, "--stats=prometheus" ) == 0 )
+	    sOptions.eStats = eSTATS_PROMETHEUS;
+	else if( strncmp( cpArg, "--stats-file=", 13 ) == 0 )
+	    sOptions.cpStatsFile = cpArg + 13;
+	else if( strncmp( cpArg, "--trace=", 8 ) == 0 )
+	    sOptions.cpTraceFile = cpArg + 8;
+	else if( strcmp( cpArg, "--autotune" ) == 0 )
+	    bAutotune = true;
+	else if( strcmp( cpArg, "--autotune=kernel" ) == 0 )
+	    bAutotune = bTuneKernel = true;
+	else if( strncmp( cpArg, "--profile=", 10 ) == 0 )
+	    bReturnValue = ( cpArg[ 10 ] != '\0' );
+	else
+	    bReturnValue = false;
+
+	if( !bReturnValue )
+	{
+	    cerr << "I'm sorry, I don't understand '" << cpArg << "'." << endl;
+	    cerr << "Usage: " << argv[ 0 ] << " [--view=XMIN,XMAX,YMIN,YMAX | --center=X,Y,WIDTH]";
+	    cerr << " [--threads=N] [--tile=N] [--numa]";
+	    cerr << " [--kernel=reference|scalar|vector]";
+	    cerr << " [--power=N | --burning-ship] [--julia=RE,IM]";
+	    cerr << " [--traversal=tiled|mirror|boundary]";
+	    cerr << " [--coloring=linear|smooth|histogram|distance]";
+	    cerr << " [--buddhabrot=SAMPLES | --atlas=SIZE] [--mmap] [--indexed] [--stdout]";
+	    cerr << " [--frames=N] [--zoom=FACTOR] [--fps=N]";
+	    cerr << " [--progress=bar|machine|none]";
+	    cerr << " [--stats=json|prometheus] [--stats-file=FILE]";
+	    cerr << " [--trace=FILE] [--autotune[=kernel]] [--profile=FILE]" << endl;
+	}
+    }
+
+    return bReturnValue;
+}
+
+// Description: Finds the tuning profile named on the command line.  It has to
+//              be known before Parse_Arguments runs, so that the options
+//              given explicitly can override the profile's.
+// Parameters: argc, argv - The command line passed into main.
+// Return Value: Returns the file given with the last --profile, or
+//               cDEFAULT_PROFILE_FILE.
+////////////////////////////////////////////////////////////////////////////////////
+const char *Get_Profile_File( int argc, char *argv[] )
+{
+    // Local Variables
+    const char *cpReturnValue = cDEFAULT_PROFILE_FILE;
+
+    for( int i = 1; i < argc; ++i )
+	if( ( strncmp( argv[ i ], "--profile=", 10 ) == 0 ) && ( argv[ i ][ 10 ] != '\0' ) )
+	    cpReturnValue = argv[ i ] + 10;
+
+    return cpReturnValue;
+}
+
+// Description: Tunes the renderer for this host and saves the result.
+// Method: Run_Autotune times every configuration, which we list (fastest
+//         marked) before writing the fastest to the profile.
+// Parameters: sOptions - The render options (their formula, traversal and
+//                        --numa setting are tuned for, and their kernel unless
+//                        the kernels are tuned too).
+//             bTuneKernel - Tune the kernel as well.
+//             cProfileFile - The profile to write.
+// Return Value: Returns false if the profile couldn't be written.
+////////////////////////////////////////////////////////////////////////////////////
+bool Autotune( const sRenderOptions &sOptions, const bool bTuneKernel, const char cProfileFile[] )
+{
+    // Local Variables
+    vector< sTuningResult > vResults;
+    sTuningProfile sBest;
+
+    cout << "Timing the " << ( bTuneKernel ? "kernels, " : "" )
+	 << "tile sizes and thread counts on this host..." << endl << endl;
+    Run_Autotune( sOptions, bTuneKernel, vResults, sBest );
+
+    cout << "kernel     tile  threads   seconds" << endl;
+
+    for( size_t i = 0; i < vResults.size(); ++i )
+    {
+	// Local Variables
+	const sTuningProfile &sTried = vResults[ i ].sProfile;
+
+	cout << left << setw( 9 ) << Get_Kernel_Name( sTried.eKernel ) << right
+	     << setw( 6 ) << sTried.iTileSize << setw( 9 ) << sTried.iThreads
+	     << fixed << setprecision( 4 ) << setw( 10 ) << vResults[ i ].dSeconds;
+
+	if( ( sTried.eKernel == sBest.eKernel ) && ( sTried.iTileSize == sBest.iTileSize ) &&
+	    ( sTried.iThreads == sBest.iThreads ) )
+	    cout << "  <- fastest";
+
+	cout << endl;
+    }
+
+    cout << endl;
+
+    if( !Save_Tuning_Profile( cProfileFile, sBest ) )
+    {
+	cerr << "I'm sorry, the tuning profile couldn't be written to '" << cProfileFile << "'." << endl;
+	return false;
+    }
+
+    cout << "Saved ";
+
+    if( sBest.bKernel )
+	cout << "--kernel=" << Get_Kernel_Name( sBest.eKernel ) << " ";
+
+    cout << "--tile=" << sBest.iTileSize << " --threads=" << sBest.iThreads << " to '"
+	 << cProfileFile << "'." << endl;
+
+    return true;
+}
+
 // Description: This function handles all the logic for prompting the user and 
 //              setting the Color Filters for the image.
 // Method: If we encountered an End of File before entering this function then we
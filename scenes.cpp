@@ -0,0 +1,398 @@
+// Name: scenes.cpp
+// Description: End to end benchmarks of named reference scenes.  Each scene is
+//              rendered through Create_Image at several sizes and iteration
+//              budgets, and the wall time, peak memory and throughput of every
+//              run can be saved as a JSON baseline and compared against later.
+//              The scenes are drawn with the program's defaults (the
+//              reference kernel included) unless overridden.
+// Usage: SceneBench [--quick] [--repeat=N] [--threads=N]
+//                   [--kernel=reference|scalar|vector] [--out-dir=DIR]
+//                   [--save=FILE] [--compare=FILE] [--threshold=FRACTION]
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "Mandelbrot.h"
+#include "Output.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Namespaces
+using namespace std;
+
+// SCENE STRUCTURE
+// Parts: cpName - The name the scene is reported under.
+//        dCenterX, dCenterY - The point of the plane in the middle of the image.
+//        dSpanX - The width of the plane shown.
+//        iIterations[] - The iteration budgets the scene is run at.
+////////////////////////////////////////////////////////////////////////////////
+struct sScene
+{
+    const char *cpName;
+    double dCenterX;
+    double dCenterY;
+    double dSpanX;
+    int iIterations[ 2 ];
+};
+
+// RUN STRUCTURE
+// Parts: sKey - "scene/WIDTHxHEIGHT/ITERATIONS", used to match baselines.
+//        dWallSeconds - Best wall time of the render.
+//        lPeakRSSKB - Peak resident memory of the render (kilobytes).
+//        dMPixelsPerSecond - Throughput of the best run.
+////////////////////////////////////////////////////////////////////////////////
+struct sRun
+{
+    string sKey;
+    double dWallSeconds;
+    long lPeakRSSKB;
+    double dMPixelsPerSecond;
+};
+
+// CONSTANTS
+// full - The whole set.
+// seahorse - Seahorse Valley, between the main cardioid and the period 2 bulb.
+// elephant - Elephant Valley, on the positive real side of the main cardioid.
+// minibrot - A period 78 minibrot deep in Seahorse Valley (about 2e5 zoom).
+const sScene sSCENES[] =
+{
+    { "full", -0.75, 0.0, 3.5, { 256, 1024 } },
+    { "seahorse", -0.7453, 0.1127, 0.01, { 1000, 4000 } },
+    { "elephant", 0.2925, 0.0149, 0.02, { 1000, 4000 } },
+    { "minibrot", -0.74364417201296329, 0.13182539739503270, 2.0e-5, { 4000, 16000 } }
+};
+const int iSCENE_COUNT = sizeof( sSCENES ) / sizeof( sScene );
+
+const int iSIZES[][ 2 ] = { { 320, 240 }, { 1280, 960 } };
+const int iSIZE_COUNT = sizeof( iSIZES ) / sizeof( iSIZES[ 0 ] );
+
+// BENCH SETTINGS STRUCTURE
+// Parts: bQuick - Only run the smallest size and budget of each scene.
+//        iRepeat - Runs of each render; the fastest is kept.
+//        sOptions - The render options every scene is drawn with.
+//        sOutDir - Where the images are written.
+//        cpSave - File to save the results to as a baseline (or NULL).
+//        cpCompare - Baseline file to compare the results with (or NULL).
+//        dThreshold - Fraction a run may get slower (or bigger) before it is
+//                     flagged as a regression.
+////////////////////////////////////////////////////////////////////////////////
+struct sSceneSettings
+{
+    bool bQuick;
+    int iRepeat;
+    sRenderOptions sOptions;
+    string sOutDir;
+    const char *cpSave;
+    const char *cpCompare;
+    double dThreshold;
+};
+
+// Description: Renders one scene in a child process so its peak memory can be
+//              measured on its own.
+// Method: The child renders the image (with its console output thrown away)
+//         and sends its wall time back through a pipe.  The parent collects
+//         the child's peak resident set size from wait4.
+// Parameters: sSettings - The settings of the run.
+//             sScene - The scene to render.
+//             iWidth, iHeight - The size of the image.
+//             iIterations - The iteration budget.
+//             dSeconds - Set to the wall time of the render.
+//             lPeakRSSKB - Set to the peak resident memory of the render.
+// Return Value: Returns false if the child failed.
+////////////////////////////////////////////////////////////////////////////////
+bool Run_Scene( const sSceneSettings &sSettings,
+		const sScene &sScene,
+		const int iWidth,
+		const int iHeight,
+		const int iIterations,
+		double &dSeconds,
+		long &lPeakRSSKB )
+{
+    // Local Variables
+    int iPipe[ 2 ];
+    int iStatus = 0;
+    pid_t pid;
+    struct rusage sUsage;
+
+    if( pipe( iPipe ) != 0 )
+	return false;
+
+    fflush( stdout );
+    pid = fork();
+
+    if( pid == 0 )
+    {
+	// Child: render the scene and report back how long it took.
+	sRenderOptions sOptions = sSettings.sOptions;
+	sColorCode sColor = { { 1.0f, 0.6f, 0.3f }, true, false, false };
+	string sFile = sSettings.sOutDir + "/" + sScene.cpName + ".png";
+	vector< char > vFile( sFile.begin(), sFile.end() );
+	chrono::steady_clock::time_point tStart;
+
+	close( iPipe[ 0 ] );
+	if( freopen( "/dev/null", "w", stdout ) == NULL )
+	    _exit( 1 );
+
+	vFile.push_back( '\0' );
+	sOptions.sView = Get_Centered_Viewport( sScene.dCenterX, sScene.dCenterY, sScene.dSpanX,
+						iWidth, iHeight );
+
+	tStart = chrono::steady_clock::now();
+	Create_Image( &vFile[ 0 ], iWidth, iHeight, iIterations, sColor, sOptions );
+	dSeconds = chrono::duration< double >( chrono::steady_clock::now() - tStart ).count();
+
+	_exit( ( write( iPipe[ 1 ], &dSeconds, sizeof( dSeconds ) ) == sizeof( dSeconds ) ) ? 0 : 1 );
+    }
+
+    close( iPipe[ 1 ] );
+
+    if( ( pid < 0 ) ||
+	( read( iPipe[ 0 ], &dSeconds, sizeof( dSeconds ) ) != sizeof( dSeconds ) ) )
+    {
+	close( iPipe[ 0 ] );
+	if( pid > 0 )
+	    waitpid( pid, &iStatus, 0 );
+	return false;
+    }
+
+    close( iPipe[ 0 ] );
+
+    if( ( wait4( pid, &iStatus, 0, &sUsage ) != pid ) || !WIFEXITED( iStatus ) ||
+	( WEXITSTATUS( iStatus ) != 0 ) )
+	return false;
+
+    lPeakRSSKB = sUsage.ru_maxrss;
+    return true;
+}
+
+// Description: Writes the results out as a JSON baseline, one run per line so
+//              Load_Baseline can read it back without a full JSON parser.
+// Return Value: Returns false if the file couldn't be written.
+////////////////////////////////////////////////////////////////////////////////
+bool Save_Baseline( const char *cpFile, const vector< sRun > &vRuns )
+{
+    // Local Variables
+    FILE *pFile = fopen( cpFile, "w" );
+
+    if( pFile == NULL )
+	return false;
+
+    fprintf( pFile, "{\n  \"runs\": [\n" );
+
+    for( size_t i = 0; i < vRuns.size(); ++i )
+	fprintf( pFile, "    {\"key\":\"%s\",\"wall_seconds\":%.6f,\"peak_rss_kb\":%ld,"
+		 "\"mpixels_per_second\":%.4f}%s\n",
+		 vRuns[ i ].sKey.c_str(), vRuns[ i ].dWallSeconds, vRuns[ i ].lPeakRSSKB,
+		 vRuns[ i ].dMPixelsPerSecond, ( i + 1 < vRuns.size() ) ? "," : "" );
+
+    fprintf( pFile, "  ]\n}\n" );
+
+    return ( fclose( pFile ) == 0 );
+}
+
+// Description: Reads a baseline written by Save_Baseline.
+// Return Value: Returns false if the file couldn't be read.
+////////////////////////////////////////////////////////////////////////////////
+bool Load_Baseline( const char *cpFile, vector< sRun > &vRuns )
+{
+    // Local Variables
+    FILE *pFile = fopen( cpFile, "r" );
+    char cLine[ 512 ];
+    char cKey[ 128 ];
+    sRun sEntry;
+
+    if( pFile == NULL )
+	return false;
+
+    while( fgets( cLine, sizeof( cLine ), pFile ) != NULL )
+    {
+	const char *cpRun = strstr( cLine, "{\"key\":\"" );
+
+	if( ( cpRun != NULL ) &&
+	    ( sscanf( cpRun, "{\"key\":\"%127[^\"]\",\"wall_seconds\":%lf,\"peak_rss_kb\":%ld,"
+		      "\"mpixels_per_second\":%lf",
+		      cKey, &sEntry.dWallSeconds, &sEntry.lPeakRSSKB,
+		      &sEntry.dMPixelsPerSecond ) == 4 ) )
+	{
+	    sEntry.sKey = cKey;
+	    vRuns.push_back( sEntry );
+	}
+    }
+
+    fclose( pFile );
+    return true;
+}
+
+// Description: Compares the results against a baseline and prints a line for
+//              every run that got slower, or used more memory, by more than
+//              the threshold.
+// Return Value: Returns the number of regressions found.
+////////////////////////////////////////////////////////////////////////////////
+int Compare_Baseline( const vector< sRun > &vRuns,
+		      const vector< sRun > &vBaseline,
+		      const double dThreshold )
+{
+    // Local Variables
+    int iRegressions = 0;
+
+    printf( "\nCompared with the baseline (threshold %.0f%%):\n", dThreshold * 100.0 );
+
+    for( size_t i = 0; i < vRuns.size(); ++i )
+    {
+	for( size_t b = 0; b < vBaseline.size(); ++b )
+	{
+	    if( vBaseline[ b ].sKey != vRuns[ i ].sKey )
+		continue;
+
+	    double dTime = vRuns[ i ].dWallSeconds / vBaseline[ b ].dWallSeconds - 1.0;
+	    double dRSS = (double)vRuns[ i ].lPeakRSSKB / (double)vBaseline[ b ].lPeakRSSKB - 1.0;
+	    bool bSlower = ( dTime > dThreshold );
+	    bool bBigger = ( dRSS > dThreshold );
+
+	    printf( "%-28s time %+7.1f%%  rss %+7.1f%%  %s\n", vRuns[ i ].sKey.c_str(),
+		    dTime * 100.0, dRSS * 100.0,
+		    ( bSlower || bBigger ) ? "REGRESSION" : "ok" );
+
+	    if( bSlower || bBigger )
+		++iRegressions;
+	}
+    }
+
+    return iRegressions;
+}
+
+// Description: Reads the settings off of the command line.
+// Return Value: Returns false if the command line couldn't be parsed.
+////////////////////////////////////////////////////////////////////////////////
+bool Parse_Scene_Arguments( int argc, char *argv[], sSceneSettings &sSettings )
+{
+    for( int i = 1; i < argc; ++i )
+    {
+	const char *cpArg = argv[ i ];
+
+	if( strcmp( cpArg, "--quick" ) == 0 )
+	    sSettings.bQuick = true;
+	else if( strncmp( cpArg, "--repeat=", 9 ) == 0 )
+	    sSettings.iRepeat = max( atoi( cpArg + 9 ), 1 );
+	else if( strncmp( cpArg, "--threads=", 10 ) == 0 )
+	    sSettings.sOptions.iThreads = atoi( cpArg + 10 );
+	else if( strcmp( cpArg, "--kernel=reference" ) == 0 )
+	    sSettings.sOptions.eKernel = eKERNEL_REFERENCE;
+	else if( strcmp( cpArg, "--kernel=scalar" ) == 0 )
+	    sSettings.sOptions.eKernel = eKERNEL_SCALAR;
+	else if( strcmp( cpArg, "--kernel=vector" ) == 0 )
+	    sSettings.sOptions.eKernel = eKERNEL_VECTOR;
+	else if( strncmp( cpArg, "--out-dir=", 10 ) == 0 )
+	    sSettings.sOutDir = cpArg + 10;
+	else if( strncmp( cpArg, "--save=", 7 ) == 0 )
+	    sSettings.cpSave = cpArg + 7;
+	else if( strncmp( cpArg, "--compare=", 10 ) == 0 )
+	    sSettings.cpCompare = cpArg + 10;
+	else if( strncmp( cpArg, "--threshold=", 12 ) == 0 )
+	    sSettings.dThreshold = atof( cpArg + 12 );
+	else
+	    return false;
+    }
+
+    return true;
+}
+
+// Description: Runs every scene at every size and budget, then saves and/or
+//              compares the results.  Exits with 2 if there were regressions.
+////////////////////////////////////////////////////////////////////////////////
+int main( int argc, char *argv[] )
+{
+    // Local Variables
+    sSceneSettings sSettings;
+    vector< sRun > vRuns;
+    vector< sRun > vBaseline;
+    int iRegressions = 0;
+
+    sSettings.bQuick = false;
+    sSettings.iRepeat = 1;
+    sSettings.sOptions = Initiate_Render_Options();
+    sSettings.sOptions.eProgress = ePROGRESS_NONE;
+    sSettings.sOutDir = "/tmp";
+    sSettings.cpSave = NULL;
+    sSettings.cpCompare = NULL;
+    sSettings.dThreshold = 0.10;
+
+    if( !Parse_Scene_Arguments( argc, argv, sSettings ) )
+    {
+	fprintf( stderr, "Usage: %s [--quick] [--repeat=N] [--threads=N] "
+		 "[--kernel=reference|scalar|vector] [--out-dir=DIR] [--save=FILE] "
+		 "[--compare=FILE] [--threshold=FRACTION]\n", argv[ 0 ] );
+	return 1;
+    }
+
+    printf( "%-28s %10s %12s %12s\n", "scene/size/iterations", "wall (s)", "peak RSS (KB)", "Mpixel/s" );
+
+    for( int s = 0; s < iSCENE_COUNT; ++s )
+    {
+	for( int z = 0; z < ( sSettings.bQuick ? 1 : iSIZE_COUNT ); ++z )
+	{
+	    for( int b = 0; b < ( sSettings.bQuick ? 1 : 2 ); ++b )
+	    {
+		// Local Variables
+		const int iWidth = iSIZES[ z ][ 0 ];
+		const int iHeight = iSIZES[ z ][ 1 ];
+		const int iIterations = sSCENES[ s ].iIterations[ b ];
+		char cKey[ 128 ];
+		sRun sBest;
+
+		snprintf( cKey, sizeof( cKey ), "%s/%dx%d/%d", sSCENES[ s ].cpName,
+			  iWidth, iHeight, iIterations );
+		sBest.sKey = cKey;
+		sBest.dWallSeconds = -1.0;
+		sBest.lPeakRSSKB = 0;
+
+		for( int r = 0; r < sSettings.iRepeat; ++r )
+		{
+		    double dSeconds = 0.0;
+		    long lPeakRSSKB = 0;
+
+		    if( !Run_Scene( sSettings, sSCENES[ s ], iWidth, iHeight, iIterations,
+				    dSeconds, lPeakRSSKB ) )
+		    {
+			fprintf( stderr, "Rendering %s failed.\n", cKey );
+			return 1;
+		    }
+
+		    if( ( sBest.dWallSeconds < 0.0 ) || ( dSeconds < sBest.dWallSeconds ) )
+			sBest.dWallSeconds = dSeconds;
+
+		    sBest.lPeakRSSKB = max( sBest.lPeakRSSKB, lPeakRSSKB );
+		}
+
+		sBest.dMPixelsPerSecond = (double)( iWidth ) * iHeight / sBest.dWallSeconds / 1.0e6;
+		vRuns.push_back( sBest );
+
+		printf( "%-28s %10.3f %12ld %12.3f\n", cKey, sBest.dWallSeconds,
+			sBest.lPeakRSSKB, sBest.dMPixelsPerSecond );
+	    }
+	}
+    }
+
+    if( ( sSettings.cpSave != NULL ) && !Save_Baseline( sSettings.cpSave, vRuns ) )
+	fprintf( stderr, "Unable to save the baseline to '%s'.\n", sSettings.cpSave );
+
+    if( sSettings.cpCompare != NULL )
+    {
+	if( !Load_Baseline( sSettings.cpCompare, vBaseline ) )
+	{
+	    fprintf( stderr, "Unable to read the baseline '%s'.\n", sSettings.cpCompare );
+	    return 1;
+	}
+
+	iRegressions = Compare_Baseline( vRuns, vBaseline, sSettings.dThreshold );
+    }
+
+    return ( iRegressions > 0 ) ? 2 : 0;
+}
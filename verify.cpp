@@ -0,0 +1,1504 @@
+// Name: verify.cpp
+// Description: Golden image equivalence checks for the optimized kernels and
+//              traversals.  A fixed corpus of viewports (and, optionally, a
+//              number of random ones) is drawn through every kernel and
+//              traversal, and each iteration field is compared with the field
+//              of the path it is meant to reproduce.  The reference field of
+//              the Mandelbrot set is itself checked pixel for pixel against
+//              the original recursive Get_Pixel_Color.  Histogram equalized
+//              images must not depend on the thread count and must match an
+//              equalization done on one thread, and distance shaded images
+//              must not change when boxes far from the set are filled in
+//              rather than drawn.  The embeddable
+//              renderer is checked against the same fields, drawing into
+//              padded buffers on a shared pool, along with its progressive
+//              render and cancellation.  Each thumbnail of a Julia atlas
+//              is checked against the Julia set of its c drawn on its own, a
+//              Buddhabrot density must not depend on the thread count or on
+//              the workers sharing density buffers, PNG files written in
+//              blocks on several threads must inflate to the rows written,
+//              videos (Y4M and raw RGB) must read back as the frames written,
+//              images drawn into mapped PPM and PAM files must match the
+//              render in memory, and the autotuner's profile file is read back
+//              as written.
+// Usage: Verify [--fuzz=N] [--seed=N] [--verbose]
+////////////////////////////////////////////////////////////////////////////////
+
+// INCLUDES
+#include "Atlas.h"
+#include "Buddhabrot.h"
+#include "Color.h"
+#include "Encoder.h"
+#include "Output.h"
+#include "Renderer.h"
+#include "Tune.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Namespaces
+using namespace std;
+
+// CASE STRUCTURE
+// Parts: sName - The name the case is reported under.
+//        sView - The area of the complex plane drawn.
+//        sFormula - The formula iterated.
+//        iWidth, iHeight - The size of the image.
+//        iMax_Iterations - The escape time limit.
+//        iTileSize - The tile size the modes are drawn with.
+//        iThreads - The worker threads the modes are drawn with.
+////////////////////////////////////////////////////////////////////////////////
+struct sCase
+{
+    string sName;
+    sViewport sView;
+    sIterationFormula sFormula;
+    int iWidth;
+    int iHeight;
+    int iMax_Iterations;
+    int iTileSize;
+    int iThreads;
+};
+
+// MODE STRUCTURE
+// Parts: cpName - The name the mode is reported under.
+//        eKernel, eTraversal - The path being checked.
+//        iBaseline - The mode whose field this one is compared with.  Modes
+//                    are listed so the baseline is always drawn first.
+//        dMaxMismatch - The fraction of pixels allowed to differ.
+//        dMaxMeanDelta - The allowed mean iteration difference per pixel.
+//        dMinSpan - Only checked on views at least this wide (0 = always).
+////////////////////////////////////////////////////////////////////////////////
+struct sMode
+{
+    const char *cpName;
+    eKernelType eKernel;
+    eTraversalType eTraversal;
+    int iBaseline;
+    double dMaxMismatch;
+    double dMaxMeanDelta;
+    double dMinSpan;
+};
+
+// RESULT STRUCTURE
+// Parts: dMismatch - The fraction of pixels that differ.
+//        dMeanDelta - The mean absolute iteration difference per pixel.
+//        iMaxDelta - The largest absolute iteration difference.
+////////////////////////////////////////////////////////////////////////////////
+struct sResult
+{
+    double dMismatch;
+    double dMeanDelta;
+    int iMaxDelta;
+};
+
+// CONSTANTS
+// The reference kernel traversals must match the tiled reference field.  The
+// double precision kernels are compared with the scalar field, which in turn is
+// compared loosely with the float reference on shallow views (deeper in, float
+// round off is amplified by the iteration and the two drift apart).
+// Mirroring moves the imaginary part of c by a rounding error and tracing only
+// misses detail finer than a pixel, so both get a little room.
+const sMode sMODES[] =
+{
+    { "reference/tiled", eKERNEL_REFERENCE, eTRAVERSAL_TILED, -1, 0.0, 0.0, 0.0 },
+    { "reference/mirror", eKERNEL_REFERENCE, eTRAVERSAL_MIRROR, 0, 0.01, 0.5, 0.0 },
+    { "reference/boundary", eKERNEL_REFERENCE, eTRAVERSAL_BOUNDARY, 0, 0.005, 0.5, 0.0 },
+    { "scalar/tiled", eKERNEL_SCALAR, eTRAVERSAL_TILED, 0, 0.05, 2.0, 0.25 },
+    { "scalar/mirror", eKERNEL_SCALAR, eTRAVERSAL_MIRROR, 3, 0.01, 0.5, 0.0 },
+    { "scalar/boundary", eKERNEL_SCALAR, eTRAVERSAL_BOUNDARY, 3, 0.005, 0.5, 0.0 },
+    { "vector/tiled", eKERNEL_VECTOR, eTRAVERSAL_TILED, 3, 0.001, 0.05, 0.0 },
+    { "vector/mirror", eKERNEL_VECTOR, eTRAVERSAL_MIRROR, 3, 0.01, 0.5, 0.0 },
+    { "vector/boundary", eKERNEL_VECTOR, eTRAVERSAL_BOUNDARY, 3, 0.005, 0.5, 0.0 }
+};
+const int iMODE_COUNT = sizeof( sMODES ) / sizeof( sMode );
+
+// The recursive Get_Pixel_Color is only checked up to this iteration limit
+// (it recurses once per iteration) and on every iRECURSIVE_STEP'th pixel.
+const int iRECURSIVE_MAX_ITERATIONS = 2000;
+const int iRECURSIVE_STEP = 3;
+
+// Description: Builds a case around a point of the complex plane.
+////////////////////////////////////////////////////////////////////////////////
+sCase Make_Case( const char *cpName,
+		 const double dCenterX,
+		 const double dCenterY,
+		 const double dSpanX,
+		 const int iWidth,
+		 const int iHeight,
+		 const int iMax_Iterations,
+		 const int iTileSize,
+		 const int iThreads )
+{
+    sCase sReturnValue;
+
+    sReturnValue.sName = cpName;
+    sReturnValue.sView = Get_Centered_Viewport( dCenterX, dCenterY, dSpanX, iWidth, iHeight );
+    sReturnValue.sFormula = Initiate_Formula();
+    sReturnValue.iWidth = iWidth;
+    sReturnValue.iHeight = iHeight;
+    sReturnValue.iMax_Iterations = iMax_Iterations;
+    sReturnValue.iTileSize = iTileSize;
+    sReturnValue.iThreads = iThreads;
+
+    return sReturnValue;
+}
+
+// Description: Builds the fixed corpus of viewports: the default view of the
+//              whole set, the usual deep zoom targets, the inside of the main
+//              cardioid, a symmetric zoom on the real axis, an odd sized
+//              image with odd tiles and one case for each of the other
+//              formulas.
+////////////////////////////////////////////////////////////////////////////////
+vector< sCase > Build_Corpus( )
+{
+    // Local Variables
+    vector< sCase > vCorpus;
+    sCase sDefault;
+
+    sDefault.sName = "default";
+    sDefault.sView = Initiate_Viewport();
+    sDefault.sFormula = Initiate_Formula();
+    sDefault.iWidth = 240;
+    sDefault.iHeight = 160;
+    sDefault.iMax_Iterations = 256;
+    sDefault.iTileSize = 64;
+    sDefault.iThreads = 0;
+    vCorpus.push_back( sDefault );
+
+    vCorpus.push_back( Make_Case( "full", -0.75, 0.0, 3.5, 200, 150, 1000, 16, 0 ) );
+    vCorpus.push_back( Make_Case( "seahorse", -0.7453, 0.1127, 0.01, 200, 150, 1000, 32, 2 ) );
+    vCorpus.push_back( Make_Case( "elephant", 0.2925, 0.0149, 0.02, 200, 150, 1000, 64, 3 ) );
+    vCorpus.push_back( Make_Case( "minibrot", -0.74364417201296329, 0.13182539739503270, 2.0e-5,
+				  160, 120, 4000, 64, 0 ) );
+    vCorpus.push_back( Make_Case( "cardioid", -0.3, 0.0, 0.4, 120, 120, 1000, 64, 0 ) );
+    vCorpus.push_back( Make_Case( "real-axis", -1.25, 0.0, 0.5, 200, 101, 1000, 32, 0 ) );
+    vCorpus.push_back( Make_Case( "odd", -0.75, 0.0, 3.0, 97, 61, 300, 7, 4 ) );
+
+    vCorpus.push_back( Make_Case( "cubic", -0.2, 0.0, 3.0, 200, 150, 500, 32, 0 ) );
+    vCorpus.back().sFormula.iPower = 3;
+    vCorpus.push_back( Make_Case( "power-8", 0.0, 0.0, 3.0, 160, 160, 500, 32, 0 ) );
+    vCorpus.back().sFormula.iPower = 8;
+    vCorpus.push_back( Make_Case( "julia", 0.0, 0.0, 3.2, 200, 150, 1000, 32, 0 ) );
+    vCorpus.back().sFormula.bJulia = true;
+    vCorpus.back().sFormula.dJuliaReal = -0.8;
+    vCorpus.back().sFormula.dJuliaImag = 0.156;
+    vCorpus.push_back( Make_Case( "burning-ship", -1.75, -0.035, 0.12, 200, 150, 1000, 32, 0 ) );
+    vCorpus.back().sFormula.eType = eFORMULA_BURNING_SHIP;
+
+    return vCorpus;
+}
+
+// Description: Builds a random case.  Half of them are centered on the real
+//              axis so the mirror traversal has something to do.
+////////////////////////////////////////////////////////////////////////////////
+sCase Build_Random_Case( mt19937 &mtRandom, const int iIndex )
+{
+    // Local Variables
+    uniform_real_distribution< double > dCenterX( -2.0, 0.5 );
+    uniform_real_distribution< double > dCenterY( -1.2, 1.2 );
+    uniform_real_distribution< double > dZoom( -5.0, 0.5 );
+    uniform_int_distribution< int > iSize( 16, 160 );
+    uniform_int_distribution< int > iIterations( 32, 2000 );
+    uniform_int_distribution< int > iTileSize( 1, 64 );
+    uniform_int_distribution< int > iThreads( 1, 4 );
+    char cName[ 32 ];
+    double dX = dCenterX( mtRandom );
+    double dY = ( iIndex % 2 == 0 ) ? 0.0 : dCenterY( mtRandom );
+    double dSpan = pow( 10.0, dZoom( mtRandom ) );
+    int iWidth = iSize( mtRandom );
+    int iHeight = iSize( mtRandom );
+    int iMax_Iterations = iIterations( mtRandom );
+    int iTile = iTileSize( mtRandom );
+
+    snprintf( cName, sizeof( cName ), "fuzz-%d", iIndex );
+
+    return Make_Case( cName, dX, dY, dSpan, iWidth, iHeight, iMax_Iterations, iTile,
+		      iThreads( mtRandom ) );
+}
+
+// Description: Compares two iteration fields.
+////////////////////////////////////////////////////////////////////////////////
+sResult Compare_Fields( const vector< int > &vField, const vector< int > &vBaseline )
+{
+    // Local Variables
+    sResult sReturnValue = { 0.0, 0.0, 0 };
+    long long llMismatched = 0;
+    long long llDelta = 0;
+
+    for( size_t i = 0; i < vField.size(); ++i )
+    {
+	int iDelta = abs( vField[ i ] - vBaseline[ i ] );
+
+	if( iDelta != 0 )
+	    ++llMismatched;
+
+	llDelta += iDelta;
+	sReturnValue.iMaxDelta = max( sReturnValue.iMaxDelta, iDelta );
+    }
+
+    sReturnValue.dMismatch = (double)( llMismatched ) / (double)( vField.size() );
+    sReturnValue.dMeanDelta = (double)( llDelta ) / (double)( vField.size() );
+
+    return sReturnValue;
+}
+
+// Description: Checks the reference field against the original recursive
+//              Get_Pixel_Color, using a grey scale so the color is a direct
+//              function of the number of iterations.
+// Return Value: Returns the number of sampled pixels whose colors differ.
+////////////////////////////////////////////////////////////////////////////////
+int Check_Recursive( const sCase &sTest, const vector< int > &vReference )
+{
+    // Local Variables
+    const sColorCode sGrey = { { 1.0f, 1.0f, 1.0f }, false, false, true };
+    const float fMaxX = (float)( sTest.iWidth );
+    const float fMaxY = (float)( sTest.iHeight );
+    const float fXMin = (float)( sTest.sView.dXMin );
+    const float fXMax = (float)( sTest.sView.dXMax );
+    const float fYMin = (float)( sTest.sView.dYMin );
+    const float fYMax = (float)( sTest.sView.dYMax );
+    int iDiffering = 0;
+
+    for( int y = 0; y < sTest.iHeight; y += iRECURSIVE_STEP )
+    {
+	for( int x = 0; x < sTest.iWidth; x += iRECURSIVE_STEP )
+	{
+	    complex< float > c( ( fXMin + (float)( x ) / ( fMaxX - 1.0f ) * ( fXMax - fXMin ) ),
+				( fYMin + (float)( y ) / ( fMaxY - 1.0f ) * ( fYMax - fYMin ) ) );
+	    sPixelColor cRecursive = Get_Pixel_Color( c, complex< float >( 0.0f, 0.0f ), 0,
+						      sTest.iMax_Iterations, sGrey );
+	    sPixelColor cField = Get_Iteration_Color( vReference[ (size_t)( y ) * sTest.iWidth + x ],
+						      sTest.iMax_Iterations, sGrey );
+
+	    if( ( cRecursive.dRed != cField.dRed ) || ( cRecursive.dGreen != cField.dGreen ) ||
+		( cRecursive.dBlue != cField.dBlue ) )
+		++iDiffering;
+	}
+    }
+
+    return iDiffering;
+}
+
+// Description: Returns the render options of a case: its view, formula, tile
+//              size and threads, drawn by the vector kernel with linear
+//              coloring and nothing reported or written.
+////////////////////////////////////////////////////////////////////////////////
+sRenderOptions Get_Case_Options( const sCase &sTest )
+{
+    sRenderOptions sReturnValue = Initiate_Render_Options();
+
+    sReturnValue.sView = sTest.sView;
+    sReturnValue.iThreads = sTest.iThreads;
+    sReturnValue.iTileSize = sTest.iTileSize;
+    sReturnValue.eKernel = eKERNEL_VECTOR;
+    sReturnValue.sFormula = sTest.sFormula;
+    sReturnValue.eProgress = ePROGRESS_NONE;
+
+    return sReturnValue;
+}
+
+// Description: Draws a case through every mode and checks each field against
+//              its baseline.
+// Parameters: sTest - The case.
+//             bVerbose - Print every comparison, not just the failures.
+//             vWorst - The worst result seen for each mode so far.
+// Return Value: Returns the number of failed checks.
+////////////////////////////////////////////////////////////////////////////////
+int Verify_Case( const sCase &sTest, const bool bVerbose, vector< sResult > &vWorst )
+{
+    // Local Variables
+    vector< vector< int > > vFields( iMODE_COUNT );
+    sRenderOptions sOptions = Get_Case_Options( sTest );
+    int iFailures = 0;
+
+    for( int m = 0; m < iMODE_COUNT; ++m )
+    {
+	const sMode &sMode = sMODES[ m ];
+
+	// The baselines are drawn the plain way on a single thread.
+	sOptions.eKernel = sMode.eKernel;
+	sOptions.eTraversal = sMode.eTraversal;
+	sOptions.iThreads = ( sMode.iBaseline < 0 ) ? 1 : sTest.iThreads;
+	Render_Iterations( sTest.iWidth, sTest.iHeight, sTest.iMax_Iterations, sOptions, vFields[ m ] );
+
+	if( sMode.iBaseline < 0 )
+	{
+	    int iDiffering = 0;
+	    bool bChecked = ( sTest.iMax_Iterations <= iRECURSIVE_MAX_ITERATIONS ) &&
+		Is_Classic_Formula( sTest.sFormula );
+
+	    if( bChecked )
+		iDiffering = Check_Recursive( sTest, vFields[ m ] );
+
+	    if( ( bVerbose && bChecked ) || ( iDiffering > 0 ) )
+		printf( "%-12s %-20s %d sampled pixels differ from Get_Pixel_Color %s\n",
+			sTest.sName.c_str(), sMode.cpName, iDiffering,
+			( iDiffering > 0 ) ? "FAIL" : "ok" );
+
+	    if( iDiffering > 0 )
+		++iFailures;
+
+	    continue;
+	}
+
+	if( sTest.sView.dXMax - sTest.sView.dXMin < sMode.dMinSpan )
+	    continue;
+
+	sResult sCompared = Compare_Fields( vFields[ m ], vFields[ sMode.iBaseline ] );
+	bool bPassed = ( sCompared.dMismatch <= sMode.dMaxMismatch ) &&
+	    ( sCompared.dMeanDelta <= sMode.dMaxMeanDelta );
+
+	vWorst[ m ].dMismatch = max( vWorst[ m ].dMismatch, sCompared.dMismatch );
+	vWorst[ m ].dMeanDelta = max( vWorst[ m ].dMeanDelta, sCompared.dMeanDelta );
+	vWorst[ m ].iMaxDelta = max( vWorst[ m ].iMaxDelta, sCompared.iMaxDelta );
+
+	if( bVerbose || !bPassed )
+	    printf( "%-12s %-20s vs %-16s %8.4f%% differ, mean delta %.4f, max delta %d %s\n",
+		    sTest.sName.c_str(), sMode.cpName, sMODES[ sMode.iBaseline ].cpName,
+		    sCompared.dMismatch * 100.0, sCompared.dMeanDelta, sCompared.iMaxDelta,
+		    bPassed ? "ok" : "FAIL" );
+
+	if( !bPassed )
+	{
+	    printf( "             reproduce with --view=%.17g,%.17g,%.17g,%.17g --tile=%d --threads=%d"
+		    " (%dx%d, %d iterations)\n",
+		    sTest.sView.dXMin, sTest.sView.dXMax, sTest.sView.dYMin, sTest.sView.dYMax,
+		    sTest.iTileSize, sTest.iThreads, sTest.iWidth, sTest.iHeight,
+		    sTest.iMax_Iterations );
+	    ++iFailures;
+	}
+    }
+
+    return iFailures;
+}
+
+// Description: Turns a color channel (0 to 1) into an 8 bit sample, the way
+//              the renderer does.
+////////////////////////////////////////////////////////////////////////////////
+unsigned char Get_Sample( const double dChannel )
+{
+    if( !( dChannel > 0.0 ) )
+	return 0;
+
+    if( dChannel >= 1.0 )
+	return 255;
+
+    return (unsigned char)( dChannel * 255.0 + 0.5 );
+}
+
+// Description: Checks histogram equalized coloring on a case.  The image must
+//              be the same byte for byte on 1, 2, 3 and 7 threads (the bins
+//              are counted per worker and added up by a parallel prefix sum
+//              over as many chunks as there are workers), and must match the
+//              image colored here from a cumulative histogram built on one
+//              thread out of the vector kernel's counts and escape times.
+// Parameters: sTest - The case.
+// Return Value: Returns the number of failed checks.
+////////////////////////////////////////////////////////////////////////////////
+int Verify_Histogram( const sCase &sTest )
+{
+    // Local Variables
+    const int iTHREADS[] = { 1, 2, 3, 7 };
+    const int iTHREAD_COUNTS = sizeof( iTHREADS ) / sizeof( int );
+    const int iMax = sTest.iMax_Iterations;
+    const size_t iBytes = (size_t)( sTest.iWidth ) * sTest.iHeight * 3;
+    const sColorCode sColor = { { 1.0f, 1.0f, 1.0f }, false, false, false };
+    sRenderOptions sOptions = Get_Case_Options( sTest );
+    vector< unsigned char > vFirst( iBytes );
+    vector< unsigned char > vRGB( iBytes );
+    vector< unsigned char > vExpected( iBytes );
+    vector< int > vIterations( (size_t)( sTest.iWidth ) * sTest.iHeight );
+    vector< float > vSmooth( vIterations.size() );
+    vector< double > vCReal( sTest.iWidth );
+    vector< long long > vBins( iMax + 1, 0 );
+    vector< float > vCDF( iMax + 1, 1.0f );
+    long long llEscaped = 0;
+    long long llRunning = 0;
+    int iThreadMismatches = 0;
+    int iMismatches = 0;
+
+    sOptions.eColoring = eCOLOR_HISTOGRAM;
+
+    for( int t = 0; t < iTHREAD_COUNTS; ++t )
+    {
+	// Local Variables
+	sRaster sTarget = { ( t == 0 ) ? &vFirst[ 0 ] : &vRGB[ 0 ], (size_t)( sTest.iWidth ) * 3, 3 };
+
+	sOptions.iThreads = iTHREADS[ t ];
+	Render_Raster( sTest.iWidth, sTest.iHeight, iMax, sColor, sOptions, sTarget, NULL );
+
+	if( ( t > 0 ) && ( vRGB != vFirst ) )
+	{
+	    printf( "%-12s histogram            %d threads differ from 1 thread FAIL\n",
+		    sTest.sName.c_str(), iTHREADS[ t ] );
+	    ++iThreadMismatches;
+	}
+    }
+
+    // The counts and escape times, row by row as the tiles draw them.
+    for( int x = 0; x < sTest.iWidth; ++x )
+	vCReal[ x ] = sTest.sView.dXMin + (double)( x ) / (double)( sTest.iWidth - 1 ) *
+	    ( sTest.sView.dXMax - sTest.sView.dXMin );
+
+    for( int y = 0; y < sTest.iHeight; ++y )
+    {
+	// Local Variables
+	const size_t iRow = (size_t)( y ) * sTest.iWidth;
+	const double dCImag = sTest.sView.dYMin + (double)( y ) / (double)( sTest.iHeight - 1 ) *
+	    ( sTest.sView.dYMax - sTest.sView.dYMin );
+
+	Get_Escape_Row( eKERNEL_VECTOR, sTest.sFormula, &vCReal[ 0 ], dCImag, sTest.iWidth, iMax,
+			&vIterations[ iRow ], &vSmooth[ iRow ], NULL );
+    }
+
+    for( size_t i = 0; i < vIterations.size(); ++i )
+	++vBins[ vIterations[ i ] ];
+
+    for( int k = 0; k < iMax; ++k )
+	llEscaped += vBins[ k ];
+
+    for( int k = 0; k < iMax; ++k )
+    {
+	llRunning += vBins[ k ];
+	vCDF[ k ] = ( llEscaped > 0 ) ? (float)( (double)( llRunning ) / (double)( llEscaped ) ) : 1.0f;
+    }
+
+    for( size_t i = 0; i < vIterations.size(); ++i )
+    {
+	// Local Variables
+	float fWeight = 1.0f;
+	sPixelColor cColor;
+
+	if( vIterations[ i ] < iMax )
+	{
+	    // Local Variables
+	    const float fSmooth = min( max( vSmooth[ i ], 0.0f ), (float)( iMax - 1 ) );
+	    const float fFraction = fSmooth - floor( fSmooth );
+
+	    fWeight = vCDF[ (int)( fSmooth ) ] * ( 1.0f - fFraction ) +
+		vCDF[ (int)( fSmooth ) + 1 ] * fFraction;
+	}
+
+	cColor = Parse_Color( fWeight, sColor );
+
+	vExpected[ i * 3 ] = Get_Sample( cColor.dRed );
+	vExpected[ i * 3 + 1 ] = Get_Sample( cColor.dGreen );
+	vExpected[ i * 3 + 2 ] = Get_Sample( cColor.dBlue );
+    }
+
+    for( size_t i = 0; i < iBytes; ++i )
+	if( vFirst[ i ] != vExpected[ i ] )
+	    ++iMismatches;
+
+    if( iMismatches == 0 )
+	return iThreadMismatches;
+
+    printf( "%-12s histogram            %d bytes differ from a serial equalization FAIL\n",
+	    sTest.sName.c_str(), iMismatches );
+
+    return iThreadMismatches + 1;
+}
+
+// Description: Checks distance shading on a case.  Tiles of iNO_FILL_TILE
+//              pixels are too small for any part of them to be filled in
+//              without being drawn, so the image drawn with them is the image
+//              drawn pixel by pixel, and the case's own tiles (which fill in
+//              the boxes that are far from the set) must give the same bytes.
+// Parameters: sTest - The case.
+// Return Value: Returns the number of failed checks.
+////////////////////////////////////////////////////////////////////////////////
+int Verify_Distance( const sCase &sTest )
+{
+    // Local Variables
+    const int iNO_FILL_TILE = 4;
+    const size_t iBytes = (size_t)( sTest.iWidth ) * sTest.iHeight * 3;
+    const sColorCode sColor = { { 1.0f, 1.0f, 1.0f }, false, false, false };
+    sRenderOptions sOptions = Get_Case_Options( sTest );
+    vector< unsigned char > vFilled( iBytes );
+    vector< unsigned char > vDrawn( iBytes );
+    sRaster sFilled = { &vFilled[ 0 ], (size_t)( sTest.iWidth ) * 3, 3 };
+    sRaster sDrawn = { &vDrawn[ 0 ], (size_t)( sTest.iWidth ) * 3, 3 };
+    int iMismatches = 0;
+
+    sOptions.eColoring = eCOLOR_DISTANCE;
+    Render_Raster( sTest.iWidth, sTest.iHeight, sTest.iMax_Iterations, sColor, sOptions, sFilled,
+		   NULL );
+
+    sOptions.iTileSize = iNO_FILL_TILE;
+    Render_Raster( sTest.iWidth, sTest.iHeight, sTest.iMax_Iterations, sColor, sOptions, sDrawn,
+		   NULL );
+
+    for( size_t i = 0; i < iBytes; i += 3 )
+	if( ( vFilled[ i ] != vDrawn[ i ] ) || ( vFilled[ i + 1 ] != vDrawn[ i + 1 ] ) ||
+	    ( vFilled[ i + 2 ] != vDrawn[ i + 2 ] ) )
+	    ++iMismatches;
+
+    if( iMismatches == 0 )
+	return 0;
+
+    printf( "%-12s distance             %d pixels differ from drawing every pixel FAIL\n",
+	    sTest.sName.c_str(), iMismatches );
+    printf( "             reproduce with --view=%.17g,%.17g,%.17g,%.17g --tile=%d --coloring=distance"
+	    " (%dx%d, %d iterations)\n",
+	    sTest.sView.dXMin, sTest.sView.dXMax, sTest.sView.dYMin, sTest.sView.dYMax,
+	    sTest.iTileSize, sTest.iWidth, sTest.iHeight, sTest.iMax_Iterations );
+
+    return 1;
+}
+
+// Description: Checks the embeddable renderer on a case.  The iterations it
+//              draws into a padded buffer on the pool (with the request's
+//              default kernel, the reference one) must match the program's
+//              field exactly, the RGBA image must hold the same colors as the
+//              RGB one with an opaque alpha, and neither may touch the
+//              padding past the end of each row.  A progressive
+//              render with no limit must come out the same as the RGB image,
+//              with every pixel marked as drawn, and a cancelled one must stop
+//              before drawing anything.  The tiles of a tile stream holding one
+//              tile at a time must cover every pixel once with the RGB
+//              image's colors, and closing a stream after its first tile must
+//              return (rather than leave the workers waiting).
+// Parameters: sTest - The case.
+//             pPool - The pool shared by every case.
+// Return Value: Returns the number of failed checks.
+////////////////////////////////////////////////////////////////////////////////
+int Verify_Renderer( const sCase &sTest, sMandelbrotPool *pPool )
+{
+    // Local Variables
+    const int iPADDING = 5;
+    const unsigned char cGUARD = 0xA5;
+    sMandelbrotRequest sRequest;
+    sRenderOptions sOptions = Get_Case_Options( sTest );
+    vector< int > vField;
+    vector< int > vIterations;
+    vector< unsigned char > vRGB;
+    vector< unsigned char > vRGBA;
+    vector< unsigned char > vProgressive;
+    vector< unsigned char > vCompleteness;
+    vector< unsigned char > vCovered;
+    sMandelbrotCancel *pCancel = NULL;
+    sMandelbrotTileStream *pStream = NULL;
+    sMandelbrotTile sTile;
+    int iCancelled = eMANDELBROT_OK;
+    int iStreamStatus = eMANDELBROT_OK;
+    size_t iIntStride = sTest.iWidth + iPADDING;
+    size_t iRGBStride = sTest.iWidth * 3 + iPADDING;
+    size_t iRGBAStride = sTest.iWidth * 4 + iPADDING;
+    int iMismatches = 0;
+    int iFailures = 0;
+
+    Mandelbrot_Init_Request( &sRequest, sTest.iWidth, sTest.iHeight );
+    sRequest.dXMin = sTest.sView.dXMin;
+    sRequest.dXMax = sTest.sView.dXMax;
+    sRequest.dYMin = sTest.sView.dYMin;
+    sRequest.dYMax = sTest.sView.dYMax;
+    sRequest.iMaxIterations = sTest.iMax_Iterations;
+    sRequest.iPower = sTest.sFormula.iPower;
+    sRequest.bBurningShip = ( sTest.sFormula.eType == eFORMULA_BURNING_SHIP );
+    sRequest.bJulia = sTest.sFormula.bJulia;
+    sRequest.dJuliaReal = sTest.sFormula.dJuliaReal;
+    sRequest.dJuliaImag = sTest.sFormula.dJuliaImag;
+    sRequest.iTileSize = sTest.iTileSize;
+    sRequest.iThreads = sTest.iThreads;
+    sRequest.iColoring = eMANDELBROT_SMOOTH;
+    sRequest.fRGBMask[ eGREEN ] = 0.5f;
+
+    sOptions.iThreads = 1;
+    sOptions.eKernel = eKERNEL_REFERENCE;
+    Render_Iterations( sTest.iWidth, sTest.iHeight, sTest.iMax_Iterations, sOptions, vField );
+
+    vIterations.assign( iIntStride * sTest.iHeight, -1 );
+    vRGB.assign( iRGBStride * sTest.iHeight, cGUARD );
+    vRGBA.assign( iRGBAStride * sTest.iHeight, cGUARD );
+    vProgressive.assign( iRGBStride * sTest.iHeight, cGUARD );
+    vCompleteness.assign( (size_t)( sTest.iWidth ) * sTest.iHeight, 0 );
+
+    if( ( Mandelbrot_Render_Iterations( &sRequest, pPool, &vIterations[ 0 ],
+					iIntStride * sizeof( int ) ) != eMANDELBROT_OK ) ||
+	( Mandelbrot_Render_Pixels( &sRequest, pPool, &vRGB[ 0 ], iRGBStride,
+				    eMANDELBROT_RGB8 ) != eMANDELBROT_OK ) ||
+	( Mandelbrot_Render_Pixels( &sRequest, pPool, &vRGBA[ 0 ], iRGBAStride,
+				    eMANDELBROT_RGBA8 ) != eMANDELBROT_OK ) ||
+	( Mandelbrot_Render_Progressive( &sRequest, pPool, &vProgressive[ 0 ], iRGBStride,
+					 eMANDELBROT_RGB8, 0.0, NULL,
+					 &vCompleteness[ 0 ] ) != eMANDELBROT_OK ) )
+    {
+	printf( "%-12s renderer call failed FAIL\n", sTest.sName.c_str() );
+	return 1;
+    }
+
+    for( int y = 0; y < sTest.iHeight; ++y )
+    {
+	for( int x = 0; x < sTest.iWidth; ++x )
+	{
+	    const unsigned char *pRGB = &vRGB[ y * iRGBStride + x * 3 ];
+	    const unsigned char *pRGBA = &vRGBA[ y * iRGBAStride + x * 4 ];
+
+	    if( ( vIterations[ y * iIntStride + x ] != vField[ (size_t)( y ) * sTest.iWidth + x ] ) ||
+		( memcmp( pRGB, pRGBA, 3 ) != 0 ) || ( pRGBA[ 3 ] != 255 ) ||
+		( memcmp( pRGB, &vProgressive[ y * iRGBStride + x * 3 ], 3 ) != 0 ) ||
+		( vCompleteness[ (size_t)( y ) * sTest.iWidth + x ] != 1 ) )
+		++iMismatches;
+	}
+
+	for( int i = 0; i < iPADDING; ++i )
+	    if( ( vIterations[ y * iIntStride + sTest.iWidth + i ] != -1 ) ||
+		( vRGB[ y * iRGBStride + sTest.iWidth * 3 + i ] != cGUARD ) ||
+		( vRGBA[ y * iRGBAStride + sTest.iWidth * 4 + i ] != cGUARD ) ||
+		( vProgressive[ y * iRGBStride + sTest.iWidth * 3 + i ] != cGUARD ) )
+		++iMismatches;
+    }
+
+    if( iMismatches > 0 )
+    {
+	printf( "%-12s renderer             %d pixels or padding bytes differ FAIL\n",
+		sTest.sName.c_str(), iMismatches );
+	++iFailures;
+    }
+
+    // A render cancelled before it starts leaves everything undrawn.
+    pCancel = Mandelbrot_Create_Cancel();
+    Mandelbrot_Cancel( pCancel );
+    iCancelled = Mandelbrot_Render_Progressive( &sRequest, pPool, &vProgressive[ 0 ], iRGBStride,
+						eMANDELBROT_RGB8, 0.0, pCancel, &vCompleteness[ 0 ] );
+    Mandelbrot_Destroy_Cancel( pCancel );
+
+    if( ( iCancelled != eMANDELBROT_PARTIAL ) ||
+	( count( vCompleteness.begin(), vCompleteness.end(), 0 ) != (long)( vCompleteness.size() ) ) )
+    {
+	printf( "%-12s renderer             cancelled render returned %d FAIL\n",
+		sTest.sName.c_str(), iCancelled );
+	++iFailures;
+    }
+
+    // Every tile streamed must match the RGB image, and every pixel must be in
+    // exactly one tile.
+    vCovered.assign( (size_t)( sTest.iWidth ) * sTest.iHeight, 0 );
+    iMismatches = 0;
+    pStream = Mandelbrot_Open_Tile_Stream( &sRequest, pPool, eMANDELBROT_RGB8, 1 );
+
+    while( Mandelbrot_Next_Tile( pStream, &sTile ) )
+	for( int y = 0; y < sTile.iHeight; ++y )
+	{
+	    if( memcmp( sTile.pPixels + y * sTile.iStride,
+			&vRGB[ ( sTile.iY + y ) * iRGBStride + sTile.iX * 3 ], sTile.iWidth * 3 ) != 0 )
+		++iMismatches;
+
+	    for( int x = 0; x < sTile.iWidth; ++x )
+		++vCovered[ (size_t)( sTile.iY + y ) * sTest.iWidth + sTile.iX + x ];
+	}
+
+    iStreamStatus = Mandelbrot_Close_Tile_Stream( pStream );
+
+    if( ( pStream == NULL ) || ( iStreamStatus != eMANDELBROT_OK ) || ( iMismatches > 0 ) ||
+	( count( vCovered.begin(), vCovered.end(), 1 ) != (long)( vCovered.size() ) ) )
+    {
+	printf( "%-12s renderer             tile stream returned %d, %d rows differ FAIL\n",
+		sTest.sName.c_str(), iStreamStatus, iMismatches );
+	++iFailures;
+    }
+
+    // A stream closed early stops its render.
+    pStream = Mandelbrot_Open_Tile_Stream( &sRequest, pPool, eMANDELBROT_RGBA8, 1 );
+    Mandelbrot_Next_Tile( pStream, &sTile );
+    iStreamStatus = Mandelbrot_Close_Tile_Stream( pStream );
+
+    if( iStreamStatus != eMANDELBROT_PARTIAL )
+    {
+	printf( "%-12s renderer             closed tile stream returned %d FAIL\n",
+		sTest.sName.c_str(), iStreamStatus );
+	++iFailures;
+    }
+
+    return iFailures;
+}
+
+// Description: Checks a Julia atlas of a formula.  The thumbnails whose c
+//              escapes the formula's own set must be left at weight 0, and
+//              every other one must hold the linear weights of the Julia set
+//              of its c drawn on its own over the thumbnail's square.  The
+//              image is sized so the last column and row of thumbnails are
+//              cut off.
+// Parameters: cpName - The name the check is reported under.
+//             sFormula - The formula.
+// Return Value: Returns the number of failed checks.
+////////////////////////////////////////////////////////////////////////////////
+int Verify_Atlas( const char *cpName, const sIterationFormula &sFormula )
+{
+    // Local Variables
+    const int iSIZE = 24;
+    const int iWIDTH = iSIZE * 9 - 5;
+    const int iHEIGHT = iSIZE * 7 - 11;
+    const int iMAX_ITERATIONS = 200;
+    const int iColumns = ( iWIDTH + iSIZE - 1 ) / iSIZE;
+    const int iRows = ( iHEIGHT + iSIZE - 1 ) / iSIZE;
+    sRenderOptions sOptions = Initiate_Render_Options();
+    sProgress sReport;
+    sRenderStats sStats;
+    vector< float > vWeights;
+    int iSkipped = 0;
+    int iMismatches = 0;
+
+    sOptions.sView = Get_Centered_Viewport( -0.6, 0.0, 3.2, iWIDTH, iHEIGHT );
+    sOptions.iThreads = 3;
+    sOptions.iTileSize = iSIZE;
+    sOptions.eKernel = eKERNEL_VECTOR;
+    sOptions.sFormula = sFormula;
+    sOptions.eProgress = ePROGRESS_NONE;
+    sOptions.iAtlasSize = iSIZE;
+    Render_Atlas( iWIDTH, iHEIGHT, iMAX_ITERATIONS, sOptions, vWeights, sReport, sStats );
+
+    for( int t = 0; t < iColumns * iRows; ++t )
+    {
+	// Local Variables
+	const int iX = t % iColumns * iSIZE;
+	const int iY = t / iColumns * iSIZE;
+	sRenderOptions sThumbnail = sOptions;
+	vector< int > vField;
+	double dCReal = 0.0;
+	double dCImag = 0.0;
+	int iEscape[ iKERNEL_LANES ];
+	double dLaneReal[ iKERNEL_LANES ];
+	double dLaneImag[ iKERNEL_LANES ];
+
+	Get_Atlas_Parameter( iWIDTH, iHEIGHT, sOptions, t, dCReal, dCImag );
+
+	for( int l = 0; l < iKERNEL_LANES; ++l )
+	{
+	    dLaneReal[ l ] = dCReal;
+	    dLaneImag[ l ] = dCImag;
+	}
+
+	Get_Escape_Lanes( sFormula, dLaneReal, dLaneImag, iMAX_ITERATIONS, iEscape );
+
+	sThumbnail.sView.dXMin = -dATLAS_RADIUS;
+	sThumbnail.sView.dXMax = dATLAS_RADIUS;
+	sThumbnail.sView.dYMin = -dATLAS_RADIUS;
+	sThumbnail.sView.dYMax = dATLAS_RADIUS;
+	sThumbnail.sFormula.bJulia = true;
+	sThumbnail.sFormula.dJuliaReal = dCReal;
+	sThumbnail.sFormula.dJuliaImag = dCImag;
+	sThumbnail.iAtlasSize = 0;
+
+	if( iEscape[ 0 ] < iMAX_ITERATIONS )
+	    ++iSkipped;
+	else
+	    Render_Iterations( iSIZE, iSIZE, iMAX_ITERATIONS, sThumbnail, vField );
+
+	for( int v = 0; ( v < iSIZE ) && ( iY + v < iHEIGHT ); ++v )
+	    for( int u = 0; ( u < iSIZE ) && ( iX + u < iWIDTH ); ++u )
+	    {
+		// Local Variables
+		const float fWeight = vWeights[ (size_t)( iY + v ) * iWIDTH + iX + u ];
+		float fExpected = 0.0f;
+
+		if( !vField.empty() )
+		    fExpected = ( vField[ v * iSIZE + u ] >= iMAX_ITERATIONS ) ? 1.0f :
+			(float)( vField[ v * iSIZE + u ] ) / (float)( iMAX_ITERATIONS );
+
+		if( fWeight != fExpected )
+		    ++iMismatches;
+	    }
+    }
+
+    // The view holds thumbnails both inside and outside the set.
+    if( ( iMismatches == 0 ) && ( iSkipped > 0 ) && ( iSkipped < iColumns * iRows ) )
+	return 0;
+
+    printf( "%-12s atlas                %d of %d thumbnails skipped, %d pixels differ FAIL\n",
+	    cpName, iSkipped, iColumns * iRows, iMismatches );
+
+    return 1;
+}
+
+// Description: Reads a whole file into memory.
+// Parameters: cpFileName - The file.
+//             vFile - Set to its bytes.
+// Return Value: Returns false if the file couldn't be opened.
+////////////////////////////////////////////////////////////////////////////////
+bool Read_File( const char *cpFileName, vector< unsigned char > &vFile )
+{
+    // Local Variables
+    unsigned char cBuffer[ 4096 ];
+    size_t iRead = 0;
+    FILE *pFile = fopen( cpFileName, "rb" );
+
+    vFile.clear();
+
+    if( pFile == NULL )
+	return false;
+
+    while( ( iRead = fread( cBuffer, 1, sizeof( cBuffer ), pFile ) ) > 0 )
+	vFile.insert( vFile.end(), cBuffer, cBuffer + iRead );
+
+    fclose( pFile );
+
+    return true;
+}
+
+// Description: Reads a 4 byte big endian number out of a PNG file.
+////////////////////////////////////////////////////////////////////////////////
+unsigned long Get_Big_Endian( const unsigned char cpIn[] )
+{
+    return ( (unsigned long)( cpIn[ 0 ] ) << 24 ) | ( (unsigned long)( cpIn[ 1 ] ) << 16 ) |
+	( (unsigned long)( cpIn[ 2 ] ) << 8 ) | (unsigned long)( cpIn[ 3 ] );
+}
+
+// Description: Reads the pixels back out of a PNG file, without going through
+//              the writer's code: the CRC of every chunk is checked, the IDAT
+//              chunks are joined and inflated in one go (which checks the
+//              Adler-32 of the whole stream), and the rows are unfiltered
+//              with any of the five PNG filters.
+// Parameters: cpFileName - The file.
+//             iWidth, iHeight - The size the image must have.
+//             iChannels - 3 for RGB or 1 for palette indices.
+//             vPixels - Set to the rows, with no filter bytes.
+// Return Value: Returns false if the file isn't a valid PNG of that kind.
+////////////////////////////////////////////////////////////////////////////////
+bool Read_Png( const char *cpFileName,
+	       const int iWidth,
+	       const int iHeight,
+	       const int iChannels,
+	       vector< unsigned char > &vPixels )
+{
+    // Local Variables
+    const unsigned char cSIGNATURE[] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+    const size_t iBytes = (size_t)( iWidth ) * iChannels;
+    vector< unsigned char > vFile;
+    vector< unsigned char > vData;
+    vector< unsigned char > vFiltered( ( iBytes + 1 ) * iHeight );
+    size_t iAt = sizeof( cSIGNATURE );
+    uLongf ulLength = (uLongf)( vFiltered.size() );
+    bool bHeader = false;
+    bool bEnd = false;
+
+    if( !Read_File( cpFileName, vFile ) )
+	return false;
+
+    if( ( vFile.size() < iAt ) || ( memcmp( &vFile[ 0 ], cSIGNATURE, iAt ) != 0 ) )
+	return false;
+
+    while( !bEnd && ( iAt + 12 <= vFile.size() ) )
+    {
+	// Local Variables
+	const unsigned char *cpChunk = &vFile[ iAt ];
+	const size_t iLength = Get_Big_Endian( cpChunk );
+
+	if( ( iAt + 12 + iLength > vFile.size() ) ||
+	    ( crc32( 0L, cpChunk + 4, (uInt)( iLength + 4 ) ) != Get_Big_Endian( cpChunk + 8 + iLength ) ) )
+	    return false;
+
+	if( memcmp( cpChunk + 4, "IHDR", 4 ) == 0 )
+	    bHeader = ( iLength == 13 ) && ( Get_Big_Endian( cpChunk + 8 ) == (unsigned long)( iWidth ) ) &&
+		( Get_Big_Endian( cpChunk + 12 ) == (unsigned long)( iHeight ) ) && ( cpChunk[ 16 ] == 8 ) &&
+		( cpChunk[ 17 ] == ( ( iChannels == 3 ) ? 2 : 3 ) );
+	else if( memcmp( cpChunk + 4, "IDAT", 4 ) == 0 )
+	    vData.insert( vData.end(), cpChunk + 8, cpChunk + 8 + iLength );
+	else if( memcmp( cpChunk + 4, "IEND", 4 ) == 0 )
+	    bEnd = true;
+
+	iAt += 12 + iLength;
+    }
+
+    if( !bHeader || !bEnd || vData.empty() ||
+	( uncompress( &vFiltered[ 0 ], &ulLength, &vData[ 0 ], (uLong)( vData.size() ) ) != Z_OK ) ||
+	( ulLength != vFiltered.size() ) )
+	return false;
+
+    vPixels.resize( iBytes * iHeight );
+
+    for( int y = 0; y < iHeight; ++y )
+    {
+	// Local Variables
+	const unsigned char *cpIn = &vFiltered[ (size_t)( y ) * ( iBytes + 1 ) ];
+	unsigned char *cpOut = &vPixels[ (size_t)( y ) * iBytes ];
+	const unsigned char *cpPrior = ( y > 0 ) ? cpOut - iBytes : NULL;
+
+	for( size_t i = 0; i < iBytes; ++i )
+	{
+	    // Local Variables
+	    const int iLeft = ( i >= (size_t)( iChannels ) ) ? cpOut[ i - iChannels ] : 0;
+	    const int iUp = ( cpPrior != NULL ) ? cpPrior[ i ] : 0;
+	    const int iCorner = ( ( cpPrior != NULL ) && ( i >= (size_t)( iChannels ) ) ) ?
+		cpPrior[ i - iChannels ] : 0;
+	    const int iGuess = iLeft + iUp - iCorner;
+	    int iPredicted = 0;
+
+	    if( cpIn[ 0 ] == 1 )
+		iPredicted = iLeft;
+	    else if( cpIn[ 0 ] == 2 )
+		iPredicted = iUp;
+	    else if( cpIn[ 0 ] == 3 )
+		iPredicted = ( iLeft + iUp ) / 2;
+	    else if( cpIn[ 0 ] == 4 )
+		iPredicted = ( ( abs( iGuess - iLeft ) <= abs( iGuess - iUp ) ) &&
+			       ( abs( iGuess - iLeft ) <= abs( iGuess - iCorner ) ) ) ? iLeft :
+		    ( abs( iGuess - iUp ) <= abs( iGuess - iCorner ) ) ? iUp : iCorner;
+	    else if( cpIn[ 0 ] != 0 )
+		return false;
+
+	    cpOut[ i ] = (unsigned char)( cpIn[ i + 1 ] + iPredicted );
+	}
+    }
+
+    return true;
+}
+
+// Description: Checks the PNG writer by reading its files back.  An image is
+//              written as RGB and as palette indices with several block sizes
+//              (down to a block per row, so nearly every block is primed with
+//              a dictionary and its checksums combined) on 1, 2 and 4
+//              threads, handed to the writer a few rows at a time, and each
+//              file must inflate to exactly the rows written.
+// Parameters: cpFileName - A scratch file to write (removed afterwards).
+// Return Value: Returns the number of failed checks.
+////////////////////////////////////////////////////////////////////////////////
+int Verify_Png( const char *cpFileName )
+{
+    // Local Variables
+    const int iBLOCK_ROWS[] = { 1, 5, 64, 0 };
+    const int iBLOCK_SIZES = sizeof( iBLOCK_ROWS ) / sizeof( int );
+    const int iTHREADS[] = { 1, 2, 4 };
+    const int iTHREAD_COUNTS = sizeof( iTHREADS ) / sizeof( int );
+    const int iBAND_ROWS = 9;
+    const sColorCode sColor = { { 1.0f, 1.0f, 1.0f }, false, false, false };
+    const sCase sTest = Make_Case( "png", -0.75, 0.0, 3.0, 203, 131, 300, 32, 2 );
+    const size_t iPixels = (size_t)( sTest.iWidth ) * sTest.iHeight;
+    sRenderOptions sOptions = Get_Case_Options( sTest );
+    vector< unsigned char > vRGB( iPixels * 3 );
+    vector< unsigned char > vIndices( iPixels );
+    vector< unsigned char > vPalette( iPNG_PALETTE_COLORS * 3 );
+    sRaster sTarget = { &vRGB[ 0 ], (size_t)( sTest.iWidth ) * 3, 3 };
+    int iFailures = 0;
+
+    Render_Raster( sTest.iWidth, sTest.iHeight, sTest.iMax_Iterations, sColor, sOptions, sTarget,
+		   NULL );
+
+    // The indexed image uses the reds as indices into a grey palette.
+    for( size_t i = 0; i < iPixels; ++i )
+	vIndices[ i ] = vRGB[ i * 3 ];
+
+    for( size_t i = 0; i < vPalette.size(); ++i )
+	vPalette[ i ] = (unsigned char)( i / 3 );
+
+    for( int iChannels = 3; iChannels > 0; iChannels -= 2 )
+	for( int b = 0; b < iBLOCK_SIZES; ++b )
+	    for( int t = 0; t < iTHREAD_COUNTS; ++t )
+	    {
+		// Local Variables
+		const vector< unsigned char > &vWritten = ( iChannels == 3 ) ? vRGB : vIndices;
+		const size_t iBytes = (size_t)( sTest.iWidth ) * iChannels;
+		sImageWriter sWriter;
+		vector< unsigned char > vRead;
+		bool bWritten = false;
+		bool bRead = false;
+
+		if( iChannels == 3 )
+		    bWritten = Open_Image_Writer( sWriter, cpFileName, eFORMAT_PNG, sTest.iWidth,
+						  sTest.iHeight, iTHREADS[ t ] );
+		else
+		    bWritten = Open_Indexed_Image_Writer( sWriter, cpFileName, sTest.iWidth,
+							  sTest.iHeight, iTHREADS[ t ], &vPalette[ 0 ],
+							  iPNG_PALETTE_COLORS );
+
+		// 0 keeps the writer's own block size.
+		if( iBLOCK_ROWS[ b ] > 0 )
+		{
+		    sWriter.iBlockRows = iBLOCK_ROWS[ b ];
+		    sWriter.iDictionaryRows = min( sWriter.iDictionaryRows, sWriter.iBlockRows );
+		}
+
+		for( int y = 0; bWritten && ( y < sTest.iHeight ); y += iBAND_ROWS )
+		    bWritten = Write_Image_Rows( sWriter, &vWritten[ (size_t)( y ) * iBytes ],
+						 min( iBAND_ROWS, sTest.iHeight - y ) );
+
+		bWritten = Close_Image_Writer( sWriter ) && bWritten;
+		bRead = bWritten && Read_Png( cpFileName, sTest.iWidth, sTest.iHeight, iChannels, vRead );
+
+		if( !bRead || ( vRead != vWritten ) )
+		{
+		    printf( "%-12s png                  %s, %d row blocks, %d threads: %s FAIL\n",
+			    sTest.sName.c_str(), ( iChannels == 3 ) ? "RGB" : "indexed",
+			    sWriter.iBlockRows, iTHREADS[ t ],
+			    !bWritten ? "not written" : ( !bRead ? "unreadable" : "pixels differ" ) );
+		    ++iFailures;
+		}
+	    }
+
+    remove( cpFileName );
+
+    return iFailures;
+}
+
+// Description: Checks the video writers by reading their files back.  Two
+//              frames (a render and a pattern running through every sample
+//              value) are handed to the writer in bands that straddle the
+//              frames, as YUV4MPEG2 and as raw RGB.  The Y4M file must hold
+//              its header and a FRAME marker before each frame, followed by
+//              the frame's Y, U and V planes, each sample within 1 of the
+//              BT.601 limited range conversion of its pixel done here in
+//              floating point (the writer works in 8 bit fixed point).  The
+//              raw file must hold exactly the bytes written.  A video closed
+//              half way through its last frame must be reported as not
+//              written.
+// Parameters: cpFileName - A scratch file to write (removed afterwards).
+// Return Value: Returns the number of failed checks.
+////////////////////////////////////////////////////////////////////////////////
+int Verify_Video( const char *cpFileName )
+{
+    // Local Variables
+    const int iFRAMES = 2;
+    const int iFRAME_RATE = 25;
+    const int iBAND_ROWS = 7;
+    const sColorCode sColor = { { 1.0f, 0.6f, 0.3f }, false, false, false };
+    const sCase sTest = Make_Case( "video", -0.75, 0.0, 3.0, 37, 23, 200, 16, 2 );
+    const size_t iPixels = (size_t)( sTest.iWidth ) * sTest.iHeight;
+    const size_t iRowBytes = (size_t)( sTest.iWidth ) * 3;
+    vector< unsigned char > vFrames( iPixels * 3 * iFRAMES );
+    vector< unsigned char > vFile;
+    sRaster sTarget = { &vFrames[ 0 ], iRowBytes, 3 };
+    char cHeader[ 128 ];
+    int iFailures = 0;
+
+    Render_Raster( sTest.iWidth, sTest.iHeight, sTest.iMax_Iterations, sColor,
+		   Get_Case_Options( sTest ), sTarget, NULL );
+
+    for( size_t i = 0; i < iPixels * 3; ++i )
+	vFrames[ iPixels * 3 + i ] = (unsigned char)( i * 7 + i / 3 );
+
+    snprintf( cHeader, sizeof( cHeader ),
+	      "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444 XCOLORRANGE=LIMITED\n", sTest.iWidth,
+	      sTest.iHeight, iFRAME_RATE );
+
+    for( int f = 0; f < 2; ++f )
+    {
+	// Local Variables
+	const eImageFormat eFormat = ( f == 0 ) ? eFORMAT_Y4M : eFORMAT_RGB;
+	const int iRows = sTest.iHeight * iFRAMES;
+	const size_t iExpected = ( f == 0 ) ?
+	    strlen( cHeader ) + ( strlen( "FRAME\n" ) + iPixels * 3 ) * iFRAMES : vFrames.size();
+	sImageWriter sWriter;
+	bool bWritten = Open_Image_Writer( sWriter, cpFileName, eFormat, sTest.iWidth,
+					   sTest.iHeight, 1, iFRAMES, iFRAME_RATE );
+	int iMismatches = 0;
+	size_t iAt = strlen( cHeader );
+
+	for( int y = 0; bWritten && ( y < iRows ); y += iBAND_ROWS )
+	    bWritten = Write_Image_Rows( sWriter, &vFrames[ (size_t)( y ) * iRowBytes ],
+					 min( iBAND_ROWS, iRows - y ) );
+
+	bWritten = Close_Image_Writer( sWriter ) && bWritten;
+
+	if( !bWritten || !Read_File( cpFileName, vFile ) || ( vFile.size() != iExpected ) )
+	{
+	    printf( "%-12s video                %s: %s FAIL\n", sTest.sName.c_str(),
+		    ( f == 0 ) ? "y4m" : "rgb", !bWritten ? "not written" : "wrong size" );
+	    ++iFailures;
+	    continue;
+	}
+
+	if( f == 1 )
+	{
+	    if( vFile != vFrames )
+	    {
+		printf( "%-12s video                rgb: bytes differ FAIL\n", sTest.sName.c_str() );
+		++iFailures;
+	    }
+
+	    continue;
+	}
+
+	if( memcmp( &vFile[ 0 ], cHeader, iAt ) != 0 )
+	    ++iMismatches;
+
+	for( int iFrame = 0; iFrame < iFRAMES; ++iFrame )
+	{
+	    // Local Variables
+	    const unsigned char *cpRGB = &vFrames[ iPixels * 3 * iFrame ];
+	    const unsigned char *cpY = NULL;
+
+	    if( memcmp( &vFile[ iAt ], "FRAME\n", 6 ) != 0 )
+		++iMismatches;
+
+	    cpY = &vFile[ iAt + 6 ];
+	    iAt += 6 + iPixels * 3;
+
+	    for( size_t i = 0; i < iPixels; ++i )
+	    {
+		// Local Variables
+		const double dR = cpRGB[ i * 3 ];
+		const double dG = cpRGB[ i * 3 + 1 ];
+		const double dB = cpRGB[ i * 3 + 2 ];
+		const double dY = 16.0 + ( 65.481 * dR + 128.553 * dG + 24.966 * dB ) / 255.0;
+		const double dU = 128.0 + ( -37.797 * dR - 74.203 * dG + 112.0 * dB ) / 255.0;
+		const double dV = 128.0 + ( 112.0 * dR - 93.786 * dG - 18.214 * dB ) / 255.0;
+
+		if( ( fabs( cpY[ i ] - dY ) > 1.0 ) || ( fabs( cpY[ iPixels + i ] - dU ) > 1.0 ) ||
+		    ( fabs( cpY[ iPixels * 2 + i ] - dV ) > 1.0 ) )
+		    ++iMismatches;
+	    }
+	}
+
+	if( iMismatches > 0 )
+	{
+	    printf( "%-12s video                y4m: %d samples or markers differ FAIL\n",
+		    sTest.sName.c_str(), iMismatches );
+	    ++iFailures;
+	}
+    }
+
+    // A frame and a half isn't a whole video.
+    {
+	// Local Variables
+	sImageWriter sWriter;
+	bool bWritten = Open_Image_Writer( sWriter, cpFileName, eFORMAT_Y4M, sTest.iWidth,
+					   sTest.iHeight, 1, iFRAMES, iFRAME_RATE ) &&
+	    Write_Image_Rows( sWriter, &vFrames[ 0 ], sTest.iHeight + sTest.iHeight / 2 );
+
+	if( Close_Image_Writer( sWriter ) && bWritten )
+	{
+	    printf( "%-12s video                y4m: a short video closed cleanly FAIL\n",
+		    sTest.sName.c_str() );
+	    ++iFailures;
+	}
+    }
+
+    remove( cpFileName );
+
+    return iFailures;
+}
+
+// Description: Checks the memory mapped output by drawing an image straight
+//              into a PPM and a PAM file through Create_Image, the way
+//              --mmap does, and reading them back.  Each file must be its
+//              header followed by exactly the bytes Render_Raster draws into
+//              memory, so the header length, the pixel offset and the tiles
+//              the workers write through the mapping are all checked.  The
+//              size doesn't divide into tiles, so the edge tiles are partial.
+// Parameters: cpBaseName - The scratch files' name, without the extension
+//                          (removed afterwards).
+// Return Value: Returns the number of failed checks.
+////////////////////////////////////////////////////////////////////////////////
+int Verify_Mapped( const char *cpBaseName )
+{
+    // Local Variables
+    const char *cpEXTENSIONS[] = { ".ppm", ".pam" };
+    const int iFORMATS = sizeof( cpEXTENSIONS ) / sizeof( const char * );
+    const sColorCode sColor = { { 1.0f, 0.6f, 0.3f }, false, false, false };
+    const sCase sTest = Make_Case( "mapped", -0.75, 0.0, 3.0, 157, 101, 250, 24, 3 );
+    sRenderOptions sOptions = Get_Case_Options( sTest );
+    vector< unsigned char > vRGB( (size_t)( sTest.iWidth ) * sTest.iHeight * 3 );
+    vector< unsigned char > vFile;
+    sRaster sTarget = { &vRGB[ 0 ], (size_t)( sTest.iWidth ) * 3, 3 };
+    char cHeader[ 128 ];
+    int iFailures = 0;
+
+    Render_Raster( sTest.iWidth, sTest.iHeight, sTest.iMax_Iterations, sColor, sOptions, sTarget,
+		   NULL );
+
+    sOptions.bMapped = true;
+
+    for( int f = 0; f < iFORMATS; ++f )
+    {
+	// Local Variables
+	string sName = string( cpBaseName ) + cpEXTENSIONS[ f ];
+	vector< char > vName( sName.begin(), sName.end() );
+	streambuf *pOutput = NULL;
+	size_t iHeaderLength = 0;
+
+	vName.push_back( '\0' );
+
+	if( f == 0 )
+	    snprintf( cHeader, sizeof( cHeader ), "P6\n%d %d\n255\n", sTest.iWidth,
+		      sTest.iHeight );
+	else
+	    snprintf( cHeader, sizeof( cHeader ),
+		      "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 3\nMAXVAL 255\nTUPLTYPE RGB\nENDHDR\n",
+		      sTest.iWidth, sTest.iHeight );
+
+	iHeaderLength = strlen( cHeader );
+
+	// Create_Image reports its completion on standard output; keep it out
+	// of ours.
+	pOutput = cout.rdbuf( NULL );
+	Create_Image( &vName[ 0 ], sTest.iWidth, sTest.iHeight, sTest.iMax_Iterations, sColor,
+		      sOptions );
+	cout.rdbuf( pOutput );
+	cout.clear();
+
+	if( !Read_File( sName.c_str(), vFile ) ||
+	    ( vFile.size() != iHeaderLength + vRGB.size() ) )
+	{
+	    printf( "%-12s mapped               %s: %s FAIL\n", sTest.sName.c_str(),
+		    cpEXTENSIONS[ f ] + 1, vFile.empty() ? "not written" : "wrong size" );
+	    ++iFailures;
+	}
+	else if( ( memcmp( &vFile[ 0 ], cHeader, iHeaderLength ) != 0 ) ||
+		 ( memcmp( &vFile[ iHeaderLength ], &vRGB[ 0 ], vRGB.size() ) != 0 ) )
+	{
+	    printf( "%-12s mapped               %s: bytes differ FAIL\n", sTest.sName.c_str(),
+		    cpEXTENSIONS[ f ] + 1 );
+	    ++iFailures;
+	}
+
+	remove( sName.c_str() );
+    }
+
+    return iFailures;
+}
+
+// Description: Checks that a Buddhabrot density doesn't depend on the thread
+//              count or on whether the workers share density buffers.  The
+//              buffers are shared by capping the memory they may take, to one
+//              buffer and to two.  Sample weights aren't whole numbers, so the
+//              order the workers add them in may change the last bits; every
+//              pixel must match the density drawn on one thread to within a
+//              relative dDENSITY_TOLERANCE.
+// Return Value: Returns the number of failed checks.
+////////////////////////////////////////////////////////////////////////////////
+int Verify_Buddhabrot()
+{
+    // Local Variables
+    const int iWIDTH = 160;
+    const int iHEIGHT = 120;
+    const int iMAX_ITERATIONS = 200;
+    const double dDENSITY_TOLERANCE = 1.0e-9;
+    const long long llBUFFER_BYTES = (long long)( iWIDTH ) * iHEIGHT * sizeof( double );
+    const int iRUNS = 4;
+    const int iTHREADS[ iRUNS ] = { 3, 7, 3, 7 };
+    const long long llMAX_BYTES[ iRUNS ] = { llMAX_DENSITY_BYTES, llMAX_DENSITY_BYTES, 1,
+					      llBUFFER_BYTES * 2 };
+    sCase sTest = Make_Case( "buddhabrot", -0.5, 0.0, 3.2, iWIDTH, iHEIGHT, iMAX_ITERATIONS,
+			     16, 1 );
+    sRenderOptions sOptions = Get_Case_Options( sTest );
+    vector< double > vExpected;
+    double dTotal = 0.0;
+    int iFailures = 0;
+
+    sOptions.llOrbitSamples = 200000;
+
+    {
+	// Local Variables
+	sProgress sReport;
+	sRenderStats sStats;
+
+	Render_Buddhabrot( iWIDTH, iHEIGHT, iMAX_ITERATIONS, sOptions, vExpected, sReport, sStats );
+    }
+
+    for( size_t i = 0; i < vExpected.size(); ++i )
+	dTotal += vExpected[ i ];
+
+    if( !( dTotal > 0.0 ) )
+    {
+	printf( "%-12s buddhabrot           empty density FAIL\n", sTest.sName.c_str() );
+	++iFailures;
+    }
+
+    for( int r = 0; r < iRUNS; ++r )
+    {
+	// Local Variables
+	sProgress sReport;
+	sRenderStats sStats;
+	vector< double > vDensity;
+	int iMismatches = 0;
+
+	sOptions.iThreads = iTHREADS[ r ];
+	Render_Buddhabrot( iWIDTH, iHEIGHT, iMAX_ITERATIONS, sOptions, vDensity, sReport, sStats,
+			   llMAX_BYTES[ r ] );
+
+	if( vDensity.size() != vExpected.size() )
+	    iMismatches = (int)( vExpected.size() );
+	else
+	    for( size_t i = 0; i < vDensity.size(); ++i )
+		if( fabs( vDensity[ i ] - vExpected[ i ] ) > dDENSITY_TOLERANCE * vExpected[ i ] )
+		    ++iMismatches;
+
+	if( iMismatches > 0 )
+	{
+	    printf( "%-12s buddhabrot           %d threads, %s buffers: %d pixels differ FAIL\n",
+		    sTest.sName.c_str(), iTHREADS[ r ],
+		    ( llMAX_BYTES[ r ] < llBUFFER_BYTES * iTHREADS[ r ] ) ? "shared" : "own",
+		    iMismatches );
+	    ++iFailures;
+	}
+    }
+
+    return iFailures;
+}
+
+// Description: Checks that a tuning profile reads back as it was written, that
+//              one without a kernel leaves the kernel alone, and that a
+//              missing file or one cut short isn't taken as a profile.
+// Parameters: cpFileName - A scratch file to write (removed afterwards).
+// Return Value: Returns the number of failed checks.
+////////////////////////////////////////////////////////////////////////////////
+int Verify_Profile( const char *cpFileName )
+{
+    // Local Variables
+    sTuningProfile sWritten;
+    sTuningProfile sRead;
+    sRenderOptions sOptions = Initiate_Render_Options();
+    bool bRoundTrip = false;
+    bool bNoKernel = false;
+    bool bTruncated = true;
+    bool bMissing = true;
+    FILE *pFile = NULL;
+
+    sWritten.eKernel = eKERNEL_SCALAR;
+    sWritten.bKernel = true;
+    sWritten.iTileSize = 48;
+    sWritten.iThreads = 3;
+    sWritten.iHardwareThreads = 7;
+
+    bRoundTrip = Save_Tuning_Profile( cpFileName, sWritten ) &&
+	Load_Tuning_Profile( cpFileName, sRead ) && sRead.bKernel &&
+	( sRead.eKernel == sWritten.eKernel ) && ( sRead.iTileSize == sWritten.iTileSize ) &&
+	( sRead.iThreads == sWritten.iThreads ) &&
+	( sRead.iHardwareThreads == sWritten.iHardwareThreads );
+
+    // Without a kernel, applying it only changes the tile size and threads.
+    sWritten.bKernel = false;
+
+    if( Save_Tuning_Profile( cpFileName, sWritten ) && Load_Tuning_Profile( cpFileName, sRead ) &&
+	!sRead.bKernel )
+    {
+	Apply_Tuning_Profile( sRead, sOptions );
+	bNoKernel = ( sOptions.eKernel == eKERNEL_REFERENCE ) && ( sOptions.iTileSize == 48 ) &&
+	    ( sOptions.iThreads == 3 );
+    }
+
+    pFile = fopen( cpFileName, "w" );
+
+    if( pFile != NULL )
+    {
+	fputs( "hardware_threads=7\nkernel=vector\n", pFile );
+	fclose( pFile );
+	bTruncated = Load_Tuning_Profile( cpFileName, sRead );
+    }
+
+    remove( cpFileName );
+    bMissing = Load_Tuning_Profile( cpFileName, sRead );
+
+    if( bRoundTrip && bNoKernel && !bTruncated && !bMissing )
+	return 0;
+
+    printf( "%-12s profile              round trip %s, no kernel %s, truncated %s, missing %s FAIL\n",
+	    "tune", bRoundTrip ? "ok" : "differs", bNoKernel ? "ok" : "differs",
+	    bTruncated ? "accepted" : "rejected", bMissing ? "accepted" : "rejected" );
+
+    return 1;
+}
+
+// Description: Checks the corpus and any random cases, then prints the worst
+//              result seen for each mode.  Exits with 1 if any check failed.
+////////////////////////////////////////////////////////////////////////////////
+int main( int argc, char *argv[] )
+{
+    // Local Variables
+    vector< sCase > vCases = Build_Corpus();
+    const size_t iCORPUS_SIZE = vCases.size();
+    vector< sResult > vWorst( iMODE_COUNT );
+    int iFuzz = 0;
+    unsigned int uSeed = 1;
+    bool bVerbose = false;
+    int iFailures = 0;
+    sMandelbrotPool *pPool = NULL;
+
+    for( int i = 1; i < argc; ++i )
+    {
+	if( strncmp( argv[ i ], "--fuzz=", 7 ) == 0 )
+	    iFuzz = atoi( argv[ i ] + 7 );
+	else if( strncmp( argv[ i ], "--seed=", 7 ) == 0 )
+	    uSeed = (unsigned int)( strtoul( argv[ i ] + 7, NULL, 10 ) );
+	else if( strcmp( argv[ i ], "--verbose" ) == 0 )
+	    bVerbose = true;
+	else
+	{
+	    fprintf( stderr, "Usage: %s [--fuzz=N] [--seed=N] [--verbose]\n", argv[ 0 ] );
+	    return 2;
+	}
+    }
+
+    mt19937 mtRandom( uSeed );
+
+    for( int i = 0; i < iFuzz; ++i )
+	vCases.push_back( Build_Random_Case( mtRandom, i ) );
+
+    for( int m = 0; m < iMODE_COUNT; ++m )
+    {
+	vWorst[ m ].dMismatch = 0.0;
+	vWorst[ m ].dMeanDelta = 0.0;
+	vWorst[ m ].iMaxDelta = 0;
+    }
+
+    for( size_t c = 0; c < vCases.size(); ++c )
+    {
+	iFailures += Verify_Case( vCases[ c ], bVerbose, vWorst );
+	iFailures += Verify_Histogram( vCases[ c ] );
+	iFailures += Verify_Distance( vCases[ c ] );
+    }
+
+    // A Julia set of dust whose distance estimates overshoot near its
+    // boundary, and a connected one whose far boxes are filled in.
+    {
+	// Local Variables
+	sCase sJulia = Make_Case( "julia-dust", 0.0, 0.0, 3.2, 800, 600, 1000, 64, 0 );
+	sCase sRabbit = Make_Case( "julia-rabbit", 0.0, 0.0, 3.2, 400, 300, 1000, 64, 0 );
+
+	sJulia.sFormula.bJulia = true;
+	sJulia.sFormula.dJuliaReal = -0.75;
+	sJulia.sFormula.dJuliaImag = 0.11;
+	iFailures += Verify_Distance( sJulia );
+
+	sRabbit.sFormula.bJulia = true;
+	sRabbit.sFormula.dJuliaReal = -0.122561;
+	sRabbit.sFormula.dJuliaImag = 0.744862;
+	iFailures += Verify_Distance( sRabbit );
+    }
+
+    // The renderer is checked on the fixed corpus, all on one pool.
+    pPool = Mandelbrot_Create_Pool( 3 );
+
+    for( size_t c = 0; c < iCORPUS_SIZE; ++c )
+	iFailures += Verify_Renderer( vCases[ c ], pPool );
+
+    Mandelbrot_Destroy_Pool( pPool );
+
+    // The atlas is checked for the classic set and a formula that isn't
+    // symmetric.
+    {
+	// Local Variables
+	sIterationFormula sShip = Initiate_Formula();
+
+	sShip.eType = eFORMULA_BURNING_SHIP;
+	iFailures += Verify_Atlas( "atlas", Initiate_Formula() );
+	iFailures += Verify_Atlas( "atlas-ship", sShip );
+    }
+
+    iFailures += Verify_Buddhabrot();
+    iFailures += Verify_Png( "Verify.png" );
+    iFailures += Verify_Video( "Verify.y4m" );
+    iFailures += Verify_Mapped( "Verify" );
+    iFailures += Verify_Profile( "Verify.profile" );
+
+    printf( "\n%-20s %12s %12s %10s %10s\n", "mode", "worst differ", "allowed", "mean delta",
+	    "max delta" );
+
+    for( int m = 1; m < iMODE_COUNT; ++m )
+	printf( "%-20s %11.4f%% %11.4f%% %10.4f %10d\n", sMODES[ m ].cpName,
+		vWorst[ m ].dMismatch * 100.0, sMODES[ m ].dMaxMismatch * 100.0,
+		vWorst[ m ].dMeanDelta, vWorst[ m ].iMaxDelta );
+
+    printf( "\n%d cases (%d random, seed %u): %d failed checks\n", (int)( vCases.size() ), iFuzz,
+	    uSeed, iFailures );
+
+    return ( iFailures > 0 ) ? 1 : 0;
+}